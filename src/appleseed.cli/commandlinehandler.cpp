@@ -85,6 +85,12 @@ CommandLineHandler::CommandLineHandler()
     m_threads.set_exact_value_count(1);
     parser().add_option_handler(&m_threads);
 
+    m_thread_affinity.add_name("--thread-affinity");
+    m_thread_affinity.set_description("bind rendering threads to cpu cores or numa nodes");
+    m_thread_affinity.set_syntax("none|cores|numa_nodes");
+    m_thread_affinity.set_exact_value_count(1);
+    parser().add_option_handler(&m_thread_affinity);
+
     m_output.add_name("--output");
     m_output.add_name("-o");
     m_output.set_description("set the name of the output file");
@@ -162,6 +168,10 @@ CommandLineHandler::CommandLineHandler()
     m_dump_input_metadata.add_name("--dump-input-metadata");
     m_dump_input_metadata.set_description("dump the input metadata of all known entities to stderr (as xml)");
     parser().add_option_handler(&m_dump_input_metadata);
+
+    m_print_numa_topology.add_name("--print-numa-topology");
+    m_print_numa_topology.set_description("print the numa nodes and their cpu cores");
+    parser().add_option_handler(&m_print_numa_topology);
 }
 
 void CommandLineHandler::print_program_usage(
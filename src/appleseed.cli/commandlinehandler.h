@@ -66,6 +66,7 @@ class CommandLineHandler
 
     // Aliases for rendering options.
     foundation::ValueOptionHandler<int>             m_threads;
+    foundation::ValueOptionHandler<std::string>     m_thread_affinity;
     foundation::ValueOptionHandler<std::string>     m_output;
     foundation::FlagOptionHandler                   m_continuous_saving;
     foundation::ValueOptionHandler<int>             m_resolution;
@@ -84,6 +85,7 @@ class CommandLineHandler
     foundation::FlagOptionHandler                   m_verbose_unit_tests;
     foundation::FlagOptionHandler                   m_benchmark_mode;
     foundation::FlagOptionHandler                   m_dump_input_metadata;
+    foundation::FlagOptionHandler                   m_print_numa_topology;
 
     // Constructor.
     CommandLineHandler();
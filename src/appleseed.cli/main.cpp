@@ -57,6 +57,7 @@
 // appleseed.foundation headers.
 #include "foundation/core/appleseed.h"
 #include "foundation/platform/path.h"
+#include "foundation/platform/system.h"
 #include "foundation/platform/thread.h"
 #include "foundation/platform/timer.h"
 #include "foundation/utility/autoreleaseptr.h"
@@ -511,6 +512,14 @@ namespace
                 g_cl.m_threads.value());
         }
 
+        // Apply --thread-affinity option.
+        if (g_cl.m_thread_affinity.is_set())
+        {
+            params.insert_path(
+                "thread_affinity",
+                g_cl.m_thread_affinity.value());
+        }
+
         // Apply --resolution option.
         apply_resolution_command_line_option(project);
 
@@ -822,6 +831,10 @@ int main(int argc, const char* argv[])
     // Configure the renderer's global logger.
     configure_renderer_logger();
 
+    // Print the NUMA topology.
+    if (g_cl.m_print_numa_topology.is_set())
+        System::print_numa_topology(g_logger);
+
     bool success = true;
 
     // Run unit tests.
@@ -0,0 +1,263 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_ALIASTABLE_H
+#define APPLESEED_FOUNDATION_MATH_ALIASTABLE_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace foundation
+{
+
+//
+// Alias table, for sampling a discrete distribution in constant time.
+//
+// AliasTable has the same interface as CDF and can be used in its place wherever the
+// distribution is sampled more often than it is built. Note however that, unlike CDF,
+// sample() is not monotonic in its argument: stratification of the input samples is
+// not carried over to the chosen items. Keep using CDF when several stratified samples
+// are drawn from the distribution for the same estimate, for instance when taking
+// multiple light samples at a shading point or when sampling an environment map.
+//
+// Reference:
+//
+//   A Linear Algorithm For Generating Random Numbers With a Given Distribution
+//   Michael D. Vose
+//   IEEE Transactions on Software Engineering, Volume 17, Issue 9, September 1991
+//
+
+template <typename Item, typename Weight>
+class AliasTable
+  : public NonCopyable
+{
+  public:
+    typedef std::pair<Item, Weight> ItemWeightPair;
+
+    // Constructor.
+    AliasTable();
+
+    // Return true if the table is empty.
+    bool empty() const;
+
+    // Return true if the table has at least one item with a positive weight.
+    bool valid() const;
+
+    // Return the sum of the weight of all inserted items.
+    Weight weight() const;
+
+    // Remove all items from the table.
+    void clear();
+
+    // Allocate memory for a given number of items.
+    void reserve(const size_t count);
+
+    // Insert an item with a given non-negative weight.
+    void insert(const Item& item, const Weight weight);
+
+    // Access the i'th item.
+    const ItemWeightPair& operator[](const size_t i) const;
+
+    // Prepare the table for sampling.
+    // This method must be called once and only once before sample() is called.
+    void prepare();
+
+    // Sample the table. x is in [0,1).
+    ItemWeightPair sample(const Weight x) const;
+
+  private:
+    struct Entry
+    {
+        Weight      m_threshold;    // probability of keeping this entry's own item
+        size_t      m_alias;        // index of the item chosen otherwise
+    };
+
+    typedef std::vector<ItemWeightPair> ItemVector;
+    typedef std::vector<Entry> EntryVector;
+
+    ItemVector      m_items;
+    Weight          m_weight_sum;
+    EntryVector     m_entries;
+};
+
+
+//
+// AliasTable class implementation.
+//
+
+template <typename Item, typename Weight>
+inline AliasTable<Item, Weight>::AliasTable()
+  : m_weight_sum(0.0)
+{
+}
+
+template <typename Item, typename Weight>
+inline bool AliasTable<Item, Weight>::empty() const
+{
+    return m_items.empty();
+}
+
+template <typename Item, typename Weight>
+inline bool AliasTable<Item, Weight>::valid() const
+{
+    return m_weight_sum > Weight(0.0);
+}
+
+template <typename Item, typename Weight>
+inline Weight AliasTable<Item, Weight>::weight() const
+{
+    return m_weight_sum;
+}
+
+template <typename Item, typename Weight>
+inline void AliasTable<Item, Weight>::clear()
+{
+    m_items.clear();
+    m_entries.clear();
+
+    m_weight_sum = Weight(0.0);
+}
+
+template <typename Item, typename Weight>
+inline void AliasTable<Item, Weight>::reserve(const size_t count)
+{
+    m_items.reserve(count);
+}
+
+template <typename Item, typename Weight>
+inline void AliasTable<Item, Weight>::insert(const Item& item, const Weight weight)
+{
+    assert(weight >= Weight(0.0));
+
+    m_items.push_back(std::make_pair(item, weight));
+
+    m_weight_sum += weight;
+}
+
+template <typename Item, typename Weight>
+inline const std::pair<Item, Weight>& AliasTable<Item, Weight>::operator[](const size_t i) const
+{
+    assert(i < m_items.size());
+
+    return m_items[i];
+}
+
+template <typename Item, typename Weight>
+void AliasTable<Item, Weight>::prepare()
+{
+    assert(valid());
+
+    const size_t item_count = m_items.size();
+
+    // Normalize weights so that they add up to 1.0.
+    const Weight rcp_weight_sum = Weight(1.0) / m_weight_sum;
+    for (size_t i = 0; i < item_count; ++i)
+        m_items[i].second *= rcp_weight_sum;
+
+    // Scale the probabilities so that they average to 1.0, and split
+    // the items into those below and those above the average.
+    std::vector<Weight> scaled(item_count);
+    std::vector<size_t> small, large;
+    small.reserve(item_count);
+    large.reserve(item_count);
+
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        scaled[i] = m_items[i].second * static_cast<Weight>(item_count);
+
+        if (scaled[i] < Weight(1.0))
+            small.push_back(i);
+        else large.push_back(i);
+    }
+
+    // Fill each entry of a small item with the excess of a large item.
+    m_entries.resize(item_count);
+
+    while (!small.empty() && !large.empty())
+    {
+        const size_t s = small.back();
+        const size_t l = large.back();
+        small.pop_back();
+
+        m_entries[s].m_threshold = scaled[s];
+        m_entries[s].m_alias = l;
+
+        scaled[l] = (scaled[l] + scaled[s]) - Weight(1.0);
+
+        if (scaled[l] < Weight(1.0))
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // The remaining items are (up to rounding errors) exactly at the average.
+    for (size_t i = 0; i < large.size(); ++i)
+    {
+        m_entries[large[i]].m_threshold = Weight(1.0);
+        m_entries[large[i]].m_alias = large[i];
+    }
+
+    for (size_t i = 0; i < small.size(); ++i)
+    {
+        m_entries[small[i]].m_threshold = Weight(1.0);
+        m_entries[small[i]].m_alias = small[i];
+    }
+}
+
+template <typename Item, typename Weight>
+inline std::pair<Item, Weight> AliasTable<Item, Weight>::sample(const Weight x) const
+{
+    assert(!m_entries.empty());     // implies valid() == true
+    assert(x >= Weight(0.0));
+    assert(x < Weight(1.0));
+
+    // Use the integer part of the scaled input to choose an entry,
+    // and its fractional part to choose between the entry's item and its alias.
+    const size_t entry_count = m_entries.size();
+    const Weight u = x * static_cast<Weight>(entry_count);
+    size_t i = static_cast<size_t>(u);
+    if (i >= entry_count)
+        i = entry_count - 1;
+
+    const Entry& entry = m_entries[i];
+    const Weight v = u - static_cast<Weight>(i);
+
+    return m_items[v < entry.m_threshold ? i : entry.m_alias];
+}
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_ALIASTABLE_H
@@ -0,0 +1,379 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_BINNEDSAHPARTITIONER_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_BINNEDSAHPARTITIONER_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace foundation {
+namespace bvh {
+
+//
+// A BVH partitioner based on the Surface Area Heuristic (SAH), evaluated over a fixed
+// number of bins instead of every item boundary.
+//
+// Items are binned according to the center of their bounding box, along each dimension.
+// Partitioning a set of n items costs O(n) and no sorting is involved at any point,
+// making construction much faster than with SAHPartitioner at the cost of slightly
+// lower tree quality.
+//
+// partition() and compute_bbox() may be called concurrently on disjoint sets of items.
+//
+
+template <typename AABBVector>
+class BinnedSAHPartitioner
+  : public NonCopyable
+{
+  public:
+    typedef AABBVector AABBVectorType;
+    typedef typename AABBVectorType::value_type AABBType;
+    typedef typename AABBType::ValueType ValueType;
+
+    // Maximum number of bins.
+    static const size_t MaxBinCount = 256;
+
+    // Constructor.
+    BinnedSAHPartitioner(
+        const AABBVectorType&   bboxes,
+        const size_t            max_leaf_size = 1,
+        const size_t            bin_count = 32,
+        const ValueType         interior_node_traversal_cost = ValueType(1.0),
+        const ValueType         item_intersection_cost = ValueType(1.0));
+
+    // Compute the bounding box of a given set of items.
+    AABBType compute_bbox(
+        const size_t            begin,
+        const size_t            end) const;
+
+    // Partition a set of items into two distinct sets.
+    size_t partition(
+        const size_t            begin,
+        const size_t            end,
+        const AABBType&         bbox);
+
+    // Return the items ordering.
+    const std::vector<size_t>& get_item_ordering() const;
+
+  private:
+    static const size_t Dimension = AABBType::Dimension;
+
+    struct Bin
+    {
+        AABBType    m_bbox;
+        size_t      m_count;
+    };
+
+    // Predicate selecting the items that belong to the left side of a split.
+    class IsLeft
+    {
+      public:
+        IsLeft(
+            const AABBVectorType&   bboxes,
+            const size_t            dimension,
+            const ValueType         origin,
+            const ValueType         scale,
+            const size_t            bin_count,
+            const size_t            split_bin)
+          : m_bboxes(bboxes)
+          , m_dimension(dimension)
+          , m_origin(origin)
+          , m_scale(scale)
+          , m_bin_count(bin_count)
+          , m_split_bin(split_bin)
+        {
+        }
+
+        bool operator()(const size_t index) const
+        {
+            const ValueType center = centroid(m_bboxes[index], m_dimension);
+            return bin_index(center, m_origin, m_scale, m_bin_count) < m_split_bin;
+        }
+
+      private:
+        const AABBVectorType&   m_bboxes;
+        const size_t            m_dimension;
+        const ValueType         m_origin;
+        const ValueType         m_scale;
+        const size_t            m_bin_count;
+        const size_t            m_split_bin;
+    };
+
+    const AABBVectorType&       m_bboxes;
+    const size_t                m_max_leaf_size;
+    const size_t                m_bin_count;
+    const ValueType             m_interior_node_traversal_cost;
+    const ValueType             m_item_intersection_cost;
+    std::vector<size_t>         m_indices;
+
+    // Return twice the center of a bounding box along a given dimension.
+    static ValueType centroid(
+        const AABBType&         bbox,
+        const size_t            dimension);
+
+    // Return the bin into which falls a given centroid.
+    static size_t bin_index(
+        const ValueType         centroid,
+        const ValueType         origin,
+        const ValueType         scale,
+        const size_t            bin_count);
+};
+
+
+//
+// BinnedSAHPartitioner class implementation.
+//
+
+template <typename AABBVector>
+const size_t BinnedSAHPartitioner<AABBVector>::MaxBinCount;
+
+template <typename AABBVector>
+BinnedSAHPartitioner<AABBVector>::BinnedSAHPartitioner(
+    const AABBVectorType&       bboxes,
+    const size_t                max_leaf_size,
+    const size_t                bin_count,
+    const ValueType             interior_node_traversal_cost,
+    const ValueType             item_intersection_cost)
+  : m_bboxes(bboxes)
+  , m_max_leaf_size(max_leaf_size)
+  , m_bin_count(std::min<size_t>(std::max<size_t>(bin_count, 2), MaxBinCount))
+  , m_interior_node_traversal_cost(interior_node_traversal_cost)
+  , m_item_intersection_cost(item_intersection_cost)
+{
+    const size_t size = m_bboxes.size();
+
+    // Identity ordering.
+    m_indices.resize(size);
+    for (size_t i = 0; i < size; ++i)
+        m_indices[i] = i;
+}
+
+template <typename AABBVector>
+typename AABBVector::value_type BinnedSAHPartitioner<AABBVector>::compute_bbox(
+    const size_t                begin,
+    const size_t                end) const
+{
+    AABBType bbox;
+    bbox.invalidate();
+
+    for (size_t i = begin; i < end; ++i)
+        bbox.insert(m_bboxes[m_indices[i]]);
+
+    return bbox;
+}
+
+template <typename AABBVector>
+size_t BinnedSAHPartitioner<AABBVector>::partition(
+    const size_t                begin,
+    const size_t                end,
+    const AABBType&             bbox)
+{
+    // Don't split leaves containing only degenerate triangles.
+    if (bbox.rank() < Dimension - 1)
+        return end;
+
+    const size_t count = end - begin;
+    assert(count > 1);
+
+    // Don't split leaves containing less than a predefined number of items.
+    if (count <= m_max_leaf_size)
+        return end;
+
+    // Compute the bounds of the item centroids.
+    ValueType centroid_min[Dimension];
+    ValueType centroid_max[Dimension];
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        centroid_min[d] = +std::numeric_limits<ValueType>::max();
+        centroid_max[d] = -std::numeric_limits<ValueType>::max();
+    }
+    for (size_t i = begin; i < end; ++i)
+    {
+        const AABBType& item_bbox = m_bboxes[m_indices[i]];
+
+        for (size_t d = 0; d < Dimension; ++d)
+        {
+            const ValueType c = centroid(item_bbox, d);
+            centroid_min[d] = std::min(centroid_min[d], c);
+            centroid_max[d] = std::max(centroid_max[d], c);
+        }
+    }
+
+    // Small sets of items don't need more bins than items.
+    const size_t bin_count = std::min(m_bin_count, count);
+
+    // Bin the items along each dimension.
+    Bin bins[Dimension][MaxBinCount];
+    ValueType scales[Dimension];
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        const ValueType extent = centroid_max[d] - centroid_min[d];
+        scales[d] = extent > ValueType(0.0) ? ValueType(bin_count) / extent : ValueType(0.0);
+
+        for (size_t b = 0; b < bin_count; ++b)
+        {
+            bins[d][b].m_bbox.invalidate();
+            bins[d][b].m_count = 0;
+        }
+    }
+    for (size_t i = begin; i < end; ++i)
+    {
+        const AABBType& item_bbox = m_bboxes[m_indices[i]];
+
+        for (size_t d = 0; d < Dimension; ++d)
+        {
+            Bin& bin = bins[d][bin_index(centroid(item_bbox, d), centroid_min[d], scales[d], bin_count)];
+            bin.m_bbox.insert(item_bbox);
+            ++bin.m_count;
+        }
+    }
+
+    ValueType best_split_cost = std::numeric_limits<ValueType>::max();
+    size_t best_split_dim = 0;
+    size_t best_split_bin = 0;
+
+    ValueType left_areas[MaxBinCount];
+
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        // All centroids coincide along this dimension.
+        if (scales[d] == ValueType(0.0))
+            continue;
+
+        const Bin* dim_bins = bins[d];
+
+        AABBType bbox_accumulator;
+
+        // Left-to-right sweep to accumulate bounding boxes and compute their surface area.
+        bbox_accumulator.invalidate();
+        for (size_t b = 0; b < bin_count - 1; ++b)
+        {
+            bbox_accumulator.insert(dim_bins[b].m_bbox);
+            left_areas[b] = bbox_accumulator.is_valid() ? half_surface_area(bbox_accumulator) : ValueType(0.0);
+        }
+
+        // Right-to-left sweep to accumulate bounding boxes, compute their surface area and find the best partition.
+        bbox_accumulator.invalidate();
+        size_t right_count = 0;
+        for (size_t b = bin_count - 1; b > 0; --b)
+        {
+            // Compute right bounding box.
+            bbox_accumulator.insert(dim_bins[b].m_bbox);
+            right_count += dim_bins[b].m_count;
+
+            // Only consider partitions leaving items on both sides.
+            const size_t left_count = count - right_count;
+            if (left_count == 0 || right_count == 0)
+                continue;
+
+            // Compute the cost of this partition.
+            const ValueType left_cost = left_areas[b - 1] * left_count;
+            const ValueType right_cost = half_surface_area(bbox_accumulator) * right_count;
+            const ValueType split_cost = left_cost + right_cost;
+
+            // Keep track of the partition with the lowest cost.
+            if (best_split_cost > split_cost)
+            {
+                best_split_cost = split_cost;
+                best_split_dim = d;
+                best_split_bin = b;
+            }
+        }
+    }
+
+    // Don't split if all items fall into the same bin.
+    if (best_split_bin == 0)
+        return end;
+
+    // Don't split if it's cheaper to make a leaf.
+    const ValueType split_cost =
+        m_interior_node_traversal_cost +
+        best_split_cost / half_surface_area(bbox) * m_item_intersection_cost;
+    const ValueType leaf_cost = count * m_item_intersection_cost;
+    if (leaf_cost <= split_cost)
+        return end;
+
+    // Move the items of the left side to the beginning of the range.
+    const std::vector<size_t>::iterator pivot_it =
+        std::partition(
+            m_indices.begin() + begin,
+            m_indices.begin() + end,
+            IsLeft(
+                m_bboxes,
+                best_split_dim,
+                centroid_min[best_split_dim],
+                scales[best_split_dim],
+                bin_count,
+                best_split_bin));
+
+    const size_t pivot = pivot_it - m_indices.begin();
+    assert(pivot > begin);
+    assert(pivot < end);
+
+    return pivot;
+}
+
+template <typename AABBVector>
+inline const std::vector<size_t>& BinnedSAHPartitioner<AABBVector>::get_item_ordering() const
+{
+    return m_indices;
+}
+
+template <typename AABBVector>
+inline typename BinnedSAHPartitioner<AABBVector>::ValueType BinnedSAHPartitioner<AABBVector>::centroid(
+    const AABBType&             bbox,
+    const size_t                dimension)
+{
+    return bbox.min[dimension] + bbox.max[dimension];
+}
+
+template <typename AABBVector>
+inline size_t BinnedSAHPartitioner<AABBVector>::bin_index(
+    const ValueType             centroid,
+    const ValueType             origin,
+    const ValueType             scale,
+    const size_t                bin_count)
+{
+    const size_t index = static_cast<size_t>((centroid - origin) * scale);
+    return std::min(index, bin_count - 1);
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_BINNEDSAHPARTITIONER_H
@@ -98,6 +98,9 @@ class APPLESEED_ALIGN(64) Node
     template <typename Tree, typename Visitor, typename Ray, size_t StackSize, size_t N>
     friend class Intersector;
 
+    template <typename T, typename Ray, size_t N>
+    friend class NodeRayTester;
+
     typedef typename AABBType::ValueType ValueType;
     static const size_t Dimension = AABBType::Dimension;
 
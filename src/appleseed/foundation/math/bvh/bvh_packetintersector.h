@@ -0,0 +1,557 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_PACKETINTERSECTOR_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_PACKETINTERSECTOR_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/bvh/bvh_intersector.h"
+#include "foundation/math/bvh/bvh_node.h"
+#include "foundation/math/bvh/bvh_statistics.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/intersection.h"
+#include "foundation/math/ray.h"
+#include "foundation/platform/compiler.h"
+#ifdef APPLESEED_USE_SSE
+#include "foundation/platform/sse.h"
+#endif
+
+// boost headers.
+#include "boost/static_assert.hpp"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Intersect one ray with the two child bounding boxes of a binary node.
+//
+// intersect() returns a bit mask of the child nodes that were hit (bit 0
+// for the left child, bit 1 for the right child) and stores the entry
+// distances of both child nodes into tmin[], which must be aligned on a
+// 16-byte boundary.
+//
+
+template <typename Node, typename Ray, size_t N>
+class NodeRayTester
+{
+  public:
+    typedef typename Node::AABBType::ValueType ValueType;
+    typedef RayInfo<ValueType, N> RayInfoType;
+
+    // Bind the tester to a given ray.
+    void set_ray(
+        const Ray&          ray,
+        const RayInfoType&  ray_info);
+
+    // Intersect the ray with the child bounding boxes of a node.
+    size_t intersect(
+        const Node&         node,
+        const ValueType     ray_tmax,
+        ValueType           tmin[2]) const;
+
+  private:
+    const Ray*              m_ray;
+    const RayInfoType*      m_ray_info;
+};
+
+
+//
+// BVH intersector for packets of rays, without motion.
+//
+// All rays of a packet traverse the tree together: each node is fetched once
+// for the packet and only the rays that hit a child node descend into it.
+// This amortizes node fetches across coherent rays such as camera rays or
+// shadow rays leaving the same point.
+//
+// The rays taking part in the traversal are selected by a bit mask, bit i
+// corresponding to rays[i]. The Visitor class must conform to the following
+// prototype:
+//
+//      class Visitor
+//        : public foundation::NonCopyable
+//      {
+//        public:
+//          // Visit a leaf for the rays selected by 'mask'. Return the mask of
+//          // the rays for which traversal should continue. distances[i] should
+//          // be set to the distance to the closest hit so far for these rays.
+//          size_t visit(
+//              const NodeType&             node,
+//              const RayType               rays[],
+//              const RayInfoType           ray_infos[],
+//              const size_t                mask,
+//              ValueType                   distances[]
+//      #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+//              , TraversalStatistics&      stats
+//      #endif
+//              );
+//      };
+//
+// foundation::bvh::PerRayPacketVisitor adapts an array of single-ray visitors
+// (as used by foundation::bvh::Intersector) to this prototype.
+//
+
+template <
+    typename Tree,
+    typename Visitor,
+    typename Ray,
+    size_t PacketSize,
+    size_t StackSize = 64,
+    size_t N = Tree::NodeType::AABBType::Dimension
+>
+class PacketIntersector
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename NodeType::AABBType::ValueType ValueType;
+    typedef Ray RayType;
+    typedef RayInfo<ValueType, N> RayInfoType;
+
+    // Intersect a packet of rays with a given BVH without motion.
+    void intersect_no_motion(
+        const Tree&             tree,
+        const RayType           rays[],
+        const RayInfoType       ray_infos[],
+        const size_t            mask,
+        Visitor&                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , TraversalStatistics&  stats
+#endif
+        ) const;
+
+  private:
+    BOOST_STATIC_ASSERT(PacketSize <= sizeof(size_t) * 8);
+
+    struct StackEntry
+    {
+        const NodeType*     m_node;
+        size_t              m_mask;
+    };
+};
+
+
+//
+// Adapt an array of single-ray visitors to the packet visitor prototype
+// expected by foundation::bvh::PacketIntersector. visitors[i] is used for
+// rays[i].
+//
+
+template <typename Visitor>
+class PerRayPacketVisitor
+  : public NonCopyable
+{
+  public:
+    // Constructor.
+    explicit PerRayPacketVisitor(Visitor* const visitors[]);
+
+    // Visit a leaf for the rays selected by 'mask'.
+    template <typename NodeType, typename RayType, typename RayInfoType, typename ValueType>
+    size_t visit(
+        const NodeType&         node,
+        const RayType           rays[],
+        const RayInfoType       ray_infos[],
+        const size_t            mask,
+        ValueType               distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , TraversalStatistics&  stats
+#endif
+        );
+
+  private:
+    Visitor* const*             m_visitors;
+};
+
+
+//
+// NodeRayTester class implementation.
+//
+
+template <typename Node, typename Ray, size_t N>
+inline void NodeRayTester<Node, Ray, N>::set_ray(
+    const Ray&              ray,
+    const RayInfoType&      ray_info)
+{
+    m_ray = &ray;
+    m_ray_info = &ray_info;
+}
+
+template <typename Node, typename Ray, size_t N>
+inline size_t NodeRayTester<Node, Ray, N>::intersect(
+    const Node&             node,
+    const ValueType         ray_tmax,
+    ValueType               tmin[2]) const
+{
+    const size_t hit_left =
+        (foundation::intersect(*m_ray, *m_ray_info, node.get_left_bbox(), tmin[0]) && tmin[0] < ray_tmax) ? 1 : 0;
+
+    const size_t hit_right =
+        (foundation::intersect(*m_ray, *m_ray_info, node.get_right_bbox(), tmin[1]) && tmin[1] < ray_tmax) ? 1 : 0;
+
+    return hit_left | (hit_right << 1);
+}
+
+#ifdef APPLESEED_USE_SSE
+
+//
+// NodeRayTester class implementation specialized for 3D double-precision
+// nodes, using SSE2 instructions. Works with any ray type derived from
+// foundation::Ray3d.
+//
+
+template <typename Ray>
+class NodeRayTester<Node<AABB3d>, Ray, 3>
+{
+  public:
+    typedef double ValueType;
+    typedef RayInfo3d RayInfoType;
+
+    // Bind the tester to a given ray.
+    void set_ray(
+        const Ray&          ray,
+        const RayInfo3d&    ray_info);
+
+    // Intersect the ray with the child bounding boxes of a node.
+    size_t intersect(
+        const Node<AABB3d>& node,
+        const double        ray_tmax,
+        double              tmin[2]) const;
+
+  private:
+    __m128d                 m_org_x;
+    __m128d                 m_org_y;
+    __m128d                 m_org_z;
+    __m128d                 m_rcp_dir_x;
+    __m128d                 m_rcp_dir_y;
+    __m128d                 m_rcp_dir_z;
+    __m128d                 m_ray_tmin;
+
+    // Offsets of the near and far planes in the bounding box data of a node.
+    size_t                  m_near_x, m_far_x;
+    size_t                  m_near_y, m_far_y;
+    size_t                  m_near_z, m_far_z;
+};
+
+template <typename Ray>
+inline void NodeRayTester<Node<AABB3d>, Ray, 3>::set_ray(
+    const Ray&              ray,
+    const RayInfo3d&        ray_info)
+{
+    m_org_x = _mm_set1_pd(ray.m_org.x);
+    m_org_y = _mm_set1_pd(ray.m_org.y);
+    m_org_z = _mm_set1_pd(ray.m_org.z);
+    m_rcp_dir_x = _mm_set1_pd(ray_info.m_rcp_dir.x);
+    m_rcp_dir_y = _mm_set1_pd(ray_info.m_rcp_dir.y);
+    m_rcp_dir_z = _mm_set1_pd(ray_info.m_rcp_dir.z);
+    m_ray_tmin = _mm_set1_pd(ray.m_tmin);
+
+    m_near_x = 0 + 2 * (1 - ray_info.m_sgn_dir.x);
+    m_far_x  = 0 + 2 * (    ray_info.m_sgn_dir.x);
+    m_near_y = 4 + 2 * (1 - ray_info.m_sgn_dir.y);
+    m_far_y  = 4 + 2 * (    ray_info.m_sgn_dir.y);
+    m_near_z = 8 + 2 * (1 - ray_info.m_sgn_dir.z);
+    m_far_z  = 8 + 2 * (    ray_info.m_sgn_dir.z);
+}
+
+template <typename Ray>
+inline size_t NodeRayTester<Node<AABB3d>, Ray, 3>::intersect(
+    const Node<AABB3d>&     node,
+    const double            ray_tmax,
+    double                  tmin[2]) const
+{
+    const __m128d xl1 = _mm_mul_pd(m_rcp_dir_x, _mm_sub_pd(_mm_load_pd(node.m_bbox_data + m_near_x), m_org_x));
+    const __m128d xl2 = _mm_mul_pd(m_rcp_dir_x, _mm_sub_pd(_mm_load_pd(node.m_bbox_data + m_far_x), m_org_x));
+    const __m128d yl1 = _mm_mul_pd(m_rcp_dir_y, _mm_sub_pd(_mm_load_pd(node.m_bbox_data + m_near_y), m_org_y));
+    const __m128d yl2 = _mm_mul_pd(m_rcp_dir_y, _mm_sub_pd(_mm_load_pd(node.m_bbox_data + m_far_y), m_org_y));
+    const __m128d zl1 = _mm_mul_pd(m_rcp_dir_z, _mm_sub_pd(_mm_load_pd(node.m_bbox_data + m_near_z), m_org_z));
+    const __m128d zl2 = _mm_mul_pd(m_rcp_dir_z, _mm_sub_pd(_mm_load_pd(node.m_bbox_data + m_far_z), m_org_z));
+
+    const __m128d mray_tmax = _mm_set1_pd(ray_tmax);
+    const __m128d t0 = _mm_max_pd(zl1, _mm_max_pd(yl1, _mm_max_pd(xl1, m_ray_tmin)));
+    const __m128d t1 = _mm_min_pd(zl2, _mm_min_pd(yl2, _mm_min_pd(xl2, mray_tmax)));
+
+    _mm_store_pd(tmin, t0);
+
+    return
+        _mm_movemask_pd(
+            _mm_or_pd(
+                _mm_cmpgt_pd(t0, t1),
+                _mm_cmpge_pd(t0, mray_tmax))) ^ 3;
+}
+
+#endif  // APPLESEED_USE_SSE
+
+
+//
+// PacketIntersector class implementation.
+//
+
+template <
+    typename Tree,
+    typename Visitor,
+    typename Ray,
+    size_t PacketSize,
+    size_t StackSize,
+    size_t N
+>
+void PacketIntersector<Tree, Visitor, Ray, PacketSize, StackSize, N>::intersect_no_motion(
+    const Tree&                 tree,
+    const RayType               rays[],
+    const RayInfoType           ray_infos[],
+    const size_t                mask,
+    Visitor&                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , TraversalStatistics&      stats
+#endif
+    ) const
+{
+    // Make sure the tree was built.
+    assert(!tree.m_nodes.empty());
+
+    // Bail out if the packet is empty.
+    if (mask == 0)
+        return;
+
+    // Prepare the rays for intersection with the child bounding boxes of nodes.
+    NodeRayTester<NodeType, RayType, N> testers[PacketSize];
+    ValueType ray_tmax[PacketSize];
+    for (size_t i = 0; i < PacketSize; ++i)
+    {
+        if (mask & (size_t(1) << i))
+        {
+            testers[i].set_ray(rays[i], ray_infos[i]);
+            ray_tmax[i] = rays[i].m_tmax;
+        }
+    }
+
+    // Node stack.
+    StackEntry stack[StackSize];
+    StackEntry* stack_ptr = stack;
+
+    // Current node and rays.
+    const NodeType* node_ptr = &tree.m_nodes[0];
+    size_t node_mask = mask;
+    size_t active_mask = mask;
+
+    // Initialize traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(++stats.m_traversal_count);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_nodes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_leaves = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t intersected_bboxes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t discarded_nodes = 0);
+
+    // Traverse the tree and intersect leaf nodes.
+    while (true)
+    {
+        // Fetch the node.
+        FOUNDATION_BVH_TRAVERSAL_STATS(++visited_nodes);
+
+        if (node_ptr->is_interior())
+        {
+            size_t left_mask = 0;
+            size_t right_mask = 0;
+            int left_votes = 0;
+
+            // Intersect the child bounding boxes with all rays of the packet that reached this node.
+            for (size_t i = 0; i < PacketSize; ++i)
+            {
+                const size_t bit = size_t(1) << i;
+
+                if ((node_mask & bit) == 0)
+                    continue;
+
+                FOUNDATION_BVH_TRAVERSAL_STATS(intersected_bboxes += 2);
+
+                SSE_ALIGN ValueType tmin[2];
+                const size_t hits = testers[i].intersect(*node_ptr, ray_tmax[i], tmin);
+
+                if (hits & 1)
+                    left_mask |= bit;
+
+                if (hits & 2)
+                    right_mask |= bit;
+
+                if (hits == 3)
+                    left_votes += tmin[0] < tmin[1] ? 1 : -1;
+            }
+
+            const NodeType* child_node_ptr = &tree.m_nodes[node_ptr->get_child_node_index()];
+
+            if (left_mask != 0 && right_mask != 0)
+            {
+                // Push the child node that is far for most rays, continue with the other one.
+                assert(stack_ptr < stack + StackSize);
+                if (left_votes >= 0)
+                {
+                    stack_ptr->m_node = child_node_ptr + 1;
+                    stack_ptr->m_mask = right_mask;
+                    node_ptr = child_node_ptr;
+                    node_mask = left_mask;
+                }
+                else
+                {
+                    stack_ptr->m_node = child_node_ptr;
+                    stack_ptr->m_mask = left_mask;
+                    node_ptr = child_node_ptr + 1;
+                    node_mask = right_mask;
+                }
+                ++stack_ptr;
+                continue;
+            }
+
+            if (left_mask != 0)
+            {
+                // Continue with the left child node.
+                FOUNDATION_BVH_TRAVERSAL_STATS(++discarded_nodes);
+                node_ptr = child_node_ptr;
+                node_mask = left_mask;
+                continue;
+            }
+
+            if (right_mask != 0)
+            {
+                // Continue with the right child node.
+                FOUNDATION_BVH_TRAVERSAL_STATS(++discarded_nodes);
+                node_ptr = child_node_ptr + 1;
+                node_mask = right_mask;
+                continue;
+            }
+
+            FOUNDATION_BVH_TRAVERSAL_STATS(discarded_nodes += 2);
+        }
+        else
+        {
+            // Visit the leaf.
+            FOUNDATION_BVH_TRAVERSAL_STATS(++visited_leaves);
+            ValueType distances[PacketSize];
+            const size_t proceed_mask =
+                visitor.visit(
+                    *node_ptr,
+                    rays,
+                    ray_infos,
+                    node_mask,
+                    distances
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , stats
+#endif
+                    );
+
+            // Keep track of the distance to the closest intersection of each ray.
+            for (size_t i = 0; i < PacketSize; ++i)
+            {
+                if ((node_mask & proceed_mask & (size_t(1) << i)) == 0)
+                    continue;
+
+                assert(distances[i] >= ValueType(0.0));
+
+                if (ray_tmax[i] > distances[i])
+                    ray_tmax[i] = distances[i];
+            }
+
+            // Remove from the packet the rays for which the visitor decided to terminate traversal.
+            active_mask &= ~(node_mask & ~proceed_mask);
+        }
+
+        // Pop the top node that still has active rays, terminate traversal if there is none.
+        node_mask = 0;
+        while (node_mask == 0 && stack_ptr > stack)
+        {
+            --stack_ptr;
+            node_ptr = stack_ptr->m_node;
+            node_mask = stack_ptr->m_mask & active_mask;
+        }
+
+        if (node_mask == 0)
+            break;
+    }
+
+    // Store traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_nodes.insert(visited_nodes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_leaves.insert(visited_leaves));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_bboxes.insert(intersected_bboxes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_discarded_nodes.insert(discarded_nodes));
+}
+
+
+//
+// PerRayPacketVisitor class implementation.
+//
+
+template <typename Visitor>
+inline PerRayPacketVisitor<Visitor>::PerRayPacketVisitor(Visitor* const visitors[])
+  : m_visitors(visitors)
+{
+}
+
+template <typename Visitor>
+template <typename NodeType, typename RayType, typename RayInfoType, typename ValueType>
+inline size_t PerRayPacketVisitor<Visitor>::visit(
+    const NodeType&             node,
+    const RayType               rays[],
+    const RayInfoType           ray_infos[],
+    const size_t                mask,
+    ValueType                   distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , TraversalStatistics&      stats
+#endif
+    )
+{
+    size_t proceed_mask = 0;
+
+    for (size_t i = 0, m = mask; m != 0; ++i, m >>= 1)
+    {
+        if ((m & 1) == 0)
+            continue;
+
+        const bool proceed =
+            m_visitors[i]->visit(
+                node,
+                rays[i],
+                ray_infos[i],
+                distances[i]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , stats
+#endif
+                );
+
+        if (proceed)
+            proceed_mask |= size_t(1) << i;
+    }
+
+    return proceed_mask;
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_PACKETINTERSECTOR_H
@@ -0,0 +1,545 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_PARALLELBUILDER_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_PARALLELBUILDER_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobmanager.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Forward declarations.
+namespace foundation    { class Logger; }
+
+namespace foundation {
+namespace bvh {
+
+//
+// Multithreaded BVH builder.
+//
+// The top of the tree is built on the calling thread until item sets become small
+// enough, at which point the remaining subtrees are built concurrently by a set
+// of worker threads. The subtrees are finally spliced into the tree such that the
+// resulting tree is identical to the one produced by foundation::bvh::Builder.
+//
+// When called from a worker thread of a foundation::JobManager (for instance when a
+// tree is built on demand while rendering), the whole tree is built on the calling
+// thread: every worker starting its own set of threads would oversubscribe the cores.
+//
+// The Partitioner class must conform to the prototype given in bvh_builder.h.
+// In addition, it must be safe to concurrently call partition() and compute_bbox()
+// on disjoint item sets, each containing no more than half of the items.
+//
+
+template <typename Tree, typename Partitioner>
+class ParallelBuilder
+  : public NonCopyable
+{
+  public:
+    // Constructor.
+    ParallelBuilder(
+        Logger&         logger,
+        const size_t    thread_count);
+
+    // Build a tree.
+    template <typename Timer>
+    void build(
+        Tree&           tree,
+        Partitioner&    partitioner,
+        const size_t    size,
+        const size_t    items_per_leaf_hint);
+
+    // Return the construction time.
+    double get_build_time() const;
+
+  private:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename Tree::NodeVectorType NodeVectorType;
+    typedef typename NodeType::AABBType AABBType;
+
+    // Minimum number of items in a subtree built by a worker thread.
+    static const size_t MinSubtreeSize = 1024;
+
+    // Number of subtrees per worker thread, for load balancing.
+    static const size_t SubtreesPerThread = 8;
+
+    struct Subtree
+    {
+        const size_t    m_begin;
+        const size_t    m_end;
+        const AABBType  m_bbox;
+        NodeVectorType  m_nodes;
+        bool            m_built;
+
+        Subtree(
+            const size_t                                        begin,
+            const size_t                                        end,
+            const AABBType&                                     bbox,
+            const typename NodeVectorType::allocator_type&      allocator)
+          : m_begin(begin)
+          , m_end(end)
+          , m_bbox(bbox)
+          , m_nodes(allocator)
+          , m_built(false)
+        {
+        }
+    };
+
+    class SubtreeJob
+      : public IJob
+    {
+      public:
+        SubtreeJob(
+            Partitioner&    partitioner,
+            Subtree&        subtree)
+          : m_partitioner(partitioner)
+          , m_subtree(subtree)
+        {
+        }
+
+        virtual void execute(const size_t thread_index)
+        {
+            m_subtree.m_nodes.push_back(NodeType());
+
+            subdivide_recurse(
+                m_subtree.m_nodes,
+                m_partitioner,
+                0,
+                m_subtree.m_begin,
+                m_subtree.m_end,
+                m_subtree.m_bbox);
+
+            m_subtree.m_built = true;
+        }
+
+      private:
+        Partitioner&        m_partitioner;
+        Subtree&            m_subtree;
+    };
+
+    typedef std::vector<Subtree*> SubtreeVector;
+
+    Logger&         m_logger;
+    const size_t    m_thread_count;
+    double          m_build_time;
+
+    // Recursively subdivide a tree.
+    static void subdivide_recurse(
+        NodeVectorType&             nodes,
+        Partitioner&                partitioner,
+        const size_t                node_index,
+        const size_t                begin,
+        const size_t                end,
+        const AABBType&             bbox);
+
+    // Recursively subdivide the top of a tree, deferring the construction of small subtrees.
+    static void subdivide_top_recurse(
+        NodeVectorType&             nodes,
+        std::vector<size_t>&        node_subtrees,
+        SubtreeVector&              subtrees,
+        Partitioner&                partitioner,
+        const size_t                max_subtree_size,
+        const size_t                node_index,
+        const size_t                begin,
+        const size_t                end,
+        const AABBType&             bbox);
+
+    // Recursively copy the top of a tree and its subtrees into the final tree.
+    static void assemble_recurse(
+        NodeVectorType&             nodes,
+        const NodeVectorType&       top_nodes,
+        const std::vector<size_t>&  node_subtrees,
+        const SubtreeVector&        subtrees,
+        const size_t                top_node_index,
+        const size_t                node_index);
+};
+
+
+//
+// ParallelBuilder class implementation.
+//
+
+template <typename Tree, typename Partitioner>
+const size_t ParallelBuilder<Tree, Partitioner>::MinSubtreeSize;
+
+template <typename Tree, typename Partitioner>
+const size_t ParallelBuilder<Tree, Partitioner>::SubtreesPerThread;
+
+template <typename Tree, typename Partitioner>
+ParallelBuilder<Tree, Partitioner>::ParallelBuilder(
+    Logger&             logger,
+    const size_t        thread_count)
+  : m_logger(logger)
+  , m_thread_count(thread_count)
+  , m_build_time(0.0)
+{
+}
+
+template <typename Tree, typename Partitioner>
+template <typename Timer>
+void ParallelBuilder<Tree, Partitioner>::build(
+    Tree&               tree,
+    Partitioner&        partitioner,
+    const size_t        size,
+    const size_t        items_per_leaf_hint)
+{
+    // Start stopwatch.
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    // Clear the tree.
+    tree.m_nodes.clear();
+
+    // Reserve memory for the nodes.
+    const size_t leaf_count_guess = size / items_per_leaf_hint;
+    const size_t node_count_guess = leaf_count_guess > 0 ? 2 * leaf_count_guess - 1 : 0;
+    tree.m_nodes.reserve(node_count_guess);
+
+    // Create the root node of the tree.
+    tree.m_nodes.push_back(NodeType());
+
+    // Compute the bounding box of the tree.
+    const AABBType root_bbox(partitioner.compute_bbox(0, size));
+
+    if (m_thread_count < 2 || size < 2 * MinSubtreeSize || JobManager::is_worker_thread())
+    {
+        // Not worth going parallel: recursively subdivide the tree on the calling thread.
+        subdivide_recurse(
+            tree.m_nodes,
+            partitioner,
+            0,              // node index
+            0,              // begin
+            size,           // end
+            root_bbox);
+    }
+    else
+    {
+        // No subtree may contain more than half of the items, see the class comment.
+        const size_t max_subtree_size =
+            std::min(
+                std::max(size / (m_thread_count * SubtreesPerThread), MinSubtreeSize),
+                size / 2);
+
+        // Subdivide the top of the tree on the calling thread.
+        NodeVectorType top_nodes(tree.m_nodes.get_allocator());
+        std::vector<size_t> node_subtrees;
+        SubtreeVector subtrees;
+        top_nodes.push_back(NodeType());
+        node_subtrees.push_back(~size_t(0));
+        subdivide_top_recurse(
+            top_nodes,
+            node_subtrees,
+            subtrees,
+            partitioner,
+            max_subtree_size,
+            0,              // node index
+            0,              // begin
+            size,           // end
+            root_bbox);
+
+        // Build the subtrees in parallel.
+        JobQueue job_queue;
+        for (size_t i = 0; i < subtrees.size(); ++i)
+            job_queue.schedule(new SubtreeJob(partitioner, *subtrees[i]));
+        JobManager job_manager(m_logger, job_queue, m_thread_count);
+        job_manager.start();
+        job_queue.wait_until_completion();
+
+        // Worker threads log and swallow exceptions thrown by jobs, but we must not
+        // return an incomplete tree. The only exception expected here is bad_alloc.
+        bool success = true;
+        for (size_t i = 0; i < subtrees.size(); ++i)
+            success = success && subtrees[i]->m_built;
+
+        // Assemble the final tree, in the same order as foundation::bvh::Builder.
+        if (success)
+        {
+            assemble_recurse(
+                tree.m_nodes,
+                top_nodes,
+                node_subtrees,
+                subtrees,
+                0,          // top node index
+                0);         // node index
+        }
+
+        for (size_t i = 0; i < subtrees.size(); ++i)
+            delete subtrees[i];
+
+        if (!success)
+        {
+            tree.m_nodes.clear();
+            throw std::bad_alloc();
+        }
+    }
+
+    // Measure and save construction time.
+    stopwatch.measure();
+    m_build_time = stopwatch.get_seconds();
+}
+
+template <typename Tree, typename Partitioner>
+inline double ParallelBuilder<Tree, Partitioner>::get_build_time() const
+{
+    return m_build_time;
+}
+
+template <typename Tree, typename Partitioner>
+void ParallelBuilder<Tree, Partitioner>::subdivide_recurse(
+    NodeVectorType&                 nodes,
+    Partitioner&                    partitioner,
+    const size_t                    node_index,
+    const size_t                    begin,
+    const size_t                    end,
+    const AABBType&                 bbox)
+{
+    assert(node_index < nodes.size());
+
+    // Try to partition the set of items.
+    size_t pivot = end;
+    if (end - begin > 1)
+    {
+        pivot = partitioner.partition(begin, end, typename Partitioner::AABBType(bbox));
+        assert(pivot > begin);
+        assert(pivot <= end);
+    }
+
+    if (pivot == end)
+    {
+        // Turn the current node into a leaf node.
+        NodeType& node = nodes[node_index];
+        node.make_leaf();
+        node.set_item_index(begin);
+        node.set_item_count(end - begin);
+    }
+    else
+    {
+        // Compute the bounding box of the child nodes.
+        const AABBType left_bbox(partitioner.compute_bbox(begin, pivot));
+        const AABBType right_bbox(partitioner.compute_bbox(pivot, end));
+
+        // Compute the indices of the child nodes.
+        const size_t left_node_index = nodes.size();
+        const size_t right_node_index = left_node_index + 1;
+
+        // Turn the current node into an interior node.
+        NodeType& node = nodes[node_index];
+        node.make_interior();
+        node.set_left_bbox(left_bbox);
+        node.set_right_bbox(right_bbox);
+        node.set_child_node_index(left_node_index);
+
+        // Create the child nodes.
+        nodes.push_back(NodeType());
+        nodes.push_back(NodeType());
+
+        // Recurse into the left subtree.
+        subdivide_recurse(
+            nodes,
+            partitioner,
+            left_node_index,
+            begin,
+            pivot,
+            left_bbox);
+
+        // Recurse into the right subtree.
+        subdivide_recurse(
+            nodes,
+            partitioner,
+            right_node_index,
+            pivot,
+            end,
+            right_bbox);
+    }
+}
+
+template <typename Tree, typename Partitioner>
+void ParallelBuilder<Tree, Partitioner>::subdivide_top_recurse(
+    NodeVectorType&                 nodes,
+    std::vector<size_t>&            node_subtrees,
+    SubtreeVector&                  subtrees,
+    Partitioner&                    partitioner,
+    const size_t                    max_subtree_size,
+    const size_t                    node_index,
+    const size_t                    begin,
+    const size_t                    end,
+    const AABBType&                 bbox)
+{
+    assert(node_index < nodes.size());
+    assert(nodes.size() == node_subtrees.size());
+
+    // Defer the construction of small subtrees to the worker threads.
+    if (end - begin <= max_subtree_size)
+    {
+        node_subtrees[node_index] = subtrees.size();
+        subtrees.push_back(new Subtree(begin, end, bbox, nodes.get_allocator()));
+        return;
+    }
+
+    // Try to partition the set of items.
+    const size_t pivot = partitioner.partition(begin, end, typename Partitioner::AABBType(bbox));
+    assert(pivot > begin);
+    assert(pivot <= end);
+
+    if (pivot == end)
+    {
+        // Turn the current node into a leaf node.
+        NodeType& node = nodes[node_index];
+        node.make_leaf();
+        node.set_item_index(begin);
+        node.set_item_count(end - begin);
+    }
+    else
+    {
+        // Compute the bounding box of the child nodes.
+        const AABBType left_bbox(partitioner.compute_bbox(begin, pivot));
+        const AABBType right_bbox(partitioner.compute_bbox(pivot, end));
+
+        // Compute the indices of the child nodes.
+        const size_t left_node_index = nodes.size();
+        const size_t right_node_index = left_node_index + 1;
+
+        // Turn the current node into an interior node.
+        NodeType& node = nodes[node_index];
+        node.make_interior();
+        node.set_left_bbox(left_bbox);
+        node.set_right_bbox(right_bbox);
+        node.set_child_node_index(left_node_index);
+
+        // Create the child nodes.
+        nodes.push_back(NodeType());
+        nodes.push_back(NodeType());
+        node_subtrees.push_back(~size_t(0));
+        node_subtrees.push_back(~size_t(0));
+
+        // Recurse into the left subtree.
+        subdivide_top_recurse(
+            nodes,
+            node_subtrees,
+            subtrees,
+            partitioner,
+            max_subtree_size,
+            left_node_index,
+            begin,
+            pivot,
+            left_bbox);
+
+        // Recurse into the right subtree.
+        subdivide_top_recurse(
+            nodes,
+            node_subtrees,
+            subtrees,
+            partitioner,
+            max_subtree_size,
+            right_node_index,
+            pivot,
+            end,
+            right_bbox);
+    }
+}
+
+template <typename Tree, typename Partitioner>
+void ParallelBuilder<Tree, Partitioner>::assemble_recurse(
+    NodeVectorType&                 nodes,
+    const NodeVectorType&           top_nodes,
+    const std::vector<size_t>&      node_subtrees,
+    const SubtreeVector&            subtrees,
+    const size_t                    top_node_index,
+    const size_t                    node_index)
+{
+    const size_t subtree_index = node_subtrees[top_node_index];
+
+    if (subtree_index != ~size_t(0))
+    {
+        // Splice the subtree: its root replaces the current node, and the serial builder
+        // would have appended the other nodes contiguously, in the same order.
+        const NodeVectorType& subtree_nodes = subtrees[subtree_index]->m_nodes;
+        const size_t base = nodes.size() - 1;
+        nodes.insert(nodes.end(), subtree_nodes.size() - 1, NodeType());
+
+        for (size_t i = 0; i < subtree_nodes.size(); ++i)
+        {
+            NodeType& node = nodes[i == 0 ? node_index : base + i];
+            node = subtree_nodes[i];
+
+            if (node.is_interior())
+                node.set_child_node_index(base + node.get_child_node_index());
+        }
+    }
+    else
+    {
+        const NodeType& top_node = top_nodes[top_node_index];
+        nodes[node_index] = top_node;
+
+        if (top_node.is_interior())
+        {
+            // Compute the indices of the child nodes.
+            const size_t left_node_index = nodes.size();
+            const size_t right_node_index = left_node_index + 1;
+            nodes[node_index].set_child_node_index(left_node_index);
+
+            // Create the child nodes.
+            nodes.push_back(NodeType());
+            nodes.push_back(NodeType());
+
+            // Recurse into the left subtree.
+            assemble_recurse(
+                nodes,
+                top_nodes,
+                node_subtrees,
+                subtrees,
+                top_node.get_child_node_index() + 0,
+                left_node_index);
+
+            // Recurse into the right subtree.
+            assemble_recurse(
+                nodes,
+                top_nodes,
+                node_subtrees,
+                subtrees,
+                top_node.get_child_node_index() + 1,
+                right_node_index);
+        }
+    }
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_PARALLELBUILDER_H
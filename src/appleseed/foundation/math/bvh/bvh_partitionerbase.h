@@ -178,6 +178,8 @@ void PartitionerBase<AABBVector>::sort_indices(
 
             const size_t size = indices.size();
 
+            // Swapping whole index vectors is only allowed when no other range of items
+            // can be partitioned concurrently, i.e. when this range is the largest one.
             if (end - begin > size / 2)
             {
                 for (size_t i = 0; i < begin; ++i)
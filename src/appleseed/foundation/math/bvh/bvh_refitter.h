@@ -0,0 +1,357 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_REFITTER_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_REFITTER_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobmanager.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Forward declarations.
+namespace foundation    { class Logger; }
+
+namespace foundation {
+namespace bvh {
+
+//
+// BVH refitter.
+//
+// Recomputes the bounding boxes of an existing tree bottom-up, keeping its topology
+// unchanged. This is much cheaper than rebuilding the tree when the items move but
+// their number and their assignment to leaves remain valid, for instance when the
+// vertices of a mesh are animated. The quality of a refitted tree degrades as items
+// move away from their original configuration; see compute_sah_cost() to decide
+// when a rebuild becomes preferable.
+//
+// Subtrees below the top levels of the tree are refitted concurrently by a set of
+// worker threads, unless the refitter is itself called from a worker thread of a
+// foundation::JobManager.
+//
+// The LeafRefitter class must conform to the following prototype:
+//
+//   class LeafRefitter
+//     : public foundation::NonCopyable
+//   {
+//     public:
+//       // Update the contents of a leaf node and return its bounding box.
+//       // Must be safe to call concurrently on distinct leaf nodes.
+//       AABBType refit(NodeType& node);
+//   };
+//
+
+template <typename Tree, typename LeafRefitter>
+class Refitter
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename NodeType::AABBType AABBType;
+
+    // Constructor.
+    Refitter(
+        Logger&         logger,
+        const size_t    thread_count);
+
+    // Refit a tree and return the bounding box of its root node.
+    template <typename Timer>
+    AABBType refit(
+        Tree&           tree,
+        LeafRefitter&   leaf_refitter);
+
+    // Return the refitting time.
+    double get_refit_time() const;
+
+  private:
+    typedef typename Tree::NodeVectorType NodeVectorType;
+
+    // Minimum number of nodes in a tree refitted by worker threads.
+    static const size_t MinParallelNodeCount = 4096;
+
+    // Number of subtrees per worker thread, for load balancing.
+    static const size_t SubtreesPerThread = 8;
+
+    struct Subtree
+    {
+        const size_t    m_node_index;
+        AABBType        m_bbox;
+        bool            m_refitted;
+
+        explicit Subtree(const size_t node_index)
+          : m_node_index(node_index)
+          , m_refitted(false)
+        {
+        }
+    };
+
+    class SubtreeJob
+      : public IJob
+    {
+      public:
+        SubtreeJob(
+            NodeVectorType& nodes,
+            LeafRefitter&   leaf_refitter,
+            Subtree&        subtree)
+          : m_nodes(nodes)
+          , m_leaf_refitter(leaf_refitter)
+          , m_subtree(subtree)
+        {
+        }
+
+        virtual void execute(const size_t thread_index)
+        {
+            m_subtree.m_bbox =
+                refit_recurse(
+                    m_nodes,
+                    m_leaf_refitter,
+                    m_subtree.m_node_index);
+
+            m_subtree.m_refitted = true;
+        }
+
+      private:
+        NodeVectorType&     m_nodes;
+        LeafRefitter&       m_leaf_refitter;
+        Subtree&            m_subtree;
+    };
+
+    typedef std::vector<Subtree> SubtreeVector;
+
+    Logger&         m_logger;
+    const size_t    m_thread_count;
+    double          m_refit_time;
+
+    // Recursively refit a subtree.
+    static AABBType refit_recurse(
+        NodeVectorType&     nodes,
+        LeafRefitter&       leaf_refitter,
+        const size_t        node_index);
+
+    // Recursively collect the roots of the subtrees refitted by the worker threads.
+    static void collect_subtrees_recurse(
+        const NodeVectorType&   nodes,
+        SubtreeVector&          subtrees,
+        const size_t            max_depth,
+        const size_t            node_index,
+        const size_t            depth);
+
+    // Recursively refit the top of a tree, once its subtrees have been refitted.
+    static AABBType refit_top_recurse(
+        NodeVectorType&         nodes,
+        const SubtreeVector&    subtrees,
+        size_t&                 subtree_index,
+        const size_t            max_depth,
+        const size_t            node_index,
+        const size_t            depth);
+};
+
+
+//
+// Refitter class implementation.
+//
+
+template <typename Tree, typename LeafRefitter>
+const size_t Refitter<Tree, LeafRefitter>::MinParallelNodeCount;
+
+template <typename Tree, typename LeafRefitter>
+const size_t Refitter<Tree, LeafRefitter>::SubtreesPerThread;
+
+template <typename Tree, typename LeafRefitter>
+Refitter<Tree, LeafRefitter>::Refitter(
+    Logger&             logger,
+    const size_t        thread_count)
+  : m_logger(logger)
+  , m_thread_count(thread_count)
+  , m_refit_time(0.0)
+{
+}
+
+template <typename Tree, typename LeafRefitter>
+template <typename Timer>
+typename Refitter<Tree, LeafRefitter>::AABBType Refitter<Tree, LeafRefitter>::refit(
+    Tree&               tree,
+    LeafRefitter&       leaf_refitter)
+{
+    assert(!tree.m_nodes.empty());
+
+    // Start stopwatch.
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    AABBType root_bbox;
+
+    if (m_thread_count < 2 || tree.m_nodes.size() < MinParallelNodeCount || JobManager::is_worker_thread())
+    {
+        // Not worth going parallel: refit the tree on the calling thread.
+        root_bbox = refit_recurse(tree.m_nodes, leaf_refitter, 0);
+    }
+    else
+    {
+        // Split the tree at the depth that yields enough subtrees to keep all threads busy.
+        size_t max_depth = 0;
+        while ((size_t(1) << max_depth) < m_thread_count * SubtreesPerThread)
+            ++max_depth;
+
+        // Collect the subtrees in depth-first order.
+        SubtreeVector subtrees;
+        collect_subtrees_recurse(tree.m_nodes, subtrees, max_depth, 0, 0);
+
+        // Refit the subtrees in parallel.
+        JobQueue job_queue;
+        for (size_t i = 0; i < subtrees.size(); ++i)
+            job_queue.schedule(new SubtreeJob(tree.m_nodes, leaf_refitter, subtrees[i]));
+        JobManager job_manager(m_logger, job_queue, m_thread_count);
+        job_manager.start();
+        job_queue.wait_until_completion();
+
+        // Worker threads log and swallow exceptions thrown by jobs, but we must not
+        // return a partially refitted tree.
+        for (size_t i = 0; i < subtrees.size(); ++i)
+        {
+            if (!subtrees[i].m_refitted)
+                throw std::bad_alloc();
+        }
+
+        // Refit the top of the tree on the calling thread.
+        size_t subtree_index = 0;
+        root_bbox = refit_top_recurse(tree.m_nodes, subtrees, subtree_index, max_depth, 0, 0);
+        assert(subtree_index == subtrees.size());
+    }
+
+    // Measure and save refitting time.
+    stopwatch.measure();
+    m_refit_time = stopwatch.get_seconds();
+
+    return root_bbox;
+}
+
+template <typename Tree, typename LeafRefitter>
+inline double Refitter<Tree, LeafRefitter>::get_refit_time() const
+{
+    return m_refit_time;
+}
+
+template <typename Tree, typename LeafRefitter>
+typename Refitter<Tree, LeafRefitter>::AABBType Refitter<Tree, LeafRefitter>::refit_recurse(
+    NodeVectorType&         nodes,
+    LeafRefitter&           leaf_refitter,
+    const size_t            node_index)
+{
+    assert(node_index < nodes.size());
+
+    if (nodes[node_index].is_leaf())
+        return leaf_refitter.refit(nodes[node_index]);
+
+    const size_t child_node_index = nodes[node_index].get_child_node_index();
+
+    // Recurse into the child nodes.
+    const AABBType left_bbox = refit_recurse(nodes, leaf_refitter, child_node_index + 0);
+    const AABBType right_bbox = refit_recurse(nodes, leaf_refitter, child_node_index + 1);
+
+    // Update the bounding boxes of the child nodes.
+    NodeType& node = nodes[node_index];
+    node.set_left_bbox(left_bbox);
+    node.set_right_bbox(right_bbox);
+
+    AABBType bbox(left_bbox);
+    bbox.insert(right_bbox);
+
+    return bbox;
+}
+
+template <typename Tree, typename LeafRefitter>
+void Refitter<Tree, LeafRefitter>::collect_subtrees_recurse(
+    const NodeVectorType&   nodes,
+    SubtreeVector&          subtrees,
+    const size_t            max_depth,
+    const size_t            node_index,
+    const size_t            depth)
+{
+    const NodeType& node = nodes[node_index];
+
+    if (depth == max_depth || node.is_leaf())
+    {
+        subtrees.push_back(Subtree(node_index));
+        return;
+    }
+
+    const size_t child_node_index = node.get_child_node_index();
+
+    collect_subtrees_recurse(nodes, subtrees, max_depth, child_node_index + 0, depth + 1);
+    collect_subtrees_recurse(nodes, subtrees, max_depth, child_node_index + 1, depth + 1);
+}
+
+template <typename Tree, typename LeafRefitter>
+typename Refitter<Tree, LeafRefitter>::AABBType Refitter<Tree, LeafRefitter>::refit_top_recurse(
+    NodeVectorType&         nodes,
+    const SubtreeVector&    subtrees,
+    size_t&                 subtree_index,
+    const size_t            max_depth,
+    const size_t            node_index,
+    const size_t            depth)
+{
+    if (depth == max_depth || nodes[node_index].is_leaf())
+    {
+        // This subtree was refitted by a worker thread, in the same order.
+        assert(subtrees[subtree_index].m_node_index == node_index);
+        return subtrees[subtree_index++].m_bbox;
+    }
+
+    const size_t child_node_index = nodes[node_index].get_child_node_index();
+
+    // Recurse into the child nodes.
+    const AABBType left_bbox =
+        refit_top_recurse(nodes, subtrees, subtree_index, max_depth, child_node_index + 0, depth + 1);
+    const AABBType right_bbox =
+        refit_top_recurse(nodes, subtrees, subtree_index, max_depth, child_node_index + 1, depth + 1);
+
+    // Update the bounding boxes of the child nodes.
+    NodeType& node = nodes[node_index];
+    node.set_left_bbox(left_bbox);
+    node.set_right_bbox(right_bbox);
+
+    AABBType bbox(left_bbox);
+    bbox.insert(right_bbox);
+
+    return bbox;
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_REFITTER_H
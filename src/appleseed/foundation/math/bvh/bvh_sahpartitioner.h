@@ -45,6 +45,9 @@ namespace bvh {
 //
 // A BVH partitioner based on the Surface Area Heuristic (SAH).
 //
+// partition() and compute_bbox() may be called concurrently on disjoint sets of items
+// as long as none of these sets contains more than half of the items.
+//
 
 template <typename AABBVector>
 class SAHPartitioner
@@ -129,7 +132,7 @@ size_t SAHPartitioner<AABBVector>::partition(
         for (size_t i = 0; i < count - 1; ++i)
         {
             bbox_accumulator.insert(bboxes[indices[begin + i]]);
-            m_left_areas[i] = half_surface_area(bbox_accumulator);
+            m_left_areas[begin + i] = half_surface_area(bbox_accumulator);
         }
 
         // Right-to-left sweep to accumulate bounding boxes, compute their surface area find the best partition.
@@ -140,7 +143,7 @@ size_t SAHPartitioner<AABBVector>::partition(
             bbox_accumulator.insert(bboxes[indices[begin + i]]);
 
             // Compute the cost of this partition.
-            const ValueType left_cost = m_left_areas[i - 1] * i;
+            const ValueType left_cost = m_left_areas[begin + i - 1] * i;
             const ValueType right_cost = half_surface_area(bbox_accumulator) * (count - i);
             const ValueType split_cost = left_cost + right_cost;
 
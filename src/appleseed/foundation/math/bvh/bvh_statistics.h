@@ -32,6 +32,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
 #include "foundation/math/population.h"
 #include "foundation/utility/statistics.h"
 #include "foundation/utility/string.h"
@@ -78,6 +79,19 @@ class TreeStatistics
 };
 
 
+//
+// Compute the cost of a 3D tree according to the Surface Area Heuristic, given the
+// cost of traversing an interior node and the cost of intersecting an item. Lower
+// is better; costs of different trees over the same items can be compared.
+//
+
+template <typename NodeVector>
+double compute_sah_cost(
+    const NodeVector&       nodes,
+    const double            interior_node_traversal_cost,
+    const double            item_intersection_cost);
+
+
 //
 // BVH traversal statistics.
 //
@@ -168,6 +182,81 @@ void TreeStatistics<Tree>::collect_stats_recurse(
     }
 }
 
+
+
+//
+// compute_sah_cost() function implementation.
+//
+
+namespace impl
+{
+    template <typename NodeVector>
+    double compute_sah_cost_recurse(
+        const NodeVector&                                       nodes,
+        const typename NodeVector::value_type&                  node,
+        const typename NodeVector::value_type::AABBType&        bbox,
+        const double                                            interior_node_traversal_cost,
+        const double                                            item_intersection_cost)
+    {
+        const double area =
+            bbox.is_valid() ? static_cast<double>(half_surface_area(bbox)) : 0.0;
+
+        if (node.is_leaf())
+            return area * node.get_item_count() * item_intersection_cost;
+
+        const size_t child_index = node.get_child_node_index();
+
+        return
+              area * interior_node_traversal_cost
+            + compute_sah_cost_recurse(
+                  nodes,
+                  nodes[child_index + 0],
+                  node.get_left_bbox(),
+                  interior_node_traversal_cost,
+                  item_intersection_cost)
+            + compute_sah_cost_recurse(
+                  nodes,
+                  nodes[child_index + 1],
+                  node.get_right_bbox(),
+                  interior_node_traversal_cost,
+                  item_intersection_cost);
+    }
+}
+
+template <typename NodeVector>
+double compute_sah_cost(
+    const NodeVector&       nodes,
+    const double            interior_node_traversal_cost,
+    const double            item_intersection_cost)
+{
+    typedef typename NodeVector::value_type NodeType;
+    typedef typename NodeType::AABBType AABBType;
+
+    assert(!nodes.empty());
+
+    const NodeType& root = nodes.front();
+
+    if (root.is_leaf())
+        return root.get_item_count() * item_intersection_cost;
+
+    AABBType root_bbox = root.get_left_bbox();
+    root_bbox.insert(root.get_right_bbox());
+
+    const double root_area =
+        root_bbox.is_valid() ? static_cast<double>(half_surface_area(root_bbox)) : 0.0;
+
+    if (root_area == 0.0)
+        return interior_node_traversal_cost;
+
+    return
+        impl::compute_sah_cost_recurse(
+            nodes,
+            root,
+            root_bbox,
+            interior_node_traversal_cost,
+            item_intersection_cost) / root_area;
+}
+
 }       // namespace bvh
 }       // namespace foundation
 
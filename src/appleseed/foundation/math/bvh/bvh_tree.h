@@ -66,15 +66,30 @@ class Tree
     template <typename Tree, typename Partitioner>
     friend class Builder;
 
+    template <typename Tree, typename Partitioner>
+    friend class ParallelBuilder;
+
     template <typename Tree, typename Partitioner>
     friend class SpatialBuilder;
 
+    template <typename Tree, typename LeafRefitter>
+    friend class Refitter;
+
     template <typename Tree>
     friend class TreeStatistics;
 
     template <typename Tree, typename Visitor, typename Ray, size_t StackSize, size_t N>
     friend class Intersector;
 
+    template <typename Tree, typename Visitor, typename Ray, size_t PacketSize, size_t StackSize, size_t N>
+    friend class PacketIntersector;
+
+    template <typename Tree, size_t W, typename AABB>
+    friend class WideTree;
+
+    template <typename Tree, typename WideTree, typename Visitor, typename Ray, size_t StackSize, size_t N>
+    friend class WideIntersector;
+
     typedef typename NodeType::AABBType AABBType;
     typedef std::vector<AABBType> AABBVector;
 
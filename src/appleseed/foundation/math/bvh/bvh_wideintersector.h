@@ -0,0 +1,528 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDEINTERSECTOR_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDEINTERSECTOR_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/bvh/bvh_intersector.h"
+#include "foundation/math/bvh/bvh_statistics.h"
+#include "foundation/math/bvh/bvh_widenode.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/ray.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
+#ifdef APPLESEED_USE_AVX
+#include "foundation/platform/avx.h"
+#endif
+#ifdef APPLESEED_USE_SSE
+#include "foundation/platform/sse.h"
+#endif
+
+// boost headers.
+#include "boost/static_assert.hpp"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Intersect a ray with all the child bounding boxes of a wide node.
+//
+// intersect() returns a bit mask of the child nodes that were hit and stores
+// the entry distances of all child nodes into tmin[], which must be aligned
+// on a 32-byte boundary. Computations are carried out with the precision of
+// the ray, whatever the precision of the bounding boxes.
+//
+
+template <typename Node, typename Ray, size_t N>
+class WideNodeRayTester
+{
+  public:
+    typedef typename Ray::ValueType ValueType;
+    typedef RayInfo<ValueType, N> RayInfoType;
+
+    static const size_t Width = Node::Width;
+
+    // Constructor.
+    WideNodeRayTester(
+        const Ray&          ray,
+        const RayInfoType&  ray_info);
+
+    // Intersect the ray with the child bounding boxes of a node.
+    size_t intersect(
+        const Node&         node,
+        const ValueType     ray_tmax,
+        ValueType           tmin[]) const;
+
+  private:
+    const Ray&              m_ray;
+    const RayInfoType&      m_ray_info;
+};
+
+
+//
+// BVH intersector for wide BVHs without motion.
+//
+// Traversal visits the child nodes that were hit in front-to-back order and
+// skips any node whose entry distance lies beyond the closest hit found so
+// far. Leaf nodes are the leaf nodes of the binary BVH the wide BVH was
+// collapsed from; the Visitor class therefore has the same prototype as for
+// foundation::bvh::Intersector.
+//
+
+template <
+    typename Tree,
+    typename WideTree,
+    typename Visitor,
+    typename Ray,
+    size_t StackSize = 64,
+    size_t N = Tree::NodeType::AABBType::Dimension
+>
+class WideIntersector
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename WideTree::NodeType WideNodeType;
+    typedef typename NodeType::AABBType::ValueType ValueType;
+    typedef Ray RayType;
+    typedef RayInfo<ValueType, N> RayInfoType;
+
+    // Intersect a ray with a given wide BVH without motion.
+    void intersect_no_motion(
+        const Tree&             tree,
+        const WideTree&         wide_tree,
+        const RayType&          ray,
+        const RayInfoType&      ray_info,
+        Visitor&                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , TraversalStatistics&  stats
+#endif
+        ) const;
+
+  private:
+    struct StackEntry
+    {
+        uint32      m_child;
+        ValueType   m_tmin;
+    };
+};
+
+
+//
+// WideNodeRayTester class implementation.
+//
+
+template <typename Node, typename Ray, size_t N>
+inline WideNodeRayTester<Node, Ray, N>::WideNodeRayTester(
+    const Ray&              ray,
+    const RayInfoType&      ray_info)
+  : m_ray(ray)
+  , m_ray_info(ray_info)
+{
+}
+
+template <typename Node, typename Ray, size_t N>
+inline size_t WideNodeRayTester<Node, Ray, N>::intersect(
+    const Node&             node,
+    const ValueType         ray_tmax,
+    ValueType               tmin[]) const
+{
+    size_t hits = 0;
+
+    for (size_t i = 0; i < Width; ++i)
+    {
+        ValueType t0 = m_ray.m_tmin;
+        ValueType t1 = ray_tmax;
+
+        for (size_t d = 0; d < N; ++d)
+        {
+            const typename Node::ValueType* bbox_data = node.m_bbox_data + d * 2 * Width + i;
+            const size_t sgn = m_ray_info.m_sgn_dir[d];
+            const ValueType near = (bbox_data[(1 - sgn) * Width] - m_ray.m_org[d]) * m_ray_info.m_rcp_dir[d];
+            const ValueType far  = (bbox_data[     sgn  * Width] - m_ray.m_org[d]) * m_ray_info.m_rcp_dir[d];
+
+            if (t0 < near)
+                t0 = near;
+
+            if (t1 > far)
+                t1 = far;
+        }
+
+        tmin[i] = t0;
+
+        if (t0 <= t1 && t0 < ray_tmax)
+            hits |= size_t(1) << i;
+    }
+
+    return hits;
+}
+
+#ifdef APPLESEED_USE_SSE
+
+//
+// WideNodeRayTester class implementation specialized for 3D double-precision
+// rays, using SSE2 (two child nodes at a time) or AVX (four child nodes at a
+// time) instructions. Single-precision bounding boxes are converted to double
+// precision as they are loaded.
+//
+
+template <typename T, size_t W>
+class WideNodeRayTester<WideNode<AABB<T, 3>, W>, Ray3d, 3>
+{
+  public:
+    typedef WideNode<AABB<T, 3>, W> Node;
+    typedef double ValueType;
+    typedef RayInfo3d RayInfoType;
+
+    static const size_t Width = W;
+
+    // Constructor.
+    WideNodeRayTester(
+        const Ray3d&        ray,
+        const RayInfo3d&    ray_info);
+
+    // Intersect the ray with the child bounding boxes of a node.
+    size_t intersect(
+        const Node&         node,
+        const double        ray_tmax,
+        double              tmin[]) const;
+
+  private:
+#ifdef APPLESEED_USE_AVX
+    BOOST_STATIC_ASSERT(Width % 4 == 0);
+
+    __m256d                 m_org_x;
+    __m256d                 m_org_y;
+    __m256d                 m_org_z;
+    __m256d                 m_rcp_dir_x;
+    __m256d                 m_rcp_dir_y;
+    __m256d                 m_rcp_dir_z;
+    __m256d                 m_ray_tmin;
+#else
+    BOOST_STATIC_ASSERT(Width % 2 == 0);
+
+    __m128d                 m_org_x;
+    __m128d                 m_org_y;
+    __m128d                 m_org_z;
+    __m128d                 m_rcp_dir_x;
+    __m128d                 m_rcp_dir_y;
+    __m128d                 m_rcp_dir_z;
+    __m128d                 m_ray_tmin;
+#endif
+
+#ifdef APPLESEED_USE_AVX
+    // Load four consecutive values as doubles.
+    static __m256d load(const double* p);
+    static __m256d load(const float* p);
+#else
+    // Load two consecutive values as doubles.
+    static __m128d load(const double* p);
+    static __m128d load(const float* p);
+#endif
+
+    // Offsets of the near and far planes in the bounding box data of a node.
+    size_t                  m_near_x, m_far_x;
+    size_t                  m_near_y, m_far_y;
+    size_t                  m_near_z, m_far_z;
+};
+
+template <typename T, size_t W>
+inline WideNodeRayTester<WideNode<AABB<T, 3>, W>, Ray3d, 3>::WideNodeRayTester(
+    const Ray3d&            ray,
+    const RayInfo3d&        ray_info)
+  : m_near_x(0 * 2 * Width + (1 - ray_info.m_sgn_dir.x) * Width)
+  , m_far_x (0 * 2 * Width + (    ray_info.m_sgn_dir.x) * Width)
+  , m_near_y(1 * 2 * Width + (1 - ray_info.m_sgn_dir.y) * Width)
+  , m_far_y (1 * 2 * Width + (    ray_info.m_sgn_dir.y) * Width)
+  , m_near_z(2 * 2 * Width + (1 - ray_info.m_sgn_dir.z) * Width)
+  , m_far_z (2 * 2 * Width + (    ray_info.m_sgn_dir.z) * Width)
+{
+#ifdef APPLESEED_USE_AVX
+    m_org_x = _mm256_set1_pd(ray.m_org.x);
+    m_org_y = _mm256_set1_pd(ray.m_org.y);
+    m_org_z = _mm256_set1_pd(ray.m_org.z);
+    m_rcp_dir_x = _mm256_set1_pd(ray_info.m_rcp_dir.x);
+    m_rcp_dir_y = _mm256_set1_pd(ray_info.m_rcp_dir.y);
+    m_rcp_dir_z = _mm256_set1_pd(ray_info.m_rcp_dir.z);
+    m_ray_tmin = _mm256_set1_pd(ray.m_tmin);
+#else
+    m_org_x = _mm_set1_pd(ray.m_org.x);
+    m_org_y = _mm_set1_pd(ray.m_org.y);
+    m_org_z = _mm_set1_pd(ray.m_org.z);
+    m_rcp_dir_x = _mm_set1_pd(ray_info.m_rcp_dir.x);
+    m_rcp_dir_y = _mm_set1_pd(ray_info.m_rcp_dir.y);
+    m_rcp_dir_z = _mm_set1_pd(ray_info.m_rcp_dir.z);
+    m_ray_tmin = _mm_set1_pd(ray.m_tmin);
+#endif
+}
+
+#ifdef APPLESEED_USE_AVX
+
+template <typename T, size_t W>
+FORCE_INLINE __m256d WideNodeRayTester<WideNode<AABB<T, 3>, W>, Ray3d, 3>::load(const double* p)
+{
+    return _mm256_load_pd(p);
+}
+
+template <typename T, size_t W>
+FORCE_INLINE __m256d WideNodeRayTester<WideNode<AABB<T, 3>, W>, Ray3d, 3>::load(const float* p)
+{
+    return _mm256_cvtps_pd(_mm_load_ps(p));
+}
+
+#else
+
+template <typename T, size_t W>
+FORCE_INLINE __m128d WideNodeRayTester<WideNode<AABB<T, 3>, W>, Ray3d, 3>::load(const double* p)
+{
+    return _mm_load_pd(p);
+}
+
+template <typename T, size_t W>
+FORCE_INLINE __m128d WideNodeRayTester<WideNode<AABB<T, 3>, W>, Ray3d, 3>::load(const float* p)
+{
+    return _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p))));
+}
+
+#endif
+
+template <typename T, size_t W>
+inline size_t WideNodeRayTester<WideNode<AABB<T, 3>, W>, Ray3d, 3>::intersect(
+    const Node&             node,
+    const double            ray_tmax,
+    double                  tmin[]) const
+{
+    size_t hits = 0;
+
+#ifdef APPLESEED_USE_AVX
+
+    const __m256d mray_tmax = _mm256_set1_pd(ray_tmax);
+
+    for (size_t i = 0; i < Width; i += 4)
+    {
+        const T* bbox_data = node.m_bbox_data + i;
+
+        const __m256d xl1 = _mm256_mul_pd(m_rcp_dir_x, _mm256_sub_pd(load(bbox_data + m_near_x), m_org_x));
+        const __m256d xl2 = _mm256_mul_pd(m_rcp_dir_x, _mm256_sub_pd(load(bbox_data + m_far_x), m_org_x));
+        const __m256d yl1 = _mm256_mul_pd(m_rcp_dir_y, _mm256_sub_pd(load(bbox_data + m_near_y), m_org_y));
+        const __m256d yl2 = _mm256_mul_pd(m_rcp_dir_y, _mm256_sub_pd(load(bbox_data + m_far_y), m_org_y));
+        const __m256d zl1 = _mm256_mul_pd(m_rcp_dir_z, _mm256_sub_pd(load(bbox_data + m_near_z), m_org_z));
+        const __m256d zl2 = _mm256_mul_pd(m_rcp_dir_z, _mm256_sub_pd(load(bbox_data + m_far_z), m_org_z));
+
+        const __m256d t0 = _mm256_max_pd(zl1, _mm256_max_pd(yl1, _mm256_max_pd(xl1, m_ray_tmin)));
+        const __m256d t1 = _mm256_min_pd(zl2, _mm256_min_pd(yl2, _mm256_min_pd(xl2, mray_tmax)));
+
+        _mm256_store_pd(tmin + i, t0);
+
+        const int miss =
+            _mm256_movemask_pd(
+                _mm256_or_pd(
+                    _mm256_cmp_pd(t0, t1, _CMP_GT_OQ),
+                    _mm256_cmp_pd(t0, mray_tmax, _CMP_GE_OQ)));
+
+        hits |= static_cast<size_t>(miss ^ 15) << i;
+    }
+
+#else
+
+    const __m128d mray_tmax = _mm_set1_pd(ray_tmax);
+
+    for (size_t i = 0; i < Width; i += 2)
+    {
+        const T* bbox_data = node.m_bbox_data + i;
+
+        const __m128d xl1 = _mm_mul_pd(m_rcp_dir_x, _mm_sub_pd(load(bbox_data + m_near_x), m_org_x));
+        const __m128d xl2 = _mm_mul_pd(m_rcp_dir_x, _mm_sub_pd(load(bbox_data + m_far_x), m_org_x));
+        const __m128d yl1 = _mm_mul_pd(m_rcp_dir_y, _mm_sub_pd(load(bbox_data + m_near_y), m_org_y));
+        const __m128d yl2 = _mm_mul_pd(m_rcp_dir_y, _mm_sub_pd(load(bbox_data + m_far_y), m_org_y));
+        const __m128d zl1 = _mm_mul_pd(m_rcp_dir_z, _mm_sub_pd(load(bbox_data + m_near_z), m_org_z));
+        const __m128d zl2 = _mm_mul_pd(m_rcp_dir_z, _mm_sub_pd(load(bbox_data + m_far_z), m_org_z));
+
+        const __m128d t0 = _mm_max_pd(zl1, _mm_max_pd(yl1, _mm_max_pd(xl1, m_ray_tmin)));
+        const __m128d t1 = _mm_min_pd(zl2, _mm_min_pd(yl2, _mm_min_pd(xl2, mray_tmax)));
+
+        _mm_store_pd(tmin + i, t0);
+
+        const int miss =
+            _mm_movemask_pd(
+                _mm_or_pd(
+                    _mm_cmpgt_pd(t0, t1),
+                    _mm_cmpge_pd(t0, mray_tmax)));
+
+        hits |= static_cast<size_t>(miss ^ 3) << i;
+    }
+
+#endif
+
+    return hits;
+}
+
+#endif  // APPLESEED_USE_SSE
+
+
+//
+// WideIntersector class implementation.
+//
+
+template <
+    typename Tree,
+    typename WideTree,
+    typename Visitor,
+    typename Ray,
+    size_t StackSize,
+    size_t N
+>
+void WideIntersector<Tree, WideTree, Visitor, Ray, StackSize, N>::intersect_no_motion(
+    const Tree&                 tree,
+    const WideTree&             wide_tree,
+    const RayType&              ray,
+    const RayInfoType&          ray_info,
+    Visitor&                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , TraversalStatistics&      stats
+#endif
+    ) const
+{
+    const size_t Width = WideNodeType::Width;
+
+    // Make sure the tree was built.
+    assert(!wide_tree.m_nodes.empty());
+
+    // Prepare the ray for intersection with the child bounding boxes of wide nodes.
+    const WideNodeRayTester<WideNodeType, RayType, N> tester(ray, ray_info);
+    APPLESEED_ALIGN(32) ValueType tmin[Width];
+
+    // Node stack, sorted so that the closest node is on top.
+    StackEntry stack[StackSize];
+    StackEntry* stack_ptr = stack;
+
+    // Push the root node.
+    stack_ptr->m_child = 0;
+    stack_ptr->m_tmin = ray.m_tmin;
+    ++stack_ptr;
+
+    // Initialize traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(++stats.m_traversal_count);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_nodes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_leaves = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t intersected_bboxes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t discarded_nodes = 0);
+
+    // Traverse the tree and intersect leaf nodes.
+    ValueType ray_tmax = ray.m_tmax;
+    while (stack_ptr > stack)
+    {
+        // Pop the top node from the stack.
+        const StackEntry entry = *--stack_ptr;
+
+        // Skip nodes that lie beyond the closest intersection found so far.
+        if (entry.m_tmin >= ray_tmax)
+        {
+            FOUNDATION_BVH_TRAVERSAL_STATS(++discarded_nodes);
+            continue;
+        }
+
+        if (entry.m_child & WideNodeType::LeafFlag)
+        {
+            // Visit the leaf.
+            FOUNDATION_BVH_TRAVERSAL_STATS(++visited_leaves);
+            ValueType distance;
+#ifndef NDEBUG
+            distance = ValueType(-1.0);
+#endif
+            const bool proceed =
+                visitor.visit(
+                    tree.m_nodes[entry.m_child & ~WideNodeType::LeafFlag],
+                    ray,
+                    ray_info,
+                    distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , stats
+#endif
+                    );
+            assert(!proceed || distance >= ValueType(0.0));
+
+            // Terminate traversal if the visitor decided so.
+            if (!proceed)
+                break;
+
+            // Keep track of the distance to the closest intersection.
+            if (ray_tmax > distance)
+                ray_tmax = distance;
+        }
+        else
+        {
+            // Fetch the node.
+            FOUNDATION_BVH_TRAVERSAL_STATS(++visited_nodes);
+            const WideNodeType& node = wide_tree.m_nodes[entry.m_child];
+
+            // Intersect all child bounding boxes at once.
+            FOUNDATION_BVH_TRAVERSAL_STATS(intersected_bboxes += node.get_child_count());
+            const size_t hits = tester.intersect(node, ray_tmax, tmin);
+
+            // Push the child nodes that were hit, keeping the stack sorted by decreasing distance.
+            assert(stack_ptr + Width <= stack + StackSize);
+            StackEntry* const first = stack_ptr;
+            for (size_t i = 0; i < Width; ++i)
+            {
+                if ((hits & (size_t(1) << i)) == 0)
+                    continue;
+
+                StackEntry* p = stack_ptr++;
+                while (p > first && (p - 1)->m_tmin < tmin[i])
+                {
+                    *p = *(p - 1);
+                    --p;
+                }
+
+                p->m_child = node.m_child[i];
+                p->m_tmin = tmin[i];
+            }
+
+            FOUNDATION_BVH_TRAVERSAL_STATS(discarded_nodes += node.get_child_count() - (stack_ptr - first));
+        }
+    }
+
+    // Store traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_nodes.insert(visited_nodes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_leaves.insert(visited_leaves));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_bboxes.insert(intersected_bboxes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_discarded_nodes.insert(discarded_nodes));
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDEINTERSECTOR_H
@@ -0,0 +1,190 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDENODE_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDENODE_H
+
+// appleseed.foundation headers.
+#include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Interior node of a wide (N-ary) BVH.
+//
+// The bounding boxes of the child nodes are stored in structure-of-arrays
+// form: for each dimension, the Width minimum values are followed by the
+// Width maximum values. This allows testing all child nodes against a ray
+// in a single pass using SIMD instructions.
+//
+// A child reference is either the index of another wide node or the index
+// of a leaf node of the binary BVH the wide BVH was collapsed from. Unused
+// child slots have an empty bounding box and are never hit.
+//
+
+template <typename AABB, size_t W>
+class APPLESEED_ALIGN(64) WideNode
+{
+  public:
+    typedef AABB AABBType;
+    typedef typename AABBType::ValueType ValueType;
+
+    static const size_t Dimension = AABBType::Dimension;
+    static const size_t Width = W;
+
+    // Constructor, marks all child slots as unused.
+    WideNode();
+
+    // Set/get the number of used child slots.
+    void set_child_count(const size_t count);
+    size_t get_child_count() const;
+
+    // Set/get the bounding box of a given child node.
+    void set_child_bbox(const size_t child, const AABBType& bbox);
+    AABBType get_child_bbox(const size_t child) const;
+
+    // Set a given child as an interior wide node or as a binary leaf node.
+    void set_child_node(const size_t child, const size_t index);
+    void set_child_leaf(const size_t child, const size_t index);
+
+    // Return whether a given child is a leaf node, and return its index.
+    bool is_child_leaf(const size_t child) const;
+    size_t get_child_index(const size_t child) const;
+
+  private:
+    template <typename Tree, typename WideTree, typename Visitor, typename Ray, size_t StackSize, size_t N>
+    friend class WideIntersector;
+
+    template <typename Node, typename Ray, size_t N>
+    friend class WideNodeRayTester;
+
+    static const uint32 LeafFlag = 0x80000000UL;
+
+    SSE_ALIGN ValueType     m_bbox_data[2 * Dimension * Width];
+    uint32                  m_child[Width];
+    uint32                  m_child_count;
+};
+
+
+//
+// WideNode class implementation.
+//
+
+template <typename AABB, size_t W>
+inline WideNode<AABB, W>::WideNode()
+  : m_child_count(0)
+{
+    for (size_t i = 0; i < Width; ++i)
+    {
+        set_child_bbox(i, AABBType::invalid());
+        m_child[i] = 0;
+    }
+}
+
+template <typename AABB, size_t W>
+inline void WideNode<AABB, W>::set_child_count(const size_t count)
+{
+    assert(count <= Width);
+    m_child_count = static_cast<uint32>(count);
+}
+
+template <typename AABB, size_t W>
+inline size_t WideNode<AABB, W>::get_child_count() const
+{
+    return static_cast<size_t>(m_child_count);
+}
+
+template <typename AABB, size_t W>
+inline void WideNode<AABB, W>::set_child_bbox(const size_t child, const AABBType& bbox)
+{
+    assert(child < Width);
+
+    for (size_t i = 0; i < Dimension; ++i)
+    {
+        m_bbox_data[i * 2 * Width + child] = bbox.min[i];
+        m_bbox_data[i * 2 * Width + Width + child] = bbox.max[i];
+    }
+}
+
+template <typename AABB, size_t W>
+inline AABB WideNode<AABB, W>::get_child_bbox(const size_t child) const
+{
+    assert(child < Width);
+
+    AABBType bbox;
+
+    for (size_t i = 0; i < Dimension; ++i)
+    {
+        bbox.min[i] = m_bbox_data[i * 2 * Width + child];
+        bbox.max[i] = m_bbox_data[i * 2 * Width + Width + child];
+    }
+
+    return bbox;
+}
+
+template <typename AABB, size_t W>
+inline void WideNode<AABB, W>::set_child_node(const size_t child, const size_t index)
+{
+    assert(child < Width);
+    assert(index < LeafFlag);
+    m_child[child] = static_cast<uint32>(index);
+}
+
+template <typename AABB, size_t W>
+inline void WideNode<AABB, W>::set_child_leaf(const size_t child, const size_t index)
+{
+    assert(child < Width);
+    assert(index < LeafFlag);
+    m_child[child] = static_cast<uint32>(index) | LeafFlag;
+}
+
+template <typename AABB, size_t W>
+inline bool WideNode<AABB, W>::is_child_leaf(const size_t child) const
+{
+    assert(child < Width);
+    return (m_child[child] & LeafFlag) != 0;
+}
+
+template <typename AABB, size_t W>
+inline size_t WideNode<AABB, W>::get_child_index(const size_t child) const
+{
+    assert(child < Width);
+    return static_cast<size_t>(m_child[child] & ~LeafFlag);
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDENODE_H
@@ -0,0 +1,269 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDETREE_H
+#define APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDETREE_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/bvh/bvh_widenode.h"
+#include "foundation/math/fp.h"
+#include "foundation/utility/alignedvector.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+#include <limits>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Wide (N-ary) BVH, obtained by collapsing a binary BVH without motion.
+//
+// Interior nodes of the binary BVH are merged into wide nodes of up to Width
+// children by repeatedly opening the interior child with the largest surface
+// area. Leaf nodes are not duplicated: wide nodes reference the leaf nodes of
+// the binary BVH, so the binary BVH must be kept alive alongside the wide one.
+//
+
+template <typename Tree, size_t W, typename AABB>
+class WideTree
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType BinaryNodeType;
+    typedef AABB AABBType;
+    typedef WideNode<AABBType, W> NodeType;
+    typedef AlignedVector<NodeType> NodeVectorType;
+    typedef typename NodeVectorType::allocator_type AllocatorType;
+
+    static const size_t Width = W;
+
+    // Constructor.
+    explicit WideTree(const AllocatorType& allocator = AllocatorType(64));
+
+    // Clear the tree.
+    void clear();
+
+    // Return true if the tree is empty.
+    bool empty() const;
+
+    // Build the wide tree from a binary tree without motion.
+    void collapse(const Tree& tree);
+
+    // Return the number of nodes in the tree.
+    size_t get_node_count() const;
+
+    // Return the size (in bytes) of this object in memory.
+    size_t get_memory_size() const;
+
+  private:
+    template <typename T, typename WT, typename Visitor, typename Ray, size_t StackSize, size_t N>
+    friend class WideIntersector;
+
+    typedef typename AABBType::ValueType ValueType;
+    typedef typename BinaryNodeType::AABBType BinaryAABBType;
+    typedef typename Tree::NodeVectorType BinaryNodeVectorType;
+
+    NodeVectorType  m_nodes;
+
+    size_t collapse_recurse(
+        const BinaryNodeVectorType& nodes,
+        const size_t                node_index);
+
+    // Convert a bounding box of the binary BVH to the precision of wide nodes.
+    static AABBType convert_bbox(const BinaryAABBType& bbox);
+};
+
+
+//
+// WideTree class implementation.
+//
+
+template <typename Tree, size_t W, typename AABB>
+WideTree<Tree, W, AABB>::WideTree(const AllocatorType& allocator)
+  : m_nodes(allocator)
+{
+}
+
+template <typename Tree, size_t W, typename AABB>
+void WideTree<Tree, W, AABB>::clear()
+{
+    m_nodes.clear();
+}
+
+template <typename Tree, size_t W, typename AABB>
+bool WideTree<Tree, W, AABB>::empty() const
+{
+    return m_nodes.empty();
+}
+
+template <typename Tree, size_t W, typename AABB>
+void WideTree<Tree, W, AABB>::collapse(const Tree& tree)
+{
+    clear();
+
+    if (tree.m_nodes.empty())
+        return;
+
+    if (tree.m_nodes[0].is_leaf())
+    {
+        // The binary tree is reduced to a single leaf, which has no bounding box:
+        // reference it from a root node through an unbounded bounding box.
+        AABBType bbox;
+        for (size_t i = 0; i < AABBType::Dimension; ++i)
+        {
+            bbox.min[i] = -std::numeric_limits<ValueType>::max();
+            bbox.max[i] = +std::numeric_limits<ValueType>::max();
+        }
+
+        m_nodes.push_back(NodeType());
+        m_nodes[0].set_child_count(1);
+        m_nodes[0].set_child_bbox(0, bbox);
+        m_nodes[0].set_child_leaf(0, 0);
+    }
+    else collapse_recurse(tree.m_nodes, 0);
+}
+
+template <typename Tree, size_t W, typename AABB>
+size_t WideTree<Tree, W, AABB>::get_node_count() const
+{
+    return m_nodes.size();
+}
+
+template <typename Tree, size_t W, typename AABB>
+size_t WideTree<Tree, W, AABB>::get_memory_size() const
+{
+    return
+          sizeof(*this)
+        + m_nodes.capacity() * sizeof(NodeType);
+}
+
+template <typename Tree, size_t W, typename AABB>
+size_t WideTree<Tree, W, AABB>::collapse_recurse(
+    const BinaryNodeVectorType& nodes,
+    const size_t                node_index)
+{
+    const BinaryNodeType& node = nodes[node_index];
+    assert(node.is_interior());
+
+    size_t child_indices[Width];
+    AABBType child_bboxes[Width];
+
+    child_indices[0] = node.get_child_node_index();
+    child_indices[1] = node.get_child_node_index() + 1;
+    child_bboxes[0] = convert_bbox(node.get_left_bbox());
+    child_bboxes[1] = convert_bbox(node.get_right_bbox());
+    size_t child_count = 2;
+
+    // Open the interior child with the largest surface area until all slots are used.
+    while (child_count < Width)
+    {
+        size_t best_child = Width;
+        ValueType best_area = ValueType(-1.0);
+
+        for (size_t i = 0; i < child_count; ++i)
+        {
+            if (nodes[child_indices[i]].is_leaf())
+                continue;
+
+            const ValueType area =
+                child_bboxes[i].is_valid() ? half_surface_area(child_bboxes[i]) : ValueType(0.0);
+
+            if (best_area < area)
+            {
+                best_area = area;
+                best_child = i;
+            }
+        }
+
+        if (best_child == Width)
+            break;
+
+        const BinaryNodeType& opened = nodes[child_indices[best_child]];
+        child_indices[child_count] = opened.get_child_node_index() + 1;
+        child_bboxes[child_count] = convert_bbox(opened.get_right_bbox());
+        child_indices[best_child] = opened.get_child_node_index();
+        child_bboxes[best_child] = convert_bbox(opened.get_left_bbox());
+        ++child_count;
+    }
+
+    // Create the wide node. Child wide nodes are created after their parent.
+    const size_t wide_index = m_nodes.size();
+    m_nodes.push_back(NodeType());
+    m_nodes[wide_index].set_child_count(child_count);
+
+    for (size_t i = 0; i < child_count; ++i)
+    {
+        m_nodes[wide_index].set_child_bbox(i, child_bboxes[i]);
+
+        if (nodes[child_indices[i]].is_leaf())
+        {
+            m_nodes[wide_index].set_child_leaf(i, child_indices[i]);
+        }
+        else
+        {
+            const size_t child_wide_index = collapse_recurse(nodes, child_indices[i]);
+            m_nodes[wide_index].set_child_node(i, child_wide_index);
+        }
+    }
+
+    return wide_index;
+}
+
+template <typename Tree, size_t W, typename AABB>
+inline typename WideTree<Tree, W, AABB>::AABBType WideTree<Tree, W, AABB>::convert_bbox(
+    const BinaryAABBType&       bbox)
+{
+    if (!bbox.is_valid())
+        return AABBType::invalid();
+
+    AABBType result;
+
+    for (size_t i = 0; i < AABBType::Dimension; ++i)
+    {
+        result.min[i] = static_cast<ValueType>(bbox.min[i]);
+        result.max[i] = static_cast<ValueType>(bbox.max[i]);
+
+        if (result.min[i] > bbox.min[i])
+            result.min[i] = shift(result.min[i], -1);
+
+        if (result.max[i] < bbox.max[i])
+            result.max[i] = shift(result.max[i], +1);
+    }
+
+    return result;
+}
+
+}       // namespace bvh
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_BVH_BVH_WIDETREE_H
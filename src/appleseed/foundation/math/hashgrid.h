@@ -0,0 +1,285 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_HASHGRID_H
+#define APPLESEED_FOUNDATION_MATH_HASHGRID_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/distance.h"
+#include "foundation/math/hash.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace foundation
+{
+
+//
+// A spatial hash grid for fixed-radius searches in a 3D point set.
+//
+// Space is divided into cubic cells whose size is chosen at build time; cells are
+// mapped to a table of buckets by hashing their integer coordinates, so the memory
+// footprint only depends on the number of points. Points are stored sorted by bucket
+// so that the points of a cell are contiguous in memory.
+//
+// Searches are most efficient when the search radius is about half the cell size:
+// the search sphere then overlaps at most 2x2x2 cells.
+//
+// Reference:
+//
+//   Optimized Spatial Hashing for Collision Detection of Deformable Objects
+//   Matthias Teschner, Bruno Heidelberger, Matthias Mueller, Danat Pomeranets, Markus Gross
+//   http://www.beosil.com/download/CollisionDetectionHashing_VMV03.pdf
+//
+
+template <typename T>
+class HashGrid3
+  : public NonCopyable
+{
+  public:
+    // Types.
+    typedef T ValueType;
+    typedef Vector<T, 3> VectorType;
+
+    // Constructor, builds an empty grid.
+    HashGrid3();
+
+    // Build the grid for a given set of points. The points will be moved into the grid.
+    void build_move_points(
+        std::vector<VectorType>&    points,
+        const ValueType             cell_size);
+
+    // Return true if the grid does not contain any point.
+    bool empty() const;
+
+    // Return the number of points in the grid.
+    size_t size() const;
+
+    // Transform an internal index to a user-data index.
+    size_t remap(const size_t i) const;
+
+    // Return the i'th point, where i is an internal index.
+    const VectorType& get_point(const size_t i) const;
+
+    // Return the size (in bytes) of this object in memory.
+    size_t get_memory_size() const;
+
+    // Call visitor.visit(i, square_dist) for every point within a given distance of a
+    // query point, where i is the internal index of the point. Each point is visited once.
+    template <typename Visitor>
+    void find_points(
+        const VectorType&           point,
+        const ValueType             max_dist,
+        Visitor&                    visitor) const;
+
+  private:
+    typedef Vector<int32, 3> CellType;
+
+    ValueType                       m_rcp_cell_size;
+    size_t                          m_bucket_mask;
+    std::vector<size_t>             m_bucket_begin;     // index of the first point of each bucket, plus an end marker
+    std::vector<VectorType>         m_points;           // sorted by bucket
+    std::vector<size_t>             m_indices;          // internal index -> user-data index
+
+    CellType compute_cell(const VectorType& point) const;
+
+    size_t compute_bucket(const CellType& cell) const;
+};
+
+typedef HashGrid3<float>  HashGrid3f;
+typedef HashGrid3<double> HashGrid3d;
+
+
+//
+// HashGrid3 class implementation.
+//
+
+template <typename T>
+inline HashGrid3<T>::HashGrid3()
+  : m_rcp_cell_size(T(1.0))
+  , m_bucket_mask(0)
+{
+}
+
+template <typename T>
+void HashGrid3<T>::build_move_points(
+    std::vector<VectorType>&        points,
+    const ValueType                 cell_size)
+{
+    assert(cell_size > T(0.0));
+
+    const size_t count = points.size();
+
+    // Use a power-of-two number of buckets, about as many as there are points.
+    size_t bucket_count = 1;
+    while (bucket_count < count)
+        bucket_count *= 2;
+
+    m_rcp_cell_size = T(1.0) / cell_size;
+    m_bucket_mask = bucket_count - 1;
+
+    // Count the points in each bucket.
+    std::vector<size_t> point_buckets(count);
+    m_bucket_begin.assign(bucket_count + 1, 0);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        point_buckets[i] = compute_bucket(compute_cell(points[i]));
+        ++m_bucket_begin[point_buckets[i] + 1];
+    }
+
+    for (size_t i = 0; i < bucket_count; ++i)
+        m_bucket_begin[i + 1] += m_bucket_begin[i];
+
+    // Sort the points by bucket.
+    std::vector<size_t> bucket_end(m_bucket_begin.begin(), m_bucket_begin.end() - 1);
+    m_indices.resize(count);
+
+    for (size_t i = 0; i < count; ++i)
+        m_indices[bucket_end[point_buckets[i]]++] = i;
+
+    m_points.resize(count);
+
+    for (size_t i = 0; i < count; ++i)
+        m_points[i] = points[m_indices[i]];
+
+    std::vector<VectorType>().swap(points);
+}
+
+template <typename T>
+inline bool HashGrid3<T>::empty() const
+{
+    return m_points.empty();
+}
+
+template <typename T>
+inline size_t HashGrid3<T>::size() const
+{
+    return m_points.size();
+}
+
+template <typename T>
+inline size_t HashGrid3<T>::remap(const size_t i) const
+{
+    assert(i < m_indices.size());
+    return m_indices[i];
+}
+
+template <typename T>
+inline const typename HashGrid3<T>::VectorType& HashGrid3<T>::get_point(const size_t i) const
+{
+    assert(i < m_points.size());
+    return m_points[i];
+}
+
+template <typename T>
+inline size_t HashGrid3<T>::get_memory_size() const
+{
+    return
+          sizeof(*this)
+        + m_bucket_begin.capacity() * sizeof(size_t)
+        + m_points.capacity() * sizeof(VectorType)
+        + m_indices.capacity() * sizeof(size_t);
+}
+
+template <typename T>
+template <typename Visitor>
+void HashGrid3<T>::find_points(
+    const VectorType&               point,
+    const ValueType                 max_dist,
+    Visitor&                        visitor) const
+{
+    if (m_points.empty())
+        return;
+
+    const ValueType max_square_dist = max_dist * max_dist;
+    const CellType min_cell = compute_cell(point - VectorType(max_dist));
+    const CellType max_cell = compute_cell(point + VectorType(max_dist));
+
+    CellType cell;
+
+    for (cell[2] = min_cell[2]; cell[2] <= max_cell[2]; ++cell[2])
+    {
+        for (cell[1] = min_cell[1]; cell[1] <= max_cell[1]; ++cell[1])
+        {
+            for (cell[0] = min_cell[0]; cell[0] <= max_cell[0]; ++cell[0])
+            {
+                const size_t bucket = compute_bucket(cell);
+                const size_t end = m_bucket_begin[bucket + 1];
+
+                for (size_t i = m_bucket_begin[bucket]; i < end; ++i)
+                {
+                    const ValueType d = square_distance(m_points[i], point);
+
+                    if (d >= max_square_dist)
+                        continue;
+
+                    // Several cells may share this bucket: only visit the points of this cell.
+                    if (compute_cell(m_points[i]) != cell)
+                        continue;
+
+                    visitor.visit(i, d);
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+inline typename HashGrid3<T>::CellType HashGrid3<T>::compute_cell(const VectorType& point) const
+{
+    return
+        CellType(
+            static_cast<int32>(std::floor(point[0] * m_rcp_cell_size)),
+            static_cast<int32>(std::floor(point[1] * m_rcp_cell_size)),
+            static_cast<int32>(std::floor(point[2] * m_rcp_cell_size)));
+}
+
+template <typename T>
+inline size_t HashGrid3<T>::compute_bucket(const CellType& cell) const
+{
+    const uint32 h =
+        mix_uint32(
+            static_cast<uint32>(cell[0]),
+            static_cast<uint32>(cell[1]),
+            static_cast<uint32>(cell[2]));
+
+    return static_cast<size_t>(h) & m_bucket_mask;
+}
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_HASHGRID_H
@@ -33,10 +33,12 @@
 // Interface headers.
 #include "foundation/math/intersection/aabbtriangle.h"
 #include "foundation/math/intersection/rayaabb.h"
+#include "foundation/math/intersection/rayobb.h"
 #include "foundation/math/intersection/rayplane.h"
 #include "foundation/math/intersection/raysphere.h"
 #include "foundation/math/intersection/raytrianglehh.h"
 #include "foundation/math/intersection/raytrianglemt.h"
 #include "foundation/math/intersection/raytrianglessk.h"
+#include "foundation/math/intersection/raytrianglewt.h"
 
 #endif  // !APPLESEED_FOUNDATION_MATH_INTERSECTION_H
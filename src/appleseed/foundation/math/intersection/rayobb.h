@@ -0,0 +1,241 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_INTERSECTION_RAYOBB_H
+#define APPLESEED_FOUNDATION_MATH_INTERSECTION_RAYOBB_H
+
+// appleseed.foundation headers.
+#include "foundation/math/minmax.h"
+#include "foundation/math/ray.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/compiler.h"
+#ifdef APPLESEED_USE_SSE
+#include "foundation/platform/sse.h"
+#endif
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation
+{
+
+//
+// A packet of four 3D oriented bounding boxes, in structure-of-arrays layout.
+//
+// Each box is stored as its center and the linear transform that maps offsets
+// from its center to the cube [-1, 1]^3. A ray is intersected with a box by
+// transforming it with this matrix and clipping it against the cube, which lets
+// a single ray be tested against the four boxes of a packet with a handful of
+// SIMD instructions. Offsetting the ray by the center of the box before rotating
+// it keeps the test accurate for small boxes far from the origin.
+//
+
+template <typename T>
+class OBBPacket4
+{
+  public:
+    // Value and vector types.
+    typedef T ValueType;
+    typedef Vector<T, 3> VectorType;
+
+    // Number of boxes in a packet.
+    static const size_t Width = 4;
+
+    // Constructor, sets all boxes to the cube [-1, 1]^3.
+    OBBPacket4();
+
+    // Set a box from its center, its orthonormal axes and its (strictly positive)
+    // half extents along these axes.
+    void set(
+        const size_t        index,
+        const VectorType&   center,
+        const VectorType    axes[3],
+        const VectorType&   half_extents);
+
+    // Centers of the boxes, one value per box: m_center[coordinate][box].
+    SSE_ALIGN ValueType m_center[3][Width];
+
+    // Rows of the 3x3 transforms, one value per box: m_xfm[row * 3 + column][box].
+    SSE_ALIGN ValueType m_xfm[9][Width];
+};
+
+
+//
+// 3D ray-OBB packet intersection.
+//
+
+// Test the intersection between a ray and the four boxes of a packet. Return a
+// mask whose bit i is set if the ray intersects box i in [ray.m_tmin, ray.m_tmax].
+// Packets that are not full should mask out the bits of their unused boxes.
+template <typename T>
+size_t intersect(
+    const Ray<T, 3>&        ray,
+    const OBBPacket4<T>&    obbs);
+
+
+//
+// OBBPacket4 class implementation.
+//
+
+template <typename T>
+inline OBBPacket4<T>::OBBPacket4()
+{
+    const VectorType axes[3] =
+    {
+        VectorType(T(1.0), T(0.0), T(0.0)),
+        VectorType(T(0.0), T(1.0), T(0.0)),
+        VectorType(T(0.0), T(0.0), T(1.0))
+    };
+
+    for (size_t i = 0; i < Width; ++i)
+        set(i, VectorType(T(0.0)), axes, VectorType(T(1.0)));
+}
+
+template <typename T>
+inline void OBBPacket4<T>::set(
+    const size_t            index,
+    const VectorType&       center,
+    const VectorType        axes[3],
+    const VectorType&       half_extents)
+{
+    assert(index < Width);
+
+    for (size_t d = 0; d < 3; ++d)
+    {
+        assert(half_extents[d] > T(0.0));
+
+        const VectorType row = axes[d] / half_extents[d];
+
+        m_center[d][index] = center[d];
+        m_xfm[d * 3 + 0][index] = row.x;
+        m_xfm[d * 3 + 1][index] = row.y;
+        m_xfm[d * 3 + 2][index] = row.z;
+    }
+}
+
+
+//
+// 3D ray-OBB packet intersection implementation.
+//
+
+template <typename T>
+inline size_t intersect(
+    const Ray<T, 3>&        ray,
+    const OBBPacket4<T>&    obbs)
+{
+    size_t mask = 0;
+
+    for (size_t i = 0; i < OBBPacket4<T>::Width; ++i)
+    {
+        const T org_x = ray.m_org.x - obbs.m_center[0][i];
+        const T org_y = ray.m_org.y - obbs.m_center[1][i];
+        const T org_z = ray.m_org.z - obbs.m_center[2][i];
+
+        T tmin = ray.m_tmin;
+        T tmax = ray.m_tmax;
+
+        for (size_t d = 0; d < 3; ++d)
+        {
+            const T m0 = obbs.m_xfm[d * 3 + 0][i];
+            const T m1 = obbs.m_xfm[d * 3 + 1][i];
+            const T m2 = obbs.m_xfm[d * 3 + 2][i];
+
+            // Transform the ray to the space of the box.
+            const T org = m0 * org_x + m1 * org_y + m2 * org_z;
+            const T dir = m0 * ray.m_dir.x + m1 * ray.m_dir.y + m2 * ray.m_dir.z;
+            const T rcp_dir = T(1.0) / dir;
+
+            // Clip the ray against the slab [-1, 1].
+            const T t1 = (T(-1.0) - org) * rcp_dir;
+            const T t2 = (T( 1.0) - org) * rcp_dir;
+            tmin = ssemax(ssemin(t1, t2), tmin);
+            tmax = ssemin(ssemax(t1, t2), tmax);
+        }
+
+        if (tmin <= tmax)
+            mask |= size_t(1) << i;
+    }
+
+    return mask;
+}
+
+#ifdef APPLESEED_USE_SSE
+
+template <>
+inline size_t intersect<float>(
+    const Ray3f&            ray,
+    const OBBPacket4<float>& obbs)
+{
+    const __m128 org_x = _mm_sub_ps(_mm_set1_ps(ray.m_org.x), _mm_load_ps(obbs.m_center[0]));
+    const __m128 org_y = _mm_sub_ps(_mm_set1_ps(ray.m_org.y), _mm_load_ps(obbs.m_center[1]));
+    const __m128 org_z = _mm_sub_ps(_mm_set1_ps(ray.m_org.z), _mm_load_ps(obbs.m_center[2]));
+
+    const __m128 dir_x = _mm_set1_ps(ray.m_dir.x);
+    const __m128 dir_y = _mm_set1_ps(ray.m_dir.y);
+    const __m128 dir_z = _mm_set1_ps(ray.m_dir.z);
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minus_one = _mm_set1_ps(-1.0f);
+
+    __m128 tmin = _mm_set1_ps(ray.m_tmin);
+    __m128 tmax = _mm_set1_ps(ray.m_tmax);
+
+    for (size_t d = 0; d < 3; ++d)
+    {
+        const __m128 m0 = _mm_load_ps(obbs.m_xfm[d * 3 + 0]);
+        const __m128 m1 = _mm_load_ps(obbs.m_xfm[d * 3 + 1]);
+        const __m128 m2 = _mm_load_ps(obbs.m_xfm[d * 3 + 2]);
+
+        // Transform the ray to the space of the boxes.
+        const __m128 org =
+            _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(m0, org_x), _mm_mul_ps(m1, org_y)),
+                _mm_mul_ps(m2, org_z));
+        const __m128 dir =
+            _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(m0, dir_x), _mm_mul_ps(m1, dir_y)),
+                _mm_mul_ps(m2, dir_z));
+        const __m128 rcp_dir = _mm_div_ps(one, dir);
+
+        // Clip the ray against the slabs [-1, 1].
+        const __m128 t1 = _mm_mul_ps(_mm_sub_ps(minus_one, org), rcp_dir);
+        const __m128 t2 = _mm_mul_ps(_mm_sub_ps(one, org), rcp_dir);
+        tmin = _mm_max_ps(_mm_min_ps(t1, t2), tmin);
+        tmax = _mm_min_ps(_mm_max_ps(t1, t2), tmax);
+    }
+
+    return static_cast<size_t>(_mm_movemask_ps(_mm_cmple_ps(tmin, tmax)));
+}
+
+#endif  // APPLESEED_USE_SSE
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_INTERSECTION_RAYOBB_H
@@ -0,0 +1,297 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_MATH_INTERSECTION_RAYTRIANGLEWT_H
+#define APPLESEED_FOUNDATION_MATH_INTERSECTION_RAYTRIANGLEWT_H
+
+// appleseed.foundation headers.
+#include "foundation/math/ray.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/compiler.h"
+
+// Standard headers.
+#include <algorithm>
+
+namespace foundation
+{
+
+//
+// Watertight ray-triangle intersection test.
+//
+// The test never misses a ray that goes through an edge or a vertex shared by
+// two triangles, even in single precision. It is therefore suitable for storing
+// and intersecting geometry in single precision. The triangle is stored as its
+// three vertices so that shared edges are evaluated identically by neighboring
+// triangles.
+//
+// Barycentric coordinates (u, v) follow the same convention as the other tests:
+// the hit point is (1 - u - v) * v0 + u * v1 + v * v2.
+//
+// Reference:
+//
+//   Watertight Ray/Triangle Intersection
+//   http://jcgt.org/published/0002/01/05/paper.pdf
+//
+
+template <typename T>
+struct TriangleWT
+{
+    // Types.
+    typedef T ValueType;
+    typedef Vector<T, 3> VectorType;
+    typedef Ray<T, 3> RayType;
+
+    // Vertices.
+    VectorType  m_v0;
+    VectorType  m_v1;
+    VectorType  m_v2;
+
+    // Constructors.
+    TriangleWT();
+    TriangleWT(
+        const VectorType&   v0,
+        const VectorType&   v1,
+        const VectorType&   v2);
+
+    // Construct a triangle from another triangle of a different type.
+    template <typename U>
+    TriangleWT(const TriangleWT<U>& rhs);
+
+    bool intersect(
+        const RayType&      ray,
+        ValueType&          t,
+        ValueType&          u,
+        ValueType&          v) const;
+
+    bool intersect(const RayType& ray) const;
+
+  private:
+    // Compute the scaled barycentric coordinates (U, V, W) of the intersection
+    // and the scaled hit distance T, return false if the ray misses the triangle.
+    bool compute(
+        const RayType&      ray,
+        ValueType&          det,
+        ValueType&          scaled_t,
+        ValueType&          scaled_u,
+        ValueType&          scaled_v) const;
+};
+
+template <typename T>
+struct TriangleWTSupportPlane
+{
+    // Types.
+    typedef T ValueType;
+    typedef Vector<T, 3> VectorType;
+    typedef Ray<T, 3> RayType;
+
+    // A point of the plane.
+    VectorType  m_p;
+
+    // Normal vector (not normalized).
+    VectorType  m_n;
+
+    // Constructors.
+    TriangleWTSupportPlane();
+    explicit TriangleWTSupportPlane(const TriangleWT<T>& triangle);
+
+    void initialize(const TriangleWT<T>& triangle);
+
+    ValueType intersect(
+        const VectorType&   org,
+        const VectorType&   dir) const;
+};
+
+
+//
+// TriangleWT class implementation.
+//
+
+template <typename T>
+inline TriangleWT<T>::TriangleWT()
+{
+}
+
+template <typename T>
+inline TriangleWT<T>::TriangleWT(
+    const VectorType&       v0,
+    const VectorType&       v1,
+    const VectorType&       v2)
+  : m_v0(v0)
+  , m_v1(v1)
+  , m_v2(v2)
+{
+}
+
+template <typename T>
+template <typename U>
+FORCE_INLINE TriangleWT<T>::TriangleWT(const TriangleWT<U>& rhs)
+  : m_v0(VectorType(rhs.m_v0))
+  , m_v1(VectorType(rhs.m_v1))
+  , m_v2(VectorType(rhs.m_v2))
+{
+}
+
+template <typename T>
+FORCE_INLINE bool TriangleWT<T>::compute(
+    const RayType&          ray,
+    ValueType&              det,
+    ValueType&              scaled_t,
+    ValueType&              scaled_u,
+    ValueType&              scaled_v) const
+{
+    // Permute the axes so that the largest component of the ray direction is z,
+    // preserving the winding of the triangle.
+    const size_t kz = max_abs_index(ray.m_dir);
+    size_t kx = kz == 2 ? 0 : kz + 1;
+    size_t ky = kx == 2 ? 0 : kx + 1;
+    if (ray.m_dir[kz] < ValueType(0.0))
+        std::swap(kx, ky);
+
+    // Shear constants that align the ray direction with the z axis.
+    const ValueType sz = ValueType(1.0) / ray.m_dir[kz];
+    const ValueType sx = ray.m_dir[kx] * sz;
+    const ValueType sy = ray.m_dir[ky] * sz;
+
+    // Vertices relative to the ray origin.
+    const VectorType a = m_v0 - ray.m_org;
+    const VectorType b = m_v1 - ray.m_org;
+    const VectorType c = m_v2 - ray.m_org;
+
+    // Shear and scale the vertices.
+    const ValueType ax = a[kx] - sx * a[kz];
+    const ValueType ay = a[ky] - sy * a[kz];
+    const ValueType bx = b[kx] - sx * b[kz];
+    const ValueType by = b[ky] - sy * b[kz];
+    const ValueType cx = c[kx] - sx * c[kz];
+    const ValueType cy = c[ky] - sy * c[kz];
+
+    // Compute the scaled barycentric coordinates.
+    ValueType w0 = cx * by - cy * bx;
+    ValueType w1 = ax * cy - ay * cx;
+    ValueType w2 = bx * ay - by * ax;
+
+    // Fall back to double precision when the ray goes exactly through an edge.
+    if (w0 == ValueType(0.0) || w1 == ValueType(0.0) || w2 == ValueType(0.0))
+    {
+        w0 = static_cast<ValueType>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+        w1 = static_cast<ValueType>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+        w2 = static_cast<ValueType>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
+    }
+
+    // Test the edges.
+    if ((w0 < ValueType(0.0) || w1 < ValueType(0.0) || w2 < ValueType(0.0)) &&
+        (w0 > ValueType(0.0) || w1 > ValueType(0.0) || w2 > ValueType(0.0)))
+        return false;
+
+    // Calculate determinant, reject rays parallel to the triangle.
+    det = w0 + w1 + w2;
+    if (det == ValueType(0.0))
+        return false;
+
+    // Calculate the scaled hit distance and test bounds.
+    scaled_t = sz * (w0 * a[kz] + w1 * b[kz] + w2 * c[kz]);
+    if (det > ValueType(0.0))
+    {
+        if (scaled_t >= ray.m_tmax * det || scaled_t < ray.m_tmin * det)
+            return false;
+    }
+    else
+    {
+        if (scaled_t <= ray.m_tmax * det || scaled_t > ray.m_tmin * det)
+            return false;
+    }
+
+    scaled_u = w1;
+    scaled_v = w2;
+
+    // Ray intersects triangle.
+    return true;
+}
+
+template <typename T>
+FORCE_INLINE bool TriangleWT<T>::intersect(
+    const RayType&          ray,
+    ValueType&              t,
+    ValueType&              u,
+    ValueType&              v) const
+{
+    ValueType det;
+    if (!compute(ray, det, t, u, v))
+        return false;
+
+    // Scale parameters.
+    const ValueType rcp_det = ValueType(1.0) / det;
+    t *= rcp_det;
+    u *= rcp_det;
+    v *= rcp_det;
+
+    return true;
+}
+
+template <typename T>
+FORCE_INLINE bool TriangleWT<T>::intersect(const RayType& ray) const
+{
+    ValueType det, t, u, v;
+    return compute(ray, det, t, u, v);
+}
+
+
+//
+// TriangleWTSupportPlane class implementation.
+//
+
+template <typename T>
+inline TriangleWTSupportPlane<T>::TriangleWTSupportPlane()
+{
+}
+
+template <typename T>
+inline TriangleWTSupportPlane<T>::TriangleWTSupportPlane(const TriangleWT<T>& triangle)
+{
+    initialize(triangle);
+}
+
+template <typename T>
+inline void TriangleWTSupportPlane<T>::initialize(const TriangleWT<T>& triangle)
+{
+    m_p = triangle.m_v0;
+    m_n = cross(triangle.m_v1 - triangle.m_v0, triangle.m_v2 - triangle.m_v0);
+}
+
+template <typename T>
+inline T TriangleWTSupportPlane<T>::intersect(
+    const VectorType&       org,
+    const VectorType&       dir) const
+{
+    return dot(m_p - org, m_n) / dot(dir, m_n);
+}
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_MATH_INTERSECTION_RAYTRIANGLEWT_H
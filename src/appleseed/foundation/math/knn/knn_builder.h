@@ -38,6 +38,8 @@
 #include "foundation/math/permutation.h"
 #include "foundation/math/split.h"
 #include "foundation/math/vector.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobqueue.h"
 #include "foundation/utility/stopwatch.h"
 
 // Standard headers.
@@ -75,6 +77,14 @@ class Builder
     void build_move_points(
         std::vector<VectorType>&    points);
 
+    // Like build_move_points() but the work is split into jobs executed by the worker
+    // threads of a job queue. The resulting tree is identical to the one built serially.
+    // Must not be called from one of the worker threads of the job queue.
+    template <typename Timer>
+    void build_move_points(
+        std::vector<VectorType>&    points,
+        JobQueue&                   job_queue);
+
     // Return the construction time.
     double get_build_time() const;
 
@@ -98,13 +108,67 @@ class Builder
             const size_t            index) const;
     };
 
+    // Ranges of points larger than this are partitioned and reordered by separate jobs.
+    enum { MinJobPointCount = 16 * 1024 };
+
+    class PartitionJob
+      : public IJob
+    {
+      public:
+        PartitionJob(
+            const Builder&          builder,
+            JobQueue&               job_queue,
+            const size_t            node_index,
+            const size_t            child_node_index,
+            const size_t            begin,
+            const size_t            end);
+
+        virtual void execute(const size_t thread_index);
+
+      private:
+        const Builder&              m_builder;
+        JobQueue&                   m_job_queue;
+        const size_t                m_node_index;
+        const size_t                m_child_node_index;
+        const size_t                m_begin;
+        const size_t                m_end;
+    };
+
+    class ReorderJob
+      : public IJob
+    {
+      public:
+        ReorderJob(
+            const TreeType&         tree,
+            VectorType              sorted_points[],
+            const size_t            begin,
+            const size_t            end);
+
+        virtual void execute(const size_t thread_index);
+
+      private:
+        const TreeType&             m_tree;
+        VectorType*                 m_sorted_points;
+        const size_t                m_begin;
+        const size_t                m_end;
+    };
+
     TreeType&   m_tree;
     double      m_build_time;
 
+    template <typename Timer>
+    void build_move_points(
+        std::vector<VectorType>&    points,
+        JobQueue*                   job_queue);
+
+    // A subtree over n > 0 points always has 2n - 1 nodes: the descendants of a node
+    // are stored contiguously starting at child_node_index, left subtree first.
     void partition(
-        const size_t                parent_node_index,
+        const size_t                node_index,
+        const size_t                child_node_index,
         const size_t                begin,
-        const size_t                end) const;
+        const size_t                end,
+        JobQueue*                   job_queue) const;
 
     BboxType compute_bbox(
         const size_t                begin,
@@ -147,8 +211,26 @@ void Builder<T, N>::build(
 
 template <typename T, size_t N>
 template <typename Timer>
-void Builder<T, N>::build_move_points(
+inline void Builder<T, N>::build_move_points(
     std::vector<VectorType>&    points)
+{
+    build_move_points<Timer>(points, static_cast<JobQueue*>(0));
+}
+
+template <typename T, size_t N>
+template <typename Timer>
+inline void Builder<T, N>::build_move_points(
+    std::vector<VectorType>&    points,
+    JobQueue&                   job_queue)
+{
+    build_move_points<Timer>(points, &job_queue);
+}
+
+template <typename T, size_t N>
+template <typename Timer>
+void Builder<T, N>::build_move_points(
+    std::vector<VectorType>&    points,
+    JobQueue*                   job_queue)
 {
     Stopwatch<Timer> stopwatch;
     stopwatch.start();
@@ -165,20 +247,43 @@ void Builder<T, N>::build_move_points(
             m_tree.m_indices[i] = i;
     }
 
-    m_tree.m_nodes.reserve(count * 2 + 1);
-    m_tree.m_nodes.push_back(NodeType());
+    m_tree.m_nodes.resize(count > 0 ? count * 2 - 1 : 1);
 
-    partition(0, 0, count);
+    if (job_queue && count > MinJobPointCount)
+    {
+        job_queue->schedule(new PartitionJob(*this, *job_queue, 0, 1, 0, count));
+        job_queue->wait_until_completion();
 
-    if (count > 0)
+        std::vector<VectorType> sorted_points(count);
+
+        for (size_t i = 0; i < count; i += MinJobPointCount)
+        {
+            job_queue->schedule(
+                new ReorderJob(
+                    m_tree,
+                    &sorted_points[0],
+                    i,
+                    std::min(i + MinJobPointCount, count)));
+        }
+
+        job_queue->wait_until_completion();
+
+        m_tree.m_points.swap(sorted_points);
+    }
+    else
     {
-        std::vector<VectorType> temp(count);
+        partition(0, 1, 0, count, 0);
+
+        if (count > 0)
+        {
+            std::vector<VectorType> temp(count);
 
-        small_item_reorder(
-            &m_tree.m_points[0],
-            &temp[0],
-            &m_tree.m_indices[0],
-            count);
+            small_item_reorder(
+                &m_tree.m_points[0],
+                &temp[0],
+                &m_tree.m_indices[0],
+                count);
+        }
     }
 
     stopwatch.measure();
@@ -207,20 +312,70 @@ inline bool Builder<T, N>::PartitionPredicate::operator()(
     return m_points[index][m_split.m_dimension] < m_split.m_abscissa;
 }
 
+template <typename T, size_t N>
+Builder<T, N>::PartitionJob::PartitionJob(
+    const Builder&              builder,
+    JobQueue&                   job_queue,
+    const size_t                node_index,
+    const size_t                child_node_index,
+    const size_t                begin,
+    const size_t                end)
+  : m_builder(builder)
+  , m_job_queue(job_queue)
+  , m_node_index(node_index)
+  , m_child_node_index(child_node_index)
+  , m_begin(begin)
+  , m_end(end)
+{
+}
+
+template <typename T, size_t N>
+void Builder<T, N>::PartitionJob::execute(const size_t thread_index)
+{
+    m_builder.partition(
+        m_node_index,
+        m_child_node_index,
+        m_begin,
+        m_end,
+        &m_job_queue);
+}
+
+template <typename T, size_t N>
+Builder<T, N>::ReorderJob::ReorderJob(
+    const TreeType&             tree,
+    VectorType                  sorted_points[],
+    const size_t                begin,
+    const size_t                end)
+  : m_tree(tree)
+  , m_sorted_points(sorted_points)
+  , m_begin(begin)
+  , m_end(end)
+{
+}
+
+template <typename T, size_t N>
+void Builder<T, N>::ReorderJob::execute(const size_t thread_index)
+{
+    for (size_t i = m_begin; i < m_end; ++i)
+        m_sorted_points[i] = m_tree.m_points[m_tree.m_indices[i]];
+}
+
 template <typename T, size_t N>
 void Builder<T, N>::partition(
-    const size_t                parent_node_index,
+    const size_t                node_index,
+    const size_t                child_node_index,
     const size_t                begin,
-    const size_t                end) const
+    const size_t                end,
+    JobQueue*                   job_queue) const
 {
     const size_t count = end - begin;
 
     if (count <= 1)
     {
-        NodeType& parent_node = m_tree.m_nodes[parent_node_index];
-        parent_node.make_leaf();
-        parent_node.set_point_index(begin);
-        parent_node.set_point_count(count);
+        NodeType& node = m_tree.m_nodes[node_index];
+        node.make_leaf();
+        node.set_point_index(begin);
+        node.set_point_count(count);
     }
     else
     {
@@ -245,22 +400,38 @@ void Builder<T, N>::partition(
             split.m_abscissa = median_point[split.m_dimension];
         }
 
-        const size_t left_node_index = m_tree.m_nodes.size();
-        const size_t right_node_index = left_node_index + 1;
-
-        m_tree.m_nodes.push_back(NodeType());
-        m_tree.m_nodes.push_back(NodeType());
-
-        NodeType& parent_node = m_tree.m_nodes[parent_node_index];
-        parent_node.make_interior();
-        parent_node.set_split_dim(split.m_dimension);
-        parent_node.set_split_abs(split.m_abscissa);
-        parent_node.set_child_node_index(left_node_index);
-        parent_node.set_point_index(begin);
-        parent_node.set_point_count(count);
+        // Both children are non-empty, so the left subtree has 2 * (pivot - begin) - 1 nodes.
+        const size_t left_node_index = child_node_index;
+        const size_t right_node_index = child_node_index + 1;
+        const size_t left_child_node_index = child_node_index + 2;
+        const size_t right_child_node_index = left_child_node_index + 2 * (pivot - begin) - 2;
+
+        NodeType& node = m_tree.m_nodes[node_index];
+        node.make_interior();
+        node.set_split_dim(split.m_dimension);
+        node.set_split_abs(split.m_abscissa);
+        node.set_child_node_index(left_node_index);
+        node.set_point_index(begin);
+        node.set_point_count(count);
+
+        // Hand the right subtree over to another job if it is large enough.
+        if (job_queue && end - pivot > MinJobPointCount)
+        {
+            job_queue->schedule(
+                new PartitionJob(
+                    *this,
+                    *job_queue,
+                    right_node_index,
+                    right_child_node_index,
+                    pivot,
+                    end));
+        }
+        else
+        {
+            partition(right_node_index, right_child_node_index, pivot, end, job_queue);
+        }
 
-        partition(left_node_index, begin, pivot);
-        partition(right_node_index, pivot, end);
+        partition(left_node_index, left_child_node_index, begin, pivot, job_queue);
     }
 }
 
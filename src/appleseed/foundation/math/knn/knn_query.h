@@ -548,7 +548,10 @@ inline void Query<T, N>::find_multiple_nearest_neighbors(
                     m_answer.array_insert(point_index, square_dist);
 
                     if (m_answer.m_size == max_answer_size)
+                    {
                         m_answer.make_heap();
+                        max_square_dist = m_answer.top().m_square_dist;
+                    }
                 }
             }
 
@@ -0,0 +1,112 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+#include "foundation/utility/arena.h"
+#include "foundation/utility/benchmark.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+BENCHMARK_SUITE(Foundation_Utility_Arena)
+{
+    using namespace foundation;
+    using namespace std;
+
+    // Mimic the scratch allocations made while shading one sample:
+    // a handful of small, differently sized blocks, all released together.
+    const size_t N = 32;
+    const size_t Sizes[] = { 16, 48, 96, 256, 24, 640, 32, 128 };
+
+    struct NewDeleteFixture
+    {
+        void* m_p[N];
+
+        void allocate_release_batch()
+        {
+            for (size_t i = 0; i < N; ++i)
+                m_p[i] = ::operator new(Sizes[i % 8]);
+
+            for (size_t i = 0; i < N; ++i)
+                ::operator delete(m_p[i]);
+        }
+    };
+
+    struct ArenaFixture
+    {
+        Arena   m_arena;
+        void*   m_p[N];
+
+        void allocate_release_batch()
+        {
+            for (size_t i = 0; i < N; ++i)
+                m_p[i] = m_arena.allocate(Sizes[i % 8]);
+
+            m_arena.clear();
+        }
+    };
+
+    BENCHMARK_CASE_F(AllocateReleaseBatch_NewDelete, NewDeleteFixture)
+    {
+        allocate_release_batch();
+    }
+
+    BENCHMARK_CASE_F(AllocateReleaseBatch_Arena, ArenaFixture)
+    {
+        allocate_release_batch();
+    }
+
+    struct VectorFixture
+    {
+        Arena m_arena;
+
+        template <typename Vector>
+        static void fill(Vector& v)
+        {
+            for (uint32 i = 0; i < 100; ++i)
+                v.push_back(i);
+        }
+    };
+
+    BENCHMARK_CASE_F(GrowVector_DefaultAllocator, VectorFixture)
+    {
+        vector<uint32> v;
+        fill(v);
+    }
+
+    BENCHMARK_CASE_F(GrowVector_ArenaAllocator, VectorFixture)
+    {
+        typedef ArenaAllocator<uint32> AllocatorType;
+        vector<uint32, AllocatorType> v((AllocatorType(m_arena)));
+        fill(v);
+        m_arena.clear();
+    }
+}
@@ -29,7 +29,10 @@
 
 // appleseed.foundation headers.
 #include "foundation/math/aabb.h"
+#include "foundation/math/basis.h"
+#include "foundation/math/beziercurve.h"
 #include "foundation/math/intersection.h"
+#include "foundation/math/minmax.h"
 #include "foundation/math/ray.h"
 #include "foundation/math/rng.h"
 #include "foundation/math/sampling.h"
@@ -38,6 +41,7 @@
 #include "foundation/utility/benchmark.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cstddef>
 #include <limits>
 
@@ -300,3 +304,119 @@ BENCHMARK_SUITE(Foundation_Math_Intersection_RayTriangleSSK)
     BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs66Percents, FixtureDouble66) { payload(); }
     BENCHMARK_CASE_F(Intersect_DoublePrecision_HitRateIs100Percents, FixtureDouble100) { payload(); }
 };
+
+BENCHMARK_SUITE(Foundation_Math_Intersection_RayCurve)
+{
+    typedef BezierCurve3f CurveType;
+    typedef BezierCurveIntersector<CurveType> CurveIntersectorType;
+
+    // A long, thin, diagonal curve, and rays crossing its bounding box.
+    struct Fixture
+      : public FixtureBase<float>
+    {
+        static const size_t RayCount = 1000;
+        static const size_t SegmentCount = 4;
+
+        CurveType               m_curve;
+        CurveType               m_segments[SegmentCount];
+        OBBPacket4<float>       m_segment_obbs;
+        RayType                 m_ray[RayCount];
+
+        bool                    m_hit;
+
+        Fixture()
+          : m_hit(false)
+        {
+            const VectorType ctrl_pts[4] =
+            {
+                VectorType(-1.0f, -1.0f, -1.0f),
+                VectorType(-0.3f, -0.4f, -0.2f),
+                VectorType( 0.4f,  0.3f,  0.2f),
+                VectorType( 1.0f,  1.0f,  1.0f)
+            };
+            m_curve = CurveType(ctrl_pts, 0.02f);
+
+            // Split the curve twice, as curve trees would.
+            CurveType halves[2];
+            m_curve.split(halves[0], halves[1]);
+            halves[0].split(m_segments[0], m_segments[1]);
+            halves[1].split(m_segments[2], m_segments[3]);
+
+            for (size_t i = 0; i < SegmentCount; ++i)
+                set_obb(i, m_segments[i]);
+
+            // Generate rays going through the bounding box of the curve.
+            MersenneTwister rng;
+            const AABB3f bbox = m_curve.compute_bbox();
+            for (size_t i = 0; i < RayCount; ++i)
+            {
+                get_random_ray(rng, 10.0f, m_ray[i]);
+
+                const VectorType target(
+                    static_cast<float>(rand_double1(rng, bbox.min.x, bbox.max.x)),
+                    static_cast<float>(rand_double1(rng, bbox.min.y, bbox.max.y)),
+                    static_cast<float>(rand_double1(rng, bbox.min.z, bbox.max.z)));
+                m_ray[i].m_dir = normalize(target - m_ray[i].m_org);
+            }
+        }
+
+        // Bound a segment with a box aligned with its chord.
+        void set_obb(const size_t index, const CurveType& segment)
+        {
+            const Basis3f basis(normalize(segment.get_control_point(3) - segment.get_control_point(0)));
+            const VectorType axes[3] = { basis.get_normal(), basis.get_tangent_u(), basis.get_tangent_v() };
+
+            VectorType center(0.0f), half_extents;
+            for (size_t d = 0; d < 3; ++d)
+            {
+                float lo = numeric_limits<float>::max();
+                float hi = -numeric_limits<float>::max();
+
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    const float x = dot(segment.get_control_point(i), axes[d]);
+                    lo = min(lo, x);
+                    hi = max(hi, x);
+                }
+
+                center += 0.5f * (lo + hi) * axes[d];
+                half_extents[d] = 0.5f * (hi - lo) + 0.5f * segment.compute_max_width();
+            }
+
+            m_segment_obbs.set(index, center, axes, half_extents);
+        }
+    };
+
+    BENCHMARK_CASE_F(Intersect_WholeCurve, Fixture)
+    {
+        for (size_t i = 0; i < RayCount; ++i)
+        {
+            CurveIntersectorType::MatrixType xfm;
+            CurveIntersectorType::make_projection_transform(xfm, m_ray[i]);
+
+            m_hit ^= CurveIntersectorType::intersect(m_curve, m_ray[i], xfm);
+        }
+    }
+
+    BENCHMARK_CASE_F(Intersect_SplitCurveWithOrientedBoundingBoxes, Fixture)
+    {
+        for (size_t i = 0; i < RayCount; ++i)
+        {
+            size_t mask = intersect(m_ray[i], m_segment_obbs);
+            if (mask == 0)
+                continue;
+
+            CurveIntersectorType::MatrixType xfm;
+            CurveIntersectorType::make_projection_transform(xfm, m_ray[i]);
+
+            for (size_t j = 0; mask != 0; ++j, mask >>= 1)
+            {
+                if ((mask & 1) && CurveIntersectorType::intersect(m_segments[j], m_ray[i], xfm))
+                {
+                    m_hit ^= true;
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,137 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/math/aliastable.h"
+#include "foundation/math/fp.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+
+TEST_SUITE(Foundation_Math_AliasTable)
+{
+    using namespace foundation;
+    using namespace std;
+
+    typedef AliasTable<int, double> AliasTable;
+
+    TEST_CASE(Empty_GivenTableInInitialState_ReturnsTrue)
+    {
+        AliasTable table;
+
+        EXPECT_TRUE(table.empty());
+    }
+
+    TEST_CASE(Valid_GivenTableInInitialState_ReturnsFalse)
+    {
+        AliasTable table;
+
+        EXPECT_FALSE(table.valid());
+    }
+
+    TEST_CASE(Valid_GivenTableWithOneItemWithZeroWeight_ReturnsFalse)
+    {
+        AliasTable table;
+        table.insert(1, 0.0);
+
+        EXPECT_FALSE(table.valid());
+    }
+
+    TEST_CASE(Clear_GivenTableWithOneItem_MakesTableEmptyAndInvalid)
+    {
+        AliasTable table;
+        table.insert(1, 0.5);
+        table.clear();
+
+        EXPECT_TRUE(table.empty());
+        EXPECT_FALSE(table.valid());
+    }
+
+    TEST_CASE(Sample_GivenTableWithOneItemWithPositiveWeight_ReturnsItem)
+    {
+        AliasTable table;
+        table.insert(1, 0.5);
+        table.prepare();
+
+        const AliasTable::ItemWeightPair result = table.sample(0.5);
+
+        EXPECT_EQ(1, result.first);
+        EXPECT_FEQ(1.0, result.second);
+    }
+
+    struct Fixture
+    {
+        AliasTable m_table;
+
+        Fixture()
+        {
+            m_table.insert(1, 0.4);
+            m_table.insert(2, 0.0);
+            m_table.insert(3, 1.6);
+            m_table.insert(4, 2.0);
+            m_table.prepare();
+        }
+    };
+
+    TEST_CASE_F(Prepare_NormalizesWeights, Fixture)
+    {
+        EXPECT_FEQ(0.1, m_table[0].second);
+        EXPECT_FEQ(0.0, m_table[1].second);
+        EXPECT_FEQ(0.4, m_table[2].second);
+        EXPECT_FEQ(0.5, m_table[3].second);
+    }
+
+    TEST_CASE_F(Sample_GivenInputOneUlpBeforeOne_ReturnsValidItem, Fixture)
+    {
+        const double almost_one = shift(1.0, -1);
+        const AliasTable::ItemWeightPair result = m_table.sample(almost_one);
+
+        EXPECT_NEQ(2, result.first);
+        EXPECT_TRUE(result.second > 0.0);
+    }
+
+    TEST_CASE_F(Sample_GivenUniformInputs_ReturnsItemsInProportionToTheirWeights, Fixture)
+    {
+        const size_t SampleCount = 1000;
+        size_t counts[4] = { 0, 0, 0, 0 };
+
+        for (size_t i = 0; i < SampleCount; ++i)
+        {
+            const double x = (i + 0.5) / SampleCount;
+            const AliasTable::ItemWeightPair result = m_table.sample(x);
+            ++counts[result.first - 1];
+        }
+
+        EXPECT_EQ(100, counts[0]);
+        EXPECT_EQ(0, counts[1]);
+        EXPECT_EQ(400, counts[2]);
+        EXPECT_EQ(500, counts[3]);
+    }
+}
@@ -0,0 +1,208 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+#include "foundation/utility/arena.h"
+#include "foundation/utility/memory.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Utility_Arena)
+{
+    TEST_CASE(Constructor_DoesNotAllocateMemory)
+    {
+        Arena arena;
+
+        EXPECT_EQ(0, arena.get_block_count());
+        EXPECT_EQ(0, arena.get_capacity());
+        EXPECT_EQ(0, arena.get_allocated_size());
+    }
+
+    TEST_CASE(Allocate_ReturnsAlignedMemory)
+    {
+        Arena arena;
+
+        arena.allocate(1, 1);
+        void* p16 = arena.allocate(3, 16);
+        arena.allocate(1, 1);
+        void* p64 = arena.allocate(5, 64);
+
+        EXPECT_TRUE(is_aligned(p16, 16));
+        EXPECT_TRUE(is_aligned(p64, 64));
+    }
+
+    TEST_CASE(Allocate_ReturnsDisjointBlocks)
+    {
+        Arena arena(64);
+
+        uint8* p[16];
+
+        for (size_t i = 0; i < 16; ++i)
+        {
+            p[i] = static_cast<uint8*>(arena.allocate(24, 8));
+
+            for (size_t j = 0; j < 24; ++j)
+                p[i][j] = static_cast<uint8>(i);
+        }
+
+        for (size_t i = 0; i < 16; ++i)
+        {
+            for (size_t j = 0; j < 24; ++j)
+                EXPECT_EQ(i, p[i][j]);
+        }
+    }
+
+    TEST_CASE(Allocate_GivenSizeLargerThanBlockSize_AllocatesDedicatedBlock)
+    {
+        Arena arena(64);
+
+        void* p = arena.allocate(1000, 16);
+
+        EXPECT_TRUE(p != 0);
+        EXPECT_EQ(1, arena.get_block_count());
+        EXPECT_TRUE(arena.get_capacity() >= 1000);
+    }
+
+    TEST_CASE(AllocateTyped_ReturnsMemoryAlignedForType)
+    {
+        Arena arena;
+
+        arena.allocate(1, 1);
+        double* p = arena.allocate<double>(4);
+
+        EXPECT_TRUE(is_aligned(p, sizeof(double)));
+    }
+
+    TEST_CASE(Clear_ResetsAllocatedSizeButKeepsBlocks)
+    {
+        Arena arena(256);
+
+        for (size_t i = 0; i < 10; ++i)
+            arena.allocate(100, 4);
+
+        const size_t block_count = arena.get_block_count();
+        const size_t capacity = arena.get_capacity();
+
+        EXPECT_EQ(1000, arena.get_allocated_size());
+
+        arena.clear();
+
+        EXPECT_EQ(0, arena.get_allocated_size());
+        EXPECT_EQ(block_count, arena.get_block_count());
+        EXPECT_EQ(capacity, arena.get_capacity());
+    }
+
+    TEST_CASE(Clear_SameAllocationPatternDoesNotGrowArena)
+    {
+        Arena arena(256);
+
+        for (size_t pass = 0; pass < 3; ++pass)
+        {
+            arena.clear();
+
+            for (size_t i = 0; i < 10; ++i)
+                arena.allocate(100, 16);
+
+            arena.allocate(1000, 16);
+        }
+
+        const size_t block_count = arena.get_block_count();
+
+        arena.clear();
+
+        for (size_t i = 0; i < 10; ++i)
+            arena.allocate(100, 16);
+
+        arena.allocate(1000, 16);
+
+        EXPECT_EQ(block_count, arena.get_block_count());
+    }
+
+    TEST_CASE(Clear_ReusesMemory)
+    {
+        Arena arena;
+
+        void* p1 = arena.allocate(32, 16);
+        arena.clear();
+        void* p2 = arena.allocate(32, 16);
+
+        EXPECT_EQ(p1, p2);
+    }
+
+    TEST_CASE(ReleaseMemory_ReturnsAllBlocks)
+    {
+        Arena arena(64);
+
+        for (size_t i = 0; i < 10; ++i)
+            arena.allocate(48, 16);
+
+        arena.release_memory();
+
+        EXPECT_EQ(0, arena.get_block_count());
+        EXPECT_EQ(0, arena.get_capacity());
+        EXPECT_EQ(0, arena.get_allocated_size());
+
+        EXPECT_TRUE(arena.allocate(48, 16) != 0);
+    }
+
+    TEST_CASE(ArenaAllocator_CanBeUsedWithStandardContainers)
+    {
+        Arena arena(128);
+
+        typedef ArenaAllocator<int> AllocatorType;
+        vector<int, AllocatorType> v((AllocatorType(arena)));
+
+        for (int i = 0; i < 100; ++i)
+            v.push_back(i);
+
+        for (int i = 0; i < 100; ++i)
+            EXPECT_EQ(i, v[i]);
+
+        EXPECT_TRUE(arena.get_allocated_size() > 0);
+    }
+
+    TEST_CASE(ArenaAllocator_AllocatorsOfSameArenaAreEqual)
+    {
+        Arena arena1, arena2;
+
+        ArenaAllocator<int> a1(arena1);
+        ArenaAllocator<double> a2(arena1);
+        ArenaAllocator<int> a3(arena2);
+
+        EXPECT_TRUE(a1 == a2);
+        EXPECT_TRUE(a1 != a3);
+    }
+}
@@ -28,13 +28,17 @@
 //
 
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/math/aabb.h"
 #include "foundation/math/bvh.h"
 #include "foundation/math/ray.h"
+#include "foundation/math/rng.h"
+#include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
 #include "foundation/platform/defaulttimers.h"
 #include "foundation/utility/alignedvector.h"
 #include "foundation/utility/iostreamop.h"
+#include "foundation/utility/log.h"
 #include "foundation/utility/test.h"
 
 // Standard headers.
@@ -120,6 +124,810 @@ TEST_SUITE(Foundation_Math_BVH_SpatialBuilder)
     }
 }
 
+TEST_SUITE(Foundation_Math_BVH_ParallelBuilder)
+{
+    typedef AlignedVector<bvh::Node<AABB3d> > NodeVector;
+    typedef vector<AABB3d> AABBVector;
+
+    typedef bvh::Tree<NodeVector> Tree;
+    typedef bvh::SAHPartitioner<AABBVector> Partitioner;
+
+    struct TestTree
+      : public Tree
+    {
+        const NodeVector& get_nodes() const
+        {
+            return m_nodes;
+        }
+    };
+
+    void generate_bboxes(AABBVector& bboxes, const size_t count)
+    {
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            Vector3d center;
+            center[0] = rand_double1(rng, -10.0, 10.0);
+            center[1] = rand_double1(rng, -10.0, 10.0);
+            center[2] = rand_double1(rng, -10.0, 10.0);
+
+            const Vector3d extent(rand_double1(rng, 0.01, 0.1));
+
+            bboxes.push_back(AABB3d(center - extent, center + extent));
+        }
+    }
+
+    TEST_CASE(Build_ProducesSameTreeAsSerialBuilder)
+    {
+        const size_t ItemCount = 20000;
+        const size_t MaxLeafSize = 4;
+
+        AABBVector bboxes;
+        generate_bboxes(bboxes, ItemCount);
+
+        Partitioner serial_partitioner(bboxes, MaxLeafSize);
+        TestTree serial_tree;
+        bvh::Builder<Tree, Partitioner> serial_builder;
+        serial_builder.build<DefaultWallclockTimer>(serial_tree, serial_partitioner, ItemCount, MaxLeafSize);
+
+        Logger logger;
+        Partitioner parallel_partitioner(bboxes, MaxLeafSize);
+        TestTree parallel_tree;
+        bvh::ParallelBuilder<Tree, Partitioner> parallel_builder(logger, 4);
+        parallel_builder.build<DefaultWallclockTimer>(parallel_tree, parallel_partitioner, ItemCount, MaxLeafSize);
+
+        EXPECT_TRUE(serial_partitioner.get_item_ordering() == parallel_partitioner.get_item_ordering());
+
+        const NodeVector& serial_nodes = serial_tree.get_nodes();
+        const NodeVector& parallel_nodes = parallel_tree.get_nodes();
+        ASSERT_EQ(serial_nodes.size(), parallel_nodes.size());
+
+        bool identical = true;
+
+        for (size_t i = 0; i < serial_nodes.size(); ++i)
+        {
+            const bvh::Node<AABB3d>& serial_node = serial_nodes[i];
+            const bvh::Node<AABB3d>& parallel_node = parallel_nodes[i];
+
+            if (serial_node.is_leaf())
+            {
+                identical = identical &&
+                    parallel_node.is_leaf() &&
+                    serial_node.get_item_index() == parallel_node.get_item_index() &&
+                    serial_node.get_item_count() == parallel_node.get_item_count();
+            }
+            else
+            {
+                identical = identical &&
+                    parallel_node.is_interior() &&
+                    serial_node.get_child_node_index() == parallel_node.get_child_node_index() &&
+                    serial_node.get_left_bbox() == parallel_node.get_left_bbox() &&
+                    serial_node.get_right_bbox() == parallel_node.get_right_bbox();
+            }
+        }
+
+        EXPECT_TRUE(identical);
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_BinnedSAHPartitioner)
+{
+    typedef AlignedVector<bvh::Node<AABB3d> > NodeVector;
+    typedef vector<AABB3d> AABBVector;
+
+    typedef bvh::Tree<NodeVector> Tree;
+    typedef bvh::BinnedSAHPartitioner<AABBVector> Partitioner;
+
+    struct TestTree
+      : public Tree
+    {
+        const NodeVector& get_nodes() const
+        {
+            return m_nodes;
+        }
+    };
+
+    void generate_bboxes(AABBVector& bboxes, const size_t count)
+    {
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            Vector3d center;
+            center[0] = rand_double1(rng, -10.0, 10.0);
+            center[1] = rand_double1(rng, -10.0, 10.0);
+            center[2] = rand_double1(rng, -10.0, 10.0);
+
+            const Vector3d extent(rand_double1(rng, 0.01, 0.1));
+
+            bboxes.push_back(AABB3d(center - extent, center + extent));
+        }
+    }
+
+    // Check that every item is referenced by exactly one leaf, and that the bounding
+    // box of every node encloses the items below it.
+    bool is_valid_recurse(
+        const NodeVector&       nodes,
+        const AABBVector&       bboxes,
+        const vector<size_t>&   ordering,
+        const size_t            node_index,
+        const AABB3d&           bbox,
+        vector<size_t>&         item_refs)
+    {
+        const bvh::Node<AABB3d>& node = nodes[node_index];
+
+        if (node.is_leaf())
+        {
+            const size_t item_end = node.get_item_index() + node.get_item_count();
+
+            for (size_t i = node.get_item_index(); i < item_end; ++i)
+            {
+                const AABB3d& item_bbox = bboxes[ordering[i]];
+
+                if (!bbox.contains(item_bbox.min) || !bbox.contains(item_bbox.max))
+                    return false;
+
+                ++item_refs[ordering[i]];
+            }
+
+            return true;
+        }
+
+        return
+            is_valid_recurse(nodes, bboxes, ordering, node.get_child_node_index() + 0, node.get_left_bbox(), item_refs) &&
+            is_valid_recurse(nodes, bboxes, ordering, node.get_child_node_index() + 1, node.get_right_bbox(), item_refs);
+    }
+
+    TEST_CASE(Build_ProducesValidTree)
+    {
+        const size_t ItemCount = 10000;
+        const size_t MaxLeafSize = 4;
+
+        AABBVector bboxes;
+        generate_bboxes(bboxes, ItemCount);
+
+        Partitioner partitioner(bboxes, MaxLeafSize, 16);
+        TestTree tree;
+        bvh::Builder<Tree, Partitioner> builder;
+        builder.build<DefaultWallclockTimer>(tree, partitioner, ItemCount, MaxLeafSize);
+
+        AABB3d root_bbox;
+        root_bbox.invalidate();
+        for (size_t i = 0; i < bboxes.size(); ++i)
+            root_bbox.insert(bboxes[i]);
+
+        vector<size_t> item_refs(ItemCount, 0);
+        EXPECT_TRUE(
+            is_valid_recurse(
+                tree.get_nodes(),
+                bboxes,
+                partitioner.get_item_ordering(),
+                0,
+                root_bbox,
+                item_refs));
+        EXPECT_TRUE(vector<size_t>(ItemCount, 1) == item_refs);
+    }
+
+    TEST_CASE(Build_GivenIdenticalItems_ProducesSingleLeaf)
+    {
+        const AABBVector bboxes(8, AABB3d(Vector3d(0.0), Vector3d(1.0)));
+
+        Partitioner partitioner(bboxes, 1);
+        TestTree tree;
+        bvh::Builder<Tree, Partitioner> builder;
+        builder.build<DefaultWallclockTimer>(tree, partitioner, bboxes.size(), 1);
+
+        ASSERT_EQ(1, tree.get_nodes().size());
+        EXPECT_TRUE(tree.get_nodes()[0].is_leaf());
+        EXPECT_EQ(8, tree.get_nodes()[0].get_item_count());
+    }
+
+    TEST_CASE(Build_ProducesTreeOfSimilarQualityAsSAHPartitioner)
+    {
+        const size_t ItemCount = 10000;
+        const size_t MaxLeafSize = 4;
+
+        AABBVector bboxes;
+        generate_bboxes(bboxes, ItemCount);
+
+        bvh::SAHPartitioner<AABBVector> sah_partitioner(bboxes, MaxLeafSize);
+        TestTree sah_tree;
+        bvh::Builder<Tree, bvh::SAHPartitioner<AABBVector> > sah_builder;
+        sah_builder.build<DefaultWallclockTimer>(sah_tree, sah_partitioner, ItemCount, MaxLeafSize);
+
+        Partitioner binned_partitioner(bboxes, MaxLeafSize, 32);
+        TestTree binned_tree;
+        bvh::Builder<Tree, Partitioner> binned_builder;
+        binned_builder.build<DefaultWallclockTimer>(binned_tree, binned_partitioner, ItemCount, MaxLeafSize);
+
+        const double sah_cost = bvh::compute_sah_cost(sah_tree.get_nodes(), 1.0, 1.0);
+        const double binned_cost = bvh::compute_sah_cost(binned_tree.get_nodes(), 1.0, 1.0);
+
+        EXPECT_LT(1.1 * sah_cost, binned_cost);
+    }
+
+    TEST_CASE(Build_ParallelBuilder_ProducesSameTreeAsSerialBuilder)
+    {
+        const size_t ItemCount = 20000;
+        const size_t MaxLeafSize = 4;
+
+        AABBVector bboxes;
+        generate_bboxes(bboxes, ItemCount);
+
+        Partitioner serial_partitioner(bboxes, MaxLeafSize);
+        TestTree serial_tree;
+        bvh::Builder<Tree, Partitioner> serial_builder;
+        serial_builder.build<DefaultWallclockTimer>(serial_tree, serial_partitioner, ItemCount, MaxLeafSize);
+
+        Logger logger;
+        Partitioner parallel_partitioner(bboxes, MaxLeafSize);
+        TestTree parallel_tree;
+        bvh::ParallelBuilder<Tree, Partitioner> parallel_builder(logger, 4);
+        parallel_builder.build<DefaultWallclockTimer>(parallel_tree, parallel_partitioner, ItemCount, MaxLeafSize);
+
+        EXPECT_TRUE(serial_partitioner.get_item_ordering() == parallel_partitioner.get_item_ordering());
+        EXPECT_EQ(serial_tree.get_nodes().size(), parallel_tree.get_nodes().size());
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_Refitter)
+{
+    typedef AlignedVector<bvh::Node<AABB3d> > NodeVector;
+    typedef vector<AABB3d> AABBVector;
+
+    typedef bvh::Tree<NodeVector> Tree;
+    typedef bvh::SAHPartitioner<AABBVector> Partitioner;
+
+    struct TestTree
+      : public Tree
+    {
+        const NodeVector& get_nodes() const
+        {
+            return m_nodes;
+        }
+    };
+
+    struct LeafRefitter
+      : public NonCopyable
+    {
+        const AABBVector&       m_bboxes;
+        const vector<size_t>&   m_ordering;
+
+        LeafRefitter(
+            const AABBVector&       bboxes,
+            const vector<size_t>&   ordering)
+          : m_bboxes(bboxes)
+          , m_ordering(ordering)
+        {
+        }
+
+        AABB3d refit(bvh::Node<AABB3d>& node) const
+        {
+            const size_t item_begin = node.get_item_index();
+            const size_t item_end = item_begin + node.get_item_count();
+
+            AABB3d bbox;
+            bbox.invalidate();
+
+            for (size_t i = item_begin; i < item_end; ++i)
+                bbox.insert(m_bboxes[m_ordering[i]]);
+
+            return bbox;
+        }
+    };
+
+    void generate_bboxes(AABBVector& bboxes, const size_t count)
+    {
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            Vector3d center;
+            center[0] = rand_double1(rng, -10.0, 10.0);
+            center[1] = rand_double1(rng, -10.0, 10.0);
+            center[2] = rand_double1(rng, -10.0, 10.0);
+
+            const Vector3d extent(rand_double1(rng, 0.01, 0.1));
+
+            bboxes.push_back(AABB3d(center - extent, center + extent));
+        }
+    }
+
+    void translate_bboxes(AABBVector& bboxes, const Vector3d& offset)
+    {
+        for (size_t i = 0; i < bboxes.size(); ++i)
+            bboxes[i] = AABB3d(bboxes[i].min + offset, bboxes[i].max + offset);
+    }
+
+    bool are_translated(
+        const NodeVector&   original_nodes,
+        const NodeVector&   refitted_nodes,
+        const Vector3d&     offset)
+    {
+        if (original_nodes.size() != refitted_nodes.size())
+            return false;
+
+        for (size_t i = 0; i < original_nodes.size(); ++i)
+        {
+            const bvh::Node<AABB3d>& original_node = original_nodes[i];
+            const bvh::Node<AABB3d>& refitted_node = refitted_nodes[i];
+
+            if (original_node.is_leaf())
+            {
+                if (!refitted_node.is_leaf() ||
+                    original_node.get_item_index() != refitted_node.get_item_index() ||
+                    original_node.get_item_count() != refitted_node.get_item_count())
+                    return false;
+            }
+            else
+            {
+                const AABB3d left_bbox = original_node.get_left_bbox();
+                const AABB3d right_bbox = original_node.get_right_bbox();
+
+                if (!refitted_node.is_interior() ||
+                    original_node.get_child_node_index() != refitted_node.get_child_node_index() ||
+                    refitted_node.get_left_bbox() != AABB3d(left_bbox.min + offset, left_bbox.max + offset) ||
+                    refitted_node.get_right_bbox() != AABB3d(right_bbox.min + offset, right_bbox.max + offset))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool refit_translates_tree(const size_t thread_count)
+    {
+        const size_t ItemCount = 20000;
+        const size_t MaxLeafSize = 4;
+        const Vector3d Offset(1.0, -2.0, 4.0);
+
+        AABBVector bboxes;
+        generate_bboxes(bboxes, ItemCount);
+
+        Partitioner partitioner(bboxes, MaxLeafSize);
+        TestTree tree;
+        bvh::Builder<Tree, Partitioner> builder;
+        builder.build<DefaultWallclockTimer>(tree, partitioner, ItemCount, MaxLeafSize);
+        const NodeVector original_nodes = tree.get_nodes();
+        const double original_cost = bvh::compute_sah_cost(original_nodes, 1.0, 1.0);
+
+        translate_bboxes(bboxes, Offset);
+
+        Logger logger;
+        LeafRefitter leaf_refitter(bboxes, partitioner.get_item_ordering());
+        bvh::Refitter<Tree, LeafRefitter> refitter(logger, thread_count);
+        const AABB3d root_bbox = refitter.refit<DefaultWallclockTimer>(tree, leaf_refitter);
+
+        AABB3d expected_root_bbox;
+        expected_root_bbox.invalidate();
+        for (size_t i = 0; i < bboxes.size(); ++i)
+            expected_root_bbox.insert(bboxes[i]);
+
+        return
+            root_bbox == expected_root_bbox &&
+            are_translated(original_nodes, tree.get_nodes(), Offset) &&
+            feq(original_cost, bvh::compute_sah_cost(tree.get_nodes(), 1.0, 1.0));
+    }
+
+    TEST_CASE(Refit_GivenTranslatedItems_TranslatesNodeBoundingBoxes)
+    {
+        EXPECT_TRUE(refit_translates_tree(1));
+    }
+
+    TEST_CASE(Refit_MultipleThreads_GivenTranslatedItems_TranslatesNodeBoundingBoxes)
+    {
+        EXPECT_TRUE(refit_translates_tree(4));
+    }
+
+    TEST_CASE(Refit_GivenScrambledItems_IncreasesSAHCost)
+    {
+        const size_t ItemCount = 1000;
+        const size_t MaxLeafSize = 4;
+
+        AABBVector bboxes;
+        generate_bboxes(bboxes, ItemCount);
+
+        Partitioner partitioner(bboxes, MaxLeafSize);
+        TestTree tree;
+        bvh::Builder<Tree, Partitioner> builder;
+        builder.build<DefaultWallclockTimer>(tree, partitioner, ItemCount, MaxLeafSize);
+        const double original_cost = bvh::compute_sah_cost(tree.get_nodes(), 1.0, 1.0);
+
+        // Items now live in random locations: the topology no longer fits them.
+        AABBVector scrambled_bboxes(bboxes.rbegin(), bboxes.rend());
+
+        Logger logger;
+        LeafRefitter leaf_refitter(scrambled_bboxes, partitioner.get_item_ordering());
+        bvh::Refitter<Tree, LeafRefitter> refitter(logger, 1);
+        refitter.refit<DefaultWallclockTimer>(tree, leaf_refitter);
+
+        EXPECT_GT(2.0 * original_cost, bvh::compute_sah_cost(tree.get_nodes(), 1.0, 1.0));
+    }
+
+    TEST_CASE(ComputeSAHCost_GivenSingleLeaf_ReturnsItemIntersectionCost)
+    {
+        NodeVector nodes(1);
+        nodes[0].make_leaf();
+        nodes[0].set_item_index(0);
+        nodes[0].set_item_count(3);
+
+        EXPECT_FEQ(3.0 * 2.0, bvh::compute_sah_cost(nodes, 1.0, 2.0));
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_WideIntersector)
+{
+    typedef bvh::Node<AABB3d> NodeType;
+    typedef AlignedVector<NodeType> NodeVector;
+    typedef vector<AABB3d> AABBVector;
+
+    typedef bvh::Tree<NodeVector> Tree;
+    typedef bvh::SAHPartitioner<AABBVector> Partitioner;
+
+    struct Visitor
+    {
+        const AABBVector&       m_bboxes;
+        const vector<size_t>&   m_ordering;
+        size_t                  m_hit_item;
+        double                  m_hit_distance;
+
+        Visitor(
+            const AABBVector&       bboxes,
+            const vector<size_t>&   ordering,
+            const double            tmax)
+          : m_bboxes(bboxes)
+          , m_ordering(ordering)
+          , m_hit_item(~0)
+          , m_hit_distance(tmax)
+        {
+        }
+
+        bool visit(
+            const NodeType&             node,
+            const Ray3d&                ray,
+            const RayInfo3d&            ray_info,
+            double&                     distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , bvh::TraversalStatistics& stats
+#endif
+            )
+        {
+            for (size_t i = 0; i < node.get_item_count(); ++i)
+            {
+                const size_t item = m_ordering[node.get_item_index() + i];
+
+                double tmin;
+                if (intersect(ray, ray_info, m_bboxes[item], tmin) && tmin < m_hit_distance)
+                {
+                    m_hit_item = item;
+                    m_hit_distance = tmin;
+                }
+            }
+
+            distance = m_hit_distance;
+            return true;
+        }
+    };
+
+    void generate_bboxes(AABBVector& bboxes, const size_t count)
+    {
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            Vector3d center;
+            center[0] = rand_double1(rng, -10.0, 10.0);
+            center[1] = rand_double1(rng, -10.0, 10.0);
+            center[2] = rand_double1(rng, -10.0, 10.0);
+
+            const Vector3d extent(rand_double1(rng, 0.05, 0.5));
+
+            bboxes.push_back(AABB3d(center - extent, center + extent));
+        }
+    }
+
+    template <size_t Width, typename WideAABB>
+    bool wide_traversal_matches_binary_traversal(const size_t item_count)
+    {
+        const size_t MaxLeafSize = 2;
+
+        AABBVector bboxes;
+        generate_bboxes(bboxes, item_count);
+
+        Partitioner partitioner(bboxes, MaxLeafSize);
+        Tree tree;
+        bvh::Builder<Tree, Partitioner> builder;
+        builder.build<DefaultWallclockTimer>(tree, partitioner, item_count, MaxLeafSize);
+
+        typedef bvh::WideTree<Tree, Width, WideAABB> WideTree;
+        WideTree wide_tree;
+        wide_tree.collapse(tree);
+
+        const bvh::Intersector<Tree, Visitor, Ray3d> intersector;
+        const bvh::WideIntersector<Tree, WideTree, Visitor, Ray3d> wide_intersector;
+
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        bvh::TraversalStatistics stats;
+#endif
+
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            Vector3d org;
+            org[0] = rand_double1(rng, -15.0, 15.0);
+            org[1] = rand_double1(rng, -15.0, 15.0);
+            org[2] = rand_double1(rng, -15.0, 15.0);
+
+            Vector3d dir;
+            dir[0] = rand_double1(rng, -1.0, 1.0);
+            dir[1] = rand_double1(rng, -1.0, 1.0);
+            dir[2] = rand_double1(rng, -1.0, 1.0);
+
+            const Ray3d ray(org, dir, 0.0, 100.0);
+            const RayInfo3d ray_info(ray);
+
+            Visitor visitor(bboxes, partitioner.get_item_ordering(), ray.m_tmax);
+            intersector.intersect_no_motion(
+                tree,
+                ray,
+                ray_info,
+                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , stats
+#endif
+                );
+
+            Visitor wide_visitor(bboxes, partitioner.get_item_ordering(), ray.m_tmax);
+            wide_intersector.intersect_no_motion(
+                tree,
+                wide_tree,
+                ray,
+                ray_info,
+                wide_visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , stats
+#endif
+                );
+
+            if (visitor.m_hit_item != wide_visitor.m_hit_item ||
+                visitor.m_hit_distance != wide_visitor.m_hit_distance)
+                return false;
+        }
+
+        return true;
+    }
+
+    TEST_CASE(Collapse_GivenTreeReducedToSingleLeaf_CreatesSingleRootNode)
+    {
+        AABBVector bboxes;
+        generate_bboxes(bboxes, 1);
+
+        Partitioner partitioner(bboxes, 4);
+        Tree tree;
+        bvh::Builder<Tree, Partitioner> builder;
+        builder.build<DefaultWallclockTimer>(tree, partitioner, 1, 4);
+
+        bvh::WideTree<Tree, 4, AABB3d> wide_tree;
+        wide_tree.collapse(tree);
+
+        ASSERT_EQ(1, wide_tree.get_node_count());
+    }
+
+    TEST_CASE(IntersectNoMotion_Width4_FindsSameHitsAsBinaryIntersector)
+    {
+        EXPECT_TRUE((wide_traversal_matches_binary_traversal<4, AABB3d>(5000)));
+    }
+
+    TEST_CASE(IntersectNoMotion_Width8_FindsSameHitsAsBinaryIntersector)
+    {
+        EXPECT_TRUE((wide_traversal_matches_binary_traversal<8, AABB3d>(5000)));
+    }
+
+    TEST_CASE(IntersectNoMotion_Width4SinglePrecisionBoundingBoxes_FindsSameHitsAsBinaryIntersector)
+    {
+        EXPECT_TRUE((wide_traversal_matches_binary_traversal<4, AABB3f>(5000)));
+    }
+
+    TEST_CASE(IntersectNoMotion_Width8SinglePrecisionBoundingBoxes_FindsSameHitsAsBinaryIntersector)
+    {
+        EXPECT_TRUE((wide_traversal_matches_binary_traversal<8, AABB3f>(5000)));
+    }
+
+    TEST_CASE(IntersectNoMotion_TreeReducedToSingleLeaf_FindsSameHitsAsBinaryIntersector)
+    {
+        EXPECT_TRUE((wide_traversal_matches_binary_traversal<4, AABB3d>(1)));
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_PacketIntersector)
+{
+    typedef bvh::Node<AABB3d> NodeType;
+    typedef AlignedVector<NodeType> NodeVector;
+    typedef vector<AABB3d> AABBVector;
+
+    typedef bvh::Tree<NodeVector> Tree;
+    typedef bvh::SAHPartitioner<AABBVector> Partitioner;
+
+    struct Visitor
+      : public NonCopyable
+    {
+        const AABBVector&       m_bboxes;
+        const vector<size_t>&   m_ordering;
+        size_t                  m_hit_item;
+        double                  m_hit_distance;
+
+        Visitor(
+            const AABBVector&       bboxes,
+            const vector<size_t>&   ordering,
+            const double            tmax)
+          : m_bboxes(bboxes)
+          , m_ordering(ordering)
+          , m_hit_item(~0)
+          , m_hit_distance(tmax)
+        {
+        }
+
+        bool visit(
+            const NodeType&             node,
+            const Ray3d&                ray,
+            const RayInfo3d&            ray_info,
+            double&                     distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , bvh::TraversalStatistics& stats
+#endif
+            )
+        {
+            for (size_t i = 0; i < node.get_item_count(); ++i)
+            {
+                const size_t item = m_ordering[node.get_item_index() + i];
+
+                double tmin;
+                if (intersect(ray, ray_info, m_bboxes[item], tmin) && tmin < m_hit_distance)
+                {
+                    m_hit_item = item;
+                    m_hit_distance = tmin;
+                }
+            }
+
+            distance = m_hit_distance;
+            return true;
+        }
+    };
+
+    typedef bvh::PerRayPacketVisitor<Visitor> PacketVisitor;
+
+    const size_t PacketSize = 8;
+
+    bool packet_traversal_matches_single_ray_traversal(const size_t mask)
+    {
+        const size_t ItemCount = 5000;
+        const size_t MaxLeafSize = 2;
+
+        MersenneTwister rng;
+
+        AABBVector bboxes;
+        for (size_t i = 0; i < ItemCount; ++i)
+        {
+            Vector3d center;
+            center[0] = rand_double1(rng, -10.0, 10.0);
+            center[1] = rand_double1(rng, -10.0, 10.0);
+            center[2] = rand_double1(rng, -10.0, 10.0);
+
+            const Vector3d extent(rand_double1(rng, 0.05, 0.5));
+
+            bboxes.push_back(AABB3d(center - extent, center + extent));
+        }
+
+        Partitioner partitioner(bboxes, MaxLeafSize);
+        Tree tree;
+        bvh::Builder<Tree, Partitioner> builder;
+        builder.build<DefaultWallclockTimer>(tree, partitioner, ItemCount, MaxLeafSize);
+
+        const bvh::Intersector<Tree, Visitor, Ray3d> intersector;
+        const bvh::PacketIntersector<Tree, PacketVisitor, Ray3d, PacketSize> packet_intersector;
+
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        bvh::TraversalStatistics stats;
+#endif
+
+        for (size_t p = 0; p < 100; ++p)
+        {
+            // Generate a packet of coherent rays sharing the same origin.
+            Vector3d org;
+            org[0] = rand_double1(rng, -15.0, 15.0);
+            org[1] = rand_double1(rng, -15.0, 15.0);
+            org[2] = rand_double1(rng, -15.0, 15.0);
+
+            Vector3d base_dir;
+            base_dir[0] = rand_double1(rng, -1.0, 1.0);
+            base_dir[1] = rand_double1(rng, -1.0, 1.0);
+            base_dir[2] = rand_double1(rng, -1.0, 1.0);
+
+            Ray3d rays[PacketSize];
+            RayInfo3d ray_infos[PacketSize];
+            for (size_t i = 0; i < PacketSize; ++i)
+            {
+                Vector3d dir = base_dir;
+                dir[0] += rand_double1(rng, -0.1, 0.1);
+                dir[1] += rand_double1(rng, -0.1, 0.1);
+
+                rays[i] = Ray3d(org, dir, 0.0, 100.0);
+                ray_infos[i] = RayInfo3d(rays[i]);
+            }
+
+            // Intersect the rays one by one.
+            size_t hit_items[PacketSize];
+            double hit_distances[PacketSize];
+            for (size_t i = 0; i < PacketSize; ++i)
+            {
+                Visitor visitor(bboxes, partitioner.get_item_ordering(), rays[i].m_tmax);
+                intersector.intersect_no_motion(
+                    tree,
+                    rays[i],
+                    ray_infos[i],
+                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , stats
+#endif
+                    );
+                hit_items[i] = visitor.m_hit_item;
+                hit_distances[i] = visitor.m_hit_distance;
+            }
+
+            // Intersect the rays as a packet.
+            Visitor v0(bboxes, partitioner.get_item_ordering(), rays[0].m_tmax);
+            Visitor v1(bboxes, partitioner.get_item_ordering(), rays[1].m_tmax);
+            Visitor v2(bboxes, partitioner.get_item_ordering(), rays[2].m_tmax);
+            Visitor v3(bboxes, partitioner.get_item_ordering(), rays[3].m_tmax);
+            Visitor v4(bboxes, partitioner.get_item_ordering(), rays[4].m_tmax);
+            Visitor v5(bboxes, partitioner.get_item_ordering(), rays[5].m_tmax);
+            Visitor v6(bboxes, partitioner.get_item_ordering(), rays[6].m_tmax);
+            Visitor v7(bboxes, partitioner.get_item_ordering(), rays[7].m_tmax);
+            Visitor* const visitors[PacketSize] = { &v0, &v1, &v2, &v3, &v4, &v5, &v6, &v7 };
+            PacketVisitor packet_visitor(visitors);
+            packet_intersector.intersect_no_motion(
+                tree,
+                rays,
+                ray_infos,
+                mask,
+                packet_visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , stats
+#endif
+                );
+
+            for (size_t i = 0; i < PacketSize; ++i)
+            {
+                if (mask & (size_t(1) << i))
+                {
+                    if (visitors[i]->m_hit_item != hit_items[i] ||
+                        visitors[i]->m_hit_distance != hit_distances[i])
+                        return false;
+                }
+                else
+                {
+                    if (visitors[i]->m_hit_item != size_t(~0))
+                        return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    TEST_CASE(IntersectNoMotion_FullPacket_FindsSameHitsAsSingleRayIntersector)
+    {
+        EXPECT_TRUE(packet_traversal_matches_single_ray_traversal(0xFF));
+    }
+
+    TEST_CASE(IntersectNoMotion_PartialPacket_IgnoresInactiveRays)
+    {
+        EXPECT_TRUE(packet_traversal_matches_single_ray_traversal(0x5A));
+    }
+}
+
 TEST_SUITE(Foundation_Math_BVH_Intersector_2D)
 {
     typedef bvh::Node<AABB2d> NodeType;
@@ -115,6 +115,23 @@ TEST_SUITE(Foundation_Utility_Cache_SACache)
 
         EXPECT_EQ(0, element_swapper.m_unload_count);
     }
+
+    TEST_CASE(Contains_GivenKeyInCache_ReturnsTrueWithoutAffectingStatistics)
+    {
+        KeyHasher key_hasher;
+        ElementSwapperCountingUnloads element_swapper;
+        SACache<Key, KeyHasher, Element, ElementSwapperCountingUnloads, 4, 2> cache(
+            key_hasher,
+            element_swapper,
+            InvalidKey);
+
+        cache.get(1);
+
+        EXPECT_TRUE(cache.contains(1));
+        EXPECT_FALSE(cache.contains(5));
+        EXPECT_EQ(0, cache.get_hit_count());
+        EXPECT_EQ(1, cache.get_miss_count());
+    }
 }
 
 TEST_SUITE(Foundation_Utility_Cache_LRUCache)
@@ -0,0 +1,146 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/math/distance.h"
+#include "foundation/math/hashgrid.h"
+#include "foundation/math/rng.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/iostreamop.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Math_HashGrid3)
+{
+    struct CountingVisitor
+    {
+        vector<size_t>  m_visit_counts;
+        size_t          m_total_visit_count;
+
+        explicit CountingVisitor(const size_t point_count)
+          : m_visit_counts(point_count, 0)
+          , m_total_visit_count(0)
+        {
+        }
+
+        void visit(const size_t index, const float square_dist)
+        {
+            ++m_visit_counts[index];
+            ++m_total_visit_count;
+        }
+    };
+
+    TEST_CASE(Empty_GivenDefaultConstructedGrid_ReturnsTrue)
+    {
+        HashGrid3f grid;
+
+        EXPECT_TRUE(grid.empty());
+    }
+
+    TEST_CASE(FindPoints_GivenEmptyGrid_VisitsNoPoint)
+    {
+        HashGrid3f grid;
+        vector<Vector3f> points;
+        grid.build_move_points(points, 1.0f);
+
+        CountingVisitor visitor(0);
+        grid.find_points(Vector3f(0.0f), 1.0f, visitor);
+
+        EXPECT_EQ(0, visitor.m_total_visit_count);
+    }
+
+    TEST_CASE(BuildMovePoints_MovesPointsIntoGrid)
+    {
+        vector<Vector3f> points;
+        points.push_back(Vector3f(0.0f, 0.0f, 0.0f));
+        points.push_back(Vector3f(1.0f, 2.0f, 3.0f));
+
+        HashGrid3f grid;
+        grid.build_move_points(points, 1.0f);
+
+        EXPECT_TRUE(points.empty());
+        ASSERT_EQ(2, grid.size());
+        EXPECT_EQ(Vector3f(0.0f, 0.0f, 0.0f), grid.get_point(grid.remap(0) == 0 ? 0 : 1));
+        EXPECT_EQ(Vector3f(1.0f, 2.0f, 3.0f), grid.get_point(grid.remap(0) == 1 ? 0 : 1));
+    }
+
+    // Return the number of points that were not visited exactly once when inside the search radius.
+    size_t count_find_points_errors(const float cell_size, const float radius)
+    {
+        const size_t PointCount = 1000;
+
+        MersenneTwister rng;
+        vector<Vector3f> points(PointCount);
+        for (size_t i = 0; i < PointCount; ++i)
+            points[i] = rand_vector1<Vector3f>(rng) * 4.0f - Vector3f(2.0f);
+
+        const vector<Vector3f> original_points(points);
+
+        HashGrid3f grid;
+        grid.build_move_points(points, cell_size);
+
+        size_t error_count = 0;
+
+        for (size_t q = 0; q < 100; ++q)
+        {
+            const Vector3f query_point = rand_vector1<Vector3f>(rng) * 4.0f - Vector3f(2.0f);
+
+            CountingVisitor visitor(PointCount);
+            grid.find_points(query_point, radius, visitor);
+
+            for (size_t i = 0; i < PointCount; ++i)
+            {
+                const size_t original_index = grid.remap(i);
+                const bool inside =
+                    square_distance(original_points[original_index], query_point) < radius * radius;
+
+                if (visitor.m_visit_counts[i] != (inside ? 1 : 0))
+                    ++error_count;
+            }
+        }
+
+        return error_count;
+    }
+
+    TEST_CASE(FindPoints_GivenRadiusHalfTheCellSize_VisitsEachPointInsideRadiusOnce)
+    {
+        EXPECT_EQ(0, count_find_points_errors(0.5f, 0.25f));
+    }
+
+    TEST_CASE(FindPoints_GivenRadiusLargerThanCellSize_VisitsEachPointInsideRadiusOnce)
+    {
+        EXPECT_EQ(0, count_find_points_errors(0.1f, 0.35f));
+    }
+}
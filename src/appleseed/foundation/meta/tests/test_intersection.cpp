@@ -552,3 +552,204 @@ TEST_SUITE(Foundation_Math_Intersection_RayTriangleSSK)
         EXPECT_FEQ(0.5, v);
     }
 }
+
+TEST_SUITE(Foundation_Math_Intersection_RayTriangleWT)
+{
+    typedef RayTriangleFixture<TriangleWT<double> > Fixture;
+
+    TEST_CASE_F(Intersect_GivenRayWithTMinEqualToHitDistance_ReturnsTrue, Fixture)
+    {
+        const Ray3d ray(Vector3d(-0.2, 1.0, 0.2), Vector3d(0.0, -1.0, 0.0), 1.0, 10.0);
+
+        const bool hit = m_triangle.intersect(ray);
+
+        ASSERT_TRUE(hit);
+    }
+
+    TEST_CASE_F(Intersect_GivenRayWithTMaxEqualToHitDistance_ReturnsFalse, Fixture)
+    {
+        const Ray3d ray(Vector3d(-0.2, 1.0, 0.2), Vector3d(0.0, -1.0, 0.0), 0.0, 1.0);
+
+        const bool hit = m_triangle.intersect(ray);
+
+        ASSERT_FALSE(hit);
+    }
+
+    TEST_CASE_F(Intersect_GivenRayWithTMinEqualToHitDistance_ReturnsHit, Fixture)
+    {
+        const Ray3d ray(Vector3d(-0.2, 1.0, 0.2), Vector3d(0.0, -1.0, 0.0), 1.0, 10.0);
+
+        double t, u, v;
+        const bool hit = m_triangle.intersect(ray, t, u, v);
+
+        ASSERT_TRUE(hit);
+        EXPECT_FEQ(1.0, t);
+    }
+
+    TEST_CASE_F(Intersect_GivenRayWithTMaxEqualToHitDistance_ReturnsNoHit, Fixture)
+    {
+        const Ray3d ray(Vector3d(-0.2, 1.0, 0.2), Vector3d(0.0, -1.0, 0.0), 0.0, 1.0);
+
+        double t, u, v;
+        const bool hit = m_triangle.intersect(ray, t, u, v);
+
+        ASSERT_FALSE(hit);
+    }
+
+    TEST_CASE_F(Intersect_GivenRayHittingDiagonalOfQuad_ReturnsHit, Fixture)
+    {
+        const Ray3d ray(Vector3d(0.0, 1.0, 0.0), Vector3d(0.0, -1.0, 0.0));
+
+        double t, u, v;
+        const bool hit = m_triangle.intersect(ray, t, u, v);
+
+        ASSERT_TRUE(hit);
+        EXPECT_FEQ(1.0, t);
+        EXPECT_FEQ(0.0, u);
+        EXPECT_FEQ(0.5, v);
+    }
+
+    TEST_CASE_F(Intersect_GivenRayHittingBackFace_ReturnsHit, Fixture)
+    {
+        const Ray3d ray(Vector3d(-0.2, -1.0, 0.2), Vector3d(0.0, 1.0, 0.0));
+
+        double t, u, v;
+        const bool hit = m_triangle.intersect(ray, t, u, v);
+
+        ASSERT_TRUE(hit);
+        EXPECT_FEQ(1.0, t);
+    }
+
+    TEST_CASE(Intersect_GivenSinglePrecisionRaysThroughSharedEdge_NeverMissesBothTriangles)
+    {
+        // Two triangles sharing the edge (v1, v2), with vertices that are not exactly representable.
+        const Vector3f v0(0.1f, 0.0f, 0.3f);
+        const Vector3f v1(1.3f, 0.1f, 0.7f);
+        const Vector3f v2(0.7f, 0.3f, 1.9f);
+        const Vector3f v3(1.9f, 0.7f, 1.7f);
+        const TriangleWT<float> triangle1(v0, v1, v2);
+        const TriangleWT<float> triangle2(v3, v2, v1);
+
+        const size_t RayCount = 1000;
+        size_t missed = 0;
+
+        for (size_t i = 0; i < RayCount; ++i)
+        {
+            // Aim at a point of the shared edge from an arbitrary direction.
+            const float k = static_cast<float>(i) / RayCount;
+            const Vector3f target = v1 + k * (v2 - v1);
+            const Vector3f org(0.3f + 0.01f * k, 5.0f, -0.2f + 0.7f * k);
+            const Ray3f ray(org, target - org);
+
+            if (!triangle1.intersect(ray) && !triangle2.intersect(ray))
+                ++missed;
+        }
+
+        EXPECT_EQ(0, missed);
+    }
+}
+
+TEST_SUITE(Foundation_Math_Intersection_RayTriangleWTSupportPlane)
+{
+    TEST_CASE(Intersect_GivenRayHittingPlane_ReturnsDistanceToPlane)
+    {
+        const TriangleWT<double> triangle(
+            Vector3d(0.5, 0.0, 0.5),
+            Vector3d(-0.5, 0.0, 0.5),
+            Vector3d(-0.5, 0.0, -0.5));
+        const TriangleWTSupportPlane<double> support_plane(triangle);
+
+        const double t = support_plane.intersect(Vector3d(3.0, 2.0, 1.0), Vector3d(0.0, -1.0, 0.0));
+
+        EXPECT_FEQ(2.0, t);
+    }
+}
+
+TEST_SUITE(Foundation_Math_Intersection_RayOBB)
+{
+    // A thin box along the diagonal of the unit cube, at index 1 of the packet.
+    template <typename T>
+    OBBPacket4<T> make_diagonal_obbs()
+    {
+        typedef Vector<T, 3> VectorType;
+
+        const VectorType axes[3] =
+        {
+            normalize(VectorType(T(1.0), T(1.0), T(1.0))),
+            normalize(VectorType(T(1.0), T(-1.0), T(0.0))),
+            normalize(VectorType(T(1.0), T(1.0), T(-2.0)))
+        };
+
+        OBBPacket4<T> obbs;
+        obbs.set(
+            1,
+            VectorType(T(0.5)),
+            axes,
+            VectorType(T(0.9), T(0.1), T(0.1)));
+
+        return obbs;
+    }
+
+    TEST_CASE(Intersect_GivenDefaultPacket_ReturnsMaskOfAllBoxes)
+    {
+        const OBBPacket4<float> obbs;
+        const Ray3f ray(Vector3f(0.5f, 0.5f, -2.0f), Vector3f(0.0f, 0.0f, 1.0f));
+
+        EXPECT_EQ(15, intersect(ray, obbs));
+    }
+
+    TEST_CASE(Intersect_GivenRayThroughDiagonalBox_ReturnsMaskOfThisBox)
+    {
+        const OBBPacket4<float> obbs = make_diagonal_obbs<float>();
+        const Ray3f ray(Vector3f(0.5f, 0.5f, -1.0f), Vector3f(0.0f, 0.0f, 1.0f));
+
+        EXPECT_EQ(2, intersect(ray, obbs) & 2);
+    }
+
+    TEST_CASE(Intersect_GivenRayThroughCornerOfBoundingBoxOfDiagonalBox_ReturnsEmptyMask)
+    {
+        const OBBPacket4<float> obbs = make_diagonal_obbs<float>();
+        const Ray3f ray(Vector3f(0.9f, 0.1f, -1.0f), Vector3f(0.0f, 0.0f, 1.0f));
+
+        EXPECT_EQ(0, intersect(ray, obbs) & 2);
+    }
+
+    TEST_CASE(Intersect_GivenRayEndingBeforeDiagonalBox_ReturnsEmptyMask)
+    {
+        const OBBPacket4<float> obbs = make_diagonal_obbs<float>();
+        const Ray3f ray(Vector3f(0.5f, 0.5f, -1.0f), Vector3f(0.0f, 0.0f, 1.0f), 0.0f, 0.5f);
+
+        EXPECT_EQ(0, intersect(ray, obbs) & 2);
+    }
+
+    TEST_CASE(Intersect_GivenRayParallelToFaceOfDiagonalBox_ReturnsMaskOfThisBox)
+    {
+        const OBBPacket4<double> obbs = make_diagonal_obbs<double>();
+        const Ray3d ray(Vector3d(-1.0), normalize(Vector3d(1.0)));
+
+        EXPECT_EQ(2, intersect(ray, obbs) & 2);
+    }
+
+    TEST_CASE(Intersect_SinglePrecisionAndDoublePrecisionResultsMatch)
+    {
+        const OBBPacket4<float> obbs_f = make_diagonal_obbs<float>();
+        const OBBPacket4<double> obbs_d = make_diagonal_obbs<double>();
+
+        size_t mismatches = 0;
+
+        for (size_t i = 0; i < 16; ++i)
+        {
+            for (size_t j = 0; j < 16; ++j)
+            {
+                const Vector3d org((i + 0.5) / 16.0, (j + 0.5) / 16.0, -1.0);
+                const Vector3d dir(0.0, 0.0, 1.0);
+
+                if (intersect(Ray3f(Vector3f(org), Vector3f(dir)), obbs_f) !=
+                    intersect(Ray3d(org, dir), obbs_d))
+                    ++mismatches;
+            }
+        }
+
+        EXPECT_EQ(0, mismatches);
+    }
+}
@@ -28,19 +28,26 @@
 //
 
 // appleseed.foundation headers.
+#include "foundation/platform/thread.h"
 #include "foundation/platform/timer.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/job/abortswitch.h"
 #include "foundation/utility/job/ijob.h"
 #include "foundation/utility/job/jobmanager.h"
 #include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/job/parallelfor.h"
 #include "foundation/utility/job/workerthread.h"
+#include "foundation/utility/job/workstealingdeque.h"
 #include "foundation/utility/log.h"
 #include "foundation/utility/test.h"
 
+// boost headers.
+#include "boost/thread/thread.hpp"
+
 // Standard headers.
 #include <cstddef>
 #include <exception>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -103,6 +110,153 @@ TEST_SUITE(Foundation_Utility_Job_AbortSwitch)
     }
 }
 
+TEST_SUITE(Foundation_Utility_Job_WorkStealingDeque)
+{
+    typedef WorkStealingDeque<size_t, 4> Deque;
+
+    TEST_CASE(Pop_GivenEmptyDeque_ReturnsFalse)
+    {
+        Deque deque;
+        size_t item;
+
+        EXPECT_FALSE(deque.pop(item));
+        EXPECT_EQ(0, deque.size());
+    }
+
+    TEST_CASE(Steal_GivenEmptyDeque_ReturnsFalse)
+    {
+        Deque deque;
+        size_t item;
+
+        EXPECT_FALSE(deque.steal(item));
+    }
+
+    TEST_CASE(Pop_ReturnsItemsInLastInFirstOutOrder)
+    {
+        Deque deque;
+        deque.push(1);
+        deque.push(2);
+
+        size_t item1, item2;
+        deque.pop(item1);
+        deque.pop(item2);
+
+        EXPECT_EQ(2, item1);
+        EXPECT_EQ(1, item2);
+        EXPECT_EQ(0, deque.size());
+    }
+
+    TEST_CASE(Steal_ReturnsItemsInFirstInFirstOutOrder)
+    {
+        Deque deque;
+        deque.push(1);
+        deque.push(2);
+
+        size_t item1, item2;
+        deque.steal(item1);
+        deque.steal(item2);
+
+        EXPECT_EQ(1, item1);
+        EXPECT_EQ(2, item2);
+        EXPECT_EQ(0, deque.size());
+    }
+
+    TEST_CASE(Push_GivenFullDeque_ReturnsFalse)
+    {
+        Deque deque;
+
+        for (size_t i = 0; i < 4; ++i)
+            deque.push(i);
+
+        EXPECT_FALSE(deque.push(4));
+        EXPECT_EQ(4, deque.size());
+    }
+
+    TEST_CASE(Push_AfterIndicesWrappedAround_Works)
+    {
+        Deque deque;
+        size_t item;
+
+        for (size_t i = 0; i < 10; ++i)
+        {
+            deque.push(i);
+            deque.steal(item);
+        }
+
+        deque.push(10);
+        deque.push(11);
+        deque.pop(item);
+
+        EXPECT_EQ(11, item);
+        EXPECT_EQ(1, deque.size());
+    }
+
+    struct Thief
+    {
+        WorkStealingDeque<size_t, 64>&  m_deque;
+        volatile bool&                  m_done;
+        size_t                          m_sum;
+        size_t                          m_count;
+
+        Thief(WorkStealingDeque<size_t, 64>& deque, volatile bool& done)
+          : m_deque(deque)
+          , m_done(done)
+          , m_sum(0)
+          , m_count(0)
+        {
+        }
+
+        void operator()()
+        {
+            while (!m_done || m_deque.size() > 0)
+            {
+                size_t item;
+                if (m_deque.steal(item))
+                {
+                    m_sum += item;
+                    ++m_count;
+                }
+                else yield();
+            }
+        }
+    };
+
+    TEST_CASE(ConcurrentPopAndSteal_EachItemIsTakenExactlyOnce)
+    {
+        const size_t ItemCount = 100000;
+
+        WorkStealingDeque<size_t, 64> deque;
+        volatile bool done = false;
+
+        Thief thief1(deque, done), thief2(deque, done);
+        ThreadFunctionWrapper<Thief> thief_func1(&thief1), thief_func2(&thief2);
+        boost::thread thread1(thief_func1);
+        boost::thread thread2(thief_func2);
+
+        size_t sum = 0, count = 0;
+
+        for (size_t i = 1; i <= ItemCount; ++i)
+        {
+            while (!deque.push(i))
+                yield();
+
+            size_t item;
+            if (i % 3 == 0 && deque.pop(item))
+            {
+                sum += item;
+                ++count;
+            }
+        }
+
+        done = true;
+        thread1.join();
+        thread2.join();
+
+        EXPECT_EQ(ItemCount, count + thief1.m_count + thief2.m_count);
+        EXPECT_EQ(ItemCount * (ItemCount + 1) / 2, sum + thief1.m_sum + thief2.m_sum);
+    }
+}
+
 TEST_SUITE(Foundation_Utility_Job_JobQueue)
 {
     class JobNotifyingAboutDestruction
@@ -221,7 +375,7 @@ TEST_SUITE(Foundation_Utility_Job_JobQueue)
     {
         JobQueue job_queue;
 
-        EXPECT_EQ(0, job_queue.acquire_scheduled_job().first.m_job);
+        EXPECT_EQ(0, job_queue.acquire_scheduled_job().m_job);
     }
 
     TEST_CASE(AcquireScheduledJobWorksOnNonEmptyJobQueue)
@@ -234,7 +388,7 @@ TEST_SUITE(Foundation_Utility_Job_JobQueue)
         const JobQueue::RunningJobInfo running_job_info =
             job_queue.acquire_scheduled_job();
 
-        EXPECT_EQ(job, running_job_info.first.m_job);
+        EXPECT_EQ(job, running_job_info.m_job);
 
         EXPECT_FALSE(job_queue.has_scheduled_jobs());
         EXPECT_TRUE(job_queue.has_running_jobs());
@@ -371,6 +525,202 @@ TEST_SUITE(Foundation_Utility_Job_JobManager)
 
         EXPECT_EQ(1, execution_count);
     }
+
+    class JobCreatingSubJobTree
+      : public IJob
+    {
+      public:
+        JobCreatingSubJobTree(
+            JobQueue&           job_queue,
+            volatile size_t*    execution_counts,
+            const size_t        depth)
+          : m_job_queue(job_queue)
+          , m_execution_counts(execution_counts)
+          , m_depth(depth)
+        {
+        }
+
+        virtual void execute(const size_t thread_index)
+        {
+            if (m_depth > 0)
+            {
+                m_job_queue.schedule(new JobCreatingSubJobTree(m_job_queue, m_execution_counts, m_depth - 1));
+                m_job_queue.schedule(new JobCreatingSubJobTree(m_job_queue, m_execution_counts, m_depth - 1));
+            }
+
+            ++m_execution_counts[thread_index];
+        }
+
+      private:
+        JobQueue&           m_job_queue;
+        volatile size_t*    m_execution_counts;
+        const size_t        m_depth;
+    };
+
+    TEST_CASE(JobManagerWithSeveralThreadsExecutesAllSubJobs)
+    {
+        const size_t ThreadCount = 4;
+
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, ThreadCount, JobManager::KeepRunningOnEmptyQueue);
+
+        volatile size_t execution_counts[ThreadCount] = { 0, 0, 0, 0 };
+
+        job_queue.schedule(new JobCreatingSubJobTree(job_queue, execution_counts, 10));
+
+        job_manager.start();
+        job_queue.wait_until_completion();
+
+        size_t execution_count = 0;
+        for (size_t i = 0; i < ThreadCount; ++i)
+            execution_count += execution_counts[i];
+
+        EXPECT_EQ(2047, execution_count);
+        EXPECT_FALSE(job_queue.has_scheduled_or_running_jobs());
+    }
+
+    TEST_CASE(JobManagerWithThreadsPinnedToCpuCoresExecutesJobs)
+    {
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, 4, JobManager::PinThreadsToCpuCores);
+
+        volatile size_t execution_count = 0;
+
+        for (size_t i = 0; i < 100; ++i)
+            job_queue.schedule(new JobNotifyingAboutExecution(execution_count));
+
+        job_manager.start();
+        job_queue.wait_until_completion();
+
+        EXPECT_EQ(100, execution_count);
+    }
+
+    TEST_CASE(JobManagerWithSeveralThreadsExecutesJobsScheduledAfterStart)
+    {
+        const size_t ThreadCount = 4;
+
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, ThreadCount, JobManager::KeepRunningOnEmptyQueue);
+
+        job_manager.start();
+
+        volatile size_t execution_count = 0;
+
+        for (size_t pass = 0; pass < 3; ++pass)
+        {
+            for (size_t i = 0; i < 100; ++i)
+                job_queue.schedule(new JobNotifyingAboutExecution(execution_count));
+
+            job_queue.wait_until_completion();
+        }
+
+        EXPECT_FALSE(job_queue.has_scheduled_or_running_jobs());
+        EXPECT_EQ(3 * 100, execution_count);
+    }
+
+    struct JobRecordingWorkerThread
+      : public IJob
+    {
+        bool& m_is_worker_thread;
+
+        explicit JobRecordingWorkerThread(bool& is_worker_thread)
+          : m_is_worker_thread(is_worker_thread)
+        {
+        }
+
+        virtual void execute(const size_t thread_index)
+        {
+            m_is_worker_thread = JobManager::is_worker_thread();
+        }
+    };
+
+    TEST_CASE_F(IsWorkerThread_DistinguishesWorkerThreadsFromCallingThread, FixtureJobManager)
+    {
+        bool is_worker_thread = false;
+
+        job_queue.schedule(new JobRecordingWorkerThread(is_worker_thread));
+
+        job_manager.start();
+        job_queue.wait_until_completion();
+
+        EXPECT_TRUE(is_worker_thread);
+        EXPECT_FALSE(JobManager::is_worker_thread());
+    }
+}
+
+TEST_SUITE(Foundation_Utility_Job_ParallelFor)
+{
+    struct MarkIterations
+    {
+        vector<size_t>& m_marks;
+
+        explicit MarkIterations(vector<size_t>& marks)
+          : m_marks(marks)
+        {
+        }
+
+        void operator()(const size_t begin, const size_t end, const size_t thread_index)
+        {
+            for (size_t i = begin; i < end; ++i)
+                ++m_marks[i];
+        }
+    };
+
+    struct Fixture
+    {
+        Logger          m_logger;
+        JobQueue        m_job_queue;
+        JobManager      m_job_manager;
+        vector<size_t>  m_marks;
+
+        Fixture()
+          : m_job_manager(m_logger, m_job_queue, 4, JobManager::KeepRunningOnEmptyQueue)
+          , m_marks(1000, 0)
+        {
+            m_job_manager.start();
+        }
+
+        bool all_marked_once(const size_t begin, const size_t end) const
+        {
+            for (size_t i = 0; i < m_marks.size(); ++i)
+            {
+                if (m_marks[i] != (i >= begin && i < end ? 1 : 0))
+                    return false;
+            }
+
+            return true;
+        }
+    };
+
+    TEST_CASE_F(ParallelFor_ExecutesEachIterationExactlyOnce, Fixture)
+    {
+        MarkIterations body(m_marks);
+
+        parallel_for(m_job_queue, 10, 990, 7, body);
+
+        EXPECT_TRUE(all_marked_once(10, 990));
+    }
+
+    TEST_CASE_F(ParallelFor_GivenGrainSizeLargerThanRange_ExecutesEachIterationExactlyOnce, Fixture)
+    {
+        MarkIterations body(m_marks);
+
+        parallel_for(m_job_queue, 0, 1000, 5000, body);
+
+        EXPECT_TRUE(all_marked_once(0, 1000));
+    }
+
+    TEST_CASE_F(ParallelFor_GivenEmptyRange_ReturnsImmediately, Fixture)
+    {
+        MarkIterations body(m_marks);
+
+        parallel_for(m_job_queue, 10, 10, 1, body);
+
+        EXPECT_TRUE(all_marked_once(0, 0));
+    }
 }
 
 TEST_SUITE(Foundation_Utility_Job_WorkerThread)
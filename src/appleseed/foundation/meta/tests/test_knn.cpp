@@ -47,12 +47,15 @@
 #include "foundation/math/vector.h"
 #include "foundation/platform/timer.h"
 #include "foundation/utility/iostreamop.h"
+#include "foundation/utility/job.h"
+#include "foundation/utility/log.h"
 #include "foundation/utility/test.h"
 
 // STANN headers.
 #include "sfcnn.hpp"
 
 // Standard headers.
+#include <algorithm>
 #include <cstddef>
 #include <vector>
 
@@ -141,6 +144,53 @@ TEST_SUITE(Foundation_Math_Knn_Builder)
 
         EXPECT_EQ(8 + 4 + 2 + 1, tree.m_nodes.size());
     }
+
+    TEST_CASE(BuildMovePoints_GivenJobQueue_BuildsSameTreeAsSerialBuild)
+    {
+        const size_t PointCount = 100000;
+
+        MersenneTwister rng;
+        vector<Vector3f> points(PointCount);
+        for (size_t i = 0; i < PointCount; ++i)
+            points[i] = rand_vector1<Vector3f>(rng);
+
+        knn::Tree3f serial_tree;
+        vector<Vector3f> serial_points(points);
+        knn::Builder3f serial_builder(serial_tree);
+        serial_builder.build_move_points<DefaultWallclockTimer>(serial_points);
+
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, 4, JobManager::KeepRunningOnEmptyQueue);
+        job_manager.start();
+
+        knn::Tree3f parallel_tree;
+        vector<Vector3f> parallel_points(points);
+        knn::Builder3f parallel_builder(parallel_tree);
+        parallel_builder.build_move_points<DefaultWallclockTimer>(parallel_points, job_queue);
+
+        EXPECT_SEQUENCE_EQ(PointCount, &serial_tree.m_points[0], &parallel_tree.m_points[0]);
+        EXPECT_SEQUENCE_EQ(PointCount, &serial_tree.m_indices[0], &parallel_tree.m_indices[0]);
+
+        ASSERT_EQ(serial_tree.m_nodes.size(), parallel_tree.m_nodes.size());
+
+        for (size_t i = 0; i < serial_tree.m_nodes.size(); ++i)
+        {
+            const knn::Node<float>& serial_node = serial_tree.m_nodes[i];
+            const knn::Node<float>& parallel_node = parallel_tree.m_nodes[i];
+
+            ASSERT_EQ(serial_node.is_leaf(), parallel_node.is_leaf());
+            EXPECT_EQ(serial_node.get_point_index(), parallel_node.get_point_index());
+            EXPECT_EQ(serial_node.get_point_count(), parallel_node.get_point_count());
+
+            if (serial_node.is_interior())
+            {
+                EXPECT_EQ(serial_node.get_child_node_index(), parallel_node.get_child_node_index());
+                EXPECT_EQ(serial_node.get_split_dim(), parallel_node.get_split_dim());
+                EXPECT_EQ(serial_node.get_split_abs(), parallel_node.get_split_abs());
+            }
+        }
+    }
 }
 
 TEST_SUITE(Foundation_Math_Knn_Answer)
@@ -396,6 +446,70 @@ TEST_SUITE(Foundation_Math_Knn_Query)
             }
         }
     }
+
+    TEST_CASE(Run_GivenMaxSearchDistanceSlightlyLargerThanAnswer_ReturnsNearestNeighbors)
+    {
+        const size_t PointCount = 10000;
+        const size_t QueryCount = 1000;
+        const size_t AnswerSize = 8;
+
+        // The search disk holds about 12 points: the answer fills up and becomes a heap
+        // while the tree is being traversed.
+        const double QueryMaxSquareDistance = square(0.066);
+
+        MersenneTwister rng;
+
+        vector<Vector3d> points;
+        generate_random_points(rng, points, PointCount);
+
+        knn::Tree3d tree;
+        knn::Builder3d builder(tree);
+        builder.build<DefaultWallclockTimer>(&points[0], PointCount);
+
+        knn::Answer<double> answer(AnswerSize);
+        knn::Query3d query(tree, answer);
+
+        size_t mismatch_count = 0;
+
+        for (size_t i = 0; i < QueryCount; ++i)
+        {
+            Vector3d q;
+            q.x = rand_double1(rng);
+            q.y = rand_double1(rng);
+            q.z = rand_double1(rng);
+
+            vector<double> square_distances;
+            for (size_t j = 0; j < PointCount; ++j)
+            {
+                const double d = square_distance(points[j], q);
+                if (d <= QueryMaxSquareDistance)
+                    square_distances.push_back(d);
+            }
+
+            sort(square_distances.begin(), square_distances.end());
+            square_distances.resize(min(square_distances.size(), AnswerSize));
+
+            query.run(q, QueryMaxSquareDistance);
+            answer.sort();
+
+            if (answer.size() != square_distances.size())
+            {
+                ++mismatch_count;
+                continue;
+            }
+
+            for (size_t j = 0; j < answer.size(); ++j)
+            {
+                if (answer.get(j).m_square_dist != square_distances[j])
+                {
+                    ++mismatch_count;
+                    break;
+                }
+            }
+        }
+
+        EXPECT_EQ(0, mismatch_count);
+    }
 }
 
 #pragma warning (pop)
@@ -114,3 +114,90 @@ TEST_SUITE(Foundation_Utility_Lazy_Access)
         EXPECT_EQ(0, access.get());
     }
 }
+
+TEST_SUITE(Foundation_Utility_Lazy_Collect)
+{
+    using namespace foundation;
+    using namespace std;
+
+    struct Object
+    {
+        size_t& m_live_count;
+
+        explicit Object(size_t& live_count)
+          : m_live_count(live_count)
+        {
+            ++m_live_count;
+        }
+
+        ~Object()
+        {
+            --m_live_count;
+        }
+    };
+
+    struct ObjectFactory : public ILazyFactory<Object>
+    {
+        size_t& m_live_count;
+
+        explicit ObjectFactory(size_t& live_count)
+          : m_live_count(live_count)
+        {
+        }
+
+        virtual auto_ptr<Object> create()
+        {
+            return auto_ptr<Object>(new Object(m_live_count));
+        }
+    };
+
+    TEST_CASE(Collect_GivenObjectBeingAccessed_ReturnsFalse)
+    {
+        size_t live_count = 0;
+        Lazy<Object> lazy(auto_ptr<ILazyFactory<Object> >(new ObjectFactory(live_count)));
+        Access<Object> access(&lazy);
+
+        EXPECT_FALSE(lazy.collect());
+        EXPECT_FALSE(lazy.collect());
+        EXPECT_EQ(1, live_count);
+    }
+
+    TEST_CASE(Collect_GivenRecentlyAccessedObject_DeletesObjectOnSecondCall)
+    {
+        size_t live_count = 0;
+        Lazy<Object> lazy(auto_ptr<ILazyFactory<Object> >(new ObjectFactory(live_count)));
+        Access<Object> access(&lazy);
+        access.reset(0);
+
+        EXPECT_FALSE(lazy.collect());
+        EXPECT_TRUE(lazy.collect());
+        EXPECT_EQ(0, live_count);
+    }
+
+    TEST_CASE(Access_GivenCollectedObject_CreatesObjectAgain)
+    {
+        size_t live_count = 0;
+        Lazy<Object> lazy(auto_ptr<ILazyFactory<Object> >(new ObjectFactory(live_count)));
+        Access<Object> access(&lazy);
+        access.reset(0);
+        lazy.collect();
+        lazy.collect();
+
+        access.reset(&lazy);
+
+        EXPECT_NEQ(0, access.get());
+        EXPECT_EQ(1, live_count);
+    }
+
+    TEST_CASE(Collect_GivenWrappedObject_ReturnsFalse)
+    {
+        size_t live_count = 0;
+        Object object(live_count);
+        Lazy<Object> lazy(&object);
+        Access<Object> access(&lazy);
+        access.reset(0);
+
+        EXPECT_FALSE(lazy.collect());
+        EXPECT_FALSE(lazy.collect());
+    }
+}
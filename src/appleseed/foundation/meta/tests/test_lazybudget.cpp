@@ -0,0 +1,167 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/utility/lazy.h"
+#include "foundation/utility/lazybudget.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+
+TEST_SUITE(Foundation_Utility_LazyBudget)
+{
+    using namespace foundation;
+    using namespace std;
+
+    struct Object
+    {
+        const size_t m_size;
+
+        explicit Object(const size_t size)
+          : m_size(size)
+        {
+        }
+
+        size_t get_memory_size() const
+        {
+            return m_size;
+        }
+    };
+
+    struct ObjectFactory : public ILazyFactory<Object>
+    {
+        const size_t m_size;
+
+        explicit ObjectFactory(const size_t size)
+          : m_size(size)
+        {
+        }
+
+        virtual auto_ptr<Object> create()
+        {
+            return auto_ptr<Object>(new Object(m_size));
+        }
+    };
+
+    Lazy<Object>* create_lazy(LazyBudget& budget, const size_t size)
+    {
+        return budget.create_lazy(auto_ptr<ILazyFactory<Object> >(new ObjectFactory(size)));
+    }
+
+    TEST_CASE(GetSize_GivenCreatedObjects_ReturnsTotalSize)
+    {
+        LazyBudget budget;
+        auto_ptr<Lazy<Object> > lazy1(create_lazy(budget, 10));
+        auto_ptr<Lazy<Object> > lazy2(create_lazy(budget, 20));
+
+        Access<Object> access1(lazy1.get());
+        Access<Object> access2(lazy2.get());
+
+        EXPECT_EQ(30, budget.get_size());
+    }
+
+    TEST_CASE(GetSize_AfterLazyObjectIsDeleted_ReturnsSizeOfRemainingObjects)
+    {
+        LazyBudget budget;
+        auto_ptr<Lazy<Object> > lazy1(create_lazy(budget, 10));
+        auto_ptr<Lazy<Object> > lazy2(create_lazy(budget, 20));
+        Access<Object>(lazy1.get()).reset(0);
+        Access<Object>(lazy2.get()).reset(0);
+
+        lazy1.reset();
+
+        EXPECT_EQ(20, budget.get_size());
+    }
+
+    TEST_CASE(Access_GivenBudgetExceeded_CollectsUnusedObject)
+    {
+        LazyBudget budget(25);
+        auto_ptr<Lazy<Object> > lazy1(create_lazy(budget, 10));
+        auto_ptr<Lazy<Object> > lazy2(create_lazy(budget, 20));
+        Access<Object>(lazy1.get()).reset(0);
+
+        Access<Object> access2(lazy2.get());
+
+        EXPECT_EQ(20, budget.get_size());
+        EXPECT_EQ(1, budget.get_collected_count());
+    }
+
+    TEST_CASE(Access_GivenBudgetExceeded_KeepsObjectsBeingAccessed)
+    {
+        LazyBudget budget(25);
+        auto_ptr<Lazy<Object> > lazy1(create_lazy(budget, 10));
+        auto_ptr<Lazy<Object> > lazy2(create_lazy(budget, 20));
+        Access<Object> access1(lazy1.get());
+
+        Access<Object> access2(lazy2.get());
+
+        EXPECT_EQ(30, budget.get_size());
+        EXPECT_EQ(0, budget.get_collected_count());
+    }
+
+    TEST_CASE(Access_GivenBudgetExceeded_CollectsLeastRecentlyAccessedObjectFirst)
+    {
+        LazyBudget budget(35);
+        auto_ptr<Lazy<Object> > lazy1(create_lazy(budget, 10));
+        auto_ptr<Lazy<Object> > lazy2(create_lazy(budget, 10));
+        auto_ptr<Lazy<Object> > lazy3(create_lazy(budget, 10));
+        auto_ptr<Lazy<Object> > lazy4(create_lazy(budget, 10));
+        Access<Object>(lazy1.get()).reset(0);
+        Access<Object>(lazy2.get()).reset(0);
+        Access<Object>(lazy3.get()).reset(0);
+
+        // Exceeds the budget: lazy1 is collected after every object got its second chance.
+        Access<Object>(lazy4.get()).reset(0);
+        EXPECT_EQ(30, budget.get_size());
+
+        // lazy1 is accessed again: lazy2 is now the least recently accessed object.
+        Access<Object>(lazy1.get()).reset(0);
+        EXPECT_EQ(30, budget.get_size());
+        EXPECT_EQ(2, budget.get_collected_count());
+
+        Access<Object> access2(lazy2.get());
+        EXPECT_EQ(3, budget.get_collected_count());
+    }
+
+    TEST_CASE(SetMaxSize_GivenSmallerBudget_CollectsUnusedObjects)
+    {
+        LazyBudget budget;
+        auto_ptr<Lazy<Object> > lazy1(create_lazy(budget, 10));
+        auto_ptr<Lazy<Object> > lazy2(create_lazy(budget, 20));
+        Access<Object>(lazy1.get()).reset(0);
+        Access<Object>(lazy2.get()).reset(0);
+
+        budget.set_max_size(1);
+
+        EXPECT_EQ(0, budget.get_size());
+        EXPECT_EQ(2, budget.get_collected_count());
+    }
+}
@@ -38,6 +38,7 @@
 
 // Standard headers.
 #include <string>
+#include <vector>
 
 // Windows.
 #if defined _WIN32
@@ -69,6 +70,7 @@
 
     // Standard headers.
     #include <cstdio>
+    #include <fstream>
 
     // Platform headers.
     #include <sys/sysinfo.h>
@@ -91,6 +93,9 @@ namespace foundation
 
 void System::print_information(Logger& logger)
 {
+    vector<vector<size_t> > numa_nodes;
+    get_numa_topology(numa_nodes);
+
     LOG_INFO(
         logger,
         "system information:\n"
@@ -99,7 +104,8 @@ void System::print_information(Logger& logger)
         "  L2 cache         size %s, line size %s\n"
         "  L3 cache         size %s, line size %s\n"
         "  physical memory  size %s\n"
-        "  virtual memory   size %s",
+        "  virtual memory   size %s\n"
+        "  numa nodes       %s",
         pretty_uint(get_logical_cpu_core_count()).c_str(),
         pretty_size(get_l1_data_cache_size()).c_str(),
         pretty_size(get_l1_data_cache_line_size()).c_str(),
@@ -108,7 +114,8 @@ void System::print_information(Logger& logger)
         pretty_size(get_l3_cache_size()).c_str(),
         pretty_size(get_l3_cache_line_size()).c_str(),
         pretty_size(get_total_physical_memory_size()).c_str(),
-        pretty_size(get_total_virtual_memory_size()).c_str());
+        pretty_size(get_total_virtual_memory_size()).c_str(),
+        pretty_uint(numa_nodes.size()).c_str());
 }
 
 size_t System::get_logical_cpu_core_count()
@@ -124,6 +131,77 @@ uint64 System::get_cpu_core_frequency(const uint32 calibration_time_ms)
     return X86Timer(calibration_time_ms).frequency();
 }
 
+namespace
+{
+    // Platform-specific, defined below. Leave the vector empty if the topology is unknown.
+    void read_numa_topology(vector<vector<size_t> >& nodes);
+
+    // Format a list of CPU cores such as { 0, 1, 2, 3, 8 } as "0-3,8".
+    string format_cpu_core_list(const vector<size_t>& cores)
+    {
+        string result;
+
+        for (size_t i = 0; i < cores.size(); )
+        {
+            size_t j = i + 1;
+            while (j < cores.size() && cores[j] == cores[j - 1] + 1)
+                ++j;
+
+            if (!result.empty())
+                result += ',';
+
+            result += to_string(cores[i]);
+
+            if (j - i > 1)
+                result += '-' + to_string(cores[j - 1]);
+
+            i = j;
+        }
+
+        return result;
+    }
+}
+
+void System::get_numa_topology(vector<vector<size_t> >& nodes)
+{
+    nodes.clear();
+
+    read_numa_topology(nodes);
+
+    if (nodes.empty())
+    {
+        const size_t core_count = get_logical_cpu_core_count();
+
+        nodes.resize(1);
+
+        for (size_t i = 0; i < core_count; ++i)
+            nodes[0].push_back(i);
+    }
+}
+
+void System::print_numa_topology(Logger& logger)
+{
+    vector<vector<size_t> > nodes;
+    get_numa_topology(nodes);
+
+    string node_list;
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        node_list +=
+            "\n  node " + to_string(i) + "  " +
+            pretty_uint(nodes[i].size()) + " " + plural(nodes[i].size(), "core") +
+            " (" + format_cpu_core_list(nodes[i]) + ")";
+    }
+
+    LOG_INFO(
+        logger,
+        "numa topology: %s %s:%s",
+        pretty_uint(nodes.size()).c_str(),
+        plural(nodes.size(), "node").c_str(),
+        node_list.c_str());
+}
+
 // ------------------------------------------------------------------------------------------------
 // Windows.
 // ------------------------------------------------------------------------------------------------
@@ -175,6 +253,28 @@ namespace
 
         return found;
     }
+
+    void read_numa_topology(vector<vector<size_t> >& nodes)
+    {
+        ULONG highest_node;
+        if (!GetNumaHighestNodeNumber(&highest_node))
+            return;
+
+        for (ULONG node = 0; node <= highest_node; ++node)
+        {
+            ULONGLONG mask;
+            if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask) || mask == 0)
+                continue;
+
+            nodes.push_back(vector<size_t>());
+
+            for (size_t i = 0; i < 64; ++i)
+            {
+                if (mask & (ULONGLONG(1) << i))
+                    nodes.back().push_back(i);
+            }
+        }
+    }
 }
 
 size_t System::get_l1_data_cache_size()
@@ -262,6 +362,11 @@ namespace
         size_t value_size = sizeof(value);
         return sysctlbyname(name, &value, &value_size, 0, 0) == 0 ? value : 0;
     }
+
+    void read_numa_topology(vector<vector<size_t> >& nodes)
+    {
+        // Mac OS X does not expose NUMA nodes.
+    }
 }
 
 size_t System::get_l1_data_cache_size()
@@ -351,6 +456,63 @@ uint64 System::get_process_virtual_memory_size()
 
 #elif defined __linux__
 
+namespace
+{
+    // Parse a list of integers such as "0-3,8,10-11", as found in sysfs.
+    void parse_integer_list(const string& text, vector<size_t>& values)
+    {
+        vector<string> ranges;
+        tokenize(text, ",\n", ranges);
+
+        for (size_t i = 0; i < ranges.size(); ++i)
+        {
+            size_t first, last;
+
+            if (sscanf(ranges[i].c_str(), "%zu-%zu", &first, &last) == 2)
+            {
+                for (size_t j = first; j <= last; ++j)
+                    values.push_back(j);
+            }
+            else if (sscanf(ranges[i].c_str(), "%zu", &first) == 1)
+                values.push_back(first);
+        }
+    }
+
+    bool read_integer_list(const string& path, vector<size_t>& values)
+    {
+        ifstream file(path.c_str());
+
+        string text;
+        if (!getline(file, text))
+            return false;
+
+        parse_integer_list(text, values);
+
+        return true;
+    }
+
+    void read_numa_topology(vector<vector<size_t> >& nodes)
+    {
+        // Reference: https://www.kernel.org/doc/Documentation/ABI/stable/sysfs-devices-node
+
+        vector<size_t> node_ids;
+        if (!read_integer_list("/sys/devices/system/node/online", node_ids))
+            return;
+
+        for (size_t i = 0; i < node_ids.size(); ++i)
+        {
+            vector<size_t> cores;
+            read_integer_list(
+                "/sys/devices/system/node/node" + to_string(node_ids[i]) + "/cpulist",
+                cores);
+
+            // Skip nodes that only have memory.
+            if (!cores.empty())
+                nodes.push_back(cores);
+        }
+    }
+}
+
 size_t System::get_l1_data_cache_size()
 {
     return sysconf(_SC_LEVEL1_DCACHE_SIZE);
@@ -39,6 +39,7 @@
 
 // Standard headers.
 #include <cstddef>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class Logger; }
@@ -67,6 +68,17 @@ class DLLSYMBOL System
     // Return the frequency, in Hz, of a given CPU core at this instant.
     static uint64 get_cpu_core_frequency(const uint32 calibration_time_ms = 10);
 
+    //
+    // NUMA topology.
+    //
+
+    // Retrieve the logical CPU cores of each NUMA node. Systems without NUMA,
+    // or whose topology can't be queried, are reported as a single node.
+    static void get_numa_topology(std::vector<std::vector<size_t> >& nodes);
+
+    // Print the NUMA topology.
+    static void print_numa_topology(Logger& logger);
+
     //
     // CPU caches.
     //
@@ -42,7 +42,14 @@
 // Standard headers.
 #include <cassert>
 
+// Platform headers.
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 using namespace boost;
+using namespace std;
 
 namespace foundation
 {
@@ -272,4 +279,48 @@ void yield()
     this_thread::yield();
 }
 
+#if defined _WIN32
+
+bool set_current_thread_cpu_affinity(const vector<size_t>& cpu_cores)
+{
+    // Only the cores of the current processor group (at most 64) can be addressed.
+    DWORD_PTR mask = 0;
+
+    for (size_t i = 0; i < cpu_cores.size(); ++i)
+    {
+        if (cpu_cores[i] < sizeof(DWORD_PTR) * 8)
+            mask |= DWORD_PTR(1) << cpu_cores[i];
+    }
+
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
+
+#elif defined __linux__
+
+bool set_current_thread_cpu_affinity(const vector<size_t>& cpu_cores)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    for (size_t i = 0; i < cpu_cores.size(); ++i)
+    {
+        if (cpu_cores[i] < CPU_SETSIZE)
+            CPU_SET(cpu_cores[i], &cpu_set);
+    }
+
+    return
+        CPU_COUNT(&cpu_set) > 0 &&
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+}
+
+#else
+
+bool set_current_thread_cpu_affinity(const vector<size_t>& cpu_cores)
+{
+    // Mac OS X only supports affinity hints between threads, not binding to cores.
+    return false;
+}
+
+#endif
+
 }   // namespace foundation
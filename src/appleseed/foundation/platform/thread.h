@@ -33,6 +33,7 @@
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
 #include "foundation/platform/types.h"
+#include "foundation/utility/casts.h"
 
 // appleseed.main headers.
 #include "main/dllsymbol.h"
@@ -47,6 +48,10 @@
 #pragma warning (pop)
 #include "boost/version.hpp"
 
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
 // Forward declarations.
 namespace foundation    { class Logger; }
 
@@ -90,6 +95,23 @@ class Spinlock
 };
 
 
+//
+// Atomically add a value to a single-precision floating-point number stored in a 32-bit integer.
+//
+
+inline void atomic_add(volatile uint32* ptr, const float operand)
+{
+    while (true)
+    {
+        const uint32 expected = *ptr;
+        const uint32 desired = binary_cast<uint32>(binary_cast<float>(expected) + operand);
+
+        if (boost_atomic::atomic_cas32(ptr, desired, expected) == expected)
+            break;
+    }
+}
+
+
 //
 // Process/thread priority levels.
 //
@@ -206,6 +228,10 @@ DLLSYMBOL void sleep(const uint32 ms);
 // Give up the remainder of the current thread's time slice, to allow other threads to run.
 DLLSYMBOL void yield();
 
+// Restrict the current thread to a set of logical CPU cores. Return false if the affinity
+// could not be set, or if the platform does not support it (Mac OS X).
+DLLSYMBOL bool set_current_thread_cpu_affinity(const std::vector<size_t>& cpu_cores);
+
 
 //
 // Spinlock class implementation.
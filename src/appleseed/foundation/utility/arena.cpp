@@ -0,0 +1,185 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "arena.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/minmax.h"
+
+// Standard headers.
+#include <new>
+
+namespace foundation
+{
+
+//
+// Arena class implementation.
+//
+
+namespace
+{
+    // Alignment of the memory blocks, and thus maximum supported alignment of allocations
+    // (larger alignments remain correct but may waste memory at the start of the block).
+    const size_t BlockAlignment = 64;
+}
+
+struct Arena::Block
+{
+    Block*  m_next;
+    size_t  m_size;     // size of the usable part of the block, in bytes
+
+    static size_t header_size()
+    {
+        return (sizeof(Block) + BlockAlignment - 1) & ~(BlockAlignment - 1);
+    }
+
+    uint8* data()
+    {
+        return reinterpret_cast<uint8*>(this) + header_size();
+    }
+};
+
+Arena::Arena(const size_t block_size)
+  : m_block_size(block_size)
+  , m_first_block(0)
+  , m_current_block(0)
+  , m_ptr(0)
+  , m_end(0)
+  , m_prev_blocks_size(0)
+{
+    assert(block_size > 0);
+}
+
+Arena::~Arena()
+{
+    release_memory();
+}
+
+void Arena::clear()
+{
+    m_current_block = m_first_block;
+    m_prev_blocks_size = 0;
+
+    if (m_current_block)
+    {
+        m_ptr = m_current_block->data();
+        m_end = m_ptr + m_current_block->m_size;
+    }
+    else m_ptr = m_end = 0;
+}
+
+void Arena::release_memory()
+{
+    Block* block = m_first_block;
+
+    while (block)
+    {
+        Block* next = block->m_next;
+        aligned_free(block);
+        block = next;
+    }
+
+    m_first_block = 0;
+
+    clear();
+}
+
+size_t Arena::get_allocated_size() const
+{
+    return
+        m_current_block
+            ? m_prev_blocks_size + static_cast<size_t>(m_ptr - m_current_block->data())
+            : 0;
+}
+
+size_t Arena::get_capacity() const
+{
+    size_t capacity = 0;
+
+    for (const Block* block = m_first_block; block; block = block->m_next)
+        capacity += block->m_size;
+
+    return capacity;
+}
+
+size_t Arena::get_block_count() const
+{
+    size_t count = 0;
+
+    for (const Block* block = m_first_block; block; block = block->m_next)
+        ++count;
+
+    return count;
+}
+
+void* Arena::allocate_slow(const size_t size, const size_t alignment)
+{
+    // Worst case amount of memory required to honor both size and alignment.
+    const size_t required_size = size + alignment - 1;
+
+    // Retire the current block.
+    if (m_current_block)
+        m_prev_blocks_size += static_cast<size_t>(m_ptr - m_current_block->data());
+
+    Block* block = m_current_block ? m_current_block->m_next : m_first_block;
+
+    // Reuse the next block if it's large enough, otherwise insert a new block after the current one.
+    if (block == 0 || block->m_size < required_size)
+    {
+        const size_t block_size = max(m_block_size, required_size);
+
+        Block* new_block =
+            static_cast<Block*>(aligned_malloc(Block::header_size() + block_size, BlockAlignment));
+
+        if (new_block == 0)
+            throw std::bad_alloc();
+
+        new_block->m_next = block;
+        new_block->m_size = block_size;
+
+        if (m_current_block)
+            m_current_block->m_next = new_block;
+        else m_first_block = new_block;
+
+        block = new_block;
+    }
+
+    m_current_block = block;
+    m_end = block->data() + block->m_size;
+
+    uint8* ptr = align(block->data(), alignment);
+    m_ptr = ptr + size;
+
+    assert(m_ptr <= m_end);
+
+    return ptr;
+}
+
+}   // namespace foundation
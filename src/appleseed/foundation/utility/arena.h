@@ -0,0 +1,239 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_UTILITY_ARENA_H
+#define APPLESEED_FOUNDATION_UTILITY_ARENA_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/memory.h"
+
+// appleseed.main headers.
+#include "main/dllsymbol.h"
+
+// boost headers.
+#include "boost/type_traits/alignment_of.hpp"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <new>
+
+namespace foundation
+{
+
+//
+// A bump allocator for short-lived scratch memory.
+//
+// Allocations are carved out of large blocks by advancing a pointer; individual
+// allocations are never freed. Instead, clear() discards all allocations at once
+// while keeping the blocks around, so that once an arena has warmed up, further
+// allocations never reach the system allocator. No destructor is ever invoked on
+// objects allocated from an arena.
+//
+// This class is not thread-safe: use one arena per thread.
+//
+
+class DLLSYMBOL Arena
+  : public NonCopyable
+{
+  public:
+    // Constructor. No memory is allocated until the first allocation.
+    explicit Arena(const size_t block_size = 16 * 1024);
+
+    // Destructor. Returns all blocks to the system.
+    ~Arena();
+
+    // Allocate a block of memory. The returned pointer is valid until the next call to clear().
+    void* allocate(const size_t size, const size_t alignment = 16);
+
+    // Allocate uninitialized storage for 'count' objects of type T.
+    template <typename T>
+    T* allocate(const size_t count = 1);
+
+    // Discard all allocations but keep the memory blocks for reuse.
+    void clear();
+
+    // Discard all allocations and return all memory blocks to the system.
+    void release_memory();
+
+    // Return the number of bytes handed out since the last call to clear(), alignment padding included.
+    size_t get_allocated_size() const;
+
+    // Return the total size of the memory blocks owned by the arena, in bytes.
+    size_t get_capacity() const;
+
+    // Return the number of memory blocks owned by the arena.
+    size_t get_block_count() const;
+
+  private:
+    struct Block;
+
+    const size_t    m_block_size;
+    Block*          m_first_block;
+    Block*          m_current_block;
+    uint8*          m_ptr;
+    uint8*          m_end;
+    size_t          m_prev_blocks_size;     // bytes used in the blocks preceding the current one
+
+    void* allocate_slow(const size_t size, const size_t alignment);
+};
+
+
+//
+// A standard-conformant allocator that allocates memory from an arena.
+//
+// deallocate() is a no-op: memory is reclaimed when the arena is cleared.
+//
+
+template <typename T>
+class ArenaAllocator
+{
+  public:
+    typedef T                   value_type;
+    typedef value_type*         pointer;
+    typedef const value_type*   const_pointer;
+    typedef value_type&         reference;
+    typedef const value_type&   const_reference;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef ArenaAllocator<U> other;
+    };
+
+    explicit ArenaAllocator(Arena& arena)
+      : m_arena(&arena)
+    {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& rhs)
+      : m_arena(rhs.m_arena)
+    {
+    }
+
+    pointer address(reference x) const
+    {
+        return &x;
+    }
+
+    const_pointer address(const_reference x) const
+    {
+        return &x;
+    }
+
+    pointer allocate(size_type n, const void* = 0)
+    {
+        return m_arena->template allocate<T>(n);
+    }
+
+    void deallocate(pointer, size_type)
+    {
+    }
+
+    size_type max_size() const
+    {
+        return std::numeric_limits<size_type>::max() / sizeof(T);
+    }
+
+    void construct(pointer p, const_reference x)
+    {
+        new(p) value_type(x);
+    }
+
+    void destroy(pointer p)
+    {
+        p->~value_type();
+    }
+
+    Arena& get_arena() const
+    {
+        return *m_arena;
+    }
+
+  private:
+    // Allow allocators of different types to access each other private members.
+    template <typename>
+    friend class ArenaAllocator;
+
+    Arena* m_arena;
+};
+
+// Arena allocators are equal if they allocate from the same arena.
+template <typename LhsT, typename RhsT>
+inline bool operator==(const ArenaAllocator<LhsT>& lhs, const ArenaAllocator<RhsT>& rhs)
+{
+    return &lhs.get_arena() == &rhs.get_arena();
+}
+
+template <typename LhsT, typename RhsT>
+inline bool operator!=(const ArenaAllocator<LhsT>& lhs, const ArenaAllocator<RhsT>& rhs)
+{
+    return !operator==(lhs, rhs);
+}
+
+
+//
+// Arena class implementation.
+//
+
+inline void* Arena::allocate(const size_t size, const size_t alignment)
+{
+    assert(size > 0);
+
+    uint8* ptr = align(m_ptr, alignment);
+
+    // Fast path: the allocation fits into the current block.
+    if (ptr + size <= m_end)
+    {
+        m_ptr = ptr + size;
+        return ptr;
+    }
+
+    return allocate_slow(size, alignment);
+}
+
+template <typename T>
+inline T* Arena::allocate(const size_t count)
+{
+    return
+        static_cast<T*>(
+            allocate(
+                count * sizeof(T),
+                boost::alignment_of<T>::value));
+}
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_UTILITY_ARENA_H
@@ -385,6 +385,9 @@ class SACache
     // Get an element from the cache.
     ElementType& get(const KeyType& key);
 
+    // Return true if a given key is in the cache. Does not affect statistics or eviction order.
+    bool contains(const KeyType& key) const;
+
     // Invalidate a cache entry.
     void invalidate(const KeyType& key);
 
@@ -792,6 +795,17 @@ get(const KeyType& key)
     return entry->m_element;
 }
 
+FOUNDATION_SACACHE_TEMPLATE_DEF(inline bool)
+contains(const KeyType& key) const
+{
+    // Find the cache line that might contain this key.
+    const size_t index = m_key_hasher(key);
+    LineType& line = const_cast<LineType&>(m_lines[index % Lines]);
+
+    // Look for this key inside the cache line.
+    return line.find_entry(key) != 0;
+}
+
 FOUNDATION_SACACHE_TEMPLATE_DEF(inline void)
 invalidate(const KeyType& key)
 {
@@ -35,5 +35,6 @@
 #include "foundation/utility/job/ijob.h"
 #include "foundation/utility/job/jobmanager.h"
 #include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/job/parallelfor.h"
 
 #endif  // !APPLESEED_FOUNDATION_UTILITY_JOB_H
@@ -31,10 +31,12 @@
 #include "jobmanager.h"
 
 // appleseed.foundation headers.
+#include "foundation/platform/system.h"
 #include "foundation/utility/job/jobqueue.h"
 #include "foundation/utility/job/workerthread.h"
 #include "foundation/utility/foreach.h"
 #include "foundation/utility/log.h"
+#include "foundation/utility/string.h"
 
 // Standard headers.
 #include <cassert>
@@ -50,6 +52,26 @@ namespace foundation
 // JobManager class implementation.
 //
 
+namespace
+{
+    // Compute the logical CPU cores a given worker thread should be bound to.
+    vector<size_t> get_worker_cpu_cores(
+        const vector<vector<size_t> >&  numa_nodes,
+        const size_t                    worker_index,
+        const int                       flags)
+    {
+        const vector<size_t>& node = numa_nodes[worker_index % numa_nodes.size()];
+
+        if (flags & JobManager::PinThreadsToCpuCores)
+        {
+            const size_t core_index = (worker_index / numa_nodes.size()) % node.size();
+            return vector<size_t>(1, node[core_index]);
+        }
+
+        return node;
+    }
+}
+
 struct JobManager::Impl
 {
     typedef vector<WorkerThread*> WorkerThreads;
@@ -103,14 +125,38 @@ void JobManager::start()
     // Create the worker threads if they don't already exist.
     if (impl->m_worker_threads.empty())
     {
+        const bool pin_threads =
+            (impl->m_flags & (PinThreadsToCpuCores | PinThreadsToNumaNodes)) != 0;
+
+        vector<vector<size_t> > numa_nodes;
+
+        if (pin_threads)
+        {
+            System::get_numa_topology(numa_nodes);
+
+            LOG_DEBUG(
+                impl->m_logger,
+                "binding %s worker %s to %s across %s numa %s.",
+                pretty_uint(impl->m_thread_count).c_str(),
+                plural(impl->m_thread_count, "thread").c_str(),
+                impl->m_flags & PinThreadsToCpuCores ? "cpu cores" : "numa nodes",
+                pretty_uint(numa_nodes.size()).c_str(),
+                plural(numa_nodes.size(), "node").c_str());
+        }
+
         for (size_t i = 0; i < impl->m_thread_count; ++i)
         {
-            impl->m_worker_threads.push_back(
+            WorkerThread* worker_thread =
                 new WorkerThread(
                     i,
                     impl->m_logger,
                     impl->m_job_queue,
-                    impl->m_flags));
+                    impl->m_flags);
+
+            if (pin_threads)
+                worker_thread->set_cpu_affinity(get_worker_cpu_cores(numa_nodes, i, impl->m_flags));
+
+            impl->m_worker_threads.push_back(worker_thread);
         }
     }
 
@@ -127,4 +173,9 @@ void JobManager::stop()
     impl->m_worker_threads.clear();
 }
 
+bool JobManager::is_worker_thread()
+{
+    return WorkerThread::is_current_thread();
+}
+
 }   // namespace foundation
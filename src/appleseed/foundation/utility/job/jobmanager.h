@@ -51,6 +51,11 @@ namespace foundation
 //
 // The job manager itself is thread-local: none of its methods are thread-safe.
 //
+// When worker threads are pinned, consecutive worker threads are spread over NUMA nodes
+// in round-robin order, so that any number of threads uses the memory bandwidth of all
+// nodes. Worker thread i is always bound to the same cores, so memory that it allocates
+// and touches first stays local to its node on systems with a first-touch policy.
+//
 
 class DLLSYMBOL JobManager
   : public NonCopyable
@@ -59,7 +64,9 @@ class DLLSYMBOL JobManager
     enum Flags
     {
         KeepRunningOnEmptyQueue = 1 << 0,   // the worker thread keeps running even if the job queue is empty
-        KeepRunningOnJobFailure = 1 << 1    // the worker thread keeps executing jobs from the work queue even if one or more jobs failed
+        KeepRunningOnJobFailure = 1 << 1,   // the worker thread keeps executing jobs from the work queue even if one or more jobs failed
+        PinThreadsToCpuCores    = 1 << 2,   // each worker thread is bound to one logical CPU core
+        PinThreadsToNumaNodes   = 1 << 3    // each worker thread is bound to the CPU cores of one NUMA node
     };
 
     // Constructor.
@@ -81,6 +88,9 @@ class DLLSYMBOL JobManager
     // Stop job execution. Returns once currently running jobs are completed.
     void stop();
 
+    // Return true if the calling thread is a worker thread of any job manager.
+    static bool is_worker_thread();
+
   private:
     struct Impl;
     Impl* impl;
@@ -34,14 +34,19 @@
 #include "foundation/platform/thread.h"
 #include "foundation/utility/job/abortswitch.h"
 #include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/workstealingdeque.h"
 #include "foundation/utility/foreach.h"
-#include "foundation/utility/iterators.h"
+#include "foundation/utility/poolallocator.h"
 
 // boost headers.
+#include "boost/cstdint.hpp"
 #include "boost/thread/condition_variable.hpp"
+#include "boost/thread/tss.hpp"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
+#include <list>
 
 using namespace std;
 
@@ -52,12 +57,189 @@ namespace foundation
 // JobQueue class implementation.
 //
 
+namespace
+{
+    // Maximum number of worker threads that get their own deque.
+    const size_t MaxWorkerSlotCount = 256;
+
+    // Capacity of a worker's deque. Must be a power of two.
+    const size_t DequeCapacity = 1024;
+
+    // Maximum number of jobs a worker moves from the shared list to its deque at once.
+    const size_t MaxBatchSize = 64;
+}
+
 struct JobQueue::Impl
 {
+    typedef list<JobInfo, PoolAllocator<JobInfo, 64> > JobList;
+
+    struct WorkerSlot
+    {
+        typedef WorkStealingDeque<JobInfo, DequeCapacity> Deque;
+
+        const size_t                m_index;
+        bool                        m_in_use;           // protected by m_mutex
+        Deque                       m_deque;
+
+        explicit WorkerSlot(const size_t index)
+          : m_index(index)
+          , m_in_use(false)
+        {
+        }
+    };
+
     mutable boost::mutex            m_mutex;
-    boost::condition_variable_any   m_event;
-    JobList                         m_scheduled_jobs;
-    JobList                         m_running_jobs;
+    boost::condition_variable_any   m_job_available;    // workers wait on this one
+    boost::condition_variable_any   m_queue_drained;    // wait_until_completion() waits on this one
+    JobList                         m_shared_jobs;      // protected by m_mutex
+
+    // Job counters. Jobs are counted as scheduled before they become visible to
+    // workers, and as pending (scheduled or running) until they are retired.
+    volatile boost::uint32_t        m_shared_job_count;
+    volatile boost::uint32_t        m_scheduled_job_count;
+    volatile boost::uint32_t        m_pending_job_count;
+    volatile boost::uint32_t        m_sleeping_worker_count;
+
+    // Worker slots are never deleted before the queue, so that thieves can safely
+    // access the deques of workers that have stopped.
+    WorkerSlot* volatile            m_slots[MaxWorkerSlotCount];
+    volatile boost::uint32_t        m_slot_count;
+
+    // Worker slot of the calling thread, if it is a worker thread of this queue.
+    boost::thread_specific_ptr<WorkerSlot> m_current_slot;
+
+    Impl()
+      : m_shared_job_count(0)
+      , m_scheduled_job_count(0)
+      , m_pending_job_count(0)
+      , m_sleeping_worker_count(0)
+      , m_slot_count(0)
+      , m_current_slot(&no_cleanup)
+    {
+    }
+
+    ~Impl()
+    {
+        for (size_t i = 0; i < m_slot_count; ++i)
+            delete m_slots[i];
+    }
+
+    // Worker threads don't own their slot, the queue does.
+    static void no_cleanup(WorkerSlot*)
+    {
+    }
+
+    size_t get_slot_count()
+    {
+        return boost_atomic::atomic_read32(&m_slot_count);
+    }
+
+    WorkerSlot* get_slot(const size_t slot_index)
+    {
+        return slot_index < get_slot_count() ? m_slots[slot_index] : 0;
+    }
+
+    // Remove all scheduled jobs from the queue and append them to a list.
+    void take_scheduled_jobs(JobList& jobs)
+    {
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            jobs.splice(jobs.end(), m_shared_jobs);
+            boost_atomic::atomic_write32(&m_shared_job_count, 0);
+        }
+
+        const size_t slot_count = get_slot_count();
+
+        for (size_t i = 0; i < slot_count; ++i)
+        {
+            WorkerSlot::Deque& deque = m_slots[i]->m_deque;
+            JobInfo job_info;
+
+            while (deque.size() > 0)
+            {
+                if (deque.steal(job_info))
+                    jobs.push_back(job_info);
+            }
+        }
+    }
+
+    // Wake up one sleeping worker, if any, after a job was scheduled.
+    void wake_worker()
+    {
+        if (boost_atomic::atomic_read32(&m_sleeping_worker_count) > 0)
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            m_job_available.notify_one();
+        }
+    }
+
+    // Take a job from the shared list. Workers also move a share of the remaining
+    // jobs to their own deque, where other workers can steal them without locking.
+    bool acquire_shared_job(WorkerSlot* slot, JobInfo& job_info)
+    {
+        if (boost_atomic::atomic_read32(&m_shared_job_count) == 0)
+            return false;
+
+        boost::mutex::scoped_lock lock(m_mutex);
+
+        if (m_shared_jobs.empty())
+            return false;
+
+        job_info = m_shared_jobs.front();
+        m_shared_jobs.pop_front();
+        boost_atomic::atomic_dec32(&m_shared_job_count);
+
+        if (slot)
+        {
+            const size_t remaining = boost_atomic::atomic_read32(&m_shared_job_count);
+            const size_t batch_size =
+                min(
+                    min(remaining / max<size_t>(get_slot_count(), 1), MaxBatchSize),
+                    DequeCapacity - slot->m_deque.size());
+
+            // Push the jobs in reverse order so that the owner pops them in scheduling order.
+            JobList::iterator end = m_shared_jobs.begin();
+            advance(end, batch_size);
+
+            for (JobList::iterator i = end; i != m_shared_jobs.begin(); )
+            {
+                const bool pushed = slot->m_deque.push(*--i);
+                assert(pushed);
+                boost_atomic::atomic_dec32(&m_shared_job_count);
+            }
+
+            m_shared_jobs.erase(m_shared_jobs.begin(), end);
+        }
+
+        return true;
+    }
+
+    // Steal a job from the deque of another worker, starting with the next one.
+    bool steal_job(const size_t slot_index, JobInfo& job_info)
+    {
+        const size_t slot_count = get_slot_count();
+        const size_t first = slot_index < slot_count ? slot_index + 1 : 0;
+
+        for (size_t i = 0; i < slot_count; ++i)
+        {
+            const size_t victim = (first + i) % slot_count;
+
+            if (victim != slot_index && m_slots[victim]->m_deque.steal(job_info))
+                return true;
+        }
+
+        return false;
+    }
+
+    // Account for a job that left the queue, either retired or cleared.
+    void release_pending_job()
+    {
+        if (boost_atomic::atomic_dec32(&m_pending_job_count) == 1)
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            m_queue_drained.notify_all();
+        }
+    }
 
     static void delete_jobs(JobList& list)
     {
@@ -81,76 +263,90 @@ JobQueue::~JobQueue()
     // We assume that worker threads are not running, so we don't lock.
 
     // At this point, no job must be running.
-    assert(impl->m_running_jobs.empty());
+    assert(get_running_job_count() == 0);
 
     // Delete all scheduled jobs that the queue owns.
-    Impl::delete_jobs(impl->m_scheduled_jobs);
+    Impl::JobList jobs;
+    impl->take_scheduled_jobs(jobs);
+    Impl::delete_jobs(jobs);
 
     delete impl;
 }
 
 void JobQueue::clear_scheduled_jobs()
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
+    Impl::JobList jobs;
+    impl->take_scheduled_jobs(jobs);
+
+    const size_t job_count = jobs.size();
 
-    impl->delete_jobs(impl->m_scheduled_jobs);
+    Impl::delete_jobs(jobs);
+
+    for (size_t i = 0; i < job_count; ++i)
+    {
+        boost_atomic::atomic_dec32(&impl->m_scheduled_job_count);
+        impl->release_pending_job();
+    }
 
-    // Notify worker threads that all scheduled jobs are gone.
-    impl->m_event.notify_all();
+    // Notify waiting threads that all scheduled jobs are gone.
+    boost::mutex::scoped_lock lock(impl->m_mutex);
+    impl->m_queue_drained.notify_all();
 }
 
 bool JobQueue::has_scheduled_jobs() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return !impl->m_scheduled_jobs.empty();
+    return get_scheduled_job_count() > 0;
 }
 
 bool JobQueue::has_running_jobs() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return !impl->m_running_jobs.empty();
+    return get_running_job_count() > 0;
 }
 
 bool JobQueue::has_scheduled_or_running_jobs() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return !impl->m_scheduled_jobs.empty() || !impl->m_running_jobs.empty();
+    return get_total_job_count() > 0;
 }
 
 size_t JobQueue::get_scheduled_job_count() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return impl->m_scheduled_jobs.size();
+    return boost_atomic::atomic_read32(&impl->m_scheduled_job_count);
 }
 
 size_t JobQueue::get_running_job_count() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
+    const size_t pending = get_total_job_count();
+    const size_t scheduled = get_scheduled_job_count();
 
-    return impl->m_running_jobs.size();
+    return pending > scheduled ? pending - scheduled : 0;
 }
 
 size_t JobQueue::get_total_job_count() const
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
-
-    return impl->m_scheduled_jobs.size() + impl->m_running_jobs.size();
+    return boost_atomic::atomic_read32(&impl->m_pending_job_count);
 }
 
 void JobQueue::schedule(IJob* job, const bool transfer_ownership)
 {
     assert(job);
 
-    boost::mutex::scoped_lock lock(impl->m_mutex);
+    const JobInfo job_info(job, transfer_ownership);
 
-    impl->m_scheduled_jobs.push_back(JobInfo(job, transfer_ownership));
+    boost_atomic::atomic_inc32(&impl->m_pending_job_count);
+    boost_atomic::atomic_inc32(&impl->m_scheduled_job_count);
 
-    // Notify worker threads that a new scheduled job is available.
-    impl->m_event.notify_all();
+    // Worker threads of this queue push the job onto their own deque.
+    Impl::WorkerSlot* slot = impl->m_current_slot.get();
+
+    if (slot == 0 || !slot->m_deque.push(job_info))
+    {
+        boost::mutex::scoped_lock lock(impl->m_mutex);
+        impl->m_shared_jobs.push_back(job_info);
+        boost_atomic::atomic_inc32(&impl->m_shared_job_count);
+    }
+
+    // Notify a sleeping worker thread that a new scheduled job is available.
+    impl->wake_worker();
 }
 
 void JobQueue::wait_until_completion()
@@ -158,65 +354,111 @@ void JobQueue::wait_until_completion()
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
     // Wait until there is no more scheduled or running jobs.
-    while (!impl->m_scheduled_jobs.empty() || !impl->m_running_jobs.empty())
-        impl->m_event.wait(lock);
+    while (boost_atomic::atomic_read32(&impl->m_pending_job_count) > 0)
+        impl->m_queue_drained.wait(lock);
 }
 
-JobQueue::RunningJobInfo JobQueue::acquire_scheduled_job()
+size_t JobQueue::acquire_worker_slot()
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
-    return acquire_scheduled_job_unlocked();
+    Impl::WorkerSlot* slot = 0;
+
+    // Reuse the slot of a worker that has stopped.
+    for (size_t i = 0; i < impl->m_slot_count && slot == 0; ++i)
+    {
+        if (!impl->m_slots[i]->m_in_use)
+            slot = impl->m_slots[i];
+    }
+
+    if (slot == 0)
+    {
+        if (impl->m_slot_count == MaxWorkerSlotCount)
+            return ~size_t(0);
+
+        slot = new Impl::WorkerSlot(impl->m_slot_count);
+        impl->m_slots[impl->m_slot_count] = slot;
+
+        // Publish the slot to thieves.
+        boost_atomic::atomic_inc32(&impl->m_slot_count);
+    }
+
+    slot->m_in_use = true;
+    impl->m_current_slot.reset(slot);
+
+    return slot->m_index;
 }
 
-JobQueue::RunningJobInfo JobQueue::wait_for_scheduled_job(AbortSwitch& abort_switch)
+void JobQueue::release_worker_slot(const size_t slot_index)
 {
+    if (slot_index == ~size_t(0))
+        return;
+
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
-    // Wait for a scheduled job to be available.
-    while (!abort_switch.is_aborted() && impl->m_scheduled_jobs.empty())    // order matters
-        impl->m_event.wait(lock);
+    assert(impl->m_current_slot.get() == impl->m_slots[slot_index]);
 
-    return acquire_scheduled_job_unlocked();
+    impl->m_slots[slot_index]->m_in_use = false;
+    impl->m_current_slot.reset(0);
 }
 
-JobQueue::RunningJobInfo JobQueue::acquire_scheduled_job_unlocked()
+JobQueue::RunningJobInfo JobQueue::acquire_scheduled_job(const size_t slot_index)
 {
-    // Bail out if there is no scheduled job.
-    if (impl->m_scheduled_jobs.empty())
-        return RunningJobInfo(JobInfo(0, false), impl->m_running_jobs.end());
-
-    // Move the next scheduled job to the end of the queue of running jobs.
-    const JobInfo job_info = impl->m_scheduled_jobs.front();
-    impl->m_scheduled_jobs.pop_front();
-    impl->m_running_jobs.push_back(job_info);
+    Impl::WorkerSlot* slot = impl->get_slot(slot_index);
+    JobInfo job_info;
 
-    // Notify worker threads that a job has moved from the scheduled to the running state.
-    impl->m_event.notify_all();
+    // Look in our own deque first, then in the shared list, then in other deques.
+    if ((slot && slot->m_deque.pop(job_info)) ||
+        impl->acquire_shared_job(slot, job_info) ||
+        impl->steal_job(slot_index, job_info))
+    {
+        // Change the job's state from 'scheduled' to 'running'.
+        boost_atomic::atomic_dec32(&impl->m_scheduled_job_count);
+        return job_info;
+    }
 
-    return RunningJobInfo(job_info, pred(impl->m_running_jobs.end()));
+    return RunningJobInfo();
 }
 
-void JobQueue::retire_running_job(const RunningJobInfo& running_job_info)
+JobQueue::RunningJobInfo JobQueue::wait_for_scheduled_job(
+    AbortSwitch&    abort_switch,
+    const size_t    slot_index)
 {
-    boost::mutex::scoped_lock lock(impl->m_mutex);
+    while (true)
+    {
+        const RunningJobInfo running_job_info = acquire_scheduled_job(slot_index);
 
-    // Remove the job from the running list.
-    impl->m_running_jobs.erase(running_job_info.second);
+        if (running_job_info.m_job || abort_switch.is_aborted())
+            return running_job_info;
 
+        boost::mutex::scoped_lock lock(impl->m_mutex);
+
+        // Wait for a scheduled job to be available. Scheduling threads read the number
+        // of sleeping workers after incrementing the number of scheduled jobs, so one of
+        // us is guaranteed to see the other's update.
+        boost_atomic::atomic_inc32(&impl->m_sleeping_worker_count);
+        while (!abort_switch.is_aborted() &&
+               boost_atomic::atomic_read32(&impl->m_scheduled_job_count) == 0)  // order matters
+            impl->m_job_available.wait(lock);
+        boost_atomic::atomic_dec32(&impl->m_sleeping_worker_count);
+    }
+}
+
+void JobQueue::retire_running_job(const RunningJobInfo& running_job_info)
+{
     // Delete the job.
-    if (running_job_info.first.m_owned)
-        delete running_job_info.first.m_job;
+    if (running_job_info.m_owned)
+        delete running_job_info.m_job;
 
-    // Notify worker threads that a scheduled job was retired.
-    impl->m_event.notify_all();
+    // Notify waiting threads if this was the last job.
+    impl->release_pending_job();
 }
 
 void JobQueue::signal_event()
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
-    impl->m_event.notify_all();
+    impl->m_job_available.notify_all();
 }
 
 }   // namespace foundation
@@ -32,7 +32,6 @@
 
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
-#include "foundation/utility/poolallocator.h"
 #include "foundation/utility/test.h"
 
 // appleseed.main headers.
@@ -40,7 +39,6 @@
 
 // Standard headers.
 #include <cstddef>
-#include <list>
 
 // Forward declarations.
 namespace foundation    { class AbortSwitch; }
@@ -66,6 +64,13 @@ namespace foundation
 //   - scheduled: the job was inserted into the job queue, but hasn't yet been executed
 //   - running: the job is currently being executed
 //
+// Scheduled jobs are stored either in a shared list, or in one of the per-worker
+// work-stealing deques. Jobs scheduled by a worker thread of this queue (typically,
+// child jobs spawned by a running job) go to the worker's own deque without locking;
+// they are executed by that worker in LIFO order, or stolen by idle workers in FIFO
+// order. Jobs scheduled from any other thread go to the shared list and are
+// executed in FIFO order.
+//
 
 class DLLSYMBOL JobQueue
   : public NonCopyable
@@ -120,7 +125,13 @@ class DLLSYMBOL JobQueue
     struct JobInfo
     {
         IJob*       m_job;
-        const bool  m_owned;
+        bool        m_owned;
+
+        JobInfo()
+          : m_job(0)
+          , m_owned(false)
+        {
+        }
 
         JobInfo(IJob* job, const bool owned)
           : m_job(job)
@@ -129,18 +140,22 @@ class DLLSYMBOL JobQueue
         }
     };
 
-    typedef std::list<JobInfo, PoolAllocator<JobInfo, 64> > JobList;
+    typedef JobInfo RunningJobInfo;
+
+    // Attach the calling thread to the queue and give it its own work-stealing deque.
+    // Return the index of the worker slot, or ~0 if all slots are taken.
+    size_t acquire_worker_slot();
 
-    typedef std::pair<JobInfo, JobList::iterator> RunningJobInfo;
+    // Detach the calling thread from the queue. Jobs left in its deque remain stealable.
+    void release_worker_slot(const size_t slot_index);
 
     // Acquire a scheduled job and change its state from 'scheduled' to 'running'.
-    RunningJobInfo acquire_scheduled_job();
+    RunningJobInfo acquire_scheduled_job(const size_t slot_index = ~size_t(0));
 
     // Wait for a scheduled job to be available.
-    RunningJobInfo wait_for_scheduled_job(AbortSwitch& abort_switch);
-
-    // Acquire a scheduled job without any locking.
-    RunningJobInfo acquire_scheduled_job_unlocked();
+    RunningJobInfo wait_for_scheduled_job(
+        AbortSwitch&    abort_switch,
+        const size_t    slot_index = ~size_t(0));
 
     // Retire a running job. The job is deleted if it is owned by the queue.
     void retire_running_job(const RunningJobInfo& running_job_info);
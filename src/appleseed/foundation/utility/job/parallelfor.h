@@ -0,0 +1,195 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_UTILITY_JOB_PARALLELFOR_H
+#define APPLESEED_FOUNDATION_UTILITY_JOB_PARALLELFOR_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/thread.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobqueue.h"
+
+// boost headers.
+#include "boost/thread/condition_variable.hpp"
+
+// Standard headers.
+#include <cstddef>
+
+namespace foundation
+{
+
+//
+// Execute a loop body over the range [begin, end) using the worker threads of a job queue.
+//
+// The body is invoked as body(range_begin, range_end, thread_index) on disjoint subranges
+// covering [begin, end), concurrently from several threads. The range is recursively
+// split in halves until subranges contain at most grain_size iterations; the halves are
+// scheduled as child jobs, so that idle workers steal the largest remaining ranges.
+//
+// The function returns once the whole range was processed. The calling thread does not
+// execute jobs while it waits, so it must not be a worker thread of the same job queue.
+//
+
+template <typename Body>
+void parallel_for(
+    JobQueue&       job_queue,
+    const size_t    begin,
+    const size_t    end,
+    const size_t    grain_size,
+    Body&           body);
+
+
+//
+// parallel_for() implementation.
+//
+
+namespace parallel_for_impl
+{
+    // Tracks the jobs of one parallel_for() call.
+    class Completion
+      : public NonCopyable
+    {
+      public:
+        Completion()
+          : m_pending_job_count(0)
+        {
+        }
+
+        void add_job()
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            ++m_pending_job_count;
+        }
+
+        void release_job()
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            if (--m_pending_job_count == 0)
+                m_done.notify_all();
+        }
+
+        void wait()
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            while (m_pending_job_count > 0)
+                m_done.wait(lock);
+        }
+
+      private:
+        boost::mutex                m_mutex;
+        boost::condition_variable   m_done;
+        size_t                      m_pending_job_count;
+    };
+
+    template <typename Body>
+    class RangeJob
+      : public IJob
+    {
+      public:
+        RangeJob(
+            JobQueue&       job_queue,
+            Completion&     completion,
+            Body&           body,
+            const size_t    begin,
+            const size_t    end,
+            const size_t    grain_size)
+          : m_job_queue(job_queue)
+          , m_completion(completion)
+          , m_body(body)
+          , m_begin(begin)
+          , m_end(end)
+          , m_grain_size(grain_size)
+        {
+            m_completion.add_job();
+        }
+
+        // Jobs are deleted once executed, or when the job queue is cleared:
+        // either way they must no longer be waited for.
+        ~RangeJob()
+        {
+            m_completion.release_job();
+        }
+
+        virtual void execute(const size_t thread_index)
+        {
+            size_t end = m_end;
+
+            // Hand the upper half of the range to other workers until the rest is small enough.
+            while (end - m_begin > m_grain_size)
+            {
+                const size_t middle = m_begin + (end - m_begin) / 2;
+
+                m_job_queue.schedule(
+                    new RangeJob(m_job_queue, m_completion, m_body, middle, end, m_grain_size));
+
+                end = middle;
+            }
+
+            m_body(m_begin, end, thread_index);
+        }
+
+      private:
+        JobQueue&           m_job_queue;
+        Completion&         m_completion;
+        Body&               m_body;
+        const size_t        m_begin;
+        const size_t        m_end;
+        const size_t        m_grain_size;
+    };
+}
+
+template <typename Body>
+void parallel_for(
+    JobQueue&       job_queue,
+    const size_t    begin,
+    const size_t    end,
+    const size_t    grain_size,
+    Body&           body)
+{
+    if (begin >= end)
+        return;
+
+    parallel_for_impl::Completion completion;
+
+    job_queue.schedule(
+        new parallel_for_impl::RangeJob<Body>(
+            job_queue,
+            completion,
+            body,
+            begin,
+            end,
+            grain_size > 0 ? grain_size : 1));
+
+    completion.wait();
+}
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_UTILITY_JOB_PARALLELFOR_H
@@ -38,6 +38,9 @@
 #include "foundation/utility/job/jobqueue.h"
 #include "foundation/utility/log.h"
 
+// boost headers.
+#include "boost/thread/tss.hpp"
+
 // Standard headers.
 #include <exception>
 
@@ -51,6 +54,16 @@ namespace foundation
 // WorkerThread class implementation.
 //
 
+namespace
+{
+    void no_cleanup(WorkerThread*)
+    {
+    }
+
+    // Worker thread running on the calling thread, if any.
+    thread_specific_ptr<WorkerThread> g_current_worker_thread(&no_cleanup);
+}
+
 WorkerThread::WorkerThread(
     const size_t    index,
     Logger&         logger,
@@ -70,6 +83,11 @@ WorkerThread::~WorkerThread()
     stop();
 }
 
+void WorkerThread::set_cpu_affinity(const vector<size_t>& cpu_cores)
+{
+    m_cpu_cores = cpu_cores;
+}
+
 void WorkerThread::start()
 {
     // Don't do anything if the worker thread is already running.
@@ -98,16 +116,35 @@ void WorkerThread::stop()
     m_thread = 0;
 }
 
+bool WorkerThread::is_current_thread()
+{
+    return g_current_worker_thread.get() != 0;
+}
+
 void WorkerThread::run()
 {
+    g_current_worker_thread.reset(this);
+
+    // Bind the thread before it allocates anything, so that its memory is local to its cores.
+    if (!m_cpu_cores.empty() && !set_current_thread_cpu_affinity(m_cpu_cores))
+    {
+        LOG_WARNING(
+            m_logger,
+            "worker thread " FMT_SIZE_T ": failed to set cpu affinity.",
+            m_index);
+    }
+
+    // Get our own deque in the job queue.
+    const size_t slot_index = m_job_queue.acquire_worker_slot();
+
     while (!m_abort_switch.is_aborted())
     {
         // Acquire a job.
         const JobQueue::RunningJobInfo running_job_info =
-            m_job_queue.wait_for_scheduled_job(m_abort_switch);
+            m_job_queue.wait_for_scheduled_job(m_abort_switch, slot_index);
 
         // Handle the case where the job queue is empty.
-        if (running_job_info.first.m_job == 0)
+        if (running_job_info.m_job == 0)
         {
             if (m_flags & JobManager::KeepRunningOnEmptyQueue)
             {
@@ -122,7 +159,7 @@ void WorkerThread::run()
         }
 
         // Execute the job.
-        const bool success = execute_job(*running_job_info.first.m_job);
+        const bool success = execute_job(*running_job_info.m_job);
 
         // Retire the job.
         m_job_queue.retire_running_job(running_job_info);
@@ -134,6 +171,10 @@ void WorkerThread::run()
             break;
         }
     }
+
+    m_job_queue.release_worker_slot(slot_index);
+
+    g_current_worker_thread.reset();
 }
 
 bool WorkerThread::execute_job(IJob& job)
@@ -36,6 +36,7 @@
 
 // Standard headers.
 #include <cstddef>
+#include <vector>
 
 // Forward declarations.
 namespace boost         { class thread; }
@@ -64,12 +65,18 @@ class WorkerThread
     // Destructor.
     ~WorkerThread();
 
+    // Bind the worker thread to a set of logical CPU cores. Takes effect at the next start().
+    void set_cpu_affinity(const std::vector<size_t>& cpu_cores);
+
     // Start the worker thread.
     void start();
 
     // Stop the worker thread.
     void stop();
 
+    // Return true if the calling thread is a worker thread.
+    static bool is_current_thread();
+
   private:
     // A helper class that encapsulates the run() method of the worker thread
     // into an object that can be passed to the constructor of boost::thread.
@@ -92,6 +99,7 @@ class WorkerThread
     Logger&             m_logger;
     JobQueue&           m_job_queue;
     const int           m_flags;
+    std::vector<size_t> m_cpu_cores;
 
     AbortSwitch         m_abort_switch;
     ThreadFunc          m_thread_func;
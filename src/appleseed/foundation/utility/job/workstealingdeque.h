@@ -0,0 +1,180 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_UTILITY_JOB_WORKSTEALINGDEQUE_H
+#define APPLESEED_FOUNDATION_UTILITY_JOB_WORKSTEALINGDEQUE_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/thread.h"
+
+// boost headers.
+#include "boost/cstdint.hpp"
+#include "boost/static_assert.hpp"
+
+// Standard headers.
+#include <cstddef>
+
+namespace foundation
+{
+
+//
+// A bounded, lock-free work-stealing deque.
+//
+// The owner thread pushes and pops items at the bottom of the deque (LIFO) while
+// any other thread may steal items from the top (FIFO). push() and pop() must only
+// be called from the owner thread; steal() and size() are safe from any thread.
+//
+// This is the Chase-Lev algorithm over a fixed-size circular array. push() fails
+// when the deque is full; callers are expected to fall back to a shared queue.
+//
+// Reference:
+//
+//   Dynamic Circular Work-Stealing Deque
+//   http://citeseerx.ist.psu.edu/viewdoc/summary?doi=10.1.1.170.1097
+//
+
+template <typename T, size_t Capacity>
+class WorkStealingDeque
+  : public NonCopyable
+{
+  public:
+    BOOST_STATIC_ASSERT((Capacity & (Capacity - 1)) == 0);
+
+    // Constructor.
+    WorkStealingDeque();
+
+    // Return the number of items in the deque. Only a hint when other threads access the deque.
+    size_t size() const;
+
+    // Push an item at the bottom of the deque. Return false if the deque is full. Owner only.
+    bool push(const T& item);
+
+    // Pop an item from the bottom of the deque. Return false if the deque is empty. Owner only.
+    bool pop(T& item);
+
+    // Steal an item from the top of the deque. Return false if the deque is empty
+    // or if another thread took the item first.
+    bool steal(T& item);
+
+  private:
+    mutable volatile boost::uint32_t    m_top;
+    mutable volatile boost::uint32_t    m_bottom;
+    T                                   m_items[Capacity];
+};
+
+
+//
+// WorkStealingDeque class implementation.
+//
+// Indices grow monotonically and wrap around; distances between them are computed
+// as signed 32-bit integers. On the platforms we support, boost_atomic::atomic_write32()
+// and atomic_cas32() are full memory barriers, which the algorithm relies upon.
+//
+
+template <typename T, size_t Capacity>
+inline WorkStealingDeque<T, Capacity>::WorkStealingDeque()
+  : m_top(0)
+  , m_bottom(0)
+{
+}
+
+template <typename T, size_t Capacity>
+inline size_t WorkStealingDeque<T, Capacity>::size() const
+{
+    const boost::uint32_t t = boost_atomic::atomic_read32(&m_top);
+    const boost::uint32_t b = boost_atomic::atomic_read32(&m_bottom);
+    const boost::int32_t n = static_cast<boost::int32_t>(b - t);
+
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+template <typename T, size_t Capacity>
+inline bool WorkStealingDeque<T, Capacity>::push(const T& item)
+{
+    const boost::uint32_t b = m_bottom;
+    const boost::uint32_t t = boost_atomic::atomic_read32(&m_top);
+
+    if (static_cast<boost::int32_t>(b - t) >= static_cast<boost::int32_t>(Capacity))
+        return false;
+
+    m_items[b & (Capacity - 1)] = item;
+
+    // Publish the item.
+    boost_atomic::atomic_write32(&m_bottom, b + 1);
+
+    return true;
+}
+
+template <typename T, size_t Capacity>
+inline bool WorkStealingDeque<T, Capacity>::pop(T& item)
+{
+    const boost::uint32_t b = m_bottom - 1;
+
+    // Reserve the bottom item before looking at the top index.
+    boost_atomic::atomic_write32(&m_bottom, b);
+
+    const boost::uint32_t t = boost_atomic::atomic_read32(&m_top);
+
+    if (static_cast<boost::int32_t>(b - t) < 0)
+    {
+        // The deque was empty.
+        boost_atomic::atomic_write32(&m_bottom, t);
+        return false;
+    }
+
+    item = m_items[b & (Capacity - 1)];
+
+    if (b != t)
+        return true;
+
+    // This was the last item: race against thieves for it.
+    const bool won = boost_atomic::atomic_cas32(&m_top, t + 1, t) == t;
+    boost_atomic::atomic_write32(&m_bottom, t + 1);
+
+    return won;
+}
+
+template <typename T, size_t Capacity>
+inline bool WorkStealingDeque<T, Capacity>::steal(T& item)
+{
+    const boost::uint32_t t = boost_atomic::atomic_read32(&m_top);
+    const boost::uint32_t b = boost_atomic::atomic_read32(&m_bottom);
+
+    if (static_cast<boost::int32_t>(b - t) <= 0)
+        return false;
+
+    item = m_items[t & (Capacity - 1)];
+
+    return boost_atomic::atomic_cas32(&m_top, t + 1, t) == t;
+}
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_UTILITY_JOB_WORKSTEALINGDEQUE_H
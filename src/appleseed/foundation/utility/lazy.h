@@ -93,12 +93,19 @@ class Lazy
     // it is owned by the lazy object.
     ~Lazy();
 
+    // Garbage-collect the object: delete it if nobody is accessing it and
+    // the factory can create it again. An object that was accessed since
+    // the last call is spared this time (second chance). Never blocks.
+    // Return true if the object was deleted.
+    bool collect();
+
   private:
     template <typename> friend class Access;
     template <typename> friend class Update;
 
     boost::mutex    m_mutex;
     int             m_reference_count;
+    bool            m_accessed;
 
     FactoryType*    m_factory;
     ObjectType*     m_object;
@@ -379,6 +386,7 @@ class AccessCacheMap
 template <typename Object>
 Lazy<Object>::Lazy(std::auto_ptr<FactoryType> factory)
   : m_reference_count(0)
+  , m_accessed(false)
   , m_factory(factory.release())
   , m_object(0)
   , m_own_object(true)
@@ -389,6 +397,7 @@ Lazy<Object>::Lazy(std::auto_ptr<FactoryType> factory)
 template <typename Object>
 Lazy<Object>::Lazy(ObjectType* object)
   : m_reference_count(0)
+  , m_accessed(false)
   , m_factory(0)
   , m_object(object)
   , m_own_object(false)
@@ -409,6 +418,29 @@ Lazy<Object>::~Lazy()
     m_object = 0;
 }
 
+template <typename Object>
+bool Lazy<Object>::collect()
+{
+    boost::mutex::scoped_try_lock lock(m_mutex);
+
+    if (!lock.owns_lock())
+        return false;
+
+    if (m_object == 0 || m_factory == 0 || m_reference_count > 0)
+        return false;
+
+    if (m_accessed)
+    {
+        m_accessed = false;
+        return false;
+    }
+
+    delete m_object;
+    m_object = 0;
+
+    return true;
+}
+
 
 //
 // Access class implementation.
@@ -459,6 +491,7 @@ void Access<Object>::reset(LazyType* lazy)
     {
         boost::mutex::scoped_lock lock(m_lazy->m_mutex);
         ++m_lazy->m_reference_count;
+        m_lazy->m_accessed = true;
 
         // Create the object if it doesn't exist yet.
         if (m_lazy->m_object == 0)
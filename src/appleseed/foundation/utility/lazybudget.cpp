@@ -0,0 +1,145 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "lazybudget.h"
+
+// Standard headers.
+#include <algorithm>
+
+using namespace std;
+
+namespace foundation
+{
+
+//
+// LazyBudget class implementation.
+//
+
+LazyBudget::LazyBudget(const size_t max_size)
+  : m_max_size(max_size)
+  , m_size(0)
+  , m_collected_count(0)
+  , m_clock_hand(0)
+{
+}
+
+LazyBudget::~LazyBudget()
+{
+    assert(m_entries.empty());
+    assert(m_size == 0);
+}
+
+void LazyBudget::set_max_size(const size_t max_size)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_max_size = max_size;
+    collect_objects(0);
+}
+
+size_t LazyBudget::get_max_size() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_max_size;
+}
+
+size_t LazyBudget::get_size() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_size;
+}
+
+size_t LazyBudget::get_collected_count() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_collected_count;
+}
+
+void LazyBudget::insert(EntryBase* entry)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_entries.push_back(entry);
+}
+
+void LazyBudget::remove(EntryBase* entry)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    const vector<EntryBase*>::iterator i =
+        find(m_entries.begin(), m_entries.end(), entry);
+    assert(i != m_entries.end());
+
+    // Keep the clock hand on the entry it was pointing to.
+    if (static_cast<size_t>(i - m_entries.begin()) < m_clock_hand)
+        --m_clock_hand;
+
+    m_entries.erase(i);
+
+    assert(m_size >= entry->m_size);
+    m_size -= entry->m_size;
+}
+
+void LazyBudget::add_object(EntryBase* entry, const size_t size)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    assert(entry->m_size == 0);
+    entry->m_size = size;
+    m_size += size;
+
+    // The entry's lazy object is locked by the caller, collect other objects only.
+    collect_objects(entry);
+}
+
+void LazyBudget::collect_objects(const EntryBase* skipped_entry)
+{
+    if (m_max_size == 0)
+        return;
+
+    const size_t entry_count = m_entries.size();
+
+    // Objects accessed since the previous sweep get a second chance.
+    for (size_t i = 0; i < 2 * entry_count && m_size > m_max_size; ++i)
+    {
+        if (m_clock_hand >= entry_count)
+            m_clock_hand = 0;
+
+        EntryBase* entry = m_entries[m_clock_hand++];
+
+        if (entry != skipped_entry && entry->m_size > 0 && entry->collect())
+        {
+            assert(m_size >= entry->m_size);
+            m_size -= entry->m_size;
+            entry->m_size = 0;
+            ++m_collected_count;
+        }
+    }
+}
+
+}   // namespace foundation
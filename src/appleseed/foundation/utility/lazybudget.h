@@ -0,0 +1,189 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_FOUNDATION_UTILITY_LAZYBUDGET_H
+#define APPLESEED_FOUNDATION_UTILITY_LAZYBUDGET_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/thread.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/lazy.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace foundation
+{
+
+//
+// A memory budget shared by a set of lazy objects.
+//
+// Lazy objects created through the budget report the memory size of their
+// object each time it is created. When the total size exceeds the budget,
+// objects are garbage-collected in approximate least recently accessed order
+// (clock algorithm) and will be created again when next accessed.
+//
+// Objects that are being accessed cannot be collected, so the budget may be
+// exceeded temporarily. Objects must provide a get_memory_size() method.
+//
+
+class LazyBudget
+  : public NonCopyable
+{
+  public:
+    // Constructor. A maximum size of 0 disables garbage collection.
+    explicit LazyBudget(const size_t max_size = 0);
+
+    // Destructor. All lazy objects must have been deleted.
+    ~LazyBudget();
+
+    // Set/get the maximum size (in bytes) of all objects.
+    void set_max_size(const size_t max_size);
+    size_t get_max_size() const;
+
+    // Return the size (in bytes) of all objects currently in memory.
+    size_t get_size() const;
+
+    // Return the number of objects garbage-collected so far.
+    size_t get_collected_count() const;
+
+    // Create a lazy object whose object counts against this budget.
+    template <typename Object>
+    Lazy<Object>* create_lazy(std::auto_ptr<ILazyFactory<Object> > factory);
+
+  private:
+    class EntryBase;
+
+    template <typename Object>
+    class Factory;
+
+    mutable boost::mutex    m_mutex;
+    size_t                  m_max_size;
+    size_t                  m_size;
+    size_t                  m_collected_count;
+    std::vector<EntryBase*> m_entries;
+    size_t                  m_clock_hand;
+
+    void insert(EntryBase* entry);
+    void remove(EntryBase* entry);
+
+    // Record the size of a newly created object and collect other objects if necessary.
+    void add_object(EntryBase* entry, const size_t size);
+
+    // Collect objects until the budget is met or all objects were tried twice.
+    void collect_objects(const EntryBase* skipped_entry);
+};
+
+
+//
+// LazyBudget class implementation.
+//
+
+class LazyBudget::EntryBase
+{
+  public:
+    size_t  m_size;
+
+    EntryBase()
+      : m_size(0)
+    {
+    }
+
+    virtual ~EntryBase() {}
+
+    virtual bool collect() = 0;
+};
+
+template <typename Object>
+class LazyBudget::Factory
+  : public ILazyFactory<Object>
+  , public LazyBudget::EntryBase
+{
+  public:
+    Factory(
+        LazyBudget&                             budget,
+        std::auto_ptr<ILazyFactory<Object> >    factory)
+      : m_budget(budget)
+      , m_factory(factory)
+      , m_lazy(0)
+    {
+    }
+
+    // Called by the lazy object's destructor.
+    ~Factory()
+    {
+        m_budget.remove(this);
+    }
+
+    void set_lazy(Lazy<Object>* lazy)
+    {
+        m_lazy = lazy;
+        m_budget.insert(this);
+    }
+
+    // Called with the lazy object locked.
+    virtual std::auto_ptr<Object> create()
+    {
+        std::auto_ptr<Object> object = m_factory->create();
+
+        if (object.get())
+            m_budget.add_object(this, object->get_memory_size());
+
+        return object;
+    }
+
+    // Called with the budget locked.
+    virtual bool collect()
+    {
+        assert(m_lazy);
+        return m_lazy->collect();
+    }
+
+  private:
+    LazyBudget&                                 m_budget;
+    std::auto_ptr<ILazyFactory<Object> >        m_factory;
+    Lazy<Object>*                               m_lazy;
+};
+
+template <typename Object>
+Lazy<Object>* LazyBudget::create_lazy(std::auto_ptr<ILazyFactory<Object> > factory)
+{
+    Factory<Object>* budget_factory = new Factory<Object>(*this, factory);
+    Lazy<Object>* lazy = new Lazy<Object>(std::auto_ptr<ILazyFactory<Object> >(budget_factory));
+    budget_factory->set_lazy(lazy);
+    return lazy;
+}
+
+}       // namespace foundation
+
+#endif  // !APPLESEED_FOUNDATION_UTILITY_LAZYBUDGET_H
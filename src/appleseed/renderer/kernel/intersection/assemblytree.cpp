@@ -44,14 +44,21 @@
 // appleseed.foundation headers.
 #include "foundation/math/intersection.h"
 #include "foundation/math/permutation.h"
+#include "foundation/platform/compiler.h"
 #include "foundation/platform/system.h"
 #include "foundation/platform/timer.h"
 #include "foundation/utility/statistics.h"
 #include "foundation/utility/string.h"
 
+// boost headers.
+#include "boost/type_traits/aligned_storage.hpp"
+#include "boost/type_traits/alignment_of.hpp"
+
 // Standard headers.
 #include <algorithm>
 #include <cstring>
+#include <limits>
+#include <memory>
 #include <utility>
 
 using namespace foundation;
@@ -90,10 +97,26 @@ AssemblyTree::~AssemblyTree()
     for (each<CurveTreeContainer> i = m_curve_trees; i; ++i)
         delete i->second;
     m_curve_trees.clear();
+
+    if (m_child_tree_budget.get_max_size() > 0)
+    {
+        RENDERER_LOG_INFO(
+            "%s %s deleted to stay within the child trees memory budget of %s.",
+            pretty_uint(m_child_tree_budget.get_collected_count()).c_str(),
+            plural(m_child_tree_budget.get_collected_count(), "child tree").c_str(),
+            pretty_size(m_child_tree_budget.get_max_size()).c_str());
+    }
 }
 
 void AssemblyTree::update()
 {
+    // Child trees are built on first access; those not in use are deleted when
+    // the total size of the trees exceeds the budget, and rebuilt when needed.
+    m_child_tree_budget.set_max_size(
+        m_scene.get_parameters().child("acceleration_structure").get_optional<size_t>(
+            "child_trees_memory_budget",
+            0));
+
     rebuild_assembly_tree();
     update_tree_hierarchy();
 }
@@ -132,6 +155,90 @@ void AssemblyTree::compute_cumulated_transforms(
     }
 }
 
+namespace
+{
+    struct TimeSegment
+    {
+        double  m_time_begin;
+        double  m_time_end;
+        AABB3d  m_bbox;
+
+        TimeSegment(
+            const double    time_begin,
+            const double    time_end,
+            const AABB3d&   bbox)
+          : m_time_begin(time_begin)
+          , m_time_end(time_end)
+          , m_bbox(bbox)
+        {
+        }
+    };
+
+    typedef vector<TimeSegment> TimeSegmentVector;
+
+    void split_time_interval(
+        const TransformSequence&    transform_seq,
+        const AABB3d&               local_bbox,
+        const double                time_begin,
+        const double                time_end,
+        const AABB3d&               bbox,
+        const size_t                depth,
+        TimeSegmentVector&          segments)
+    {
+        if (depth > 0 && bbox.is_valid())
+        {
+            const double time_middle = 0.5 * (time_begin + time_end);
+            const AABB3d bbox1 = transform_seq.to_parent(local_bbox, time_begin, time_middle);
+            const AABB3d bbox2 = transform_seq.to_parent(local_bbox, time_middle, time_end);
+
+            // A ray tests the bounding boxes of both halves but only intersects
+            // the assembly instance during the half that contains its time.
+            const double split_cost =
+                  (half_surface_area(bbox1) + half_surface_area(bbox2))
+                * (AssemblyTreeInteriorNodeTraversalCost + 0.5 * AssemblyTreeTriangleIntersectionCost);
+            const double cost =
+                  half_surface_area(bbox)
+                * (AssemblyTreeInteriorNodeTraversalCost + AssemblyTreeTriangleIntersectionCost);
+
+            if (split_cost < cost)
+            {
+                split_time_interval(transform_seq, local_bbox, time_begin, time_middle, bbox1, depth - 1, segments);
+                split_time_interval(transform_seq, local_bbox, time_middle, time_end, bbox2, depth - 1, segments);
+                return;
+            }
+        }
+
+        segments.push_back(TimeSegment(time_begin, time_end, bbox));
+    }
+
+    // Split the span of a transform sequence into time segments as long as the
+    // surface area heuristic predicts that this speeds up intersection.
+    void split_time_interval(
+        const TransformSequence&    transform_seq,
+        const AABB3d&               local_bbox,
+        const size_t                depth,
+        TimeSegmentVector&          segments)
+    {
+        double time_begin = 0.0, time_end = 0.0;
+
+        if (transform_seq.size() > 0)
+        {
+            Transformd transform;
+            transform_seq.get_transform(0, time_begin, transform);
+            transform_seq.get_transform(transform_seq.size() - 1, time_end, transform);
+        }
+
+        split_time_interval(
+            transform_seq,
+            local_bbox,
+            time_begin,
+            time_end,
+            transform_seq.to_parent(local_bbox),
+            depth,
+            segments);
+    }
+}
+
 void AssemblyTree::collect_assembly_instances(
     const AssemblyInstanceContainer&    assembly_instances,
     AABBVector&                         assembly_instance_bboxes)
@@ -153,19 +260,35 @@ void AssemblyTree::collect_assembly_instances(
         if (assembly.object_instances().empty())
             continue;
 
-        // Create and store an item for this assembly instance.
-        m_items.push_back(
-            Item(
-                &assembly,
-                &assembly_instance,
-                assembly_instance.cumulated_transform_sequence()));
+        // Split the shutter interval of moving assembly instances into time segments.
+        const TransformSequence& transform_seq = assembly_instance.cumulated_transform_sequence();
+        TimeSegmentVector segments;
+        split_time_interval(
+            transform_seq,
+            assembly.compute_non_hierarchical_local_bbox(),
+            transform_seq.size() > 1 ? AssemblyTreeMaxTimeSplitDepth : 0,
+            segments);
 
-        // Compute and store the assembly instance bounding box.
-        AABB3d assembly_instance_bbox(
-            assembly_instance.cumulated_transform_sequence().to_parent(
-                assembly.compute_non_hierarchical_local_bbox()));
-        assembly_instance_bbox.robust_grow(1.0e-15);
-        assembly_instance_bboxes.push_back(assembly_instance_bbox);
+        // Rays outside the span of the transform sequence see its first or last transform.
+        segments.front().m_time_begin = -numeric_limits<double>::max();
+        segments.back().m_time_end = numeric_limits<double>::max();
+
+        for (const_each<TimeSegmentVector> s = segments; s; ++s)
+        {
+            // Create and store an item for this time segment of the assembly instance.
+            m_items.push_back(
+                Item(
+                    &assembly,
+                    &assembly_instance,
+                    transform_seq,
+                    s->m_time_begin,
+                    s->m_time_end));
+
+            // Store the bounding box of the assembly instance during this time segment.
+            AABB3d segment_bbox(s->m_bbox);
+            segment_bbox.robust_grow(1.0e-15);
+            assembly_instance_bboxes.push_back(segment_bbox);
+        }
     }
 }
 
@@ -187,10 +310,20 @@ void AssemblyTree::rebuild_assembly_tree()
         m_scene.assembly_instances(),
         assembly_instance_bboxes);
 
+    // The first time segment of each assembly instance starts at -infinity.
+    size_t assembly_instance_count = 0;
+    for (const_each<ItemVector> i = m_items; i; ++i)
+    {
+        if (i->m_time_begin == -numeric_limits<double>::max())
+            ++assembly_instance_count;
+    }
+
     RENDERER_LOG_INFO(
-        "building assembly tree (%s %s)...",
+        "building assembly tree (%s %s, %s %s)...",
+        pretty_int(assembly_instance_count).c_str(),
+        plural(assembly_instance_count, "assembly instance").c_str(),
         pretty_int(m_items.size()).c_str(),
-        plural(m_items.size(), "assembly instance").c_str());
+        plural(m_items.size(), "time segment").c_str());
 
     // Create the partitioner.
     typedef bvh::SAHPartitioner<AABBVector> Partitioner;
@@ -292,7 +425,14 @@ void AssemblyTree::update_tree_hierarchy()
                 continue;
             }
 
-            // The child trees of this assembly are out-of-date: delete them.
+            // The child trees of this assembly are out-of-date: refit them if only vertices moved.
+            if (refit_child_trees(assembly))
+            {
+                m_assembly_versions[assembly.get_uid()] = current_version_id;
+                continue;
+            }
+
+            // Otherwise delete them.
             delete_child_trees(assembly);
         }
 
@@ -385,30 +525,63 @@ namespace
         return new Lazy<RegionTree>(region_tree_factory);
     }
 
-    Lazy<TriangleTree>* create_triangle_tree(const Scene& scene, const Assembly& assembly)
+    // Builds the triangle tree of an assembly from the current state of the assembly.
+    // A tree that was refitted after its vertices moved, then garbage-collected, must
+    // not be rebuilt with the bounding box and regions the original tree was built with.
+    class AssemblyTriangleTreeFactory
+      : public ILazyFactory<TriangleTree>
     {
-        // Compute the assembly space bounding box of the assembly.
-        const GAABB3 assembly_bbox =
-            compute_parent_bbox<GAABB3>(
-                assembly.object_instances().begin(),
-                assembly.object_instances().end());
+      public:
+        AssemblyTriangleTreeFactory(
+            const Scene&        scene,
+            const Assembly&     assembly)
+          : m_scene(scene)
+          , m_assembly(assembly)
+        {
+        }
+
+        virtual auto_ptr<TriangleTree> create() OVERRIDE
+        {
+            // Compute the assembly space bounding box of the assembly.
+            const GAABB3 assembly_bbox =
+                compute_parent_bbox<GAABB3>(
+                    m_assembly.object_instances().begin(),
+                    m_assembly.object_instances().end());
+
+            RegionInfoVector regions;
+            collect_regions(m_assembly, regions);
+
+            return
+                auto_ptr<TriangleTree>(
+                    new TriangleTree(
+                        TriangleTree::Arguments(
+                            m_scene,
+                            m_assembly.get_uid(),
+                            assembly_bbox,
+                            m_assembly,
+                            regions)));
+        }
 
-        RegionInfoVector regions;
-        collect_regions(assembly, regions);
+      private:
+        const Scene&            m_scene;
+        const Assembly&         m_assembly;
+    };
 
+    Lazy<TriangleTree>* create_triangle_tree(
+        const Scene&        scene,
+        const Assembly&     assembly,
+        LazyBudget&         budget)
+    {
         auto_ptr<ILazyFactory<TriangleTree> > triangle_tree_factory(
-            new TriangleTreeFactory(
-                TriangleTree::Arguments(
-                    scene,
-                    assembly.get_uid(),
-                    assembly_bbox,
-                    assembly,
-                    regions)));
+            new AssemblyTriangleTreeFactory(scene, assembly));
 
-        return new Lazy<TriangleTree>(triangle_tree_factory);
+        return budget.create_lazy(triangle_tree_factory);
     }
 
-    Lazy<CurveTree>* create_curve_tree(const Scene& scene, const Assembly& assembly)
+    Lazy<CurveTree>* create_curve_tree(
+        const Scene&        scene,
+        const Assembly&     assembly,
+        LazyBudget&         budget)
     {
         // Compute the assembly space bounding box of the assembly.
         const GAABB3 assembly_bbox =
@@ -424,7 +597,7 @@ namespace
                     assembly_bbox,
                     assembly)));
 
-        return new Lazy<CurveTree>(curve_tree_factory);
+        return budget.create_lazy(curve_tree_factory);
     }
 }
 
@@ -441,7 +614,7 @@ void AssemblyTree::create_child_trees(const Assembly& assembly)
         else
         {
             m_triangle_trees.insert(
-                make_pair(assembly.get_uid(), create_triangle_tree(m_scene, assembly)));
+                make_pair(assembly.get_uid(), create_triangle_tree(m_scene, assembly, m_child_tree_budget)));
         }
     }
 
@@ -449,7 +622,7 @@ void AssemblyTree::create_child_trees(const Assembly& assembly)
     if (has_object_instances_of_type(assembly, CurveObjectFactory::get_model()))
     {
         m_curve_trees.insert(
-            make_pair(assembly.get_uid(), create_curve_tree(m_scene, assembly)));
+            make_pair(assembly.get_uid(), create_curve_tree(m_scene, assembly, m_child_tree_budget)));
     }
 }
 
@@ -469,6 +642,41 @@ void AssemblyTree::update_child_trees(const Assembly& assembly)
     }
 }
 
+bool AssemblyTree::refit_child_trees(const Assembly& assembly)
+{
+    // Only triangle trees can be refitted.
+    if (assembly.is_flushable())
+        return false;
+
+    const TriangleTreeContainer::iterator triangle_tree_it = m_triangle_trees.find(assembly.get_uid());
+    if (triangle_tree_it == m_triangle_trees.end())
+        return false;
+
+    {
+        // A tree that is not in memory has nothing to refit.
+        Update<TriangleTree> access(triangle_tree_it->second);
+        if (access.get() == 0 || !access->refit())
+            return false;
+
+        access->update_non_geometry();
+    }
+
+    // Curve trees are simply rebuilt.
+    const CurveTreeContainer::iterator curve_tree_it = m_curve_trees.find(assembly.get_uid());
+    if (curve_tree_it != m_curve_trees.end())
+    {
+        delete curve_tree_it->second;
+        m_curve_trees.erase(curve_tree_it);
+    }
+    if (has_object_instances_of_type(assembly, CurveObjectFactory::get_model()))
+    {
+        m_curve_trees.insert(
+            make_pair(assembly.get_uid(), create_curve_tree(m_scene, assembly, m_child_tree_budget)));
+    }
+
+    return true;
+}
+
 void AssemblyTree::delete_child_trees(const Assembly& assembly)
 {
     if (assembly.is_flushable())
@@ -560,135 +768,183 @@ bool AssemblyLeafVisitor::visit(
 
     for (size_t i = 0; i < assembly_instance_count; ++i)
     {
+        if (!items[i].covers(ray.m_time))
+            continue;
+
         FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+        visit_item(items[i], ray);
+    }
 
-        // Retrieve the assembly instance.
-        const AssemblyTree::Item& item = items[i];
+    // Continue traversal.
+    distance = m_shading_point.m_ray.m_tmax;
+    return true;
+}
 
-        // Evaluate the transformation of the assembly instance.
-        Transformd tmp;
-        const Transformd& assembly_instance_transform =
-            item.m_transform_sequence.evaluate(ray.m_time, tmp);
+void AssemblyLeafVisitor::visit_item(
+    const AssemblyTree::Item&           item,
+    const ShadingRay&                   ray)
+{
+    // Evaluate the transformation of the assembly instance.
+    Transformd tmp;
+    const Transformd& assembly_instance_transform =
+        item.m_transform_sequence.evaluate(ray.m_time, tmp);
+
+    // Transform the ray to assembly instance space.
+    ShadingPoint local_shading_point;
+    compute_assembly_instance_ray(
+        *item.m_assembly_instance,
+        assembly_instance_transform,
+        m_parent_shading_point,
+        ray,
+        local_shading_point.m_ray);
+    const RayInfo3d local_ray_info(local_shading_point.m_ray);
+
+    if (item.m_assembly->is_flushable())
+    {
+        // Retrieve the region tree of this assembly.
+        const RegionTree& region_tree =
+            *m_region_tree_cache.access(
+                item.m_assembly_uid,
+                m_tree.m_region_trees);
 
-        // Transform the ray to assembly instance space.
-        ShadingPoint local_shading_point;
-        compute_assembly_instance_ray(
-            *item.m_assembly_instance,
-            assembly_instance_transform,
-            m_parent_shading_point,
-            ray,
-            local_shading_point.m_ray);
-        const RayInfo3d local_ray_info(local_shading_point.m_ray);
+        // Check the intersection between the ray and the region tree.
+        RegionLeafVisitor visitor(
+            local_shading_point,
+            m_triangle_tree_cache
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , m_triangle_tree_stats
+#endif
+            );
+        RegionLeafIntersector intersector;
+        intersector.intersect(
+            region_tree,
+            local_shading_point.m_ray,
+            local_ray_info,
+            visitor);
+    }
+    else
+    {
+        // Retrieve the triangle tree of this assembly.
+        const TriangleTree* triangle_tree =
+            m_triangle_tree_cache.access(
+                item.m_assembly_uid,
+                m_tree.m_triangle_trees);
 
-        if (item.m_assembly->is_flushable())
+        if (triangle_tree)
         {
-            // Retrieve the region tree of this assembly.
-            const RegionTree& region_tree =
-                *m_region_tree_cache.access(
-                    item.m_assembly_uid,
-                    m_tree.m_region_trees);
-
-            // Check the intersection between the ray and the region tree.
-            RegionLeafVisitor visitor(
-                local_shading_point,
-                m_triangle_tree_cache
+            // Check the intersection between the ray and the triangle tree.
+            TriangleTreeIntersector intersector;
+            TriangleLeafVisitor visitor(*triangle_tree, local_shading_point);
+            if (triangle_tree->get_moving_triangle_count() > 0)
+            {
+                intersector.intersect_motion(
+                    *triangle_tree,
+                    local_shading_point.m_ray,
+                    local_ray_info,
+                    local_shading_point.m_ray.m_time,
+                    visitor
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
-                , m_triangle_tree_stats
+                    , m_triangle_tree_stats
 #endif
-                );
-            RegionLeafIntersector intersector;
-            intersector.intersect(
-                region_tree,
-                local_shading_point.m_ray,
-                local_ray_info,
-                visitor);
-        }
-        else
-        {
-            // Retrieve the triangle tree of this assembly.
-            const TriangleTree* triangle_tree =
-                m_triangle_tree_cache.access(
-                    item.m_assembly_uid,
-                    m_tree.m_triangle_trees);
-
-            if (triangle_tree)
+                    );
+            }
+            else if (triangle_tree->get_node_width() == 8)
+            {
+                TriangleTreeWide8Intersector wide_intersector;
+                wide_intersector.intersect_no_motion(
+                    *triangle_tree,
+                    triangle_tree->get_wide8_tree(),
+                    local_shading_point.m_ray,
+                    local_ray_info,
+                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_triangle_tree_stats
+#endif
+                    );
+            }
+            else if (triangle_tree->get_node_width() == 4)
             {
-                // Check the intersection between the ray and the triangle tree.
-                TriangleTreeIntersector intersector;
-                TriangleLeafVisitor visitor(*triangle_tree, local_shading_point);
-                if (triangle_tree->get_moving_triangle_count() > 0)
-                {
-                    intersector.intersect_motion(
-                        *triangle_tree,
-                        local_shading_point.m_ray,
-                        local_ray_info,
-                        local_shading_point.m_ray.m_time,
-                        visitor
+                TriangleTreeWide4Intersector wide_intersector;
+                wide_intersector.intersect_no_motion(
+                    *triangle_tree,
+                    triangle_tree->get_wide4_tree(),
+                    local_shading_point.m_ray,
+                    local_ray_info,
+                    visitor
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
-                        , m_triangle_tree_stats
+                    , m_triangle_tree_stats
 #endif
-                        );
-                }
-                else
-                {
-                    intersector.intersect_no_motion(
-                        *triangle_tree,
-                        local_shading_point.m_ray,
-                        local_ray_info,
-                        visitor
+                    );
+            }
+            else
+            {
+                intersector.intersect_no_motion(
+                    *triangle_tree,
+                    local_shading_point.m_ray,
+                    local_ray_info,
+                    visitor
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
-                        , m_triangle_tree_stats
+                    , m_triangle_tree_stats
 #endif
-                        );
-                }
-                visitor.read_hit_triangle_data();
+                    );
             }
+            visitor.read_hit_triangle_data();
         }
+    }
 
-        // Retrieve the curve tree of this assembly.
-        const CurveTree* curve_tree =
-            m_curve_tree_cache.access(
-                item.m_assembly_uid,
-                m_tree.m_curve_trees);
+    // Retrieve the curve tree of this assembly.
+    const CurveTree* curve_tree =
+        m_curve_tree_cache.access(
+            item.m_assembly_uid,
+            m_tree.m_curve_trees);
 
-        if (curve_tree)
-        {
-            // Check the intersection between the ray and the curve tree.
-            const GRay3 ray(local_shading_point.m_ray);
-            const GRayInfo3 ray_info(local_ray_info);
-            CurveIntersectorType::MatrixType xfm_matrix;
-            CurveIntersectorType::make_projection_transform(xfm_matrix, ray);
-            CurveLeafVisitor visitor(*curve_tree, xfm_matrix, local_shading_point);
-            CurveTreeIntersector intersector;
-            intersector.intersect_no_motion(
-                *curve_tree,
-                ray,
-                ray_info,
-                visitor
+    if (curve_tree)
+    {
+        // Check the intersection between the ray and the curve tree.
+        const GRay3 ray(local_shading_point.m_ray);
+        const GRayInfo3 ray_info(local_ray_info);
+        CurveIntersectorType::MatrixType xfm_matrix;
+        CurveIntersectorType::make_projection_transform(xfm_matrix, ray);
+        CurveLeafVisitor visitor(*curve_tree, xfm_matrix, local_shading_point);
+        CurveTreeIntersector intersector;
+        intersector.intersect_no_motion(
+            *curve_tree,
+            ray,
+            ray_info,
+            visitor
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
-                , m_curve_tree_stats
+            , m_curve_tree_stats
 #endif
-                );
-        }
-
-        // Keep track of the closest hit.
-        if (local_shading_point.hit() && local_shading_point.m_ray.m_tmax < m_shading_point.m_ray.m_tmax)
-        {
-            m_shading_point.m_ray.m_tmax = local_shading_point.m_ray.m_tmax;
-            m_shading_point.m_primitive_type = local_shading_point.m_primitive_type;
-            m_shading_point.m_bary = local_shading_point.m_bary;
-            m_shading_point.m_assembly_instance = item.m_assembly_instance;
-            m_shading_point.m_assembly_instance_transform = assembly_instance_transform;
-            m_shading_point.m_object_instance_index = local_shading_point.m_object_instance_index;
-            m_shading_point.m_region_index = local_shading_point.m_region_index;
-            m_shading_point.m_primitive_index = local_shading_point.m_primitive_index;
-            m_shading_point.m_triangle_support_plane = local_shading_point.m_triangle_support_plane;
-        }
+            );
     }
 
-    // Continue traversal.
-    distance = m_shading_point.m_ray.m_tmax;
-    return true;
+    // Keep track of the closest hit.
+    update_closest_hit(
+        m_shading_point,
+        local_shading_point,
+        item.m_assembly_instance,
+        assembly_instance_transform);
+}
+
+
+void AssemblyLeafVisitor::update_closest_hit(
+    ShadingPoint&                       shading_point,
+    const ShadingPoint&                 local_shading_point,
+    const AssemblyInstance*             assembly_instance,
+    const Transformd&                   assembly_instance_transform)
+{
+    if (local_shading_point.hit() && local_shading_point.m_ray.m_tmax < shading_point.m_ray.m_tmax)
+    {
+        shading_point.m_ray.m_tmax = local_shading_point.m_ray.m_tmax;
+        shading_point.m_primitive_type = local_shading_point.m_primitive_type;
+        shading_point.m_bary = local_shading_point.m_bary;
+        shading_point.m_assembly_instance = assembly_instance;
+        shading_point.m_assembly_instance_transform = assembly_instance_transform;
+        shading_point.m_object_instance_index = local_shading_point.m_object_instance_index;
+        shading_point.m_region_index = local_shading_point.m_region_index;
+        shading_point.m_primitive_index = local_shading_point.m_primitive_index;
+        shading_point.m_triangle_support_plane = local_shading_point.m_triangle_support_plane;
+    }
 }
 
 
@@ -715,140 +971,489 @@ bool AssemblyLeafProbeVisitor::visit(
 
     for (size_t i = 0; i < assembly_instance_count; ++i)
     {
+        if (!items[i].covers(ray.m_time))
+            continue;
+
         FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
 
-        // Retrieve the assembly instance.
-        const AssemblyTree::Item& item = items[i];
+        // Terminate traversal if there was a hit.
+        if (visit_item(items[i], ray))
+        {
+            m_hit = true;
+            return false;
+        }
+    }
 
-        // Evaluate the transformation of the assembly instance.
-        Transformd tmp;
-        const Transformd& assembly_instance_transform =
-            item.m_transform_sequence.evaluate(ray.m_time, tmp);
+    // Continue traversal.
+    distance = ray.m_tmax;
+    return true;
+}
 
-        // Transform the ray to assembly instance space.
-        ShadingRay local_ray;
-        compute_assembly_instance_ray(
-            *item.m_assembly_instance,
-            assembly_instance_transform,
-            m_parent_shading_point,
-            ray,
-            local_ray);
-        const RayInfo3d local_ray_info(local_ray);
+bool AssemblyLeafProbeVisitor::visit_item(
+    const AssemblyTree::Item&           item,
+    const ShadingRay&                   ray)
+{
+    // Evaluate the transformation of the assembly instance.
+    Transformd tmp;
+    const Transformd& assembly_instance_transform =
+        item.m_transform_sequence.evaluate(ray.m_time, tmp);
+
+    // Transform the ray to assembly instance space.
+    ShadingRay local_ray;
+    compute_assembly_instance_ray(
+        *item.m_assembly_instance,
+        assembly_instance_transform,
+        m_parent_shading_point,
+        ray,
+        local_ray);
+    const RayInfo3d local_ray_info(local_ray);
+
+    if (item.m_assembly->is_flushable())
+    {
+        // Retrieve the region tree of this assembly.
+        const RegionTree& region_tree =
+            *m_region_tree_cache.access(
+                item.m_assembly_uid,
+                m_tree.m_region_trees);
+
+        // Check the intersection between the ray and the region tree.
+        RegionLeafProbeVisitor visitor(
+            m_triangle_tree_cache
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , m_triangle_tree_stats
+#endif
+            );
+        RegionLeafProbeIntersector intersector;
+        intersector.intersect(
+            region_tree,
+            local_ray,
+            local_ray_info,
+            visitor);
+
+        // Stop as soon as a hit is found.
+        if (visitor.hit())
+            return true;
+    }
+    else
+    {
+        // Retrieve the triangle tree of this assembly.
+        const TriangleTree* triangle_tree =
+            m_triangle_tree_cache.access(
+                item.m_assembly_uid,
+                m_tree.m_triangle_trees);
 
-        if (item.m_assembly->is_flushable())
+        if (triangle_tree)
         {
-            // Retrieve the region tree of this assembly.
-            const RegionTree& region_tree =
-                *m_region_tree_cache.access(
-                    item.m_assembly_uid,
-                    m_tree.m_region_trees);
-
-            // Check the intersection between the ray and the region tree.
-            RegionLeafProbeVisitor visitor(
-                m_triangle_tree_cache
+            // Check the intersection between the ray and the triangle tree.
+            TriangleTreeProbeIntersector intersector;
+            TriangleLeafProbeVisitor visitor(*triangle_tree, local_ray.m_time);
+            if (triangle_tree->get_moving_triangle_count() > 0)
+            {
+                intersector.intersect_motion(
+                    *triangle_tree,
+                    local_ray,
+                    local_ray_info,
+                    local_ray.m_time,
+                    visitor
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
-                , m_triangle_tree_stats
+                    , m_triangle_tree_stats
 #endif
-                );
-            RegionLeafProbeIntersector intersector;
-            intersector.intersect(
-                region_tree,
-                local_ray,
-                local_ray_info,
-                visitor);
-
-            // Terminate traversal if there was a hit.
-            if (visitor.hit())
+                    );
+            }
+            else if (triangle_tree->get_node_width() == 8)
             {
-                m_hit = true;
-                return false;
+                TriangleTreeWide8ProbeIntersector wide_intersector;
+                wide_intersector.intersect_no_motion(
+                    *triangle_tree,
+                    triangle_tree->get_wide8_tree(),
+                    local_ray,
+                    local_ray_info,
+                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_triangle_tree_stats
+#endif
+                    );
             }
-        }
-        else
-        {
-            // Retrieve the triangle tree of this assembly.
-            const TriangleTree* triangle_tree =
-                m_triangle_tree_cache.access(
-                    item.m_assembly_uid,
-                    m_tree.m_triangle_trees);
-
-            if (triangle_tree)
+            else if (triangle_tree->get_node_width() == 4)
             {
-                // Check the intersection between the ray and the triangle tree.
-                TriangleTreeProbeIntersector intersector;
-                TriangleLeafProbeVisitor visitor(*triangle_tree, local_ray.m_time);
-                if (triangle_tree->get_moving_triangle_count() > 0)
-                {
-                    intersector.intersect_motion(
-                        *triangle_tree,
-                        local_ray,
-                        local_ray_info,
-                        local_ray.m_time,
-                        visitor
+                TriangleTreeWide4ProbeIntersector wide_intersector;
+                wide_intersector.intersect_no_motion(
+                    *triangle_tree,
+                    triangle_tree->get_wide4_tree(),
+                    local_ray,
+                    local_ray_info,
+                    visitor
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
-                        , m_triangle_tree_stats
+                    , m_triangle_tree_stats
 #endif
-                        );
-                }
-                else
-                {
-                    intersector.intersect_no_motion(
-                        *triangle_tree,
-                        local_ray,
-                        local_ray_info,
-                        visitor
+                    );
+            }
+            else
+            {
+                intersector.intersect_no_motion(
+                    *triangle_tree,
+                    local_ray,
+                    local_ray_info,
+                    visitor
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
-                        , m_triangle_tree_stats
+                    , m_triangle_tree_stats
 #endif
-                        );
-                }
-
-                // Terminate traversal if there was a hit.
-                if (visitor.hit())
-                {
-                    m_hit = true;
-                    return false;
-                }
+                    );
             }
+
+            // Stop as soon as a hit is found.
+            if (visitor.hit())
+                return true;
         }
+    }
 
-        // Retrieve the curve tree of this assembly.
-        const CurveTree* curve_tree =
-            m_curve_tree_cache.access(
-                item.m_assembly_uid,
-                m_tree.m_curve_trees);
+    // Retrieve the curve tree of this assembly.
+    const CurveTree* curve_tree =
+        m_curve_tree_cache.access(
+            item.m_assembly_uid,
+            m_tree.m_curve_trees);
+
+    if (curve_tree)
+    {
+        // Check intersection between ray and curve tree.
+        const GRay3 ray(local_ray);
+        const GRayInfo3 ray_info(local_ray_info);
+        CurveIntersectorType::MatrixType xfm_matrix;
+        CurveIntersectorType::make_projection_transform(xfm_matrix, ray);
+        CurveLeafProbeVisitor visitor(*curve_tree, xfm_matrix);
+        CurveTreeProbeIntersector intersector;
+        intersector.intersect_no_motion(
+            *curve_tree,
+            ray,
+            ray_info,
+            visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , m_curve_tree_stats
+#endif
+            );
+
+        // Stop as soon as a hit is found.
+        if (visitor.hit())
+            return true;
+    }
 
-        if (curve_tree)
+    return false;
+}
+
+
+//
+// Utility functions for intersecting packets of rays with assembly instances.
+//
+
+namespace
+{
+    // Return true if the rays of a packet can traverse the geometry of a given
+    // assembly together, false if they must be handled one at a time.
+    bool is_packet_traceable(
+        const Assembly&                 assembly,
+        const TriangleTree*             triangle_tree,
+        const CurveTree*                curve_tree)
+    {
+        return
+            !assembly.is_flushable() &&
+            triangle_tree != 0 &&
+            triangle_tree->get_moving_triangle_count() == 0 &&
+            curve_tree == 0;
+    }
+
+    // Uninitialized storage for one triangle leaf visitor per ray of a packet.
+    template <typename Visitor>
+    struct VisitorArray
+    {
+        typedef typename boost::aligned_storage<
+            sizeof(Visitor),
+            boost::alignment_of<Visitor>::value
+        >::type StorageType;
+
+        StorageType     m_storage[RayPacketSize];
+        Visitor*        m_visitors[RayPacketSize];
+    };
+}
+
+
+//
+// AssemblyLeafPacketVisitor class implementation.
+//
+
+size_t AssemblyLeafPacketVisitor::visit(
+    const AssemblyTree::NodeType&       node,
+    const ShadingRay                    rays[],
+    const ShadingRay::RayInfoType       ray_infos[],
+    const size_t                        mask,
+    double                              distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , bvh::TraversalStatistics&         stats
+#endif
+    )
+{
+    // Retrieve the assembly instances for this leaf.
+    const size_t assembly_instance_count = node.get_item_count();
+    const AssemblyTree::Item* items =
+        assembly_instance_count <= AssemblyTree::NodeType::MaxUserDataSize / sizeof(AssemblyTree::Item)
+            ? &node.get_user_data<AssemblyTree::Item>()     // items are stored in the leaf node
+            : &m_tree.m_items[node.get_item_index()];       // items are stored in the tree
+
+    for (size_t i = 0; i < assembly_instance_count; ++i)
+    {
+        const size_t item_mask = items[i].covers(rays, mask);
+
+        if (item_mask == 0)
+            continue;
+
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+        visit_item(items[i], item_mask);
+    }
+
+    // Continue traversal for all rays.
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if (mask & (size_t(1) << i))
+            distances[i] = m_shading_points[i].m_ray.m_tmax;
+    }
+
+    return mask;
+}
+
+void AssemblyLeafPacketVisitor::visit_item(
+    const AssemblyTree::Item&           item,
+    const size_t                        mask)
+{
+    // Retrieve the child trees of this assembly.
+    const TriangleTree* triangle_tree =
+        item.m_assembly->is_flushable()
+            ? 0
+            : m_triangle_tree_cache.access(item.m_assembly_uid, m_tree.m_triangle_trees);
+    const CurveTree* curve_tree =
+        m_curve_tree_cache.access(item.m_assembly_uid, m_tree.m_curve_trees);
+
+    if (!is_packet_traceable(*item.m_assembly, triangle_tree, curve_tree))
+    {
+        // Intersect the rays one at a time.
+        for (size_t i = 0; i < RayPacketSize; ++i)
         {
-            // Check intersection between ray and curve tree.
-            const GRay3 ray(local_ray);
-            const GRayInfo3 ray_info(local_ray_info);
-            CurveIntersectorType::MatrixType xfm_matrix;
-            CurveIntersectorType::make_projection_transform(xfm_matrix, ray);
-            CurveLeafProbeVisitor visitor(*curve_tree, xfm_matrix);
-            CurveTreeProbeIntersector intersector;
-            intersector.intersect_no_motion(
-                *curve_tree,
-                ray,
-                ray_info,
-                visitor
+            if ((mask & (size_t(1) << i)) == 0)
+                continue;
+
+            AssemblyLeafVisitor visitor(
+                m_shading_points[i],
+                m_tree,
+                m_region_tree_cache,
+                m_triangle_tree_cache,
+                m_curve_tree_cache,
+                m_parent_shading_point
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
                 , m_curve_tree_stats
 #endif
                 );
+            visitor.visit_item(item, m_shading_points[i].m_ray);
+        }
 
-            // Terminate traversal if there was a hit.
-            if (visitor.hit())
-            {
-                m_hit = true;
-                return false;
-            }
+        return;
+    }
+
+    // Transform the rays to assembly instance space.
+    Transformd transforms[RayPacketSize];
+    ShadingRay local_rays[RayPacketSize];
+    ShadingRay::RayInfoType local_ray_infos[RayPacketSize];
+    ShadingPoint local_shading_points[RayPacketSize];
+    VisitorArray<TriangleLeafVisitor> visitors;
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if ((mask & (size_t(1) << i)) == 0)
+            continue;
+
+        const ShadingRay& ray = m_shading_points[i].m_ray;
+        transforms[i] = item.m_transform_sequence.evaluate(ray.m_time);
+        compute_assembly_instance_ray(
+            *item.m_assembly_instance,
+            transforms[i],
+            m_parent_shading_point,
+            ray,
+            local_rays[i]);
+        local_ray_infos[i] = ShadingRay::RayInfoType(local_rays[i]);
+        local_shading_points[i].m_ray = local_rays[i];
+        visitors.m_visitors[i] =
+            new (&visitors.m_storage[i]) TriangleLeafVisitor(*triangle_tree, local_shading_points[i]);
+    }
+
+    // Check the intersection between the packet and the triangle tree.
+    bvh::PerRayPacketVisitor<TriangleLeafVisitor> packet_visitor(visitors.m_visitors);
+    TriangleTreePacketIntersector intersector;
+    intersector.intersect_no_motion(
+        *triangle_tree,
+        local_rays,
+        local_ray_infos,
+        mask,
+        packet_visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , m_triangle_tree_stats
+#endif
+        );
+
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if ((mask & (size_t(1) << i)) == 0)
+            continue;
+
+        visitors.m_visitors[i]->read_hit_triangle_data();
+        visitors.m_visitors[i]->~TriangleLeafVisitor();
+
+        // Keep track of the closest hit.
+        AssemblyLeafVisitor::update_closest_hit(
+            m_shading_points[i],
+            local_shading_points[i],
+            item.m_assembly_instance,
+            transforms[i]);
+    }
+}
+
+
+//
+// AssemblyLeafPacketProbeVisitor class implementation.
+//
+
+size_t AssemblyLeafPacketProbeVisitor::visit(
+    const AssemblyTree::NodeType&       node,
+    const ShadingRay                    rays[],
+    const ShadingRay::RayInfoType       ray_infos[],
+    const size_t                        mask,
+    double                              distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , bvh::TraversalStatistics&         stats
+#endif
+    )
+{
+    // Retrieve the assembly instances for this leaf.
+    const size_t assembly_instance_count = node.get_item_count();
+    const AssemblyTree::Item* items =
+        assembly_instance_count <= AssemblyTree::NodeType::MaxUserDataSize / sizeof(AssemblyTree::Item)
+            ? &node.get_user_data<AssemblyTree::Item>()     // items are stored in the leaf node
+            : &m_tree.m_items[node.get_item_index()];       // items are stored in the tree
+
+    size_t active_mask = mask;
+
+    for (size_t i = 0; i < assembly_instance_count && active_mask != 0; ++i)
+    {
+        const size_t item_mask = items[i].covers(rays, active_mask);
+
+        if (item_mask == 0)
+            continue;
+
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+        // Terminate traversal for the rays that hit something.
+        const size_t hit_mask = visit_item(items[i], rays, item_mask);
+        m_hit_mask |= hit_mask;
+        active_mask &= ~hit_mask;
+    }
+
+    // Continue traversal for the other rays.
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if (active_mask & (size_t(1) << i))
+            distances[i] = rays[i].m_tmax;
+    }
+
+    return active_mask;
+}
+
+size_t AssemblyLeafPacketProbeVisitor::visit_item(
+    const AssemblyTree::Item&           item,
+    const ShadingRay                    rays[],
+    const size_t                        mask)
+{
+    // Retrieve the child trees of this assembly.
+    const TriangleTree* triangle_tree =
+        item.m_assembly->is_flushable()
+            ? 0
+            : m_triangle_tree_cache.access(item.m_assembly_uid, m_tree.m_triangle_trees);
+    const CurveTree* curve_tree =
+        m_curve_tree_cache.access(item.m_assembly_uid, m_tree.m_curve_trees);
+
+    size_t hit_mask = 0;
+
+    if (!is_packet_traceable(*item.m_assembly, triangle_tree, curve_tree))
+    {
+        // Intersect the rays one at a time.
+        AssemblyLeafProbeVisitor visitor(
+            m_tree,
+            m_region_tree_cache,
+            m_triangle_tree_cache,
+            m_curve_tree_cache,
+            m_parent_shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , m_triangle_tree_stats
+            , m_curve_tree_stats
+#endif
+            );
+
+        for (size_t i = 0; i < RayPacketSize; ++i)
+        {
+            if ((mask & (size_t(1) << i)) == 0)
+                continue;
+
+            if (visitor.visit_item(item, rays[i]))
+                hit_mask |= size_t(1) << i;
         }
+
+        return hit_mask;
     }
 
-    // Continue traversal.
-    distance = ray.m_tmax;
-    return true;
+    // Transform the rays to assembly instance space.
+    ShadingRay local_rays[RayPacketSize];
+    ShadingRay::RayInfoType local_ray_infos[RayPacketSize];
+    VisitorArray<TriangleLeafProbeVisitor> visitors;
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if ((mask & (size_t(1) << i)) == 0)
+            continue;
+
+        Transformd tmp;
+        const Transformd& assembly_instance_transform =
+            item.m_transform_sequence.evaluate(rays[i].m_time, tmp);
+        compute_assembly_instance_ray(
+            *item.m_assembly_instance,
+            assembly_instance_transform,
+            m_parent_shading_point,
+            rays[i],
+            local_rays[i]);
+        local_ray_infos[i] = ShadingRay::RayInfoType(local_rays[i]);
+        visitors.m_visitors[i] =
+            new (&visitors.m_storage[i]) TriangleLeafProbeVisitor(*triangle_tree, local_rays[i].m_time);
+    }
+
+    // Check the intersection between the packet and the triangle tree.
+    bvh::PerRayPacketVisitor<TriangleLeafProbeVisitor> packet_visitor(visitors.m_visitors);
+    TriangleTreePacketProbeIntersector intersector;
+    intersector.intersect_no_motion(
+        *triangle_tree,
+        local_rays,
+        local_ray_infos,
+        mask,
+        packet_visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , m_triangle_tree_stats
+#endif
+        );
+
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if ((mask & (size_t(1) << i)) == 0)
+            continue;
+
+        if (visitors.m_visitors[i]->hit())
+            hit_mask |= size_t(1) << i;
+
+        visitors.m_visitors[i]->~TriangleLeafProbeVisitor();
+    }
+
+    return hit_mask;
 }
 
 }   // namespace renderer
@@ -48,6 +48,8 @@
 #include "foundation/math/bvh.h"
 #include "foundation/utility/alignedvector.h"
 #include "foundation/utility/lazy.h"
+#include "foundation/utility/lazybudget.h"
+#include "foundation/utility/test.h"
 #include "foundation/utility/version.h"
 
 // Standard headers.
@@ -55,6 +57,7 @@
 #include <vector>
 
 // Forward declarations.
+DECLARE_TEST_CASE(Renderer_Kernel_Intersection_AssemblyTree, Update_GivenRefittedTriangleTreeCollectedByBudget_RebuildsTreeWithAllTriangles);
 namespace foundation    { class Statistics; }
 namespace renderer      { class Assembly; }
 namespace renderer      { class AssemblyInstance; }
@@ -90,26 +93,58 @@ class AssemblyTree
   private:
     friend class AssemblyLeafVisitor;
     friend class AssemblyLeafProbeVisitor;
+    friend class AssemblyLeafPacketVisitor;
+    friend class AssemblyLeafPacketProbeVisitor;
     friend class Intersector;
 
+    GRANT_ACCESS_TO_TEST_CASE(Renderer_Kernel_Intersection_AssemblyTree, Update_GivenRefittedTriangleTreeCollectedByBudget_RebuildsTreeWithAllTriangles);
+
+    // Moving assembly instances are represented by one item per time segment,
+    // each with a bounding box enclosing the instance during that segment only.
     struct Item
     {
         const renderer::Assembly*               m_assembly;
         foundation::UniqueID                    m_assembly_uid;
         const renderer::AssemblyInstance*       m_assembly_instance;
         renderer::TransformSequence             m_transform_sequence;
+        double                                  m_time_begin;
+        double                                  m_time_end;
 
         Item() {}
 
         Item(
             const renderer::Assembly*           assembly,
             const renderer::AssemblyInstance*   assembly_instance,
-            renderer::TransformSequence         transform_sequence)
+            renderer::TransformSequence         transform_sequence,
+            const double                        time_begin,
+            const double                        time_end)
           : m_assembly(assembly)
           , m_assembly_uid(assembly->get_uid())
           , m_assembly_instance(assembly_instance)
           , m_transform_sequence(transform_sequence)
+          , m_time_begin(time_begin)
+          , m_time_end(time_end)
+        {
+        }
+
+        // Return true if rays at a given time must be intersected with this item.
+        bool covers(const double time) const
+        {
+            return m_time_begin <= time && time < m_time_end;
+        }
+
+        // Return the subset of the rays selected by 'mask' that must be intersected with this item.
+        size_t covers(const ShadingRay rays[], const size_t mask) const
         {
+            size_t result = 0;
+
+            for (size_t i = 0; i < RayPacketSize; ++i)
+            {
+                if ((mask & (size_t(1) << i)) && covers(rays[i].m_time))
+                    result |= size_t(1) << i;
+            }
+
+            return result;
         }
     };
 
@@ -124,6 +159,7 @@ class AssemblyTree
     ItemVector              m_items;
     AssemblyVersionMap      m_assembly_versions;
     CurveTreeContainer      m_curve_trees;
+    foundation::LazyBudget  m_child_tree_budget;    // triangle and curve trees only
 
     void compute_cumulated_transforms(
         AssemblyInstanceContainer&              assembly_instances,
@@ -140,6 +176,7 @@ class AssemblyTree
     void collect_unique_assemblies(AssemblyVector& assemblies) const;
     void create_child_trees(const Assembly& assembly);
     void update_child_trees(const Assembly& assembly);
+    bool refit_child_trees(const Assembly& assembly);
     void delete_child_trees(const Assembly& assembly);
 };
 
@@ -178,6 +215,8 @@ class AssemblyLeafVisitor
         );
 
   private:
+    friend class AssemblyLeafPacketVisitor;
+
     ShadingPoint&                                   m_shading_point;
     const AssemblyTree&                             m_tree;
     RegionTreeAccessCache&                          m_region_tree_cache;
@@ -188,6 +227,19 @@ class AssemblyLeafVisitor
     foundation::bvh::TraversalStatistics&           m_triangle_tree_stats;
     foundation::bvh::TraversalStatistics&           m_curve_tree_stats;
 #endif
+
+    // Intersect the ray with a single assembly instance.
+    void visit_item(
+        const AssemblyTree::Item&                   item,
+        const ShadingRay&                           ray);
+
+    // Merge a hit found in the space of an assembly instance into a world
+    // space shading point, if it is closer.
+    static void update_closest_hit(
+        ShadingPoint&                               shading_point,
+        const ShadingPoint&                         local_shading_point,
+        const AssemblyInstance*                     assembly_instance,
+        const foundation::Transformd&               assembly_instance_transform);
 };
 
 
@@ -225,6 +277,66 @@ class AssemblyLeafProbeVisitor
         );
 
   private:
+    friend class AssemblyLeafPacketProbeVisitor;
+
+    const AssemblyTree&                             m_tree;
+    RegionTreeAccessCache&                          m_region_tree_cache;
+    TriangleTreeAccessCache&                        m_triangle_tree_cache;
+    CurveTreeAccessCache&                           m_curve_tree_cache;
+    const ShadingPoint*                             m_parent_shading_point;
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    foundation::bvh::TraversalStatistics&           m_triangle_tree_stats;
+    foundation::bvh::TraversalStatistics&           m_curve_tree_stats;
+#endif
+
+    // Intersect the ray with a single assembly instance, return true if a hit was found.
+    bool visit_item(
+        const AssemblyTree::Item&                   item,
+        const ShadingRay&                           ray);
+};
+
+
+//
+// Assembly leaf visitor for packets of rays, used during tree intersection.
+//
+// Assembly instances whose triangle tree has no moving triangles are
+// intersected by the whole packet at once. Other assembly instances
+// (flushable assemblies, curves, motion blur) are intersected one ray
+// at a time.
+//
+
+class AssemblyLeafPacketVisitor
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor. shading_points[i] receives the hit of rays[i].
+    AssemblyLeafPacketVisitor(
+        ShadingPoint                                shading_points[],
+        const AssemblyTree&                         tree,
+        RegionTreeAccessCache&                      region_tree_cache,
+        TriangleTreeAccessCache&                    triangle_tree_cache,
+        CurveTreeAccessCache&                       curve_tree_cache,
+        const ShadingPoint*                         parent_shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics&     triangle_tree_stats
+        , foundation::bvh::TraversalStatistics&     curve_tree_stats
+#endif
+        );
+
+    // Visit a leaf for the rays selected by 'mask'.
+    size_t visit(
+        const AssemblyTree::NodeType&               node,
+        const ShadingRay                            rays[],
+        const ShadingRay::RayInfoType               ray_infos[],
+        const size_t                                mask,
+        double                                      distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics&     stats
+#endif
+        );
+
+  private:
+    ShadingPoint*                                   m_shading_points;
     const AssemblyTree&                             m_tree;
     RegionTreeAccessCache&                          m_region_tree_cache;
     TriangleTreeAccessCache&                        m_triangle_tree_cache;
@@ -234,6 +346,69 @@ class AssemblyLeafProbeVisitor
     foundation::bvh::TraversalStatistics&           m_triangle_tree_stats;
     foundation::bvh::TraversalStatistics&           m_curve_tree_stats;
 #endif
+
+    // Intersect the rays selected by 'mask' with a single assembly instance.
+    void visit_item(
+        const AssemblyTree::Item&                   item,
+        const size_t                                mask);
+};
+
+
+//
+// Assembly leaf visitor for packets of probe rays, only return boolean
+// answers (whether an intersection was found or not) for each ray.
+//
+
+class AssemblyLeafPacketProbeVisitor
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor.
+    AssemblyLeafPacketProbeVisitor(
+        const AssemblyTree&                         tree,
+        RegionTreeAccessCache&                      region_tree_cache,
+        TriangleTreeAccessCache&                    triangle_tree_cache,
+        CurveTreeAccessCache&                       curve_tree_cache,
+        const ShadingPoint*                         parent_shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics&     triangle_tree_stats
+        , foundation::bvh::TraversalStatistics&     curve_tree_stats
+#endif
+        );
+
+    // Visit a leaf for the rays selected by 'mask'.
+    size_t visit(
+        const AssemblyTree::NodeType&               node,
+        const ShadingRay                            rays[],
+        const ShadingRay::RayInfoType               ray_infos[],
+        const size_t                                mask,
+        double                                      distances[]
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics&     stats
+#endif
+        );
+
+    // Return the mask of the rays that hit something.
+    size_t get_hit_mask() const;
+
+  private:
+    const AssemblyTree&                             m_tree;
+    RegionTreeAccessCache&                          m_region_tree_cache;
+    TriangleTreeAccessCache&                        m_triangle_tree_cache;
+    CurveTreeAccessCache&                           m_curve_tree_cache;
+    const ShadingPoint*                             m_parent_shading_point;
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    foundation::bvh::TraversalStatistics&           m_triangle_tree_stats;
+    foundation::bvh::TraversalStatistics&           m_curve_tree_stats;
+#endif
+    size_t                                          m_hit_mask;
+
+    // Intersect the rays selected by 'mask' with a single assembly instance,
+    // return the mask of the rays that hit something.
+    size_t visit_item(
+        const AssemblyTree::Item&                   item,
+        const ShadingRay                            rays[],
+        const size_t                                mask);
 };
 
 
@@ -253,6 +428,20 @@ typedef foundation::bvh::Intersector<
     ShadingRay
 > AssemblyTreeProbeIntersector;
 
+typedef foundation::bvh::PacketIntersector<
+    AssemblyTree,
+    AssemblyLeafPacketVisitor,
+    ShadingRay,
+    RayPacketSize
+> AssemblyTreePacketIntersector;
+
+typedef foundation::bvh::PacketIntersector<
+    AssemblyTree,
+    AssemblyLeafPacketProbeVisitor,
+    ShadingRay,
+    RayPacketSize
+> AssemblyTreePacketProbeIntersector;
+
 
 //
 // AssemblyLeafVisitor class implementation.
@@ -311,6 +500,71 @@ inline AssemblyLeafProbeVisitor::AssemblyLeafProbeVisitor(
 {
 }
 
+
+
+//
+// AssemblyLeafPacketVisitor class implementation.
+//
+
+inline AssemblyLeafPacketVisitor::AssemblyLeafPacketVisitor(
+    ShadingPoint                                    shading_points[],
+    const AssemblyTree&                             tree,
+    RegionTreeAccessCache&                          region_tree_cache,
+    TriangleTreeAccessCache&                        triangle_tree_cache,
+    CurveTreeAccessCache&                           curve_tree_cache,
+    const ShadingPoint*                             parent_shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , foundation::bvh::TraversalStatistics&         triangle_tree_stats
+    , foundation::bvh::TraversalStatistics&         curve_tree_stats
+#endif
+    )
+  : m_shading_points(shading_points)
+  , m_tree(tree)
+  , m_region_tree_cache(region_tree_cache)
+  , m_triangle_tree_cache(triangle_tree_cache)
+  , m_curve_tree_cache(curve_tree_cache)
+  , m_parent_shading_point(parent_shading_point)
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+  , m_triangle_tree_stats(triangle_tree_stats)
+  , m_curve_tree_stats(curve_tree_stats)
+#endif
+{
+}
+
+
+//
+// AssemblyLeafPacketProbeVisitor class implementation.
+//
+
+inline AssemblyLeafPacketProbeVisitor::AssemblyLeafPacketProbeVisitor(
+    const AssemblyTree&                             tree,
+    RegionTreeAccessCache&                          region_tree_cache,
+    TriangleTreeAccessCache&                        triangle_tree_cache,
+    CurveTreeAccessCache&                           curve_tree_cache,
+    const ShadingPoint*                             parent_shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , foundation::bvh::TraversalStatistics&         triangle_tree_stats
+    , foundation::bvh::TraversalStatistics&         curve_tree_stats
+#endif
+    )
+  : m_tree(tree)
+  , m_region_tree_cache(region_tree_cache)
+  , m_triangle_tree_cache(triangle_tree_cache)
+  , m_curve_tree_cache(curve_tree_cache)
+  , m_parent_shading_point(parent_shading_point)
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+  , m_triangle_tree_stats(triangle_tree_stats)
+  , m_curve_tree_stats(curve_tree_stats)
+#endif
+  , m_hit_mask(0)
+{
+}
+
+inline size_t AssemblyLeafPacketProbeVisitor::get_hit_mask() const
+{
+    return m_hit_mask;
+}
+
 }       // namespace renderer
 
 #endif  // !APPLESEED_RENDERER_KERNEL_INTERSECTION_ASSEMBLYTREE_H
@@ -40,6 +40,12 @@
 
 // appleseed.foundation headers.
 #include "foundation/core/exceptions/exceptionnotimplemented.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/basis.h"
+#include "foundation/math/minmax.h"
+#include "foundation/math/permutation.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
 #include "foundation/math/transform.h"
 #include "foundation/platform/defaulttimers.h"
 #include "foundation/platform/system.h"
@@ -49,6 +55,7 @@
 // Standard headers.
 #include <cassert>
 #include <cstring>
+#include <limits>
 #include <string>
 
 using namespace foundation;
@@ -76,12 +83,13 @@ CurveTree::Arguments::Arguments(
 CurveTree::CurveTree(const Arguments& arguments)
   : TreeType(AlignedAllocator<void>(System::get_l1_data_cache_line_size()))
   , m_arguments(arguments)
+  , m_curve_obbs(AlignedAllocator<void>(System::get_l1_data_cache_line_size()))
 {
     // Retrieve construction parameters.
     const MessageContext message_context(
         string("while building curve tree for assembly \"") + m_arguments.m_assembly.get_name() + "\"");
     const ParamArray& params = m_arguments.m_assembly.get_parameters().child("acceleration_structure");
-    const string algorithm = params.get_optional<string>("algorithm", "bvh", make_vector("bvh", "sbvh"), message_context);
+    const string algorithm = params.get_optional<string>("algorithm", "bvh", make_vector("bvh", "binned_bvh", "sbvh"), message_context);
     const double time = params.get_optional<double>("time", 0.5);
 
     // Start stopwatch.
@@ -90,7 +98,8 @@ CurveTree::CurveTree(const Arguments& arguments)
 
     // Build the tree.
     Statistics statistics;
-    if (algorithm == "bvh")
+    // Curve trees are small: the binned BVH algorithm builds a regular BVH.
+    if (algorithm == "bvh" || algorithm == "binned_bvh")
         build_bvh(params, time, statistics);
     else throw ExceptionNotImplemented();
 
@@ -103,6 +112,18 @@ CurveTree::CurveTree(const Arguments& arguments)
             statistics).to_string().c_str());
 }
 
+size_t CurveTree::get_memory_size() const
+{
+    return
+          TreeType::get_memory_size()
+        - sizeof(*static_cast<const TreeType*>(this))
+        + sizeof(*this)
+        + m_curves3.capacity() * sizeof(CurveType)
+        + m_curve_keys.capacity() * sizeof(CurveKey)
+        + m_curve_v_ranges.capacity() * sizeof(GVector2)
+        + m_curve_obbs.capacity() * sizeof(OBBPacketType);
+}
+
 void CurveTree::build_bvh(
     const ParamArray&       params,
     const double            time,
@@ -114,14 +135,16 @@ void CurveTree::build_bvh(
         m_arguments.m_curve_tree_uid,
         m_arguments.m_assembly.get_name());
     vector<GAABB3> curve_bboxes;
-    collect_curves(curve_bboxes);
+    collect_curves(
+        params.get_optional<size_t>("curve_split_depth", CurveTreeDefaultSplitDepth),
+        curve_bboxes);
 
     // Print statistics about the input geometry.
     RENDERER_LOG_INFO(
-        "building curve tree #" FMT_UNIQUE_ID " (bvh, %s %s)...",
+        "building curve tree #" FMT_UNIQUE_ID " (bvh, %s curve %s)...",
         m_arguments.m_curve_tree_uid,
         pretty_uint(m_curve_keys.size()).c_str(),
-        plural(m_curve_keys.size(), "curve").c_str());
+        plural(m_curve_keys.size(), "segment").c_str());
 
     // Create the partitioner.
     typedef bvh::SAHPartitioner<vector<GAABB3> > Partitioner;
@@ -152,11 +175,143 @@ void CurveTree::build_bvh(
 
         vector<CurveKey> temp_keys(m_curve_keys.size());
         small_item_reorder(&m_curve_keys[0], &temp_keys[0], &order[0], order.size());
+
+        vector<GVector2> temp_v_ranges(m_curve_v_ranges.size());
+        small_item_reorder(&m_curve_v_ranges[0], &temp_v_ranges[0], &order[0], order.size());
+    }
+
+    // Store the oriented bounding boxes of the curve segments.
+    store_curve_obbs();
+    statistics.insert("curve segments", m_curves3.size());
+    statistics.insert_size("leaf boxes", m_curve_obbs.size() * sizeof(OBBPacketType));
+}
+
+namespace
+{
+    GAABB3 compute_curve_bbox(const CurveType& curve)
+    {
+        GAABB3 curve_bbox = curve.compute_bbox();
+        curve_bbox.grow(GVector3(GScalar(0.5) * curve.compute_max_width()));
+        return curve_bbox;
+    }
+
+    // Recursively split a curve in halves as long as it tightens its bounding boxes.
+    void split_curve(
+        const CurveType&    curve,
+        const GScalar       v0,
+        const GScalar       v1,
+        const size_t        depth,
+        vector<CurveType>&  segments,
+        vector<GVector2>&   v_ranges)
+    {
+        if (depth > 0)
+        {
+            CurveType c1, c2;
+            curve.split(c1, c2);
+
+            const GScalar curve_area = half_surface_area(compute_curve_bbox(curve));
+            const GScalar split_area =
+                  half_surface_area(compute_curve_bbox(c1))
+                + half_surface_area(compute_curve_bbox(c2));
+
+            if (split_area < CurveTreeSplitMaxAreaRatio * curve_area)
+            {
+                const GScalar vm = GScalar(0.5) * (v0 + v1);
+                split_curve(c1, v0, vm, depth - 1, segments, v_ranges);
+                split_curve(c2, vm, v1, depth - 1, segments, v_ranges);
+                return;
+            }
+        }
+
+        segments.push_back(curve);
+        v_ranges.push_back(GVector2(v0, v1));
+    }
+
+    // Compute an oriented bounding box of a curve, aligned with its chord.
+    void compute_curve_obb(
+        const CurveType&    curve,
+        GVector3&           center,
+        GVector3            axes[3],
+        GVector3&           half_extents)
+    {
+        const GVector3 chord =
+              curve.get_control_point(CurveType::Degree)
+            - curve.get_control_point(0);
+        const GScalar chord_norm = norm(chord);
+
+        const Basis3<GScalar> basis(
+            chord_norm > GScalar(0.0) ? chord / chord_norm : GVector3(1.0f, 0.0f, 0.0f));
+        axes[0] = basis.get_normal();
+        axes[1] = basis.get_tangent_u();
+        axes[2] = basis.get_tangent_v();
+
+        // The curve lies in the convex hull of its control points.
+        GVector3 lo(numeric_limits<GScalar>::max());
+        GVector3 hi(-numeric_limits<GScalar>::max());
+        for (size_t i = 0; i < curve.get_control_point_count(); ++i)
+        {
+            const GVector3& p = curve.get_control_point(i);
+
+            for (size_t d = 0; d < 3; ++d)
+            {
+                const GScalar x = dot(p, axes[d]);
+                lo[d] = min(lo[d], x);
+                hi[d] = max(hi[d], x);
+            }
+        }
+
+        // Pad the box with the radius of the curve, plus a small margin against rounding errors.
+        const GScalar radius = GScalar(0.5) * curve.compute_max_width();
+        const GScalar margin = GScalar(1.0e-4) * (max_value(hi - lo) + radius);
+
+        center = GVector3(0.0f);
+        for (size_t d = 0; d < 3; ++d)
+        {
+            center += GScalar(0.5) * (lo[d] + hi[d]) * axes[d];
+            half_extents[d] =
+                max(
+                    GScalar(0.5) * (hi[d] - lo[d]) + radius + margin,
+                    numeric_limits<GScalar>::min());
+        }
+    }
+}
+
+void CurveTree::store_curve_obbs()
+{
+    const size_t node_count = m_nodes.size();
+
+    for (size_t i = 0; i < node_count; ++i)
+    {
+        NodeType& node = m_nodes[i];
+
+        if (node.is_leaf())
+        {
+            const size_t curve_index = node.get_item_index();
+            const size_t curve_count = node.get_item_count();
+
+            node.set_user_data(static_cast<uint32>(m_curve_obbs.size()));
+
+            for (size_t j = 0; j < curve_count; ++j)
+            {
+                if (j % OBBPacketType::Width == 0)
+                    m_curve_obbs.push_back(OBBPacketType());
+
+                GVector3 center, axes[3], half_extents;
+                compute_curve_obb(m_curves3[curve_index + j], center, axes, half_extents);
+
+                m_curve_obbs.back().set(j % OBBPacketType::Width, center, axes, half_extents);
+            }
+        }
     }
 }
 
-void CurveTree::collect_curves(vector<GAABB3>& curve_bboxes)
+void CurveTree::collect_curves(
+    const size_t            split_depth,
+    vector<GAABB3>&         curve_bboxes)
 {
+    vector<CurveType> segments;
+    vector<GVector2> v_ranges;
+
     const ObjectInstanceContainer& object_instances = m_arguments.m_assembly.object_instances();
 
     for (size_t i = 0; i < object_instances.size(); ++i)
@@ -184,12 +339,17 @@ void CurveTree::collect_curves(vector<GAABB3>& curve_bboxes)
             const CurveType curve(curve_object.get_curve(j), transform);
             const CurveKey curve_key(i, j, 0);  // for now we assume all the curves have the same material
 
-            GAABB3 curve_bbox = curve.compute_bbox();
-            curve_bbox.grow(GVector3(GScalar(0.5) * curve.compute_max_width()));
-
-            m_curves3.push_back(curve);
-            m_curve_keys.push_back(curve_key);
-            curve_bboxes.push_back(curve_bbox);
+            segments.clear();
+            v_ranges.clear();
+            split_curve(curve, GScalar(0.0), GScalar(1.0), split_depth, segments, v_ranges);
+
+            for (size_t k = 0; k < segments.size(); ++k)
+            {
+                m_curves3.push_back(segments[k]);
+                m_curve_keys.push_back(curve_key);
+                m_curve_v_ranges.push_back(v_ranges[k]);
+                curve_bboxes.push_back(compute_curve_bbox(segments[k]));
+            }
         }
     }
 }
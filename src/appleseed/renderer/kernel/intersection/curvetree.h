@@ -40,13 +40,17 @@
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
 #include "foundation/math/bvh.h"
+#include "foundation/math/intersection/rayobb.h"
 #include "foundation/math/matrix.h"
+#include "foundation/math/scalar.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/alignedvector.h"
 #include "foundation/utility/lazy.h"
 #include "foundation/utility/poolallocator.h"
 #include "foundation/utility/uid.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cstddef>
 #include <map>
 #include <memory>
@@ -64,6 +68,10 @@ namespace renderer
 //
 // Curve tree.
 //
+// Curves are split into segments with tighter bounding boxes, and each leaf stores
+// an oriented bounding box per segment. Leaves test the ray against these boxes four
+// at a time, and only intersect the segments whose box is hit.
+//
 
 class CurveTree
   : public foundation::bvh::Tree<
@@ -92,6 +100,9 @@ class CurveTree
     // Constructor, builds the tree for a given assembly.
     explicit CurveTree(const Arguments& arguments);
 
+    // Return the size (in bytes) of this object in memory.
+    size_t get_memory_size() const;
+
     void build_bvh(
         const ParamArray&                       params,
         const double                            time,
@@ -101,11 +112,19 @@ class CurveTree
     friend class CurveLeafVisitor;
     friend class CurveLeafProbeVisitor;
 
-    const Arguments         m_arguments;
-    std::vector<CurveType>  m_curves3;
-    std::vector<CurveKey>   m_curve_keys;
+    typedef foundation::OBBPacket4<GScalar> OBBPacketType;
+
+    const Arguments                             m_arguments;
+    std::vector<CurveType>                      m_curves3;          // curve segments
+    std::vector<CurveKey>                       m_curve_keys;
+    std::vector<GVector2>                       m_curve_v_ranges;   // range of v covered by each segment in its curve
+    foundation::AlignedVector<OBBPacketType>    m_curve_obbs;
 
-    void collect_curves(std::vector<GAABB3>& curve_bboxes);
+    void collect_curves(
+        const size_t                            split_depth,
+        std::vector<GAABB3>&                    curve_bboxes);
+
+    void store_curve_obbs();
 };
 
 
@@ -258,24 +277,44 @@ inline bool CurveLeafVisitor::visit(
 {
     const size_t curve_index = node.get_item_index();
     const size_t curve_count = node.get_item_count();
+    const CurveTree::OBBPacketType* obbs = &m_tree.m_curve_obbs[node.get_user_data<foundation::uint32>()];
 
-    // Sequentially intersect all curves of the leaf.
-    for (size_t i = 0; i < curve_count; ++i)
+    // Intersect the oriented bounding boxes of the curve segments of the leaf four
+    // at a time, and only intersect the segments whose bounding box is hit.
+    for (size_t i = 0; i < curve_count; i += CurveTree::OBBPacketType::Width, ++obbs)
     {
-        // For now we intersect curves as they are stored in memory (no floating point format conversion).
-        const CurveType& curve = m_tree.m_curves3[curve_index + i];
+        GRay3 clipped_ray(ray);
+        clipped_ray.m_tmax = std::min(ray.m_tmax, static_cast<GScalar>(m_shading_point.m_ray.m_tmax));
+
+        size_t mask = foundation::intersect(clipped_ray, *obbs);
+        if (curve_count - i < CurveTree::OBBPacketType::Width)
+            mask &= (size_t(1) << (curve_count - i)) - 1;
 
-        // Intersect the curve.
-        GScalar u, v, t = ray.m_tmax;
-        if (CurveIntersectorType::intersect(curve, ray, m_xfm_matrix, u, v, t))
+        for (size_t j = 0; mask != 0; ++j, mask >>= 1)
         {
-            const CurveKey& key = m_tree.m_curve_keys[curve_index + i];
-            m_shading_point.m_primitive_type = ShadingPoint::PrimitiveCurve;
-            m_shading_point.m_ray.m_tmax = static_cast<double>(t);
-            m_shading_point.m_bary[0] = static_cast<double>(u);
-            m_shading_point.m_bary[1] = static_cast<double>(v);
-            m_shading_point.m_object_instance_index = key.get_object_instance_index();
-            m_shading_point.m_primitive_index = key.get_curve_index();
+            if ((mask & 1) == 0)
+                continue;
+
+            // For now we intersect curves as they are stored in memory (no floating point format conversion).
+            const size_t segment_index = curve_index + i + j;
+            const CurveType& curve = m_tree.m_curves3[segment_index];
+
+            // Intersect the curve segment.
+            GScalar u, v, t = clipped_ray.m_tmax;
+            if (CurveIntersectorType::intersect(curve, ray, m_xfm_matrix, u, v, t))
+            {
+                // Express v along the whole curve.
+                const GVector2& v_range = m_tree.m_curve_v_ranges[segment_index];
+                v = foundation::lerp(v_range[0], v_range[1], v);
+
+                const CurveKey& key = m_tree.m_curve_keys[segment_index];
+                m_shading_point.m_primitive_type = ShadingPoint::PrimitiveCurve;
+                m_shading_point.m_ray.m_tmax = static_cast<double>(t);
+                m_shading_point.m_bary[0] = static_cast<double>(u);
+                m_shading_point.m_bary[1] = static_cast<double>(v);
+                m_shading_point.m_object_instance_index = key.get_object_instance_index();
+                m_shading_point.m_primitive_index = key.get_curve_index();
+            }
         }
     }
 
@@ -311,19 +350,31 @@ inline bool CurveLeafProbeVisitor::visit(
 {
     const size_t curve_index = node.get_item_index();
     const size_t curve_count = node.get_item_count();
+    const CurveTree::OBBPacketType* obbs = &m_tree.m_curve_obbs[node.get_user_data<foundation::uint32>()];
 
-    // Sequentially intersect all curves of the leaf.
-    for (size_t i = 0; i < curve_count; ++i)
+    // Intersect the oriented bounding boxes of the curve segments of the leaf four
+    // at a time, and only intersect the segments whose bounding box is hit.
+    for (size_t i = 0; i < curve_count; i += CurveTree::OBBPacketType::Width, ++obbs)
     {
-        // For now we intersect curves as they are stored in memory (no floating point format conversion).
-        const CurveType& curve = m_tree.m_curves3[curve_index + i];
+        size_t mask = foundation::intersect(ray, *obbs);
+        if (curve_count - i < CurveTree::OBBPacketType::Width)
+            mask &= (size_t(1) << (curve_count - i)) - 1;
 
-        // Intersect the curve.
-        if (CurveIntersectorType::intersect(curve, ray, m_xfm_matrix))
+        for (size_t j = 0; mask != 0; ++j, mask >>= 1)
         {
-            FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(i + 1));
-            m_hit = true;
-            return false;
+            if ((mask & 1) == 0)
+                continue;
+
+            // For now we intersect curves as they are stored in memory (no floating point format conversion).
+            const CurveType& curve = m_tree.m_curves3[curve_index + i + j];
+
+            // Intersect the curve segment.
+            if (CurveIntersectorType::intersect(curve, ray, m_xfm_matrix))
+            {
+                FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(i + j + 1));
+                m_hit = true;
+                return false;
+            }
         }
     }
 
@@ -56,6 +56,10 @@ const double AssemblyTreeInteriorNodeTraversalCost = 1.0;
 // Relative cost of intersecting an assembly.
 const double AssemblyTreeTriangleIntersectionCost = 10.0;
 
+// Maximum number of times the shutter interval of a moving assembly instance is
+// split in halves to get time segments with tighter bounding boxes.
+const size_t AssemblyTreeMaxTimeSplitDepth = 3;
+
 
 //
 // Region tree settings.
@@ -86,6 +90,13 @@ typedef foundation::TriangleMT<GScalar> GTriangleType;
 typedef foundation::TriangleMT<double> TriangleType;
 typedef foundation::TriangleMTSupportPlane<double> TriangleSupportPlaneType;
 
+// Triangle format used for storage and intersection by single precision triangle trees.
+typedef foundation::TriangleWT<GScalar> GWatertightTriangleType;
+
+// Intersect static triangles in single precision using a watertight test.
+// Can be overridden per scene and per assembly.
+const bool TriangleTreeDefaultSinglePrecision = false;
+
 // Maximum number of triangles per leaf.
 const size_t TriangleTreeDefaultMaxLeafSize = 2;
 
@@ -98,6 +109,18 @@ const GScalar TriangleTreeDefaultTriangleIntersectionCost(1.0);
 // Number of bins used during SBVH construction.
 const size_t TriangleTreeDefaultBinCount = 256;
 
+// Number of bins used during binned BVH construction.
+const size_t TriangleTreeDefaultBinnedBVHBinCount = 32;
+
+// Width of the nodes used during traversal (2 for binary trees, 4 or 8 for wide trees).
+const size_t TriangleTreeDefaultNodeWidth = 2;
+
+// Refit triangle trees when the geometry of their assembly moves, instead of rebuilding them.
+const bool TriangleTreeDefaultRefit = true;
+
+// Rebuild a refitted triangle tree when its SAH cost grew by more than this factor.
+const double TriangleTreeDefaultRefitMaxCostGrowth = 1.5;
+
 // Define this symbol to enable reordering the nodes of triangle trees for better
 // locality of reference. Requires a lot of temporary memory for minimal results.
 #undef RENDERER_TRIANGLE_TREE_REORDER_NODES
@@ -112,6 +135,9 @@ const size_t TriangleTreeAccessCacheWays = 2;
 // Size of the stack (in number of nodes) used during traversal.
 const size_t TriangleTreeStackSize = 64;
 
+// Size of the stack (in number of nodes) used during traversal of wide trees.
+const size_t TriangleTreeWideStackSize = 256;
+
 
 //
 // Curve tree settings.
@@ -123,8 +149,16 @@ typedef foundation::BezierCurve3<GScalar> CurveType;
 // Curve intersector.
 typedef foundation::BezierCurveIntersector<CurveType> CurveIntersectorType;
 
-// Maximum number of curves per leaf.
-const size_t CurveTreeDefaultMaxLeafSize = 1;
+// Maximum number of curve segments per leaf. The oriented bounding boxes of the
+// segments of a leaf are intersected four at a time.
+const size_t CurveTreeDefaultMaxLeafSize = 4;
+
+// Maximum number of times curves are split in halves to get segments with tighter bounding boxes.
+const size_t CurveTreeDefaultSplitDepth = 2;
+
+// Curves are only split if the bounding boxes of the two halves have a total surface
+// area below this fraction of the surface area of the bounding box of the curve.
+const GScalar CurveTreeSplitMaxAreaRatio(0.8);
 
 // Relative cost of traversing an interior node.
 const GScalar CurveTreeDefaultInteriorNodeTraversalCost(1.0);
@@ -144,6 +178,10 @@ const size_t CurveTreeStackSize = 64;
 // Miscellaneous settings.
 //
 
+// Maximum number of rays traversing the scene together when several rays are
+// traced at once. Longer ray streams are split into packets of this size.
+const size_t RayPacketSize = 16;
+
 // If defined, an adaptive procedure is used to offset intersection points.
 // If left undefined, a fixed, constant-time procedure is used. The adaptive
 // procedure handles degenerate cases better but is slightly slower. It must
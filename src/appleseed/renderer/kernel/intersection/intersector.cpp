@@ -45,6 +45,7 @@
 #include "foundation/utility/string.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
 #include <memory>
 #include <string>
@@ -341,6 +342,148 @@ bool Intersector::trace_probe(
     return visitor.hit();
 }
 
+void Intersector::trace(
+    const ShadingRay                rays[],
+    const size_t                    ray_count,
+    ShadingPoint                    shading_points[],
+    const ShadingPoint*             parent_shading_point) const
+{
+    assert(parent_shading_point == 0 || parent_shading_point->hit());
+
+    // Update ray casting statistics.
+    m_shading_ray_count += ray_count;
+
+    // Initialize the shading points.
+    for (size_t i = 0; i < ray_count; ++i)
+    {
+        ShadingPoint& shading_point = shading_points[i];
+
+        assert(shading_point.m_scene == 0);
+        assert(shading_point.hit() == false);
+        assert(parent_shading_point != &shading_point);
+
+        shading_point.m_region_kit_cache = &m_region_kit_cache;
+        shading_point.m_tess_cache = &m_tess_cache;
+        shading_point.m_texture_cache = &m_texture_cache;
+        shading_point.m_scene = &m_trace_context.get_scene();
+        shading_point.m_ray = rays[i];
+    }
+
+    // Refine and offset the previous intersection point.
+    if (parent_shading_point &&
+        parent_shading_point->hit() &&
+        !(parent_shading_point->m_members & ShadingPoint::HasRefinedPoints))
+        parent_shading_point->refine_and_offset();
+
+    // Retrieve assembly tree.
+    const AssemblyTree& assembly_tree = m_trace_context.get_assembly_tree();
+
+    // Trace the rays in packets.
+    for (size_t begin = 0; begin < ray_count; begin += RayPacketSize)
+    {
+        const size_t packet_size = min(ray_count - begin, RayPacketSize);
+        const size_t mask = packet_size < sizeof(size_t) * 8 ? (size_t(1) << packet_size) - 1 : ~size_t(0);
+
+        // Compute ray info once for the entire traversal.
+        ShadingRay::RayInfoType ray_infos[RayPacketSize];
+        for (size_t i = 0; i < packet_size; ++i)
+            ray_infos[i] = ShadingRay::RayInfoType(rays[begin + i]);
+
+        // Check the intersection between the packet and the assembly tree.
+        AssemblyTreePacketIntersector intersector;
+        AssemblyLeafPacketVisitor visitor(
+            shading_points + begin,
+            assembly_tree,
+            m_region_tree_cache,
+            m_triangle_tree_cache,
+            m_curve_tree_cache,
+            parent_shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , m_triangle_tree_traversal_stats
+            , m_curve_tree_traversal_stats
+#endif
+            );
+        intersector.intersect_no_motion(
+            assembly_tree,
+            rays + begin,
+            ray_infos,
+            mask,
+            visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , m_assembly_tree_traversal_stats
+#endif
+            );
+    }
+
+    // Detect and report self-intersections.
+    if (m_report_self_intersections)
+    {
+        for (size_t i = 0; i < ray_count; ++i)
+            report_self_intersection(shading_points[i], parent_shading_point);
+    }
+}
+
+void Intersector::trace_probe(
+    const ShadingRay                rays[],
+    const size_t                    ray_count,
+    bool                            hits[],
+    const ShadingPoint*             parent_shading_point) const
+{
+    assert(parent_shading_point == 0 || parent_shading_point->hit());
+
+    // Update ray casting statistics.
+    m_probe_ray_count += ray_count;
+
+    // Refine and offset the previous intersection point.
+    if (parent_shading_point &&
+        parent_shading_point->hit() &&
+        !(parent_shading_point->m_members & ShadingPoint::HasRefinedPoints))
+        parent_shading_point->refine_and_offset();
+
+    // Retrieve assembly tree.
+    const AssemblyTree& assembly_tree = m_trace_context.get_assembly_tree();
+
+    // Trace the rays in packets.
+    for (size_t begin = 0; begin < ray_count; begin += RayPacketSize)
+    {
+        const size_t packet_size = min(ray_count - begin, RayPacketSize);
+        const size_t mask = packet_size < sizeof(size_t) * 8 ? (size_t(1) << packet_size) - 1 : ~size_t(0);
+
+        // Compute ray info once for the entire traversal.
+        ShadingRay::RayInfoType ray_infos[RayPacketSize];
+        for (size_t i = 0; i < packet_size; ++i)
+            ray_infos[i] = ShadingRay::RayInfoType(rays[begin + i]);
+
+        // Check the intersection between the packet and the assembly tree.
+        AssemblyTreePacketProbeIntersector intersector;
+        AssemblyLeafPacketProbeVisitor visitor(
+            assembly_tree,
+            m_region_tree_cache,
+            m_triangle_tree_cache,
+            m_curve_tree_cache,
+            parent_shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , m_triangle_tree_traversal_stats
+            , m_curve_tree_traversal_stats
+#endif
+            );
+        intersector.intersect_no_motion(
+            assembly_tree,
+            rays + begin,
+            ray_infos,
+            mask,
+            visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , m_assembly_tree_traversal_stats
+#endif
+            );
+
+        const size_t hit_mask = visitor.get_hit_mask();
+        for (size_t i = 0; i < packet_size; ++i)
+            hits[begin + i] = (hit_mask & (size_t(1) << i)) != 0;
+    }
+}
+
 void Intersector::manufacture_hit(
     ShadingPoint&                       shading_point,
     const ShadingRay&                   shading_ray,
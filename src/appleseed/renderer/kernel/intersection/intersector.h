@@ -103,6 +103,24 @@ class Intersector
         const ShadingRay&               ray,
         const ShadingPoint*             parent_shading_point = 0) const;
 
+    // Trace a stream of world space rays through the scene. Rays are traced in
+    // packets and should be coherent (e.g. neighboring camera rays, or rays
+    // leaving the same point) to benefit from packet traversal.
+    // shading_points[i] receives the hit of rays[i].
+    void trace(
+        const ShadingRay                rays[],
+        const size_t                    ray_count,
+        ShadingPoint                    shading_points[],
+        const ShadingPoint*             parent_shading_point = 0) const;
+
+    // Trace a stream of world space probe rays through the scene.
+    // hits[i] is set to true if rays[i] hit something.
+    void trace_probe(
+        const ShadingRay                rays[],
+        const size_t                    ray_count,
+        bool                            hits[],
+        const ShadingPoint*             parent_shading_point = 0) const;
+
     // Manufacture a hit "by hand".
     void manufacture_hit(
         ShadingPoint&                       shading_point,
@@ -525,6 +525,34 @@ double RegionLeafVisitor::visit(
                 visitor
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
                 , m_triangle_tree_stats
+#endif
+                );
+        }
+        else if (triangle_tree->get_node_width() == 8)
+        {
+            TriangleTreeWide8Intersector wide_intersector;
+            wide_intersector.intersect_no_motion(
+                *triangle_tree,
+                triangle_tree->get_wide8_tree(),
+                ray,
+                ray_info,
+                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
+#endif
+                );
+        }
+        else if (triangle_tree->get_node_width() == 4)
+        {
+            TriangleTreeWide4Intersector wide_intersector;
+            wide_intersector.intersect_no_motion(
+                *triangle_tree,
+                triangle_tree->get_wide4_tree(),
+                ray,
+                ray_info,
+                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
 #endif
                 );
         }
@@ -580,6 +608,34 @@ double RegionLeafProbeVisitor::visit(
                 visitor
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
                 , m_triangle_tree_stats
+#endif
+                );
+        }
+        else if (triangle_tree->get_node_width() == 8)
+        {
+            TriangleTreeWide8ProbeIntersector wide_intersector;
+            wide_intersector.intersect_no_motion(
+                *triangle_tree,
+                triangle_tree->get_wide8_tree(),
+                ray,
+                ray_info,
+                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
+#endif
+                );
+        }
+        else if (triangle_tree->get_node_width() == 4)
+        {
+            TriangleTreeWide4ProbeIntersector wide_intersector;
+            wide_intersector.intersect_no_motion(
+                *triangle_tree,
+                triangle_tree->get_wide4_tree(),
+                ray,
+                ray_info,
+                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
 #endif
                 );
         }
@@ -35,9 +35,15 @@
 #include "renderer/kernel/intersection/trianglevertexinfo.h"
 
 // appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/scalar.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/memory.h"
 
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+
 using namespace foundation;
 using namespace std;
 
@@ -48,7 +54,8 @@ size_t TriangleEncoder::compute_size(
     const vector<TriangleVertexInfo>&   triangle_vertex_infos,
     const vector<size_t>&               triangle_indices,
     const size_t                        item_begin,
-    const size_t                        item_count)
+    const size_t                        item_count,
+    const bool                          single_precision)
 {
     size_t size = 0;
 
@@ -60,7 +67,7 @@ size_t TriangleEncoder::compute_size(
         size += sizeof(uint32);         // motion segment count
 
         if (vertex_info.m_motion_segment_count == 0)
-            size += sizeof(GTriangleType);
+            size += single_precision ? sizeof(GWatertightTriangleType) : sizeof(GTriangleType);
         else size += (vertex_info.m_motion_segment_count + 1) * 3 * sizeof(GVector3);
     }
 
@@ -73,6 +80,7 @@ void TriangleEncoder::encode(
     const vector<size_t>&               triangle_indices,
     const size_t                        item_begin,
     const size_t                        item_count,
+    const bool                          single_precision,
     MemoryWriter&                       writer)
 {
     for (size_t i = 0; i < item_count; ++i)
@@ -80,18 +88,18 @@ void TriangleEncoder::encode(
         const size_t triangle_index = triangle_indices[item_begin + i];
         const TriangleVertexInfo& vertex_info = triangle_vertex_infos[triangle_index];
 
-        writer.write(static_cast<uint32>(vertex_info.m_motion_segment_count));
-
         if (vertex_info.m_motion_segment_count == 0)
         {
-            writer.write(
-                GTriangleType(
-                    triangle_vertices[vertex_info.m_vertex_index + 0],
-                    triangle_vertices[vertex_info.m_vertex_index + 1],
-                    triangle_vertices[vertex_info.m_vertex_index + 2]));
+            encode(
+                triangle_vertices[vertex_info.m_vertex_index + 0],
+                triangle_vertices[vertex_info.m_vertex_index + 1],
+                triangle_vertices[vertex_info.m_vertex_index + 2],
+                single_precision,
+                writer);
         }
         else
         {
+            writer.write(static_cast<uint32>(vertex_info.m_motion_segment_count));
             writer.write(
                 &triangle_vertices[vertex_info.m_vertex_index],
                 (vertex_info.m_motion_segment_count + 1) * 3 * sizeof(GVector3));
@@ -99,4 +107,192 @@ void TriangleEncoder::encode(
     }
 }
 
+void TriangleEncoder::encode(
+    const GVector3&                     v0,
+    const GVector3&                     v1,
+    const GVector3&                     v2,
+    const bool                          single_precision,
+    MemoryWriter&                       writer)
+{
+    writer.write(static_cast<uint32>(0));     // motion segment count
+
+    if (single_precision)
+        writer.write(GWatertightTriangleType(v0, v1, v2));
+    else writer.write(GTriangleType(v0, v1, v2));
+}
+
+namespace
+{
+    const size_t MaxIndexedVertexCount = 65536;
+
+    struct VertexIndexLess
+    {
+        const vector<GVector3>& m_vertices;
+
+        explicit VertexIndexLess(const vector<GVector3>& vertices)
+          : m_vertices(vertices)
+        {
+        }
+
+        bool operator()(const size_t lhs, const size_t rhs) const
+        {
+            const GVector3& a = m_vertices[lhs];
+            const GVector3& b = m_vertices[rhs];
+
+            if (a[0] != b[0])
+                return a[0] < b[0];
+
+            if (a[1] != b[1])
+                return a[1] < b[1];
+
+            return a[2] < b[2];
+        }
+    };
+
+    // Build the table of the distinct vertices of a leaf, and find the index
+    // in this table of each vertex of each triangle of the leaf.
+    void build_vertex_table(
+        const vector<GVector3>& leaf_vertices,
+        vector<GVector3>&       vertex_table,
+        vector<size_t>&         vertex_indices)
+    {
+        const size_t vertex_count = leaf_vertices.size();
+
+        vector<size_t> order(vertex_count);
+        for (size_t i = 0; i < vertex_count; ++i)
+            order[i] = i;
+
+        sort(order.begin(), order.end(), VertexIndexLess(leaf_vertices));
+
+        vertex_table.clear();
+        vertex_indices.resize(vertex_count);
+
+        for (size_t i = 0; i < vertex_count; ++i)
+        {
+            const GVector3& vertex = leaf_vertices[order[i]];
+
+            if (vertex_table.empty() || vertex_table.back() != vertex)
+                vertex_table.push_back(vertex);
+
+            vertex_indices[order[i]] = vertex_table.size() - 1;
+        }
+    }
+
+    // Size of an array of uint16, padded to a multiple of 4 bytes.
+    size_t padded_uint16_array_size(const size_t count)
+    {
+        return ((count + 1) & ~size_t(1)) * sizeof(uint16);
+    }
+
+    size_t indexed_size(
+        const size_t            vertex_count,
+        const size_t            triangle_count,
+        const bool              quantized)
+    {
+        size_t size = sizeof(uint32);       // vertex count
+
+        if (quantized)
+        {
+            size += 2 * sizeof(GVector3);   // origin and scale
+            size += padded_uint16_array_size(3 * vertex_count);
+        }
+        else size += vertex_count * sizeof(GVector3);
+
+        size += padded_uint16_array_size(3 * triangle_count);
+
+        return size;
+    }
+
+    void write_padding(const size_t count, MemoryWriter& writer)
+    {
+        if (count & 1)
+            writer.write(static_cast<uint16>(0));
+    }
+}
+
+size_t TriangleEncoder::compute_indexed_size(
+    const vector<GVector3>&             leaf_vertices,
+    const bool                          quantized)
+{
+    assert(leaf_vertices.size() % 3 == 0);
+
+    vector<GVector3> vertex_table;
+    vector<size_t> vertex_indices;
+    build_vertex_table(leaf_vertices, vertex_table, vertex_indices);
+
+    const size_t vertex_count = vertex_table.size();
+
+    if (vertex_count > MaxIndexedVertexCount)
+        return 0;
+
+    return indexed_size(vertex_count, leaf_vertices.size() / 3, quantized);
+}
+
+size_t TriangleEncoder::compute_indexed_size(
+    const uint8*                        leaf_data,
+    const size_t                        triangle_count,
+    const bool                          quantized)
+{
+    const uint32 vertex_count = *reinterpret_cast<const uint32*>(leaf_data);
+
+    return indexed_size(vertex_count, triangle_count, quantized);
+}
+
+void TriangleEncoder::encode_indexed(
+    const vector<GVector3>&             leaf_vertices,
+    const bool                          quantized,
+    MemoryWriter&                       writer)
+{
+    assert(leaf_vertices.size() % 3 == 0);
+
+    vector<GVector3> vertex_table;
+    vector<size_t> vertex_indices;
+    build_vertex_table(leaf_vertices, vertex_table, vertex_indices);
+
+    const size_t vertex_count = vertex_table.size();
+    assert(vertex_count <= MaxIndexedVertexCount);
+
+    writer.write(static_cast<uint32>(vertex_count));
+
+    if (quantized)
+    {
+        // Quantize vertices relative to the bounding box of the leaf.
+        GAABB3 bbox;
+        bbox.invalidate();
+        for (size_t i = 0; i < vertex_count; ++i)
+            bbox.insert(vertex_table[i]);
+
+        const GVector3 origin = vertex_count > 0 ? bbox.min : GVector3(0.0);
+        const GVector3 scale = vertex_count > 0 ? bbox.extent() / GScalar(65535.0) : GVector3(0.0);
+
+        writer.write(origin);
+        writer.write(scale);
+
+        for (size_t i = 0; i < vertex_count; ++i)
+        {
+            for (size_t j = 0; j < 3; ++j)
+            {
+                const GScalar q =
+                    scale[j] > GScalar(0.0)
+                        ? (vertex_table[i][j] - origin[j]) / scale[j]
+                        : GScalar(0.0);
+
+                writer.write(round<uint16>(clamp(q, GScalar(0.0), GScalar(65535.0))));
+            }
+        }
+
+        write_padding(3 * vertex_count, writer);
+    }
+    else
+    {
+        for (size_t i = 0; i < vertex_count; ++i)
+            writer.write(vertex_table[i]);
+    }
+
+    for (size_t i = 0; i < vertex_indices.size(); ++i)
+        writer.write(static_cast<uint16>(vertex_indices[i]));
+
+    write_padding(vertex_indices.size(), writer);
+}
+
 }   // namespace renderer
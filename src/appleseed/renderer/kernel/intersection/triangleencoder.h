@@ -33,6 +33,9 @@
 // appleseed.renderer headers.
 #include "renderer/global/globaltypes.h"
 
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+
 // Standard headers.
 #include <cstddef>
 #include <vector>
@@ -44,14 +47,29 @@ namespace renderer      { class TriangleVertexInfo; }
 namespace renderer
 {
 
+//
+// Encode the triangles of a leaf of a triangle tree. Static triangles are stored
+// as GWatertightTriangleType when single_precision is true, as GTriangleType
+// otherwise.
+//
+
 class TriangleEncoder
 {
   public:
+    // Leaf encodings.
+    enum Encoding
+    {
+        Triangles,      // one self-contained triangle after another
+        Indexed,        // table of distinct vertices followed by 16-bit vertex indices, static triangles only
+        Quantized       // like Indexed, with vertices stored as 16-bit offsets relative to the leaf bounds
+    };
+
     static size_t compute_size(
         const std::vector<TriangleVertexInfo>&  triangle_vertex_infos,
         const std::vector<size_t>&              triangle_indices,
         const size_t                            item_begin,
-        const size_t                            item_count);
+        const size_t                            item_count,
+        const bool                              single_precision);
 
     static void encode(
         const std::vector<TriangleVertexInfo>&  triangle_vertex_infos,
@@ -59,9 +77,138 @@ class TriangleEncoder
         const std::vector<size_t>&              triangle_indices,
         const size_t                            item_begin,
         const size_t                            item_count,
+        const bool                              single_precision,
+        foundation::MemoryWriter&               writer);
+
+    // Encode a single static triangle.
+    static void encode(
+        const GVector3&                         v0,
+        const GVector3&                         v1,
+        const GVector3&                         v2,
+        const bool                              single_precision,
+        foundation::MemoryWriter&               writer);
+
+    // Compute the size of a leaf of static triangles stored with the Indexed (quantized
+    // is false) or Quantized (quantized is true) encoding. leaf_vertices contains three
+    // vertices per triangle. Return 0 if the leaf has too many distinct vertices to be
+    // referenced with 16-bit indices.
+    static size_t compute_indexed_size(
+        const std::vector<GVector3>&            leaf_vertices,
+        const bool                              quantized);
+
+    // Compute the size of a leaf that was encoded with the Indexed or Quantized encoding.
+    static size_t compute_indexed_size(
+        const foundation::uint8*                leaf_data,
+        const size_t                            triangle_count,
+        const bool                              quantized);
+
+    // Encode a leaf of static triangles with the Indexed or Quantized encoding.
+    static void encode_indexed(
+        const std::vector<GVector3>&            leaf_vertices,
+        const bool                              quantized,
         foundation::MemoryWriter&               writer);
 };
 
+
+//
+// Decode, one triangle at a time, the leaves encoded by TriangleEncoder::encode_indexed().
+//
+// Layout of an indexed leaf:
+//
+//   vertex count V             uint32
+//   vertices                   V GVector3 (Indexed encoding)
+//                           or origin and scale as two GVector3, followed by 3 * V uint16 (Quantized encoding)
+//   vertex indices             3 uint16 per triangle
+//
+// Arrays of uint16 are padded to a multiple of 4 bytes.
+//
+
+class IndexedTriangleLeafDecoder
+{
+  public:
+    // Constructor.
+    IndexedTriangleLeafDecoder(
+        const foundation::uint8*                leaf_data,
+        const bool                              quantized);
+
+    // Retrieve the vertices of a given triangle of the leaf.
+    void get_triangle(
+        const size_t                            triangle_index,
+        GVector3&                               v0,
+        GVector3&                               v1,
+        GVector3&                               v2) const;
+
+  private:
+    const bool                                  m_quantized;
+    const GVector3*                             m_vertices;
+    const foundation::uint16*                   m_quantized_vertices;
+    GVector3                                    m_origin;
+    GVector3                                    m_scale;
+    const foundation::uint16*                   m_indices;
+
+    GVector3 get_vertex(const size_t vertex_index) const;
+};
+
+
+//
+// IndexedTriangleLeafDecoder class implementation.
+//
+
+inline IndexedTriangleLeafDecoder::IndexedTriangleLeafDecoder(
+    const foundation::uint8*                    leaf_data,
+    const bool                                  quantized)
+  : m_quantized(quantized)
+{
+    const size_t vertex_count = *reinterpret_cast<const foundation::uint32*>(leaf_data);
+    leaf_data += sizeof(foundation::uint32);
+
+    if (quantized)
+    {
+        m_origin = reinterpret_cast<const GVector3*>(leaf_data)[0];
+        m_scale = reinterpret_cast<const GVector3*>(leaf_data)[1];
+        leaf_data += 2 * sizeof(GVector3);
+
+        m_vertices = 0;
+        m_quantized_vertices = reinterpret_cast<const foundation::uint16*>(leaf_data);
+        leaf_data += ((3 * vertex_count + 1) & ~size_t(1)) * sizeof(foundation::uint16);
+    }
+    else
+    {
+        m_vertices = reinterpret_cast<const GVector3*>(leaf_data);
+        m_quantized_vertices = 0;
+        leaf_data += vertex_count * sizeof(GVector3);
+    }
+
+    m_indices = reinterpret_cast<const foundation::uint16*>(leaf_data);
+}
+
+inline void IndexedTriangleLeafDecoder::get_triangle(
+    const size_t                                triangle_index,
+    GVector3&                                   v0,
+    GVector3&                                   v1,
+    GVector3&                                   v2) const
+{
+    const foundation::uint16* indices = m_indices + triangle_index * 3;
+
+    v0 = get_vertex(indices[0]);
+    v1 = get_vertex(indices[1]);
+    v2 = get_vertex(indices[2]);
+}
+
+inline GVector3 IndexedTriangleLeafDecoder::get_vertex(const size_t vertex_index) const
+{
+    if (!m_quantized)
+        return m_vertices[vertex_index];
+
+    const foundation::uint16* q = m_quantized_vertices + vertex_index * 3;
+
+    return
+        GVector3(
+            m_origin[0] + static_cast<GScalar>(q[0]) * m_scale[0],
+            m_origin[1] + static_cast<GScalar>(q[1]) * m_scale[1],
+            m_origin[2] + static_cast<GScalar>(q[2]) * m_scale[2]);
+}
+
 }       // namespace renderer
 
 #endif  // !APPLESEED_RENDERER_KERNEL_INTERSECTION_TRIANGLEENCODER_H
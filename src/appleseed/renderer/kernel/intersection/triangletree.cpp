@@ -38,6 +38,7 @@
 #include "renderer/kernel/tessellation/statictessellation.h"
 #include "renderer/kernel/texturing/texturecache.h"
 #include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/entity/entity.h"
 #include "renderer/modeling/material/material.h"
 #include "renderer/modeling/object/iregion.h"
 #include "renderer/modeling/object/object.h"
@@ -46,25 +47,39 @@
 #include "renderer/modeling/scene/assembly.h"
 #include "renderer/modeling/scene/containers.h"
 #include "renderer/modeling/scene/objectinstance.h"
+#include "renderer/modeling/scene/scene.h"
 #include "renderer/utility/bbox.h"
 #include "renderer/utility/messagecontext.h"
 #include "renderer/utility/paramarray.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/appleseed.h"
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/math/area.h"
 #include "foundation/math/permutation.h"
 #include "foundation/math/treeoptimizer.h"
 #include "foundation/platform/system.h"
+#include "foundation/platform/thread.h"
 #include "foundation/platform/timer.h"
+#include "foundation/utility/bufferedfile.h"
+#include "foundation/utility/foreach.h"
+#include "foundation/utility/lazy.h"
 #include "foundation/utility/makevector.h"
 #include "foundation/utility/memory.h"
+#include "foundation/utility/siphash.h"
 #include "foundation/utility/statistics.h"
 #include "foundation/utility/stopwatch.h"
 
+// boost headers.
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
 // Standard headers.
 #include <algorithm>
 #include <cassert>
+#include <iomanip>
 #include <set>
+#include <sstream>
 #include <string>
 
 using namespace foundation;
@@ -398,27 +413,105 @@ TriangleTree::TriangleTree(const Arguments& arguments)
     const MessageContext message_context(
         string("while building triangle tree for assembly \"") + m_arguments.m_assembly.get_name() + "\"");
     const ParamArray& params = m_arguments.m_assembly.get_parameters().child("acceleration_structure");
-    const string algorithm = params.get_optional<string>("algorithm", "bvh", make_vector("bvh", "sbvh"), message_context);
+    const string algorithm = params.get_optional<string>("algorithm", "bvh", make_vector("bvh", "binned_bvh", "sbvh"), message_context);
     const double time = params.get_optional<double>("time", 0.5);
     const bool save_memory = params.get_optional<bool>("save_temporary_memory", false);
+    m_node_width = params.get_optional<size_t>("node_width", TriangleTreeDefaultNodeWidth, make_vector("2", "4", "8"), message_context);
+
+    // Single precision may be enabled for the whole scene and overridden per assembly.
+    const bool scene_single_precision =
+        m_arguments.m_scene.get_parameters().child("acceleration_structure").get_optional<bool>(
+            "single_precision",
+            TriangleTreeDefaultSinglePrecision);
+    m_single_precision = params.get_optional<bool>("single_precision", scene_single_precision);
+
+    // Leaves may store static triangles as a table of shared vertices.
+    const string leaf_encoding =
+        params.get_optional<string>(
+            "leaf_encoding",
+            "triangles",
+            make_vector("triangles", "indexed", "quantized"),
+            message_context);
+    m_leaf_encoding =
+        leaf_encoding == "indexed" ? TriangleEncoder::Indexed :
+        leaf_encoding == "quantized" ? TriangleEncoder::Quantized :
+        TriangleEncoder::Triangles;
+
+    m_build_params = params;
+
+    // Built trees may be cached on disk for the whole scene.
+    const string cache_directory =
+        m_arguments.m_scene.get_parameters().child("acceleration_structure").get_optional<string>(
+            "cache_directory",
+            "");
 
     // Start stopwatch.
     Stopwatch<DefaultWallclockTimer> stopwatch;
     stopwatch.start();
 
-    // Build the tree.
+    // Look for this tree in the cache.
     Statistics statistics;
-    if (algorithm == "bvh")
-        build_bvh(params, time, save_memory, statistics);
-    else build_sbvh(params, time, save_memory, statistics);
+    string cache_filepath;
+    uint64 cache_key = 0;
+    bool loaded_from_cache = false;
+    if (!cache_directory.empty())
+    {
+        cache_key = compute_cache_key(params, algorithm, time, save_memory);
+        cache_filepath = make_cache_filepath(cache_directory, cache_key);
+        loaded_from_cache = load_from_cache(cache_filepath, cache_key);
+        statistics.insert<string>("cache", loaded_from_cache ? "hit" : "miss");
+    }
+
+    if (!loaded_from_cache)
+    {
+        // Build the tree.
+        if (algorithm == "sbvh")
+            build_sbvh(params, time, save_memory, statistics);
+        else build_bvh(params, time, save_memory, algorithm == "binned_bvh", statistics);
 
 #ifdef RENDERER_TRIANGLE_TREE_REORDER_NODES
-    // Optimize the tree layout in memory.
-    TreeOptimizer<NodeVectorType> tree_optimizer(m_nodes);
-    tree_optimizer.optimize_node_layout(TriangleTreeSubtreeDepth);
-    assert(m_nodes.size() == m_nodes.capacity());
+        // Optimize the tree layout in memory.
+        TreeOptimizer<NodeVectorType> tree_optimizer(m_nodes);
+        tree_optimizer.optimize_node_layout(TriangleTreeSubtreeDepth);
+        assert(m_nodes.size() == m_nodes.capacity());
 #endif
 
+        // Store the tree in the cache.
+        if (!cache_filepath.empty())
+            save_to_cache(cache_filepath, cache_key);
+    }
+
+    // Remember the topology and the quality of the tree, to decide later whether it can be refitted.
+    m_topology_signature = compute_topology_signature();
+    m_sah_cost = compute_sah_cost();
+    statistics.insert("sah cost", m_sah_cost);
+
+    // Collapse the tree into a wide tree. Trees with moving triangles are kept binary.
+    if (m_node_width > 2 && m_moving_triangle_count > 0)
+    {
+        RENDERER_LOG_DEBUG(
+            "triangle tree #" FMT_UNIQUE_ID " contains moving triangles, using binary nodes.",
+            m_arguments.m_triangle_tree_uid);
+        m_node_width = 2;
+    }
+    if (m_node_width == 4)
+    {
+        m_wide4_tree.collapse(*this);
+        statistics.insert("wide nodes", m_wide4_tree.get_node_count());
+    }
+    else if (m_node_width == 8)
+    {
+        m_wide8_tree.collapse(*this);
+        statistics.insert("wide nodes", m_wide8_tree.get_node_count());
+    }
+    statistics.insert("node width", m_node_width);
+    statistics.insert<string>("precision", m_single_precision ? "single" : "double");
+    statistics.insert<string>(
+        "leaf encoding",
+        m_leaf_encoding == TriangleEncoder::Indexed ? "indexed" :
+        m_leaf_encoding == TriangleEncoder::Quantized ? "quantized" :
+        "triangles");
+
     // Print triangle tree statistics.
     statistics.insert_size("nodes alignment", alignment(&m_nodes[0]));
     statistics.insert_time("total time", stopwatch.measure().get_seconds());
@@ -455,6 +548,8 @@ size_t TriangleTree::get_memory_size() const
           TreeType::get_memory_size()
         - sizeof(*static_cast<const TreeType*>(this))
         + sizeof(*this)
+        + m_wide4_tree.get_memory_size() - sizeof(m_wide4_tree)
+        + m_wide8_tree.get_memory_size() - sizeof(m_wide8_tree)
         + m_triangle_keys.capacity() * sizeof(TriangleKey)
         + m_leaf_data.capacity() * sizeof(uint8);
 }
@@ -494,65 +589,25 @@ namespace
     }
 }
 
-void TriangleTree::build_bvh(
-    const ParamArray&   params,
-    const double        time,
-    const bool          save_memory,
-    Statistics&         statistics)
+template <typename Partitioner>
+void TriangleTree::build_bvh_tree(
+    Partitioner&                        partitioner,
+    const vector<TriangleKey>&          triangle_keys,
+    const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+    vector<GAABB3>&                     triangle_bboxes,
+    const double                        time,
+    const bool                          save_memory,
+    const size_t                        max_leaf_size,
+    const size_t                        build_thread_count,
+    const double                        collection_time,
+    Statistics&                         statistics)
 {
     Stopwatch<DefaultWallclockTimer> stopwatch;
 
-    // Collect triangles intersecting the bounding box of this tree.
-    RENDERER_LOG_INFO(
-        "collecting geometry for triangle tree #" FMT_UNIQUE_ID " from assembly \"%s\" (%s %s)...",
-        m_arguments.m_triangle_tree_uid,
-        m_arguments.m_assembly.get_name(),
-        pretty_uint(m_arguments.m_regions.size()).c_str(),
-        plural(m_arguments.m_regions.size(), "region").c_str());
-    stopwatch.start();
-    vector<TriangleKey> triangle_keys;
-    vector<TriangleVertexInfo> triangle_vertex_infos;
-    vector<GAABB3> triangle_bboxes;
-    collect_triangles(
-        m_arguments,
-        time,
-        save_memory,
-        &triangle_keys,
-        &triangle_vertex_infos,
-        0,
-        &triangle_bboxes);
-    const double collection_time = stopwatch.measure().get_seconds();
-
-    // Store the number of static and moving triangles.
-    m_static_triangle_count = count_static_triangles(triangle_vertex_infos);
-    m_moving_triangle_count = triangle_vertex_infos.size() - m_static_triangle_count;
-
-    // Print statistics about the input geometry.
-    RENDERER_LOG_INFO(
-        "building triangle tree #" FMT_UNIQUE_ID " (bvh, %s %s, %s %s)...",
-        m_arguments.m_triangle_tree_uid,
-        pretty_uint(m_static_triangle_count).c_str(),
-        plural(m_static_triangle_count, "static triangle").c_str(),
-        pretty_uint(m_moving_triangle_count).c_str(),
-        plural(m_moving_triangle_count, "moving triangle").c_str());
-
-    // Retrieving the partitioner parameters.
-    const size_t max_leaf_size = params.get_optional<size_t>("max_leaf_size", TriangleTreeDefaultMaxLeafSize);
-    const GScalar interior_node_traversal_cost = params.get_optional<GScalar>("interior_node_traversal_cost", TriangleTreeDefaultInteriorNodeTraversalCost);
-    const GScalar triangle_intersection_cost = params.get_optional<GScalar>("triangle_intersection_cost", TriangleTreeDefaultTriangleIntersectionCost);
-
-    // Create the partitioner.
-    typedef bvh::SAHPartitioner<vector<GAABB3> > Partitioner;
-    Partitioner partitioner(
-        triangle_bboxes,
-        max_leaf_size,
-        interior_node_traversal_cost,
-        triangle_intersection_cost);
-
     // Build the tree.
-    typedef bvh::Builder<TriangleTree, Partitioner> Builder;
-    Builder builder;
-    builder.build<DefaultWallclockTimer>(
+    typedef bvh::ParallelBuilder<TriangleTree, Partitioner> Builder;
+    Builder builder(global_logger(), build_thread_count);
+    builder.template build<DefaultWallclockTimer>(
         *this,
         partitioner,
         triangle_keys.size(),
@@ -598,6 +653,106 @@ void TriangleTree::build_bvh(
     statistics.insert_time("store time", storing_time);
 }
 
+void TriangleTree::build_bvh(
+    const ParamArray&   params,
+    const double        time,
+    const bool          save_memory,
+    const bool          binned,
+    Statistics&         statistics)
+{
+    Stopwatch<DefaultWallclockTimer> stopwatch;
+
+    // Collect triangles intersecting the bounding box of this tree.
+    RENDERER_LOG_INFO(
+        "collecting geometry for triangle tree #" FMT_UNIQUE_ID " from assembly \"%s\" (%s %s)...",
+        m_arguments.m_triangle_tree_uid,
+        m_arguments.m_assembly.get_name(),
+        pretty_uint(m_arguments.m_regions.size()).c_str(),
+        plural(m_arguments.m_regions.size(), "region").c_str());
+    stopwatch.start();
+    vector<TriangleKey> triangle_keys;
+    vector<TriangleVertexInfo> triangle_vertex_infos;
+    vector<GAABB3> triangle_bboxes;
+    collect_triangles(
+        m_arguments,
+        time,
+        save_memory,
+        &triangle_keys,
+        &triangle_vertex_infos,
+        0,
+        &triangle_bboxes);
+    const double collection_time = stopwatch.measure().get_seconds();
+
+    // Store the number of static and moving triangles.
+    m_static_triangle_count = count_static_triangles(triangle_vertex_infos);
+    m_moving_triangle_count = triangle_vertex_infos.size() - m_static_triangle_count;
+
+    // Print statistics about the input geometry.
+    RENDERER_LOG_INFO(
+        "building triangle tree #" FMT_UNIQUE_ID " (%s, %s %s, %s %s)...",
+        m_arguments.m_triangle_tree_uid,
+        binned ? "binned bvh" : "bvh",
+        pretty_uint(m_static_triangle_count).c_str(),
+        plural(m_static_triangle_count, "static triangle").c_str(),
+        pretty_uint(m_moving_triangle_count).c_str(),
+        plural(m_moving_triangle_count, "moving triangle").c_str());
+
+    // Retrieving the partitioner parameters.
+    const size_t max_leaf_size = params.get_optional<size_t>("max_leaf_size", TriangleTreeDefaultMaxLeafSize);
+    const size_t bin_count = params.get_optional<size_t>("bin_count", TriangleTreeDefaultBinnedBVHBinCount);
+    const GScalar interior_node_traversal_cost = params.get_optional<GScalar>("interior_node_traversal_cost", TriangleTreeDefaultInteriorNodeTraversalCost);
+    const GScalar triangle_intersection_cost = params.get_optional<GScalar>("triangle_intersection_cost", TriangleTreeDefaultTriangleIntersectionCost);
+    const size_t build_thread_count = params.get_optional<size_t>("build_threads", System::get_logical_cpu_core_count());
+
+    if (binned)
+    {
+        // Create the partitioner.
+        typedef bvh::BinnedSAHPartitioner<vector<GAABB3> > Partitioner;
+        Partitioner partitioner(
+            triangle_bboxes,
+            max_leaf_size,
+            bin_count,
+            interior_node_traversal_cost,
+            triangle_intersection_cost);
+
+        // Build the tree.
+        build_bvh_tree(
+            partitioner,
+            triangle_keys,
+            triangle_vertex_infos,
+            triangle_bboxes,
+            time,
+            save_memory,
+            max_leaf_size,
+            build_thread_count,
+            collection_time,
+            statistics);
+    }
+    else
+    {
+        // Create the partitioner.
+        typedef bvh::SAHPartitioner<vector<GAABB3> > Partitioner;
+        Partitioner partitioner(
+            triangle_bboxes,
+            max_leaf_size,
+            interior_node_traversal_cost,
+            triangle_intersection_cost);
+
+        // Build the tree.
+        build_bvh_tree(
+            partitioner,
+            triangle_keys,
+            triangle_vertex_infos,
+            triangle_bboxes,
+            time,
+            save_memory,
+            max_leaf_size,
+            build_thread_count,
+            collection_time,
+            statistics);
+    }
+}
+
 void TriangleTree::build_sbvh(
     const ParamArray&   params,
     const double        time,
@@ -879,6 +1034,106 @@ vector<GAABB3> TriangleTree::compute_motion_bboxes(
     }
 }
 
+namespace
+{
+    void gather_leaf_vertices(
+        const vector<size_t>&               triangle_indices,
+        const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+        const vector<GVector3>&             triangle_vertices,
+        const size_t                        item_begin,
+        const size_t                        item_count,
+        vector<GVector3>&                   leaf_vertices)
+    {
+        leaf_vertices.clear();
+
+        for (size_t i = 0; i < item_count; ++i)
+        {
+            const size_t triangle_index = triangle_indices[item_begin + i];
+            const TriangleVertexInfo& vertex_info = triangle_vertex_infos[triangle_index];
+
+            assert(vertex_info.m_motion_segment_count == 0);
+
+            leaf_vertices.push_back(triangle_vertices[vertex_info.m_vertex_index + 0]);
+            leaf_vertices.push_back(triangle_vertices[vertex_info.m_vertex_index + 1]);
+            leaf_vertices.push_back(triangle_vertices[vertex_info.m_vertex_index + 2]);
+        }
+    }
+
+    size_t compute_leaf_size(
+        const TriangleEncoder::Encoding     leaf_encoding,
+        const bool                          single_precision,
+        const vector<size_t>&               triangle_indices,
+        const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+        const vector<GVector3>&             triangle_vertices,
+        const size_t                        item_begin,
+        const size_t                        item_count,
+        vector<GVector3>&                   leaf_vertices)
+    {
+        if (leaf_encoding == TriangleEncoder::Triangles)
+        {
+            return
+                TriangleEncoder::compute_size(
+                    triangle_vertex_infos,
+                    triangle_indices,
+                    item_begin,
+                    item_count,
+                    single_precision);
+        }
+
+        gather_leaf_vertices(
+            triangle_indices,
+            triangle_vertex_infos,
+            triangle_vertices,
+            item_begin,
+            item_count,
+            leaf_vertices);
+
+        return
+            TriangleEncoder::compute_indexed_size(
+                leaf_vertices,
+                leaf_encoding == TriangleEncoder::Quantized);
+    }
+
+    void encode_leaf(
+        const TriangleEncoder::Encoding     leaf_encoding,
+        const bool                          single_precision,
+        const vector<size_t>&               triangle_indices,
+        const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+        const vector<GVector3>&             triangle_vertices,
+        const size_t                        item_begin,
+        const size_t                        item_count,
+        vector<GVector3>&                   leaf_vertices,
+        MemoryWriter&                       writer)
+    {
+        if (leaf_encoding == TriangleEncoder::Triangles)
+        {
+            TriangleEncoder::encode(
+                triangle_vertex_infos,
+                triangle_vertices,
+                triangle_indices,
+                item_begin,
+                item_count,
+                single_precision,
+                writer);
+        }
+        else
+        {
+            gather_leaf_vertices(
+                triangle_indices,
+                triangle_vertex_infos,
+                triangle_vertices,
+                item_begin,
+                item_count,
+                leaf_vertices);
+
+            TriangleEncoder::encode_indexed(
+                leaf_vertices,
+                leaf_encoding == TriangleEncoder::Quantized,
+                writer);
+        }
+    }
+}
+
 void TriangleTree::store_triangles(
     const vector<size_t>&               triangle_indices,
     const vector<TriangleVertexInfo>&   triangle_vertex_infos,
@@ -888,6 +1143,42 @@ void TriangleTree::store_triangles(
 {
     const size_t node_count = m_nodes.size();
 
+    vector<GVector3> leaf_vertices;
+
+    // Indexed leaves only store static triangles, and at most 65536 distinct vertices.
+    if (m_leaf_encoding != TriangleEncoder::Triangles)
+    {
+        if (m_moving_triangle_count > 0)
+        {
+            RENDERER_LOG_DEBUG(
+                "triangle tree #" FMT_UNIQUE_ID " contains moving triangles, using triangle leaves.",
+                m_arguments.m_triangle_tree_uid);
+            m_leaf_encoding = TriangleEncoder::Triangles;
+        }
+
+        for (size_t i = 0; i < node_count && m_leaf_encoding != TriangleEncoder::Triangles; ++i)
+        {
+            const NodeType& node = m_nodes[i];
+
+            if (node.is_leaf() &&
+                compute_leaf_size(
+                    m_leaf_encoding,
+                    m_single_precision,
+                    triangle_indices,
+                    triangle_vertex_infos,
+                    triangle_vertices,
+                    node.get_item_index(),
+                    node.get_item_count(),
+                    leaf_vertices) == 0)
+            {
+                RENDERER_LOG_DEBUG(
+                    "triangle tree #" FMT_UNIQUE_ID " has leaves with too many vertices, using triangle leaves.",
+                    m_arguments.m_triangle_tree_uid);
+                m_leaf_encoding = TriangleEncoder::Triangles;
+            }
+        }
+    }
+
     // Gather statistics.
 
     size_t leaf_count = 0;
@@ -906,13 +1197,17 @@ void TriangleTree::store_triangles(
             const size_t item_count = node.get_item_count();
 
             const size_t leaf_size =
-                TriangleEncoder::compute_size(
-                    triangle_vertex_infos,
+                compute_leaf_size(
+                    m_leaf_encoding,
+                    m_single_precision,
                     triangle_indices,
+                    triangle_vertex_infos,
+                    triangle_vertices,
                     item_begin,
-                    item_count);
+                    item_count,
+                    leaf_vertices);
 
-            if (leaf_size < NodeType::MaxUserDataSize)
+            if (leaf_size <= NodeType::MaxUserDataSize - 4)
                 ++fat_leaf_count;
             else leaf_data_size += leaf_size;
         }
@@ -943,11 +1238,15 @@ void TriangleTree::store_triangles(
             }
 
             const size_t leaf_size =
-                TriangleEncoder::compute_size(
-                    triangle_vertex_infos,
+                compute_leaf_size(
+                    m_leaf_encoding,
+                    m_single_precision,
                     triangle_indices,
+                    triangle_vertex_infos,
+                    triangle_vertices,
                     item_begin,
-                    item_count);
+                    item_count,
+                    leaf_vertices);
 
             MemoryWriter user_data_writer(&node.get_user_data<uint8>());
 
@@ -955,30 +1254,596 @@ void TriangleTree::store_triangles(
             {
                 user_data_writer.write<uint32>(~0);
 
-                TriangleEncoder::encode(
+                encode_leaf(
+                    m_leaf_encoding,
+                    m_single_precision,
+                    triangle_indices,
                     triangle_vertex_infos,
                     triangle_vertices,
-                    triangle_indices,
                     item_begin,
                     item_count,
+                    leaf_vertices,
                     user_data_writer);
             }
             else
             {
                 user_data_writer.write(static_cast<uint32>(leaf_data_writer.offset()));
 
-                TriangleEncoder::encode(
+                encode_leaf(
+                    m_leaf_encoding,
+                    m_single_precision,
+                    triangle_indices,
                     triangle_vertex_infos,
                     triangle_vertices,
-                    triangle_indices,
                     item_begin,
                     item_count,
+                    leaf_vertices,
                     leaf_data_writer);
             }
         }
     }
 
     statistics.insert_percent("fat leaves", fat_leaf_count, leaf_count);
+    statistics.insert_size("leaf data", leaf_data_size);
+}
+
+namespace
+{
+    //
+    // Layout of a cached triangle tree file:
+    //
+    //   magic number               uint32
+    //   format version             uint32
+    //   cache key                  uint64
+    //   static triangle count      uint64
+    //   moving triangle count      uint64
+    //   leaf encoding              uint32
+    //   nodes                      uint64 count, followed by the nodes
+    //   node bounding boxes        uint64 count, followed by the bounding boxes
+    //   triangle keys              uint64 count, followed by the keys
+    //   leaf data                  uint64 count, followed by the bytes
+    //
+    // Cached files are only meant to be read back by the same build of appleseed
+    // on the same machine: the library version and the size of the nodes are part
+    // of the cache key, and all data is stored in native byte order.
+    //
+
+    const uint32 TriangleTreeCacheMagicNumber = 0x43545341;     // 'ASTC' in little endian
+    const uint32 TriangleTreeCacheFormatVersion = 2;
+
+    template <typename T>
+    uint64 hash_vector(const vector<T>& vec)
+    {
+        return vec.empty() ? 0 : siphash24(&vec[0], vec.size() * sizeof(T));
+    }
+
+    uint64 hash_string(const string& s)
+    {
+        return siphash24(s.c_str(), s.size());
+    }
+
+    template <typename Vector>
+    bool write_vector(BufferedFile& file, const Vector& vec)
+    {
+        const uint64 count = vec.size();
+        if (file.write(count) != sizeof(count))
+            return false;
+
+        const size_t size = vec.size() * sizeof(typename Vector::value_type);
+        return size == 0 || file.write(&vec[0], size) == size;
+    }
+
+    template <typename Vector>
+    bool read_vector(BufferedFile& file, const int64 file_size, Vector& vec)
+    {
+        uint64 count;
+        if (file.read(count) != sizeof(count))
+            return false;
+
+        // Don't trust the element count of a truncated or corrupted file.
+        if (count > static_cast<uint64>(file_size) / sizeof(typename Vector::value_type))
+            return false;
+
+        vec.resize(static_cast<size_t>(count));
+
+        const size_t size = vec.size() * sizeof(typename Vector::value_type);
+        return size == 0 || file.read(&vec[0], size) == size;
+    }
+}
+
+uint64 TriangleTree::compute_cache_key(
+    const ParamArray&   params,
+    const string&       algorithm,
+    const double        time,
+    const bool          save_memory) const
+{
+    // Collect the tessellation exactly as the builders would see it.
+    vector<TriangleKey> triangle_keys;
+    vector<TriangleVertexInfo> triangle_vertex_infos;
+    vector<GVector3> triangle_vertices;
+    collect_triangles<GAABB3>(
+        m_arguments,
+        time,
+        save_memory,
+        &triangle_keys,
+        &triangle_vertex_infos,
+        &triangle_vertices,
+        0);
+
+    // Gather the build parameters.
+    const double build_params[] =
+    {
+        static_cast<double>(TriangleTreeCacheFormatVersion),
+        static_cast<double>(sizeof(NodeType)),
+#ifdef RENDERER_TRIANGLE_TREE_REORDER_NODES
+        static_cast<double>(TriangleTreeSubtreeDepth),
+#else
+        0.0,
+#endif
+        time,
+        static_cast<double>(params.get_optional<size_t>("max_leaf_size", TriangleTreeDefaultMaxLeafSize)),
+        static_cast<double>(params.get_optional<size_t>("bin_count", TriangleTreeDefaultBinCount)),
+        static_cast<double>(params.get_optional<GScalar>("interior_node_traversal_cost", TriangleTreeDefaultInteriorNodeTraversalCost)),
+        static_cast<double>(params.get_optional<GScalar>("triangle_intersection_cost", TriangleTreeDefaultTriangleIntersectionCost)),
+        m_single_precision ? 1.0 : 0.0,
+        static_cast<double>(m_leaf_encoding),
+        m_arguments.m_bbox.min[0],
+        m_arguments.m_bbox.min[1],
+        m_arguments.m_bbox.min[2],
+        m_arguments.m_bbox.max[0],
+        m_arguments.m_bbox.max[1],
+        m_arguments.m_bbox.max[2]
+    };
+
+    uint64 key = hash_string(Appleseed::get_lib_version());
+    key = Entity::combine_signatures(key, hash_string(algorithm));
+    key = Entity::combine_signatures(key, siphash24(build_params, sizeof(build_params)));
+    key = Entity::combine_signatures(key, hash_vector(triangle_keys));
+    key = Entity::combine_signatures(key, hash_vector(triangle_vertex_infos));
+    key = Entity::combine_signatures(key, hash_vector(triangle_vertices));
+
+    return key;
+}
+
+string TriangleTree::make_cache_filepath(
+    const string&       cache_directory,
+    const uint64        cache_key)
+{
+    stringstream sstr;
+    sstr << hex << setw(16) << setfill('0') << cache_key << ".tree";
+
+    return (boost::filesystem::path(cache_directory) / sstr.str()).string();
+}
+
+bool TriangleTree::load_from_cache(
+    const string&       filepath,
+    const uint64        cache_key)
+{
+    BufferedFile file;
+    if (!file.open(filepath.c_str(), BufferedFile::BinaryType, BufferedFile::ReadMode))
+        return false;
+
+    file.seek(0, BufferedFile::SeekFromEnd);
+    const int64 file_size = file.tell();
+    file.seek(0, BufferedFile::SeekFromBeginning);
+
+    uint32 magic_number, format_version, leaf_encoding;
+    uint64 key, static_triangle_count, moving_triangle_count;
+
+    const bool success =
+        file.read(magic_number) == sizeof(magic_number) &&
+        magic_number == TriangleTreeCacheMagicNumber &&
+        file.read(format_version) == sizeof(format_version) &&
+        format_version == TriangleTreeCacheFormatVersion &&
+        file.read(key) == sizeof(key) &&
+        key == cache_key &&
+        file.read(static_triangle_count) == sizeof(static_triangle_count) &&
+        file.read(moving_triangle_count) == sizeof(moving_triangle_count) &&
+        file.read(leaf_encoding) == sizeof(leaf_encoding) &&
+        leaf_encoding <= TriangleEncoder::Quantized &&
+        read_vector(file, file_size, m_nodes) &&
+        read_vector(file, file_size, m_node_bboxes) &&
+        read_vector(file, file_size, m_triangle_keys) &&
+        read_vector(file, file_size, m_leaf_data) &&
+        !m_nodes.empty();
+
+    if (!success)
+    {
+        RENDERER_LOG_WARNING(
+            "ignoring invalid cached triangle tree file %s.",
+            filepath.c_str());
+
+        clear_release_memory(m_nodes);
+        clear_release_memory(m_node_bboxes);
+        clear_release_memory(m_triangle_keys);
+        clear_release_memory(m_leaf_data);
+
+        return false;
+    }
+
+    m_static_triangle_count = static_cast<size_t>(static_triangle_count);
+    m_moving_triangle_count = static_cast<size_t>(moving_triangle_count);
+    m_leaf_encoding = static_cast<TriangleEncoder::Encoding>(leaf_encoding);
+
+    RENDERER_LOG_INFO(
+        "loaded triangle tree #" FMT_UNIQUE_ID " from %s (%s %s, %s %s).",
+        m_arguments.m_triangle_tree_uid,
+        filepath.c_str(),
+        pretty_uint(m_static_triangle_count).c_str(),
+        plural(m_static_triangle_count, "static triangle").c_str(),
+        pretty_uint(m_moving_triangle_count).c_str(),
+        plural(m_moving_triangle_count, "moving triangle").c_str());
+
+    return true;
+}
+
+void TriangleTree::save_to_cache(
+    const string&       filepath,
+    const uint64        cache_key) const
+{
+    const boost::filesystem::path path(filepath);
+
+    // Write to a temporary file first, so that concurrent renders never read a partial file.
+    const boost::filesystem::path temp_path(
+        filepath + "." + to_string(m_arguments.m_triangle_tree_uid) + ".tmp");
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(path.parent_path(), ec);
+
+    BufferedFile file;
+    bool success =
+        file.open(temp_path.string().c_str(), BufferedFile::BinaryType, BufferedFile::WriteMode);
+
+    if (success)
+    {
+        const uint64 static_triangle_count = m_static_triangle_count;
+        const uint64 moving_triangle_count = m_moving_triangle_count;
+        const uint32 leaf_encoding = m_leaf_encoding;
+
+        success =
+            file.write(TriangleTreeCacheMagicNumber) == sizeof(TriangleTreeCacheMagicNumber) &&
+            file.write(TriangleTreeCacheFormatVersion) == sizeof(TriangleTreeCacheFormatVersion) &&
+            file.write(cache_key) == sizeof(cache_key) &&
+            file.write(static_triangle_count) == sizeof(static_triangle_count) &&
+            file.write(moving_triangle_count) == sizeof(moving_triangle_count) &&
+            file.write(leaf_encoding) == sizeof(leaf_encoding) &&
+            write_vector(file, m_nodes) &&
+            write_vector(file, m_node_bboxes) &&
+            write_vector(file, m_triangle_keys) &&
+            write_vector(file, m_leaf_data);
+
+        success = file.close() && success;
+    }
+
+    if (success)
+    {
+        boost::filesystem::rename(temp_path, path, ec);
+        success = !ec;
+    }
+
+    if (!success)
+    {
+        boost::filesystem::remove(temp_path, ec);
+
+        RENDERER_LOG_WARNING(
+            "failed to write cached triangle tree file %s.",
+            filepath.c_str());
+    }
+}
+
+namespace
+{
+    //
+    // Updates the leaves of a triangle tree from the current tessellations of its assembly.
+    //
+
+    class TriangleLeafRefitter
+      : public NonCopyable
+    {
+      public:
+        TriangleLeafRefitter(
+            const Assembly&                 assembly,
+            const vector<TriangleKey>&      triangle_keys,
+            vector<uint8>&                  leaf_data,
+            const bool                      single_precision,
+            const TriangleEncoder::Encoding leaf_encoding)
+          : m_triangle_keys(triangle_keys)
+          , m_leaf_data(leaf_data)
+          , m_single_precision(single_precision)
+          , m_leaf_encoding(leaf_encoding)
+        {
+            boost_atomic::atomic_write32(&m_leaf_size_changed, 0);
+
+            const ObjectInstanceContainer& object_instances = assembly.object_instances();
+            const size_t object_instance_count = object_instances.size();
+
+            m_transforms.reserve(object_instance_count);
+            m_first_tess.reserve(object_instance_count);
+            m_region_kits.reserve(object_instance_count);
+
+            for (size_t i = 0; i < object_instance_count; ++i)
+            {
+                const ObjectInstance* object_instance = object_instances.get_by_index(i);
+                assert(object_instance);
+
+                m_transforms.push_back(&object_instance->get_transform());
+                m_first_tess.push_back(m_tess.size());
+
+                // Keep the region kit and the tessellations alive while refitting.
+                m_region_kits.push_back(Access<RegionKit>(&object_instance->get_object().get_region_kit()));
+                const RegionKit& region_kit = m_region_kits.back().ref();
+
+                for (size_t j = 0; j < region_kit.size(); ++j)
+                    m_tess.push_back(Access<StaticTriangleTess>(&region_kit[j]->get_static_triangle_tess()));
+            }
+        }
+
+        // Return true if all the triangles that are not referenced by the tree are degenerate.
+        bool has_only_degenerate_unreferenced_triangles() const
+        {
+            // Flag the triangles referenced by the tree.
+            vector<vector<bool> > referenced(m_tess.size());
+            for (size_t i = 0; i < m_tess.size(); ++i)
+                referenced[i].resize(m_tess[i]->m_primitives.size(), false);
+            for (const_each<vector<TriangleKey> > i = m_triangle_keys; i; ++i)
+                referenced[get_tess_index(*i)][i->get_triangle_index()] = true;
+
+            for (size_t i = 0; i < m_transforms.size(); ++i)
+            {
+                const size_t tess_end = i + 1 < m_first_tess.size() ? m_first_tess[i + 1] : m_tess.size();
+
+                for (size_t j = m_first_tess[i]; j < tess_end; ++j)
+                {
+                    const StaticTriangleTess& tess = m_tess[j].ref();
+
+                    for (size_t k = 0; k < tess.m_primitives.size(); ++k)
+                    {
+                        if (referenced[j][k])
+                            continue;
+
+                        // Degenerate triangles are not stored in the tree, see collect_static_triangles().
+                        const Triangle& triangle = tess.m_primitives[k];
+                        const GVector3& v0_os = tess.m_vertices[triangle.m_v0];
+                        const GVector3& v1_os = tess.m_vertices[triangle.m_v1];
+                        const GVector3& v2_os = tess.m_vertices[triangle.m_v2];
+                        if (square_area(v0_os, v1_os, v2_os) == GScalar(0.0))
+                            continue;
+
+                        const Transformd& transform = *m_transforms[i];
+                        const GVector3 v0 = transform.point_to_parent(v0_os);
+                        const GVector3 v1 = transform.point_to_parent(v1_os);
+                        const GVector3 v2 = transform.point_to_parent(v2_os);
+                        if (square_area(v0, v1, v2) != GScalar(0.0))
+                            return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        // Return true if the vertices of an indexed leaf no longer fit in the space of the leaf,
+        // for instance when vertices that used to coincide moved apart.
+        bool has_leaf_size_changed() const
+        {
+            return boost_atomic::atomic_read32(&m_leaf_size_changed) == 1;
+        }
+
+        AABB3d refit(TriangleTree::NodeType& node) const
+        {
+            const size_t item_begin = node.get_item_index();
+            const size_t item_count = node.get_item_count();
+
+            // Find where the triangles of this leaf are stored, see TriangleTree::store_triangles().
+            uint8* user_data = &node.get_user_data<uint8>();
+            const uint32 leaf_data_index = *reinterpret_cast<const uint32*>(user_data);
+            uint8* leaf_data =
+                leaf_data_index == ~uint32(0)
+                    ? user_data + sizeof(uint32)
+                    : &m_leaf_data[leaf_data_index];
+            MemoryWriter writer(leaf_data);
+
+            GAABB3 bbox;
+            bbox.invalidate();
+
+            if (m_leaf_encoding != TriangleEncoder::Triangles)
+            {
+                vector<GVector3> leaf_vertices;
+                leaf_vertices.reserve(item_count * 3);
+
+                for (size_t i = 0; i < item_count; ++i)
+                {
+                    GVector3 v0, v1, v2;
+                    get_triangle_vertices(m_triangle_keys[item_begin + i], v0, v1, v2);
+
+                    leaf_vertices.push_back(v0);
+                    leaf_vertices.push_back(v1);
+                    leaf_vertices.push_back(v2);
+
+                    bbox.insert(v0);
+                    bbox.insert(v1);
+                    bbox.insert(v2);
+                }
+
+                // The leaf can only be encoded in place if its size did not change.
+                const bool quantized = m_leaf_encoding == TriangleEncoder::Quantized;
+                if (TriangleEncoder::compute_indexed_size(leaf_vertices, quantized) ==
+                    TriangleEncoder::compute_indexed_size(leaf_data, item_count, quantized))
+                    TriangleEncoder::encode_indexed(leaf_vertices, quantized, writer);
+                else boost_atomic::atomic_write32(&m_leaf_size_changed, 1);
+
+                return AABB3d(bbox);
+            }
+
+            for (size_t i = 0; i < item_count; ++i)
+            {
+                GVector3 v0, v1, v2;
+                get_triangle_vertices(m_triangle_keys[item_begin + i], v0, v1, v2);
+
+                TriangleEncoder::encode(v0, v1, v2, m_single_precision, writer);
+
+                bbox.insert(v0);
+                bbox.insert(v1);
+                bbox.insert(v2);
+            }
+
+            return AABB3d(bbox);
+        }
+
+      private:
+        const vector<TriangleKey>&              m_triangle_keys;
+        vector<uint8>&                          m_leaf_data;
+        const bool                              m_single_precision;
+        const TriangleEncoder::Encoding         m_leaf_encoding;
+        mutable volatile boost::uint32_t        m_leaf_size_changed;
+        vector<const Transformd*>               m_transforms;   // per object instance
+        vector<size_t>                          m_first_tess;   // per object instance
+        vector<Access<RegionKit> >              m_region_kits;  // per object instance
+        vector<Access<StaticTriangleTess> >     m_tess;         // per region
+
+        size_t get_tess_index(const TriangleKey& triangle_key) const
+        {
+            return
+                  m_first_tess[triangle_key.get_object_instance_index()]
+                + triangle_key.get_region_index();
+        }
+
+        void get_triangle_vertices(
+            const TriangleKey&  triangle_key,
+            GVector3&           v0,
+            GVector3&           v1,
+            GVector3&           v2) const
+        {
+            const StaticTriangleTess& tess = m_tess[get_tess_index(triangle_key)].ref();
+            const Transformd& transform = *m_transforms[triangle_key.get_object_instance_index()];
+            const Triangle& triangle = tess.m_primitives[triangle_key.get_triangle_index()];
+
+            // Transform triangle vertices to assembly space.
+            v0 = transform.point_to_parent(tess.m_vertices[triangle.m_v0]);
+            v1 = transform.point_to_parent(tess.m_vertices[triangle.m_v1]);
+            v2 = transform.point_to_parent(tess.m_vertices[triangle.m_v2]);
+        }
+    };
+}
+
+uint64 TriangleTree::compute_topology_signature() const
+{
+    const ObjectInstanceContainer& object_instances = m_arguments.m_assembly.object_instances();
+    const size_t object_instance_count = object_instances.size();
+
+    uint64 signature = object_instance_count;
+
+    for (size_t i = 0; i < object_instance_count; ++i)
+    {
+        const ObjectInstance* object_instance = object_instances.get_by_index(i);
+        assert(object_instance);
+
+        Access<RegionKit> region_kit(&object_instance->get_object().get_region_kit());
+        signature = Entity::combine_signatures(signature, region_kit->size());
+
+        for (size_t j = 0; j < region_kit->size(); ++j)
+        {
+            Access<StaticTriangleTess> tess(&(*region_kit)[j]->get_static_triangle_tess());
+
+            // Vertex positions may change, but not how they are connected.
+            const uint64 counts[] =
+            {
+                tess->m_vertices.size(),
+                tess->get_motion_segment_count()
+            };
+            signature = Entity::combine_signatures(signature, siphash24(counts, sizeof(counts)));
+            signature = Entity::combine_signatures(signature, hash_vector(tess->m_primitives));
+        }
+    }
+
+    return signature;
+}
+
+double TriangleTree::compute_sah_cost() const
+{
+    return
+        bvh::compute_sah_cost(
+            m_nodes,
+            m_build_params.get_optional<double>("interior_node_traversal_cost", TriangleTreeDefaultInteriorNodeTraversalCost),
+            m_build_params.get_optional<double>("triangle_intersection_cost", TriangleTreeDefaultTriangleIntersectionCost));
+}
+
+bool TriangleTree::refit()
+{
+    const ParamArray& params = m_arguments.m_assembly.get_parameters().child("acceleration_structure");
+
+    if (!params.get_optional<bool>("refit", TriangleTreeDefaultRefit))
+        return false;
+
+    // Changing the build parameters requires a rebuild.
+    if (params != m_build_params)
+        return false;
+
+    // Motion bounding boxes are not refitted.
+    if (m_moving_triangle_count > 0)
+        return false;
+
+    // Triangles may only move, they may not be added, removed or reconnected.
+    if (compute_topology_signature() != m_topology_signature)
+        return false;
+
+    RENDERER_LOG_INFO(
+        "refitting triangle tree #" FMT_UNIQUE_ID " (%s %s)...",
+        m_arguments.m_triangle_tree_uid,
+        pretty_uint(m_static_triangle_count).c_str(),
+        plural(m_static_triangle_count, "static triangle").c_str());
+
+    TriangleLeafRefitter leaf_refitter(
+        m_arguments.m_assembly,
+        m_triangle_keys,
+        m_leaf_data,
+        m_single_precision,
+        m_leaf_encoding);
+
+    // Triangles that were left out because they were degenerate must remain so.
+    if (!leaf_refitter.has_only_degenerate_unreferenced_triangles())
+        return false;
+
+    // Refit the tree.
+    const size_t refit_thread_count = params.get_optional<size_t>("build_threads", System::get_logical_cpu_core_count());
+    bvh::Refitter<TriangleTree, TriangleLeafRefitter> refitter(global_logger(), refit_thread_count);
+    refitter.refit<DefaultWallclockTimer>(*this, leaf_refitter);
+
+    if (leaf_refitter.has_leaf_size_changed())
+    {
+        RENDERER_LOG_DEBUG(
+            "vertices of triangle tree #" FMT_UNIQUE_ID " no longer fit in its leaves, rebuilding it.",
+            m_arguments.m_triangle_tree_uid);
+        return false;
+    }
+
+    // Give up if the topology of the tree no longer fits the triangles.
+    const double sah_cost = compute_sah_cost();
+    const double max_cost_growth = params.get_optional<double>("refit_max_cost_growth", TriangleTreeDefaultRefitMaxCostGrowth);
+    if (sah_cost > m_sah_cost * max_cost_growth)
+    {
+        RENDERER_LOG_DEBUG(
+            "sah cost of triangle tree #" FMT_UNIQUE_ID " grew from %f to %f after refitting, rebuilding it.",
+            m_arguments.m_triangle_tree_uid,
+            m_sah_cost,
+            sah_cost);
+        return false;
+    }
+
+    // Collapse the refitted tree into a wide tree.
+    if (m_node_width == 4)
+        m_wide4_tree.collapse(*this);
+    else if (m_node_width == 8)
+        m_wide8_tree.collapse(*this);
+
+    RENDERER_LOG_DEBUG(
+        "refitted triangle tree #" FMT_UNIQUE_ID " in %s, sah cost %f (built with %f).",
+        m_arguments.m_triangle_tree_uid,
+        pretty_time(refitter.get_refit_time()).c_str(),
+        sah_cost,
+        m_sah_cost);
+
+    return true;
 }
 
 namespace
@@ -36,9 +36,11 @@
 #include "renderer/kernel/intersection/intersectionsettings.h"
 #include "renderer/kernel/intersection/probevisitorbase.h"
 #include "renderer/kernel/intersection/regioninfo.h"
+#include "renderer/kernel/intersection/triangleencoder.h"
 #include "renderer/kernel/intersection/trianglekey.h"
 #include "renderer/kernel/shading/shadingpoint.h"
 #include "renderer/kernel/shading/shadingray.h"
+#include "renderer/utility/paramarray.h"
 
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
@@ -51,18 +53,24 @@
 #include "foundation/utility/alignedvector.h"
 #include "foundation/utility/lazy.h"
 #include "foundation/utility/poolallocator.h"
+#include "foundation/utility/test.h"
 #include "foundation/utility/uid.h"
 
 // Standard headers.
 #include <cstddef>
 #include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 // Forward declarations.
+DECLARE_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, SaveToCache_ThenLoadFromCache_RestoresIdenticalTree);
+DECLARE_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, LoadFromCache_GivenTruncatedFile_ReturnsFalseAndTreeIsRebuilt);
+DECLARE_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, LoadFromCache_GivenCorruptedHeader_ReturnsFalseAndTreeIsRebuilt);
+DECLARE_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, LoadFromCache_GivenCorruptedCacheKey_ReturnsFalseAndTreeIsRebuilt);
+DECLARE_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, ComputeCacheKey_GivenDifferentBuildInputs_ReturnsDifferentKeys);
 namespace foundation    { class Statistics; }
 namespace renderer      { class Assembly; }
-namespace renderer      { class ParamArray; }
 namespace renderer      { class Scene; }
 namespace renderer      { class TriangleVertexInfo; }
 
@@ -84,6 +92,10 @@ class TriangleTree
            >
 {
   public:
+    // Wide trees collapsed from this tree, with single precision bounding boxes.
+    typedef foundation::bvh::WideTree<TreeType, 4, GAABB3> Wide4TreeType;
+    typedef foundation::bvh::WideTree<TreeType, 8, GAABB3> Wide8TreeType;
+
     // Construction arguments.
     struct Arguments
     {
@@ -111,10 +123,29 @@ class TriangleTree
     // Update the non-geometry aspects of the tree.
     void update_non_geometry();
 
+    // Update the bounding boxes and the triangles of the tree to follow the current
+    // vertex positions of the assembly, keeping the topology of the tree. Return false
+    // if the tree must be rebuilt instead, in which case it is left in an unusable state.
+    bool refit();
+
     // Return the number of static and moving triangles.
     size_t get_static_triangle_count() const;
     size_t get_moving_triangle_count() const;
 
+    // Return the width of the nodes used for traversal (2, 4 or 8).
+    // Trees with moving triangles are always traversed as binary trees.
+    size_t get_node_width() const;
+
+    // Return true if static triangles are stored and intersected in single precision.
+    bool is_single_precision() const;
+
+    // Return how the triangles are stored in the leaves of the tree.
+    TriangleEncoder::Encoding get_leaf_encoding() const;
+
+    // Return the wide trees (only valid if the node width is 4 or 8).
+    const Wide4TreeType& get_wide4_tree() const;
+    const Wide8TreeType& get_wide8_tree() const;
+
     // Return the size (in bytes) of this object in memory.
     size_t get_memory_size() const;
 
@@ -122,11 +153,27 @@ class TriangleTree
     friend class TriangleLeafVisitor;
     friend class TriangleLeafProbeVisitor;
 
+    GRANT_ACCESS_TO_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, SaveToCache_ThenLoadFromCache_RestoresIdenticalTree);
+    GRANT_ACCESS_TO_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, LoadFromCache_GivenTruncatedFile_ReturnsFalseAndTreeIsRebuilt);
+    GRANT_ACCESS_TO_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, LoadFromCache_GivenCorruptedHeader_ReturnsFalseAndTreeIsRebuilt);
+    GRANT_ACCESS_TO_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, LoadFromCache_GivenCorruptedCacheKey_ReturnsFalseAndTreeIsRebuilt);
+    GRANT_ACCESS_TO_TEST_CASE(Renderer_Kernel_Intersection_TriangleTree, ComputeCacheKey_GivenDifferentBuildInputs_ReturnsDifferentKeys);
+
     const Arguments                             m_arguments;
 
     size_t                                      m_static_triangle_count;
     size_t                                      m_moving_triangle_count;
 
+    bool                                        m_single_precision;
+    TriangleEncoder::Encoding                   m_leaf_encoding;
+
+    size_t                                      m_node_width;
+    ParamArray                                  m_build_params;
+    foundation::uint64                          m_topology_signature;
+    double                                      m_sah_cost;
+    Wide4TreeType                               m_wide4_tree;
+    Wide8TreeType                               m_wide8_tree;
+
     std::vector<TriangleKey>                    m_triangle_keys;
     std::vector<foundation::uint8>              m_leaf_data;
 
@@ -137,6 +184,20 @@ class TriangleTree
         const ParamArray&                       params,
         const double                            time,
         const bool                              save_memory,
+        const bool                              binned,
+        foundation::Statistics&                 statistics);
+
+    template <typename Partitioner>
+    void build_bvh_tree(
+        Partitioner&                            partitioner,
+        const std::vector<TriangleKey>&         triangle_keys,
+        const std::vector<TriangleVertexInfo>&  triangle_vertex_infos,
+        std::vector<GAABB3>&                    triangle_bboxes,
+        const double                            time,
+        const bool                              save_memory,
+        const size_t                            max_leaf_size,
+        const size_t                            build_thread_count,
+        const double                            collection_time,
         foundation::Statistics&                 statistics);
 
     void build_sbvh(
@@ -158,6 +219,28 @@ class TriangleTree
         const std::vector<TriangleKey>&         triangle_keys,
         foundation::Statistics&                 statistics);
 
+    foundation::uint64 compute_cache_key(
+        const ParamArray&                       params,
+        const std::string&                      algorithm,
+        const double                            time,
+        const bool                              save_memory) const;
+
+    foundation::uint64 compute_topology_signature() const;
+
+    double compute_sah_cost() const;
+
+    static std::string make_cache_filepath(
+        const std::string&                      cache_directory,
+        const foundation::uint64                cache_key);
+
+    bool load_from_cache(
+        const std::string&                      filepath,
+        const foundation::uint64                cache_key);
+
+    void save_to_cache(
+        const std::string&                      filepath,
+        const foundation::uint64                cache_key) const;
+
     void update_intersection_filters();
     void delete_intersection_filters();
 };
@@ -234,6 +317,8 @@ class TriangleLeafVisitor
   private:
     const TriangleTree&     m_tree;
     const bool              m_has_intersection_filters;
+    const bool              m_single_precision;
+    const TriangleEncoder::Encoding m_leaf_encoding;
     ShadingPoint&           m_shading_point;
     GTriangleType           m_interpolated_triangle;
     const GTriangleType*    m_hit_triangle;
@@ -270,6 +355,8 @@ class TriangleLeafProbeVisitor
     const TriangleTree&     m_tree;
     const double            m_time;
     const bool              m_has_intersection_filters;
+    const bool              m_single_precision;
+    const TriangleEncoder::Encoding m_leaf_encoding;
 };
 
 
@@ -291,6 +378,54 @@ typedef foundation::bvh::Intersector<
     TriangleTreeStackSize
 > TriangleTreeProbeIntersector;
 
+typedef foundation::bvh::WideIntersector<
+    TriangleTree,
+    TriangleTree::Wide4TreeType,
+    TriangleLeafVisitor,
+    foundation::Ray3d,          // make sure we pick the SIMD-optimized version of foundation::bvh::WideNodeRayTester
+    TriangleTreeWideStackSize
+> TriangleTreeWide4Intersector;
+
+typedef foundation::bvh::WideIntersector<
+    TriangleTree,
+    TriangleTree::Wide4TreeType,
+    TriangleLeafProbeVisitor,
+    foundation::Ray3d,
+    TriangleTreeWideStackSize
+> TriangleTreeWide4ProbeIntersector;
+
+typedef foundation::bvh::WideIntersector<
+    TriangleTree,
+    TriangleTree::Wide8TreeType,
+    TriangleLeafVisitor,
+    foundation::Ray3d,
+    TriangleTreeWideStackSize
+> TriangleTreeWide8Intersector;
+
+typedef foundation::bvh::WideIntersector<
+    TriangleTree,
+    TriangleTree::Wide8TreeType,
+    TriangleLeafProbeVisitor,
+    foundation::Ray3d,
+    TriangleTreeWideStackSize
+> TriangleTreeWide8ProbeIntersector;
+
+typedef foundation::bvh::PacketIntersector<
+    TriangleTree,
+    foundation::bvh::PerRayPacketVisitor<TriangleLeafVisitor>,
+    ShadingRay,
+    RayPacketSize,
+    TriangleTreeStackSize
+> TriangleTreePacketIntersector;
+
+typedef foundation::bvh::PacketIntersector<
+    TriangleTree,
+    foundation::bvh::PerRayPacketVisitor<TriangleLeafProbeVisitor>,
+    ShadingRay,
+    RayPacketSize,
+    TriangleTreeStackSize
+> TriangleTreePacketProbeIntersector;
+
 
 //
 // Utility class to convert a triangle to the desired precision if necessary,
@@ -344,6 +479,31 @@ inline size_t TriangleTree::get_moving_triangle_count() const
     return m_moving_triangle_count;
 }
 
+inline size_t TriangleTree::get_node_width() const
+{
+    return m_node_width;
+}
+
+inline bool TriangleTree::is_single_precision() const
+{
+    return m_single_precision;
+}
+
+inline TriangleEncoder::Encoding TriangleTree::get_leaf_encoding() const
+{
+    return m_leaf_encoding;
+}
+
+inline const TriangleTree::Wide4TreeType& TriangleTree::get_wide4_tree() const
+{
+    return m_wide4_tree;
+}
+
+inline const TriangleTree::Wide8TreeType& TriangleTree::get_wide8_tree() const
+{
+    return m_wide8_tree;
+}
+
 
 //
 // TriangleLeafVisitor class implementation.
@@ -354,6 +514,8 @@ inline TriangleLeafVisitor::TriangleLeafVisitor(
     ShadingPoint&                           shading_point)
   : m_tree(tree)
   , m_has_intersection_filters(!tree.m_intersection_filters.empty())
+  , m_single_precision(tree.m_single_precision)
+  , m_leaf_encoding(tree.m_leaf_encoding)
   , m_shading_point(shading_point)
   , m_hit_triangle(0)
 {
@@ -381,7 +543,73 @@ inline bool TriangleLeafVisitor::visit(
     const size_t triangle_index = node.get_item_index();
     const size_t triangle_count = node.get_item_count();
 
-    // Sequentially intersect all triangles of the leaf.
+    // Convert the ray to single precision if necessary.
+    GRay3 single_precision_ray;
+    if (m_single_precision)
+        single_precision_ray = GRay3(ray);
+
+    // Sequentially intersect all triangles of the leaf. The closest hit so far
+    // is tracked by the shading point: 'ray' may be a copy of its ray that was
+    // not shortened, for instance when intersecting packets of rays.
+    if (m_leaf_encoding != TriangleEncoder::Triangles)
+    {
+        // Decode static triangles from the vertex table of the leaf.
+        const IndexedTriangleLeafDecoder decoder(leaf_data, m_leaf_encoding == TriangleEncoder::Quantized);
+
+        for (size_t i = 0; i < triangle_count; ++i)
+        {
+            GVector3 vert0, vert1, vert2;
+            decoder.get_triangle(i, vert0, vert1, vert2);
+
+            // Intersect the triangle.
+            double t, u, v;
+            if (m_single_precision)
+            {
+                GScalar gt, gu, gv;
+                if (!GWatertightTriangleType(vert0, vert1, vert2).intersect(single_precision_ray, gt, gu, gv))
+                    continue;
+
+                t = gt;
+                u = gu;
+                v = gv;
+            }
+            else
+            {
+                const GTriangleType triangle(vert0, vert1, vert2);
+                const impl::TriangleReader reader(triangle);
+
+                if (!reader.m_triangle.intersect(ray, t, u, v))
+                    continue;
+            }
+
+            if (t >= m_shading_point.m_ray.m_tmax)
+                continue;
+
+            // Optionally filter intersections.
+            if (m_has_intersection_filters)
+            {
+                const TriangleKey& triangle_key = m_tree.m_triangle_keys[triangle_index + i];
+                const IntersectionFilter* filter =
+                    m_tree.m_intersection_filters[triangle_key.get_object_instance_index()];
+                if (filter && !filter->accept(triangle_key, u, v))
+                    continue;
+            }
+
+            m_interpolated_triangle = GTriangleType(vert0, vert1, vert2);
+            m_hit_triangle = &m_interpolated_triangle;
+            m_hit_triangle_index = triangle_index + i;
+            m_shading_point.m_ray.m_tmax = t;
+            m_shading_point.m_bary[0] = u;
+            m_shading_point.m_bary[1] = v;
+        }
+
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(triangle_count));
+
+        // Continue traversal.
+        distance = m_shading_point.m_ray.m_tmax;
+        return true;
+    }
+
     for (size_t i = 0; i < triangle_count; ++i)
     {
         // Retrieve the number of motion segments for this triangle.
@@ -389,7 +617,39 @@ inline bool TriangleLeafVisitor::visit(
             *reinterpret_cast<const foundation::uint32*>(leaf_data);
         leaf_data += sizeof(foundation::uint32);
 
-        if (motion_segment_count == 0)
+        if (motion_segment_count == 0 && m_single_precision)
+        {
+            // Load the triangle.
+            const GWatertightTriangleType* triangle_ptr = reinterpret_cast<const GWatertightTriangleType*>(leaf_data);
+            leaf_data += sizeof(GWatertightTriangleType);
+
+            // Intersect the triangle in single precision.
+            GScalar t, u, v;
+            if (triangle_ptr->intersect(single_precision_ray, t, u, v) && t < m_shading_point.m_ray.m_tmax)
+            {
+                // Optionally filter intersections.
+                if (m_has_intersection_filters)
+                {
+                    const TriangleKey& triangle_key = m_tree.m_triangle_keys[triangle_index + i];
+                    const IntersectionFilter* filter =
+                        m_tree.m_intersection_filters[triangle_key.get_object_instance_index()];
+                    if (filter && !filter->accept(triangle_key, u, v))
+                        continue;
+                }
+
+                m_interpolated_triangle =
+                    GTriangleType(
+                        triangle_ptr->m_v0,
+                        triangle_ptr->m_v1,
+                        triangle_ptr->m_v2);
+                m_hit_triangle = &m_interpolated_triangle;
+                m_hit_triangle_index = triangle_index + i;
+                m_shading_point.m_ray.m_tmax = t;
+                m_shading_point.m_bary[0] = u;
+                m_shading_point.m_bary[1] = v;
+            }
+        }
+        else if (motion_segment_count == 0)
         {
             // Load the triangle, converting it to the right format if necessary.
             const GTriangleType* triangle_ptr = reinterpret_cast<const GTriangleType*>(leaf_data);
@@ -398,7 +658,7 @@ inline bool TriangleLeafVisitor::visit(
 
             // Intersect the triangle.
             double t, u, v;
-            if (reader.m_triangle.intersect(ray, t, u, v))
+            if (reader.m_triangle.intersect(ray, t, u, v) && t < m_shading_point.m_ray.m_tmax)
             {
                 // Optionally filter intersections.
                 if (m_has_intersection_filters)
@@ -437,7 +697,7 @@ inline bool TriangleLeafVisitor::visit(
 
             // Intersect the triangle.
             double t, u, v;
-            if (reader.m_triangle.intersect(ray, t, u, v))
+            if (reader.m_triangle.intersect(ray, t, u, v) && t < m_shading_point.m_ray.m_tmax)
             {
                 // Optionally filter intersections.
                 if (m_has_intersection_filters)
@@ -496,6 +756,8 @@ inline TriangleLeafProbeVisitor::TriangleLeafProbeVisitor(
   : m_tree(tree)
   , m_time(time)
   , m_has_intersection_filters(!tree.m_intersection_filters.empty())
+  , m_single_precision(tree.m_single_precision)
+  , m_leaf_encoding(tree.m_leaf_encoding)
 {
 }
 
@@ -520,7 +782,53 @@ inline bool TriangleLeafProbeVisitor::visit(
 
     const size_t triangle_count = node.get_item_count();
 
+    // Convert the ray to single precision if necessary.
+    GRay3 single_precision_ray;
+    if (m_single_precision)
+        single_precision_ray = GRay3(ray);
+
     // Sequentially intersect triangles until a hit is found.
+    if (m_leaf_encoding != TriangleEncoder::Triangles)
+    {
+        // Decode static triangles from the vertex table of the leaf.
+        const IndexedTriangleLeafDecoder decoder(leaf_data, m_leaf_encoding == TriangleEncoder::Quantized);
+
+        for (size_t i = 0; i < triangle_count; ++i)
+        {
+            GVector3 vert0, vert1, vert2;
+            decoder.get_triangle(i, vert0, vert1, vert2);
+
+            // Intersect the triangle.
+            bool hit;
+            if (m_single_precision)
+            {
+                GScalar t, u, v;
+                hit =
+                    GWatertightTriangleType(vert0, vert1, vert2).intersect(single_precision_ray, t, u, v) &&
+                    t < ray.m_tmax;
+            }
+            else
+            {
+                const GTriangleType triangle(vert0, vert1, vert2);
+                const impl::TriangleReader reader(triangle);
+                hit = reader.m_triangle.intersect(ray);
+            }
+
+            if (hit)
+            {
+                FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(i + 1));
+                m_hit = true;
+                return false;
+            }
+        }
+
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(triangle_count));
+
+        // Continue traversal.
+        distance = ray.m_tmax;
+        return true;
+    }
+
     for (size_t i = 0; i < triangle_count; ++i)
     {
         // Retrieve the number of motion segments for this triangle.
@@ -528,7 +836,22 @@ inline bool TriangleLeafProbeVisitor::visit(
             *reinterpret_cast<const foundation::uint32*>(leaf_data);
         leaf_data += sizeof(foundation::uint32);
 
-        if (motion_segment_count == 0)
+        if (motion_segment_count == 0 && m_single_precision)
+        {
+            // Load the triangle.
+            const GWatertightTriangleType* triangle_ptr = reinterpret_cast<const GWatertightTriangleType*>(leaf_data);
+            leaf_data += sizeof(GWatertightTriangleType);
+
+            // Intersect the triangle in single precision.
+            GScalar t, u, v;
+            if (triangle_ptr->intersect(single_precision_ray, t, u, v) && t < ray.m_tmax)
+            {
+                FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(i + 1));
+                m_hit = true;
+                return false;
+            }
+        }
+        else if (motion_segment_count == 0)
         {
             // Load the triangle, converting it to the right format if necessary.
             const GTriangleType* triangle_ptr = reinterpret_cast<const GTriangleType*>(leaf_data);
@@ -33,6 +33,7 @@
 // appleseed.renderer headers.
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/aov/spectrumstack.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
 #include "renderer/kernel/lighting/lightsampler.h"
 #include "renderer/kernel/lighting/tracer.h"
 #include "renderer/kernel/shading/shadingcontext.h"
@@ -201,6 +202,26 @@ class DirectLightingIntegrator
         Spectrum&                       radiance,
         SpectrumStack&                  aovs);
 
+    template <typename WeightingFunction>
+    void add_emitting_triangle_sample_contributions(
+        const LightSample               samples[],
+        const foundation::Vector3d      targets[],
+        const size_t                    sample_count,
+        WeightingFunction&              weighting_function,
+        Spectrum&                       radiance,
+        SpectrumStack&                  aovs);
+
+    template <typename WeightingFunction>
+    void add_emitting_triangle_sample_contribution(
+        const LightSample&              sample,
+        const double                    transmission,
+        WeightingFunction&              weighting_function,
+        Spectrum&                       radiance,
+        SpectrumStack&                  aovs);
+
+    bool is_emitting_triangle_sample_contributing(
+        const LightSample&              sample) const;
+
     void add_non_physical_light_sample_contribution(
         const LightSample&              sample,
         Spectrum&                       radiance,
@@ -224,8 +245,8 @@ class DirectLightingIntegrator
 //                                                   `-->  add_non_physical_light_sample_contribution
 //
 //
-//                                 .-->  add_emitting_triangle_sample_contribution
-//                                 |
+//                                 .-->  add_emitting_triangle_sample_contributions
+//                                 |     (packets of shadow rays)
 //   sample_lights_low_variance  --+
 //                                 |
 //                                 `-->  add_non_physical_light_sample_contribution
@@ -350,20 +371,50 @@ void DirectLightingIntegrator::sample_lights_low_variance(
     {
         sampling_context.split_in_place(3, m_light_sample_count);
 
+        // Light samples are gathered so that their shadow rays can be traced as packets.
+        LightSample samples[RayPacketSize];
+        foundation::Vector3d targets[RayPacketSize];
+        size_t sample_count = 0;
+
         for (size_t i = 0; i < m_light_sample_count; ++i)
         {
             const foundation::Vector3d s = sampling_context.next_vector2<3>();
 
-            LightSample sample;
-            m_light_sampler.sample_emitting_triangles(m_time, s, sample);
-
-            add_emitting_triangle_sample_contribution(
-                sample,
-                weighting_function,
-                radiance,
-                aovs);
+            LightSample& sample = samples[sample_count];
+            if (!m_light_sampler.sample_emitting_triangles(
+                    m_time,
+                    m_point,
+                    m_shading_basis.get_normal(),
+                    s,
+                    sample))
+                continue;
+
+            if (!is_emitting_triangle_sample_contributing(sample))
+                continue;
+
+            targets[sample_count++] = sample.m_point;
+
+            if (sample_count == RayPacketSize)
+            {
+                add_emitting_triangle_sample_contributions(
+                    samples,
+                    targets,
+                    sample_count,
+                    weighting_function,
+                    radiance,
+                    aovs);
+                sample_count = 0;
+            }
         }
 
+        add_emitting_triangle_sample_contributions(
+            samples,
+            targets,
+            sample_count,
+            weighting_function,
+            radiance,
+            aovs);
+
         if (m_light_sample_count > 1)
         {
             const float rcp_light_sample_count = 1.0f / m_light_sample_count;
@@ -489,7 +540,11 @@ void DirectLightingIntegrator::take_single_bsdf_sample(
         const double bsdf_point_prob = bsdf_prob * cos_on / square_distance;
 
         // Compute the probability density wrt. surface area mesure of the light sample.
-        const double light_point_prob = m_light_sampler.evaluate_pdf(light_shading_point);
+        const double light_point_prob =
+            m_light_sampler.evaluate_pdf(
+                m_point,
+                m_shading_basis.get_normal(),
+                light_shading_point);
 
         // Apply the weighting function.
         weight *=
@@ -524,7 +579,8 @@ void DirectLightingIntegrator::take_single_light_sample(
     const foundation::Vector3d s = sampling_context.next_vector2<3>();
 
     LightSample sample;
-    m_light_sampler.sample(m_time, s, sample);
+    if (!m_light_sampler.sample(m_time, m_point, m_shading_basis.get_normal(), s, sample))
+        return;
 
     if (sample.m_triangle)
     {
@@ -549,15 +605,78 @@ void DirectLightingIntegrator::add_emitting_triangle_sample_contribution(
     WeightingFunction&                  weighting_function,
     Spectrum&                           radiance,
     SpectrumStack&                      aovs)
+{
+    if (!is_emitting_triangle_sample_contributing(sample))
+        return;
+
+    // Compute the transmission factor between the light sample and the shading point.
+    const double transmission =
+        m_shading_context.get_tracer().trace_between(
+            m_shading_point,
+            sample.m_point,
+            ShadingRay::ShadowRay);
+
+    // Discard occluded samples.
+    if (transmission == 0.0)
+        return;
+
+    add_emitting_triangle_sample_contribution(
+        sample,
+        transmission,
+        weighting_function,
+        radiance,
+        aovs);
+}
+
+template <typename WeightingFunction>
+void DirectLightingIntegrator::add_emitting_triangle_sample_contributions(
+    const LightSample                   samples[],
+    const foundation::Vector3d          targets[],
+    const size_t                        sample_count,
+    WeightingFunction&                  weighting_function,
+    Spectrum&                           radiance,
+    SpectrumStack&                      aovs)
+{
+    assert(sample_count <= RayPacketSize);
+
+    if (sample_count == 0)
+        return;
+
+    // Compute the transmission factors between the light samples and the shading point.
+    double transmissions[RayPacketSize];
+    m_shading_context.get_tracer().trace_between(
+        m_shading_point,
+        targets,
+        sample_count,
+        ShadingRay::ShadowRay,
+        transmissions);
+
+    // Add the contributions of unoccluded samples, in sampling order.
+    for (size_t i = 0; i < sample_count; ++i)
+    {
+        if (transmissions[i] > 0.0)
+        {
+            add_emitting_triangle_sample_contribution(
+                samples[i],
+                transmissions[i],
+                weighting_function,
+                radiance,
+                aovs);
+        }
+    }
+}
+
+inline bool DirectLightingIntegrator::is_emitting_triangle_sample_contributing(
+    const LightSample&                  sample) const
 {
     const EDF* edf = sample.m_triangle->m_edf;
 
     // No contribution if we are computing indirect lighting but this light does not cast indirect light.
     if (m_indirect && !(edf->get_flags() & EDF::CastIndirectLight))
-        return;
+        return false;
 
     // Compute the incoming direction in world space.
-    foundation::Vector3d incoming = sample.m_point - m_point;
+    const foundation::Vector3d incoming = sample.m_point - m_point;
 
     // Cull light samples behind the shading surface
     // if the BSDF is either Reflective or Transmissive, but not both.
@@ -569,24 +688,26 @@ void DirectLightingIntegrator::add_emitting_triangle_sample_contribution(
             cos_in = -cos_in;
 
         if (cos_in <= 0.0)
-            return;
+            return false;
     }
 
     // Cull samples on lights emitting in the wrong direction.
-    double cos_on = foundation::dot(-incoming, sample.m_shading_normal);
-    if (cos_on <= 0.0)
-        return;
+    return foundation::dot(-incoming, sample.m_shading_normal) > 0.0;
+}
 
-    // Compute the transmission factor between the light sample and the shading point.
-    const double transmission =
-        m_shading_context.get_tracer().trace_between(
-            m_shading_point,
-            sample.m_point,
-            ShadingRay::ShadowRay);
+template <typename WeightingFunction>
+void DirectLightingIntegrator::add_emitting_triangle_sample_contribution(
+    const LightSample&                  sample,
+    const double                        transmission,
+    WeightingFunction&                  weighting_function,
+    Spectrum&                           radiance,
+    SpectrumStack&                      aovs)
+{
+    const EDF* edf = sample.m_triangle->m_edf;
 
-    // Discard occluded samples.
-    if (transmission == 0.0)
-        return;
+    // Compute the incoming direction in world space.
+    foundation::Vector3d incoming = sample.m_point - m_point;
+    double cos_on = foundation::dot(-incoming, sample.m_shading_normal);
 
     // Compute the square distance between the light sample and the shading point.
     const double square_distance = foundation::square_norm(incoming);
@@ -114,16 +114,23 @@ LightSampler::LightSampler(const Scene& scene, const ParamArray& params)
     // Build the hash table of emitting triangles.
     build_emitting_triangle_hash_table();
 
-    // Prepare the CDFs for sampling.
-    if (m_non_physical_lights_cdf.valid())
-        m_non_physical_lights_cdf.prepare();
-    if (m_emitting_triangles_cdf.valid())
+    // Prepare the alias tables and the CDF for sampling.
+    if (m_non_physical_lights_table.valid())
+        m_non_physical_lights_table.prepare();
+    if (m_emitting_triangles_table.valid())
+    {
+        m_emitting_triangles_table.prepare();
         m_emitting_triangles_cdf.prepare();
+    }
 
     // Store the triangle probability densities into the emitting triangles.
     const size_t emitting_triangle_count = m_emitting_triangles.size();
     for (size_t i = 0; i < emitting_triangle_count; ++i)
-        m_emitting_triangles[i].m_triangle_prob = m_emitting_triangles_cdf[i].second;
+        m_emitting_triangles[i].m_triangle_prob = m_emitting_triangles_table[i].second;
+
+    // Build the light tree.
+    if (m_params.m_light_tree && emitting_triangle_count > 0)
+        build_emitting_triangle_tree();
 
    RENDERER_LOG_INFO(
         "found %s %s, %s emitting %s.",
@@ -178,11 +185,11 @@ void LightSampler::collect_non_physical_lights(
         light_info.m_light = &light;
         m_non_physical_lights.push_back(light_info);
 
-        // Insert the light into the CDF.
+        // Insert the light into the alias table.
         // todo: compute importance.
         double importance = 1.0;
         importance *= light.get_uncached_importance_multiplier();
-        m_non_physical_lights_cdf.insert(light_index, importance);
+        m_non_physical_lights_table.insert(light_index, importance);
     }
 }
 
@@ -353,14 +360,15 @@ void LightSampler::collect_emitting_triangles(
                     emitting_triangle.m_geometric_normal = side == 0 ? geometric_normal : -geometric_normal;
                     emitting_triangle.m_triangle_support_plane = triangle_support_plane;
                     emitting_triangle.m_rcp_area = rcp_area;
-                    emitting_triangle.m_triangle_prob = 0.0;    // will be initialized once the emitting triangle CDF is built
+                    emitting_triangle.m_triangle_prob = 0.0;    // will be initialized once the emitting triangle alias table is built
                     emitting_triangle.m_edf = edf;
 
                     // Store the light-emitting triangle.
                     const size_t emitting_triangle_index = m_emitting_triangles.size();
                     m_emitting_triangles.push_back(emitting_triangle);
 
-                    // Insert the light-emitting triangle into the CDF.
+                    // Insert the light-emitting triangle into the alias table and the CDF.
+                    m_emitting_triangles_table.insert(emitting_triangle_index, triangle_prob);
                     m_emitting_triangles_cdf.insert(emitting_triangle_index, triangle_prob);
                 }
             }
@@ -389,14 +397,60 @@ void LightSampler::build_emitting_triangle_hash_table()
     }
 }
 
+void LightSampler::build_emitting_triangle_tree()
+{
+    const size_t emitting_triangle_count = m_emitting_triangles.size();
+
+    vector<LightTree::Item> items(emitting_triangle_count);
+
+    for (size_t i = 0; i < emitting_triangle_count; ++i)
+    {
+        const EmittingTriangle& emitting_triangle = m_emitting_triangles[i];
+        LightTree::Item& item = items[i];
+
+        item.m_bbox.invalidate();
+        item.m_bbox.insert(emitting_triangle.m_v0);
+        item.m_bbox.insert(emitting_triangle.m_v1);
+        item.m_bbox.insert(emitting_triangle.m_v2);
+
+        // Light is emitted around the shading normal, which is interpolated from the vertex normals.
+        item.m_normals = DirectionCone(emitting_triangle.m_geometric_normal);
+        item.m_normals = DirectionCone::merge(item.m_normals, DirectionCone(emitting_triangle.m_n0));
+        item.m_normals = DirectionCone::merge(item.m_normals, DirectionCone(emitting_triangle.m_n1));
+        item.m_normals = DirectionCone::merge(item.m_normals, DirectionCone(emitting_triangle.m_n2));
+
+        item.m_power = emitting_triangle.m_triangle_prob;
+    }
+
+    m_emitting_triangle_tree.build(items);
+
+    RENDERER_LOG_INFO(
+        "built light tree with %s %s.",
+        pretty_int(m_emitting_triangle_tree.get_node_count()).c_str(),
+        plural(m_emitting_triangle_tree.get_node_count(), "node").c_str());
+}
+
+const EmittingTriangle* LightSampler::find_emitting_triangle(const ShadingPoint& shading_point) const
+{
+    assert(shading_point.get_primitive_type() == ShadingPoint::PrimitiveTriangle);
+
+    const EmittingTriangleKey triangle_key(
+        shading_point.get_assembly_instance().get_uid(),
+        shading_point.get_object_instance_index(),
+        shading_point.get_region_index(),
+        shading_point.get_primitive_index());
+
+    return m_emitting_triangle_hash_table.get(triangle_key);
+}
+
 void LightSampler::sample_non_physical_lights(
     const double                        time,
     const Vector3d&                     s,
     LightSample&                        light_sample) const
 {
-    assert(m_non_physical_lights_cdf.valid());
+    assert(m_non_physical_lights_table.valid());
 
-    const EmitterCDF::ItemWeightPair result = m_non_physical_lights_cdf.sample(s[0]);
+    const EmitterTable::ItemWeightPair result = m_non_physical_lights_table.sample(s[0]);
     const size_t light_index = result.first;
     const double light_prob = result.second;
 
@@ -417,11 +471,34 @@ void LightSampler::sample_emitting_triangles(
     const Vector3d&                     s,
     LightSample&                        light_sample) const
 {
-    assert(m_emitting_triangles_cdf.valid());
+    sample_emitting_triangles(time, s, true, light_sample);
+}
 
-    const EmitterCDF::ItemWeightPair result = m_emitting_triangles_cdf.sample(s[0]);
+bool LightSampler::sample_emitting_triangles(
+    const double                        time,
+    const Vector3d&                     point,
+    const Vector3d&                     normal,
+    const Vector3d&                     s,
+    LightSample&                        light_sample) const
+{
+    return sample_emitting_triangles(time, point, normal, s, true, light_sample);
+}
+
+void LightSampler::sample_emitting_triangles(
+    const double                        time,
+    const Vector3d&                     s,
+    const bool                          stratified,
+    LightSample&                        light_sample) const
+{
+    assert(m_emitting_triangles_table.valid());
+
+    const EmitterTable::ItemWeightPair result =
+        stratified
+            ? m_emitting_triangles_cdf.sample(s[0])
+            : m_emitting_triangles_table.sample(s[0]);
     const size_t emitter_index = result.first;
     const double emitter_prob = result.second;
+    assert(m_emitting_triangles[emitter_index].m_triangle_prob == emitter_prob);
 
     light_sample.m_light = 0;
     sample_emitting_triangle(
@@ -435,16 +512,51 @@ void LightSampler::sample_emitting_triangles(
     assert(light_sample.m_probability > 0.0);
 }
 
+bool LightSampler::sample_emitting_triangles(
+    const double                        time,
+    const Vector3d&                     point,
+    const Vector3d&                     normal,
+    const Vector3d&                     s,
+    const bool                          stratified,
+    LightSample&                        light_sample) const
+{
+    assert(m_emitting_triangles_table.valid());
+
+    if (m_emitting_triangle_tree.empty())
+    {
+        sample_emitting_triangles(time, s, stratified, light_sample);
+        return true;
+    }
+
+    size_t emitter_index;
+    double emitter_prob;
+    if (!m_emitting_triangle_tree.sample(point, normal, s[0], emitter_index, emitter_prob))
+        return false;
+
+    light_sample.m_light = 0;
+    sample_emitting_triangle(
+        time,
+        Vector2d(s[1], s[2]),
+        emitter_index,
+        emitter_prob,
+        light_sample);
+
+    assert(light_sample.m_triangle);
+    assert(light_sample.m_probability > 0.0);
+
+    return true;
+}
+
 void LightSampler::sample(
     const double                        time,
     const Vector3d&                     s,
     LightSample&                        light_sample) const
 {
-    assert(m_non_physical_lights_cdf.valid() || m_emitting_triangles_cdf.valid());
+    assert(m_non_physical_lights_table.valid() || m_emitting_triangles_table.valid());
 
-    if (m_non_physical_lights_cdf.valid())
+    if (m_non_physical_lights_table.valid())
     {
-        if (m_emitting_triangles_cdf.valid())
+        if (m_emitting_triangles_table.valid())
         {
             if (s[0] < 0.5)
             {
@@ -458,6 +570,7 @@ void LightSampler::sample(
                 sample_emitting_triangles(
                     time,
                     Vector3d((s[0] - 0.5) * 2.0, s[1], s[2]),
+                    false,
                     light_sample);
             }
 
@@ -465,23 +578,69 @@ void LightSampler::sample(
         }
         else sample_non_physical_lights(time, s, light_sample);
     }
-    else sample_emitting_triangles(time, s, light_sample);
+    else sample_emitting_triangles(time, s, false, light_sample);
 }
 
-double LightSampler::evaluate_pdf(const ShadingPoint& shading_point) const
+bool LightSampler::sample(
+    const double                        time,
+    const Vector3d&                     point,
+    const Vector3d&                     normal,
+    const Vector3d&                     s,
+    LightSample&                        light_sample) const
 {
-    assert(shading_point.get_primitive_type() == ShadingPoint::PrimitiveTriangle);
+    assert(m_non_physical_lights_table.valid() || m_emitting_triangles_table.valid());
 
-    const EmittingTriangleKey triangle_key(
-        shading_point.get_assembly_instance().get_uid(),
-        shading_point.get_object_instance_index(),
-        shading_point.get_region_index(),
-        shading_point.get_primitive_index());
+    if (m_non_physical_lights_table.valid())
+    {
+        if (m_emitting_triangles_table.valid())
+        {
+            if (s[0] < 0.5)
+            {
+                sample_non_physical_lights(
+                    time,
+                    Vector3d(s[0] * 2.0, s[1], s[2]),
+                    light_sample);
+            }
+            else
+            {
+                if (!sample_emitting_triangles(
+                        time,
+                        point,
+                        normal,
+                        Vector3d((s[0] - 0.5) * 2.0, s[1], s[2]),
+                        false,
+                        light_sample))
+                    return false;
+            }
+
+            light_sample.m_probability *= 0.5;
+        }
+        else sample_non_physical_lights(time, s, light_sample);
+
+        return true;
+    }
+    else return sample_emitting_triangles(time, point, normal, s, false, light_sample);
+}
 
-    const EmittingTriangle* triangle = m_emitting_triangle_hash_table.get(triangle_key);
+double LightSampler::evaluate_pdf(const ShadingPoint& shading_point) const
+{
+    const EmittingTriangle* triangle = find_emitting_triangle(shading_point);
     return triangle->m_triangle_prob * triangle->m_rcp_area;
 }
 
+double LightSampler::evaluate_pdf(
+    const Vector3d&                     point,
+    const Vector3d&                     normal,
+    const ShadingPoint&                 shading_point) const
+{
+    if (m_emitting_triangle_tree.empty())
+        return evaluate_pdf(shading_point);
+
+    const EmittingTriangle* triangle = find_emitting_triangle(shading_point);
+    const size_t triangle_index = triangle - &m_emitting_triangles[0];
+    return m_emitting_triangle_tree.evaluate_pdf(point, normal, triangle_index) * triangle->m_rcp_area;
+}
+
 void LightSampler::sample_non_physical_light(
     const double                        time,
     const Vector2d&                     s,
@@ -509,7 +668,6 @@ void LightSampler::sample_emitting_triangle(
 {
     // Fetch the emitting triangle.
     const EmittingTriangle& emitting_triangle = m_emitting_triangles[triangle_index];
-    assert(emitting_triangle.m_triangle_prob == triangle_prob);
 
     // Store a pointer to the emitting triangle.
     light_sample.m_triangle = &emitting_triangle;
@@ -548,6 +706,7 @@ void LightSampler::sample_emitting_triangle(
 
 LightSampler::Parameters::Parameters(const ParamArray& params)
   : m_importance_sampling(params.get_optional<bool>("enable_importance_sampling", false))
+  , m_light_tree(params.get_optional<bool>("enable_light_tree", false))
 {
 }
 
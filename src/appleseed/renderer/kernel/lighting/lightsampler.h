@@ -32,12 +32,14 @@
 
 // appleseed.renderer headers.
 #include "renderer/kernel/intersection/intersectionsettings.h"
+#include "renderer/kernel/lighting/lighttree.h"
 #include "renderer/modeling/scene/containers.h"
 #include "renderer/utility/transformsequence.h"
 
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
 #include "foundation/platform/types.h"
+#include "foundation/math/aliastable.h"
 #include "foundation/math/cdf.h"
 #include "foundation/math/hash.h"
 #include "foundation/math/transform.h"
@@ -167,6 +169,17 @@ class LightSample
 // The light sampler collects all the light-emitting entities (non-physical lights, mesh lights)
 // and allows to sample them.
 //
+// By default, emitting triangles are chosen with a probability proportional to their importance
+// only. When the light tree is enabled, the methods taking the position and the normal of the
+// receiving point choose emitting triangles according to their estimated contribution at that
+// point instead; they fall back to the former strategy when the light tree is disabled.
+//
+// sample_emitting_triangles() is meant to be called several times at the same receiving point
+// with a stratified set of samples. It chooses emitting triangles with a CDF, which maps nearby
+// samples to nearby triangles, so that the chosen triangles remain stratified. sample() takes a
+// single light sample at a time and uses alias tables instead, which are faster to sample but do
+// not preserve stratification.
+//
 
 class LightSampler
   : public foundation::NonCopyable
@@ -205,6 +218,15 @@ class LightSampler
         const foundation::Vector3d&         s,
         LightSample&                        light_sample) const;
 
+    // Sample the set of emitting triangles for a given receiving point. The normal at the
+    // receiving point may be zero. Return false if no emitting triangle can light the point.
+    bool sample_emitting_triangles(
+        const double                        time,
+        const foundation::Vector3d&         point,
+        const foundation::Vector3d&         normal,
+        const foundation::Vector3d&         s,
+        LightSample&                        light_sample) const;
+
     // Sample the sets of non-physical lights and emitting triangles.
     void sample(
         const double                        time,
@@ -214,19 +236,37 @@ class LightSampler
         const foundation::Vector4d&         s,
         LightSample&                        light_sample) const;
 
+    // Sample the sets of non-physical lights and emitting triangles for a given receiving point.
+    // The normal at the receiving point may be zero. Return false if no light sample was chosen.
+    bool sample(
+        const double                        time,
+        const foundation::Vector3d&         point,
+        const foundation::Vector3d&         normal,
+        const foundation::Vector3d&         s,
+        LightSample&                        light_sample) const;
+
     // Compute the probability density in area measure of a given light sample.
     double evaluate_pdf(const ShadingPoint& shading_point) const;
 
+    // Compute the probability density in area measure of a given light sample
+    // when sampling for a given receiving point.
+    double evaluate_pdf(
+        const foundation::Vector3d&         point,
+        const foundation::Vector3d&         normal,
+        const ShadingPoint&                 shading_point) const;
+
   private:
     struct Parameters
     {
         const bool m_importance_sampling;
+        const bool m_light_tree;
 
         explicit Parameters(const ParamArray& params);
     };
 
     typedef std::vector<NonPhysicalLightInfo> NonPhysicalLightVector;
     typedef std::vector<EmittingTriangle> EmittingTriangleVector;
+    typedef foundation::AliasTable<size_t, double> EmitterTable;
     typedef foundation::CDF<size_t, double> EmitterCDF;
 
     const Parameters            m_params;
@@ -236,8 +276,10 @@ class LightSampler
 
     EmittingTriangleVector      m_emitting_triangles;
 
-    EmitterCDF                  m_non_physical_lights_cdf;
+    EmitterTable                m_non_physical_lights_table;
+    EmitterTable                m_emitting_triangles_table;
     EmitterCDF                  m_emitting_triangles_cdf;
+    LightTree                   m_emitting_triangle_tree;
 
     EmittingTriangleKeyHasher   m_triangle_key_hasher;
     EmittingTriangleHashTable   m_emitting_triangle_hash_table;
@@ -266,6 +308,26 @@ class LightSampler
     // Build a hash table that allows to find the emitting triangle at a given shading point.
     void build_emitting_triangle_hash_table();
 
+    // Build the light tree of emitting triangles.
+    void build_emitting_triangle_tree();
+
+    // Find the emitting triangle at a given shading point.
+    const EmittingTriangle* find_emitting_triangle(const ShadingPoint& shading_point) const;
+
+    // Sample the set of emitting triangles, with the CDF if stratified is true or with the alias table otherwise.
+    void sample_emitting_triangles(
+        const double                        time,
+        const foundation::Vector3d&         s,
+        const bool                          stratified,
+        LightSample&                        light_sample) const;
+    bool sample_emitting_triangles(
+        const double                        time,
+        const foundation::Vector3d&         point,
+        const foundation::Vector3d&         normal,
+        const foundation::Vector3d&         s,
+        const bool                          stratified,
+        LightSample&                        light_sample) const;
+
     // Sample a given non-physical light.
     void sample_non_physical_light(
         const double                        time,
@@ -345,7 +407,7 @@ inline size_t LightSampler::get_emitting_triangle_count() const
 
 inline bool LightSampler::has_lights_or_emitting_triangles() const
 {
-    return m_non_physical_lights_cdf.valid() || m_emitting_triangles_cdf.valid();
+    return m_non_physical_lights_table.valid() || m_emitting_triangles_table.valid();
 }
 
 inline void LightSampler::sample_non_physical_light(
@@ -501,6 +501,8 @@ namespace
             const size_t                sequence_index,
             SampleVector&               samples) OVERRIDE
         {
+            m_shading_context.get_arena().clear();
+
             SamplingContext sampling_context(
                 m_rng,
                 0,
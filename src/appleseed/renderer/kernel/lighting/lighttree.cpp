@@ -0,0 +1,365 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "lighttree.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/scalar.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+namespace
+{
+    const size_t NoParent = ~size_t(0);
+
+    // Return cos(max(0, a - b)) given the sines and cosines of a and b.
+    inline double cos_sub_clamped(
+        const double    sin_a,
+        const double    cos_a,
+        const double    sin_b,
+        const double    cos_b)
+    {
+        return cos_a > cos_b ? 1.0 : cos_a * cos_b + sin_a * sin_b;
+    }
+
+    // Return sin(max(0, a - b)) given the sines and cosines of a and b.
+    inline double sin_sub_clamped(
+        const double    sin_a,
+        const double    cos_a,
+        const double    sin_b,
+        const double    cos_b)
+    {
+        return cos_a > cos_b ? 0.0 : sin_a * cos_b - cos_a * sin_b;
+    }
+
+    inline double sin_from_cos(const double cos_theta)
+    {
+        return sqrt(max(1.0 - cos_theta * cos_theta, 0.0));
+    }
+
+    struct CentroidOrder
+    {
+        const vector<LightTree::Item>&  m_items;
+        const size_t                    m_dim;
+
+        CentroidOrder(
+            const vector<LightTree::Item>&  items,
+            const size_t                    dim)
+          : m_items(items)
+          , m_dim(dim)
+        {
+        }
+
+        bool operator()(const size_t lhs, const size_t rhs) const
+        {
+            return m_items[lhs].m_bbox.center(m_dim) < m_items[rhs].m_bbox.center(m_dim);
+        }
+    };
+}
+
+
+//
+// DirectionCone class implementation.
+//
+
+DirectionCone DirectionCone::merge(const DirectionCone& a, const DirectionCone& b)
+{
+    const double theta_a = acos(clamp(a.m_cos_theta, -1.0, 1.0));
+    const double theta_b = acos(clamp(b.m_cos_theta, -1.0, 1.0));
+    const double theta_d = acos(clamp(dot(a.m_axis, b.m_axis), -1.0, 1.0));
+
+    // Return one of the cones if it contains the other.
+    if (min(theta_d + theta_b, Pi) <= theta_a)
+        return a;
+    if (min(theta_d + theta_a, Pi) <= theta_b)
+        return b;
+
+    DirectionCone result(a.m_axis);
+
+    // Return the whole sphere of directions if the cones cannot be bounded more tightly.
+    const double theta_o = 0.5 * (theta_a + theta_d + theta_b);
+    const Vector3d rotation_axis = cross(a.m_axis, b.m_axis);
+    if (theta_o >= Pi || square_norm(rotation_axis) == 0.0)
+    {
+        result.m_cos_theta = -1.0;
+        return result;
+    }
+
+    // Rotate the axis of the first cone toward the axis of the second one.
+    const double theta_r = theta_o - theta_a;
+    const Vector3d k = normalize(rotation_axis);
+    result.m_axis = normalize(a.m_axis * cos(theta_r) + cross(k, a.m_axis) * sin(theta_r));
+    result.m_cos_theta = cos(theta_o);
+
+    return result;
+}
+
+
+//
+// LightTree class implementation.
+//
+
+LightTree::LightTree()
+{
+}
+
+void LightTree::build(const vector<Item>& items)
+{
+    m_nodes.clear();
+    m_item_leaves.assign(items.size(), NoParent);
+
+    if (items.empty())
+        return;
+
+    m_nodes.reserve(2 * items.size() - 1);
+
+    vector<size_t> indices(items.size());
+    for (size_t i = 0; i < items.size(); ++i)
+        indices[i] = i;
+
+    build_node(items, indices, 0, items.size(), NoParent);
+
+    assert(m_nodes.size() == 2 * items.size() - 1);
+}
+
+size_t LightTree::build_node(
+    const vector<Item>&         items,
+    vector<size_t>&             indices,
+    const size_t                begin,
+    const size_t                end,
+    const size_t                parent)
+{
+    assert(end > begin);
+
+    const size_t node_index = m_nodes.size();
+    m_nodes.push_back(Node());
+    m_nodes[node_index].m_parent = parent;
+
+    if (end - begin == 1)
+    {
+        const size_t item_index = indices[begin];
+        const Item& item = items[item_index];
+
+        Node& node = m_nodes[node_index];
+        node.m_bbox = item.m_bbox;
+        node.m_normals = item.m_normals;
+        node.m_power = item.m_power;
+        node.m_child = item_index;
+        node.m_leaf = true;
+
+        m_item_leaves[item_index] = node_index;
+
+        return node_index;
+    }
+
+    // Split the items in two halves along the dimension of largest centroid extent.
+    AABB3d centroid_bbox;
+    centroid_bbox.invalidate();
+    for (size_t i = begin; i < end; ++i)
+        centroid_bbox.insert(items[indices[i]].m_bbox.center());
+
+    const size_t middle = (begin + end) / 2;
+    nth_element(
+        indices.begin() + begin,
+        indices.begin() + middle,
+        indices.begin() + end,
+        CentroidOrder(items, max_index(centroid_bbox.extent())));
+
+    // Build the children. The first child immediately follows its parent.
+    const size_t left_index = build_node(items, indices, begin, middle, node_index);
+    const size_t right_index = build_node(items, indices, middle, end, node_index);
+    assert(left_index == node_index + 1);
+
+    const Node& left = m_nodes[left_index];
+    const Node& right = m_nodes[right_index];
+
+    Node& node = m_nodes[node_index];
+    node.m_bbox = left.m_bbox;
+    node.m_bbox.insert(right.m_bbox);
+    node.m_normals = DirectionCone::merge(left.m_normals, right.m_normals);
+    node.m_power = left.m_power + right.m_power;
+    node.m_child = right_index;
+    node.m_leaf = false;
+
+    return node_index;
+}
+
+bool LightTree::sample(
+    const Vector3d&             point,
+    const Vector3d&             normal,
+    const double                s,
+    size_t&                     item_index,
+    double&                     probability) const
+{
+    assert(s >= 0.0 && s < 1.0);
+
+    if (!contributes(point, normal))
+        return false;
+
+    size_t node_index = 0;
+    double prob = 1.0;
+    double u = s;
+
+    while (!m_nodes[node_index].m_leaf)
+    {
+        const size_t left_index = node_index + 1;
+        const size_t right_index = m_nodes[node_index].m_child;
+
+        const double left_importance = compute_importance(m_nodes[left_index], point, normal);
+        const double right_importance = compute_importance(m_nodes[right_index], point, normal);
+        const double total_importance = left_importance + right_importance;
+
+        if (total_importance == 0.0)
+            return false;
+
+        // Choose a child and reuse the sample for the next level.
+        const double left_prob = left_importance / total_importance;
+        if (u < left_prob || right_importance == 0.0)
+        {
+            node_index = left_index;
+            prob *= left_prob;
+            u = u / left_prob;
+        }
+        else
+        {
+            node_index = right_index;
+            prob *= 1.0 - left_prob;
+            u = (u - left_prob) / (1.0 - left_prob);
+        }
+    }
+
+    assert(prob > 0.0);
+
+    item_index = m_nodes[node_index].m_child;
+    probability = prob;
+
+    return true;
+}
+
+double LightTree::evaluate_pdf(
+    const Vector3d&             point,
+    const Vector3d&             normal,
+    const size_t                item_index) const
+{
+    assert(item_index < m_item_leaves.size());
+
+    if (!contributes(point, normal))
+        return 0.0;
+
+    size_t node_index = m_item_leaves[item_index];
+    double prob = 1.0;
+
+    // Walk up to the root, accumulating the probability of each choice.
+    while (m_nodes[node_index].m_parent != NoParent)
+    {
+        const size_t parent_index = m_nodes[node_index].m_parent;
+        const size_t left_index = parent_index + 1;
+        const size_t right_index = m_nodes[parent_index].m_child;
+
+        const double left_importance = compute_importance(m_nodes[left_index], point, normal);
+        const double right_importance = compute_importance(m_nodes[right_index], point, normal);
+        const double total_importance = left_importance + right_importance;
+
+        if (total_importance == 0.0)
+            return 0.0;
+
+        prob *= (node_index == left_index ? left_importance : right_importance) / total_importance;
+        node_index = parent_index;
+    }
+
+    return prob;
+}
+
+bool LightTree::contributes(
+    const Vector3d&             point,
+    const Vector3d&             normal) const
+{
+    return !m_nodes.empty() && compute_importance(m_nodes[0], point, normal) > 0.0;
+}
+
+double LightTree::compute_importance(
+    const Node&                 node,
+    const Vector3d&             point,
+    const Vector3d&             normal) const
+{
+    const Vector3d center = node.m_bbox.center();
+    const Vector3d to_point = point - center;
+    const double square_distance = square_norm(to_point);
+    const double square_radius = 0.25 * square_norm(node.m_bbox.extent());
+
+    // Don't let the importance blow up when the point is close to or inside the node.
+    const double rcp_clamped_square_distance = 1.0 / max(square_distance, square_radius);
+
+    // Nothing can be culled if the point is inside the bounding sphere of the node.
+    if (square_distance <= square_radius)
+        return node.m_power * rcp_clamped_square_distance;
+
+    // Bound the angle subtended by the node as seen from the point.
+    const double sin2_theta_b = square_radius / square_distance;
+    const double sin_theta_b = sqrt(sin2_theta_b);
+    const double cos_theta_b = sqrt(1.0 - sin2_theta_b);
+
+    // Compute the smallest angle between the emitters' normals and the direction toward the point.
+    const Vector3d wi = to_point / sqrt(square_distance);
+    const double cos_theta_w = dot(node.m_normals.m_axis, wi);
+    const double sin_theta_w = sin_from_cos(cos_theta_w);
+    const double cos_theta_o = node.m_normals.m_cos_theta;
+    const double sin_theta_o = sin_from_cos(cos_theta_o);
+    const double cos_theta_x = cos_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    const double sin_theta_x = sin_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    const double cos_theta = cos_sub_clamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+
+    // Emitters only emit over the hemisphere around their normal.
+    if (cos_theta <= 0.0)
+        return 0.0;
+
+    double importance = node.m_power * cos_theta * rcp_clamped_square_distance;
+
+    // Account for the orientation of the receiving surface, if any.
+    if (normal != Vector3d(0.0))
+    {
+        const double cos_theta_i = abs(dot(wi, normal));
+        const double sin_theta_i = sin_from_cos(cos_theta_i);
+        importance *= cos_sub_clamped(sin_theta_i, cos_theta_i, sin_theta_b, cos_theta_b);
+    }
+
+    return importance;
+}
+
+}   // namespace renderer
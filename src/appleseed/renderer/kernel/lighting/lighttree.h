@@ -0,0 +1,183 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_RENDERER_KERNEL_LIGHTING_LIGHTTREE_H
+#define APPLESEED_RENDERER_KERNEL_LIGHTING_LIGHTTREE_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/vector.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+namespace renderer
+{
+
+//
+// A cone of directions, defined by a unit-length axis and the cosine of its half-angle.
+//
+
+class DirectionCone
+{
+  public:
+    foundation::Vector3d        m_axis;
+    double                      m_cos_theta;
+
+    // Constructors.
+    DirectionCone();            // leave all fields uninitialized
+    explicit DirectionCone(const foundation::Vector3d& direction);
+
+    // Return the smallest cone (as computed by a conservative approximation) containing two cones.
+    static DirectionCone merge(const DirectionCone& a, const DirectionCone& b);
+};
+
+
+//
+// A light tree is a bounding volume hierarchy over a set of emitters, where each node
+// also bounds the orientation of the emitters and stores their total power. It allows
+// to choose an emitter with a probability roughly proportional to its contribution at
+// a given point, in time logarithmic in the number of emitters.
+//
+// Emitters are assumed to emit over the hemisphere around each of their normals.
+//
+// Reference:
+//
+//   Importance Sampling of Many Lights with Adaptive Tree Splitting
+//   Alejandro Conty Estevez, Christopher Kulla
+//   http://www.aconty.com/pdf/many-lights-hpg2018.pdf
+//
+
+class LightTree
+  : public foundation::NonCopyable
+{
+  public:
+    // An emitter, as seen by the light tree.
+    struct Item
+    {
+        foundation::AABB3d      m_bbox;                 // world space bounding box of the emitter
+        DirectionCone           m_normals;              // bounds of the emitter's normals
+        double                  m_power;                // power or importance of the emitter, positive
+    };
+
+    // Constructor, builds an empty tree.
+    LightTree();
+
+    // Build the tree. Item indices are preserved.
+    void build(const std::vector<Item>& items);
+
+    // Return true if the tree is empty.
+    bool empty() const;
+
+    // Return the number of nodes in the tree.
+    size_t get_node_count() const;
+
+    // Choose an item for a point with a given unit-length normal (the normal may be
+    // zero if the point is not on a surface). Return false if no item can contribute
+    // to the point, in which case item_index and probability are left untouched.
+    bool sample(
+        const foundation::Vector3d&     point,
+        const foundation::Vector3d&     normal,
+        const double                    s,
+        size_t&                         item_index,
+        double&                         probability) const;
+
+    // Return the probability that sample() chooses a given item.
+    double evaluate_pdf(
+        const foundation::Vector3d&     point,
+        const foundation::Vector3d&     normal,
+        const size_t                    item_index) const;
+
+    // Return true if at least one item can contribute to a given point.
+    bool contributes(
+        const foundation::Vector3d&     point,
+        const foundation::Vector3d&     normal) const;
+
+  private:
+    struct Node
+    {
+        foundation::AABB3d      m_bbox;
+        DirectionCone           m_normals;
+        double                  m_power;
+        size_t                  m_parent;               // index of the parent node, ~0 for the root
+        size_t                  m_child;                // index of the second child (interior nodes) or of the item (leaves)
+        bool                    m_leaf;
+    };
+
+    std::vector<Node>           m_nodes;                // depth-first order: the first child of a node follows it
+    std::vector<size_t>         m_item_leaves;          // index of the leaf holding each item
+
+    size_t build_node(
+        const std::vector<Item>&        items,
+        std::vector<size_t>&            indices,
+        const size_t                    begin,
+        const size_t                    end,
+        const size_t                    parent);
+
+    double compute_importance(
+        const Node&                     node,
+        const foundation::Vector3d&     point,
+        const foundation::Vector3d&     normal) const;
+};
+
+
+//
+// DirectionCone class implementation.
+//
+
+inline DirectionCone::DirectionCone()
+{
+}
+
+inline DirectionCone::DirectionCone(const foundation::Vector3d& direction)
+  : m_axis(direction)
+  , m_cos_theta(1.0)
+{
+}
+
+
+//
+// LightTree class implementation.
+//
+
+inline bool LightTree::empty() const
+{
+    return m_nodes.empty();
+}
+
+inline size_t LightTree::get_node_count() const
+{
+    return m_nodes.size();
+}
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_LIGHTTREE_H
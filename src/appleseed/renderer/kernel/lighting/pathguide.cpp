@@ -0,0 +1,447 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "pathguide.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/scalar.h"
+#include "foundation/platform/thread.h"
+#include "foundation/utility/casts.h"
+
+// Standard headers.
+#include <cassert>
+#include <cmath>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+namespace
+{
+    const uint32 NoChild = 0;
+    const size_t NoSource = ~size_t(0);
+
+    struct RefineItem
+    {
+        size_t  m_source_index;         // index of the corresponding source node, or NoSource if there is none
+        double  m_energy;               // energy of the corresponding source node
+        size_t  m_index;                // index of the node in the refined tree
+        size_t  m_depth;
+    };
+
+    // Find the quadrant of the unit square containing a given point,
+    // and remap the point to the unit square of this quadrant.
+    inline size_t find_quadrant(Vector2d& point)
+    {
+        const size_t x = point[0] >= 0.5 ? 1 : 0;
+        const size_t y = point[1] >= 0.5 ? 1 : 0;
+
+        point[0] = min(point[0] * 2.0 - x, 1.0);
+        point[1] = min(point[1] * 2.0 - y, 1.0);
+
+        return x + 2 * y;
+    }
+
+    // Choose between two events given their weights, and remap the sample to [0, 1).
+    inline bool choose_second(
+        const double    w0,
+        const double    w1,
+        double&         s)
+    {
+        const double p0 = w0 / (w0 + w1);
+
+        if (s < p0)
+        {
+            s /= p0;
+            return false;
+        }
+        else
+        {
+            s = (s - p0) / (1.0 - p0);
+            return true;
+        }
+    }
+}
+
+
+//
+// DirectionalQuadtree class implementation.
+//
+
+DirectionalQuadtree::Node::Node()
+{
+    for (size_t i = 0; i < 4; ++i)
+    {
+        m_energy[i] = binary_cast<uint32>(0.0f);
+        m_children[i] = NoChild;
+    }
+}
+
+float DirectionalQuadtree::Node::get_energy(const size_t quadrant) const
+{
+    return binary_cast<float>(m_energy[quadrant]);
+}
+
+float DirectionalQuadtree::Node::get_energy() const
+{
+    return get_energy(0) + get_energy(1) + get_energy(2) + get_energy(3);
+}
+
+DirectionalQuadtree::DirectionalQuadtree()
+  : m_nodes(1)
+{
+}
+
+double DirectionalQuadtree::get_energy() const
+{
+    return m_nodes[0].get_energy();
+}
+
+void DirectionalQuadtree::record(const Vector3d& direction, const float energy)
+{
+    Vector2d point = direction_to_square(direction);
+    size_t node_index = 0;
+
+    while (true)
+    {
+        Node& node = m_nodes[node_index];
+        const size_t quadrant = find_quadrant(point);
+
+        if (node.m_children[quadrant] == NoChild)
+        {
+            atomic_add(&node.m_energy[quadrant], energy);
+            return;
+        }
+
+        node_index = node.m_children[quadrant];
+    }
+}
+
+void DirectionalQuadtree::build()
+{
+    // Children always come after their parent: visit the nodes in reverse order.
+    for (size_t i = m_nodes.size(); i > 0; --i)
+    {
+        Node& node = m_nodes[i - 1];
+
+        for (size_t q = 0; q < 4; ++q)
+        {
+            if (node.m_children[q] != NoChild)
+                node.m_energy[q] = binary_cast<uint32>(m_nodes[node.m_children[q]].get_energy());
+        }
+    }
+}
+
+void DirectionalQuadtree::refine(
+    const DirectionalQuadtree&  source,
+    const double                threshold,
+    const size_t                max_depth)
+{
+    assert(this != &source);
+
+    const double total_energy = source.get_energy();
+
+    m_nodes.assign(1, Node());
+
+    // Without any light to guide the subdivision, keep the structure of the source tree.
+    if (total_energy <= 0.0)
+    {
+        for (size_t i = 1; i < source.m_nodes.size(); ++i)
+            m_nodes.push_back(Node());
+
+        for (size_t i = 0; i < source.m_nodes.size(); ++i)
+        {
+            for (size_t q = 0; q < 4; ++q)
+                m_nodes[i].m_children[q] = source.m_nodes[i].m_children[q];
+        }
+
+        return;
+    }
+
+    vector<RefineItem> stack;
+    const RefineItem root = { 0, total_energy, 0, 1 };
+    stack.push_back(root);
+
+    while (!stack.empty())
+    {
+        const RefineItem item = stack.back();
+        stack.pop_back();
+
+        if (item.m_depth >= max_depth)
+            continue;
+
+        for (size_t q = 0; q < 4; ++q)
+        {
+            // Energy of the quadrant in the source tree. Where the source tree is
+            // not subdivided, assume that the energy is uniformly distributed.
+            const Node* source_node =
+                item.m_source_index != NoSource ? &source.m_nodes[item.m_source_index] : 0;
+            const double energy =
+                source_node ? source_node->get_energy(q) : item.m_energy * 0.25;
+
+            if (energy / total_energy <= threshold)
+                continue;
+
+            const size_t child_index = m_nodes.size();
+            m_nodes.push_back(Node());
+            m_nodes[item.m_index].m_children[q] = static_cast<uint32>(child_index);
+
+            RefineItem child;
+            child.m_source_index =
+                source_node && source_node->m_children[q] != NoChild
+                    ? source_node->m_children[q]
+                    : NoSource;
+            child.m_energy = energy;
+            child.m_index = child_index;
+            child.m_depth = item.m_depth + 1;
+            stack.push_back(child);
+        }
+    }
+}
+
+Vector3d DirectionalQuadtree::sample(
+    const Vector2d&             s,
+    double&                     probability) const
+{
+    assert(get_energy() > 0.0);
+
+    Vector2d local_s = s;
+    Vector2d origin(0.0);
+    double size = 1.0;
+    double pdf = 1.0;
+    size_t node_index = 0;
+
+    while (true)
+    {
+        const Node& node = m_nodes[node_index];
+
+        const double e0 = node.get_energy(0);
+        const double e1 = node.get_energy(1);
+        const double e2 = node.get_energy(2);
+        const double e3 = node.get_energy(3);
+
+        // First choose a column, then a quadrant in this column.
+        const size_t x = choose_second(e0 + e2, e1 + e3, local_s[0]) ? 1 : 0;
+        const size_t y =
+            x == 0
+                ? (choose_second(e0, e2, local_s[1]) ? 1 : 0)
+                : (choose_second(e1, e3, local_s[1]) ? 1 : 0);
+        const size_t quadrant = x + 2 * y;
+
+        pdf *= 4.0 * node.get_energy(quadrant) / (e0 + e1 + e2 + e3);
+
+        size *= 0.5;
+        origin[0] += x * size;
+        origin[1] += y * size;
+
+        if (node.m_children[quadrant] == NoChild)
+        {
+            const Vector2d point(
+                min(origin[0] + local_s[0] * size, 1.0),
+                min(origin[1] + local_s[1] * size, 1.0));
+
+            probability = pdf * (1.0 / (4.0 * Pi));
+            return square_to_direction(point);
+        }
+
+        node_index = node.m_children[quadrant];
+    }
+}
+
+double DirectionalQuadtree::evaluate_pdf(const Vector3d& direction) const
+{
+    Vector2d point = direction_to_square(direction);
+    double pdf = 1.0;
+    size_t node_index = 0;
+
+    while (true)
+    {
+        const Node& node = m_nodes[node_index];
+
+        const double total_energy = node.get_energy();
+        if (total_energy <= 0.0)
+            return 0.0;
+
+        const size_t quadrant = find_quadrant(point);
+        pdf *= 4.0 * node.get_energy(quadrant) / total_energy;
+
+        if (node.m_children[quadrant] == NoChild)
+            return pdf * (1.0 / (4.0 * Pi));
+
+        node_index = node.m_children[quadrant];
+    }
+}
+
+Vector2d DirectionalQuadtree::direction_to_square(const Vector3d& direction)
+{
+    const double u = clamp(0.5 * (direction[2] + 1.0), 0.0, 1.0);
+    double v = atan2(direction[1], direction[0]) * RcpTwoPi;
+
+    if (v < 0.0)
+        v += 1.0;
+
+    return Vector2d(u, min(v, 1.0));
+}
+
+Vector3d DirectionalQuadtree::square_to_direction(const Vector2d& point)
+{
+    const double z = 2.0 * point[0] - 1.0;
+    const double r = sqrt(max(1.0 - z * z, 0.0));
+    const double phi = TwoPi * point[1];
+
+    return Vector3d(r * cos(phi), r * sin(phi), z);
+}
+
+
+//
+// PathGuide class implementation.
+//
+
+namespace
+{
+    const size_t MaxDirectionalDepth = 20;
+}
+
+PathGuide::PathGuide(
+    const AABB3d&               bbox,
+    const size_t                spatial_threshold,
+    const double                directional_threshold,
+    const double                bsdf_sampling_fraction)
+  : m_bbox(bbox)
+  , m_spatial_threshold(spatial_threshold)
+  , m_directional_threshold(directional_threshold)
+  , m_bsdf_sampling_fraction(bsdf_sampling_fraction)
+  , m_iteration_count(0)
+{
+    const SpatialNode root = { 0, 0, true };
+    m_nodes.push_back(root);
+
+    m_cells.resize(1);
+    m_cells[0].m_record_count = 0;
+}
+
+const DirectionalQuadtree* PathGuide::get_distribution(const Vector3d& point) const
+{
+    const DirectionalQuadtree& tree = m_cells[find_cell(point)].m_sampling_tree;
+    return tree.get_energy() > 0.0 ? &tree : 0;
+}
+
+void PathGuide::record(
+    const Vector3d&             point,
+    const Vector3d&             direction,
+    const float                 radiance)
+{
+    SpatialCell& cell = m_cells[find_cell(point)];
+
+    cell.m_recording_tree.record(direction, radiance);
+    boost_atomic::atomic_inc32(&cell.m_record_count);
+}
+
+void PathGuide::update()
+{
+    for (size_t i = 0; i < m_cells.size(); ++i)
+        m_cells[i].m_recording_tree.build();
+
+    split_cells();
+
+    for (size_t i = 0; i < m_cells.size(); ++i)
+    {
+        SpatialCell& cell = m_cells[i];
+
+        cell.m_sampling_tree = cell.m_recording_tree;
+        cell.m_recording_tree.refine(
+            cell.m_sampling_tree,
+            m_directional_threshold,
+            MaxDirectionalDepth);
+        cell.m_record_count = 0;
+    }
+
+    ++m_iteration_count;
+}
+
+size_t PathGuide::find_cell(const Vector3d& point) const
+{
+    Vector3d min_point = m_bbox.min;
+    Vector3d max_point = m_bbox.max;
+    size_t node_index = 0;
+
+    while (!m_nodes[node_index].m_leaf)
+    {
+        const SpatialNode& node = m_nodes[node_index];
+        const double middle = 0.5 * (min_point[node.m_axis] + max_point[node.m_axis]);
+
+        if (point[node.m_axis] < middle)
+        {
+            max_point[node.m_axis] = middle;
+            node_index = node.m_index;
+        }
+        else
+        {
+            min_point[node.m_axis] = middle;
+            node_index = node.m_index + 1;
+        }
+    }
+
+    return m_nodes[node_index].m_index;
+}
+
+void PathGuide::split_cells()
+{
+    // New nodes are appended and visited in turn, so cells keep being split
+    // until their share of the records falls below the threshold.
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        if (!m_nodes[i].m_leaf)
+            continue;
+
+        const size_t cell_index = m_nodes[i].m_index;
+
+        if (m_cells[cell_index].m_record_count <= m_spatial_threshold)
+            continue;
+
+        // The records are assumed to be evenly split between the two halves.
+        m_cells[cell_index].m_record_count /= 2;
+        const size_t new_cell_index = m_cells.size();
+        m_cells.push_back(m_cells[cell_index]);
+
+        const size_t child_axis = (m_nodes[i].m_axis + 1) % 3;
+        const SpatialNode child0 = { child_axis, cell_index, true };
+        const SpatialNode child1 = { child_axis, new_cell_index, true };
+
+        m_nodes[i].m_index = m_nodes.size();
+        m_nodes[i].m_leaf = false;
+        m_nodes.push_back(child0);
+        m_nodes.push_back(child1);
+    }
+}
+
+}   // namespace renderer
@@ -0,0 +1,216 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_RENDERER_KERNEL_LIGHTING_PATHGUIDE_H
+#define APPLESEED_RENDERER_KERNEL_LIGHTING_PATHGUIDE_H
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+namespace renderer
+{
+
+//
+// A quadtree over the sphere of directions, storing the amount of light arriving from each cell.
+//
+// Directions are mapped to the unit square with the (area-preserving) cylindrical mapping,
+// so that a uniform density over the square is a uniform density over the sphere.
+//
+
+class DirectionalQuadtree
+{
+  public:
+    // Constructor, builds a tree with a single node and no energy.
+    DirectionalQuadtree();
+
+    // Return the number of nodes in the tree.
+    size_t get_node_count() const;
+
+    // Return the total energy stored in the tree. Only valid after build() was called.
+    double get_energy() const;
+
+    // Add some energy to the cell containing a given direction. Thread-safe.
+    void record(const foundation::Vector3d& direction, const float energy);
+
+    // Propagate the energy recorded in the leaves up to the root.
+    void build();
+
+    // Replace this tree by an empty tree whose cells are subdivided where the
+    // fraction of the energy of a given (built) tree exceeds a threshold.
+    void refine(
+        const DirectionalQuadtree&      source,
+        const double                    threshold,
+        const size_t                    max_depth);
+
+    // Sample the tree, choosing a direction with a probability proportional to the energy
+    // of its cell. Only valid if the tree was built and has some energy.
+    foundation::Vector3d sample(
+        const foundation::Vector2d&     s,
+        double&                         probability) const;     // PDF value wrt. solid angle
+
+    // Compute the probability density wrt. solid angle of sample() returning a given direction.
+    double evaluate_pdf(const foundation::Vector3d& direction) const;
+
+    // Map a unit-length direction to the unit square, and back.
+    static foundation::Vector2d direction_to_square(const foundation::Vector3d& direction);
+    static foundation::Vector3d square_to_direction(const foundation::Vector2d& point);
+
+  private:
+    struct Node
+    {
+        foundation::uint32      m_energy[4];            // energy of each quadrant, as single-precision floats
+        foundation::uint32      m_children[4];          // index of the node subdividing each quadrant, 0 if none
+
+        Node();
+
+        float get_energy(const size_t quadrant) const;
+        float get_energy() const;
+    };
+
+    std::vector<Node>           m_nodes;                // children always come after their parent
+};
+
+
+//
+// A path guide learns the distribution of light arriving at the points of the scene and
+// allows to sample directions according to it. It is a binary tree subdividing the scene
+// in space (alternating between the three axes), where each leaf holds two directional
+// quadtrees: one in which light is recorded while rendering, and one learned during
+// the previous training iteration which is used for sampling.
+//
+// Recording is thread-safe. Sampling is thread-safe, and can run concurrently with
+// recording. update() must be called while neither is in progress.
+//
+// Reference:
+//
+//   Practical Path Guiding for Efficient Light-Transport Simulation
+//   Thomas Mueller, Markus Gross, Jan Novák
+//   https://tom94.net/data/publications/mueller17practical/mueller17practical.pdf
+//
+
+class PathGuide
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor.
+    PathGuide(
+        const foundation::AABB3d&       bbox,                   // world space bounding box of the scene
+        const size_t                    spatial_threshold,      // number of records above which a spatial cell is split
+        const double                    directional_threshold,  // fraction of the energy above which a directional cell is split
+        const double                    bsdf_sampling_fraction);
+
+    // Return the probability with which the BSDF rather than the guide should be sampled.
+    double get_bsdf_sampling_fraction() const;
+
+    // Return the number of training iterations so far.
+    size_t get_iteration_count() const;
+
+    // Return the number of spatial cells.
+    size_t get_spatial_cell_count() const;
+
+    // Return the distribution of light learned around a given point, or 0 if none.
+    const DirectionalQuadtree* get_distribution(const foundation::Vector3d& point) const;
+
+    // Record some light arriving at a given point from a given direction. Thread-safe.
+    void record(
+        const foundation::Vector3d&     point,
+        const foundation::Vector3d&     direction,              // world space direction toward the light, unit-length
+        const float                     radiance);
+
+    // Use the light recorded so far for sampling, and start a new training iteration.
+    void update();
+
+  private:
+    struct SpatialNode
+    {
+        size_t                  m_axis;
+        size_t                  m_index;                // index of the first child, or of the cell for leaves
+        bool                    m_leaf;
+    };
+
+    struct SpatialCell
+    {
+        DirectionalQuadtree     m_sampling_tree;
+        DirectionalQuadtree     m_recording_tree;
+        foundation::uint32      m_record_count;
+    };
+
+    const foundation::AABB3d    m_bbox;
+    const size_t                m_spatial_threshold;
+    const double                m_directional_threshold;
+    const double                m_bsdf_sampling_fraction;
+    size_t                      m_iteration_count;
+    std::vector<SpatialNode>    m_nodes;
+    std::vector<SpatialCell>    m_cells;
+
+    size_t find_cell(const foundation::Vector3d& point) const;
+
+    void split_cells();
+};
+
+
+//
+// DirectionalQuadtree class implementation.
+//
+
+inline size_t DirectionalQuadtree::get_node_count() const
+{
+    return m_nodes.size();
+}
+
+
+//
+// PathGuide class implementation.
+//
+
+inline double PathGuide::get_bsdf_sampling_fraction() const
+{
+    return m_bsdf_sampling_fraction;
+}
+
+inline size_t PathGuide::get_iteration_count() const
+{
+    return m_iteration_count;
+}
+
+inline size_t PathGuide::get_spatial_cell_count() const
+{
+    return m_cells.size();
+}
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_PATHGUIDE_H
@@ -34,6 +34,7 @@
 #include "renderer/global/globallogger.h"
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/intersection/intersector.h"
+#include "renderer/kernel/lighting/pathguide.h"
 #include "renderer/kernel/lighting/pathvertex.h"
 #include "renderer/kernel/shading/shadingcontext.h"
 #include "renderer/kernel/shading/shadingpoint.h"
@@ -51,12 +52,14 @@
 #include "foundation/core/concepts/noncopyable.h"
 #include "foundation/math/basis.h"
 #include "foundation/math/rr.h"
+#include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
 #include "foundation/utility/string.h"
 
 // Standard headers.
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
 
 // Forward declarations.
@@ -79,7 +82,8 @@ class PathTracer
         const size_t            rr_min_path_length,
         const size_t            max_path_length,
         const size_t            max_iterations = 1000,
-        const double            near_start = 0.0);          // abort tracing if the first ray is shorter than this
+        const double            near_start = 0.0,           // abort tracing if the first ray is shorter than this
+        const PathGuide*        path_guide = 0);            // optional guide for sampling scattering directions
 
     size_t trace(
         SamplingContext&        sampling_context,
@@ -98,6 +102,21 @@ class PathTracer
     const size_t                m_max_path_length;
     const size_t                m_max_iterations;
     const double                m_near_start;
+    const PathGuide*            m_path_guide;
+
+    // Sample the BSDF at a given vertex, or a mixture of the BSDF and of the path guide when one is
+    // available. The value is not divided by the probability density, like for BSDF::sample().
+    BSDF::Mode sample_bsdf(
+        SamplingContext&        sampling_context,
+        const PathVertex&       vertex,
+        foundation::Vector3d&   incoming,
+        Spectrum&               value,
+        double&                 probability,                // PDF value of the sampling strategy
+        double&                 bsdf_probability) const;    // PDF value of the BSDF alone
+
+    // Estimate the angular spread of a non-specular lobe from the probability density of a sample:
+    // a lobe of density p covers a solid angle of about 1/p, i.e. a cone of half-angle 1/sqrt(Pi * p).
+    static double compute_lobe_spread(const double probability);
 
     // Determine the appropriate ray type for a given scattering mode.
     static ShadingRay::Type bsdf_mode_to_ray_type(
@@ -120,12 +139,14 @@ inline PathTracer<PathVisitor, Adjoint>::PathTracer(
     const size_t                rr_min_path_length,
     const size_t                max_path_length,
     const size_t                max_iterations,
-    const double                near_start)
+    const double                near_start,
+    const PathGuide*            path_guide)
   : m_path_visitor(path_visitor)
   , m_rr_min_path_length(rr_min_path_length)
   , m_max_path_length(max_path_length)
   , m_max_iterations(max_iterations)
   , m_near_start(near_start)
+  , m_path_guide(path_guide)
 {
 }
 
@@ -219,7 +240,7 @@ size_t PathTracer<PathVisitor, Adjoint>::trace(
                     // Evaluate the alpha map at the shading point.
                     material->get_alpha_map()->evaluate(
                         shading_context.get_texture_cache(),
-                        vertex.get_uv(0),
+                        vertex.m_shading_point->get_source_inputs(0),
                         alpha);
                 }
 
@@ -240,12 +261,13 @@ size_t PathTracer<PathVisitor, Adjoint>::trace(
                 if (pass_through(sampling_context, alpha))
                 {
                     // Construct a ray that continues in the same direction as the incoming ray.
-                    const ShadingRay cutoff_ray(
+                    ShadingRay cutoff_ray(
                         vertex.get_point(),
                         ray.m_dir,
                         ray.m_time,
                         ray.m_type,
                         ray.m_depth);   // ray depth does not increase when passing through an alpha-mapped surface
+                    cutoff_ray.copy_differentials(ray);
 
                     // Trace the ray.
                     shading_points[shading_point_index].clear();
@@ -299,18 +321,15 @@ size_t PathTracer<PathVisitor, Adjoint>::trace(
         // Sample the BSDF.
         foundation::Vector3d incoming;
         Spectrum bsdf_value;
+        double sample_prob;
         double bsdf_prob;
         const BSDF::Mode bsdf_mode =
-            vertex.m_bsdf->sample(
+            sample_bsdf(
                 sampling_context,
-                vertex.m_bsdf_data,
-                Adjoint,
-                true,       // multiply by |cos(incoming, normal)|
-                vertex.get_geometric_normal(),
-                vertex.get_shading_basis(),
-                vertex.m_outgoing,
+                vertex,
                 incoming,
                 bsdf_value,
+                sample_prob,
                 bsdf_prob);
         if (bsdf_mode == BSDF::Absorption)
             break;
@@ -321,9 +340,11 @@ size_t PathTracer<PathVisitor, Adjoint>::trace(
 
         vertex.m_prev_bsdf_prob = bsdf_prob;
         vertex.m_prev_bsdf_mode = bsdf_mode;
+        vertex.m_prev_point = vertex.get_point();
+        vertex.m_prev_normal = vertex.get_shading_normal();
 
-        if (bsdf_prob != BSDF::DiracDelta)
-            bsdf_value /= static_cast<float>(bsdf_prob);
+        if (sample_prob != BSDF::DiracDelta)
+            bsdf_value /= static_cast<float>(sample_prob);
 
         // Update the path throughput.
         vertex.m_throughput *= bsdf_value;
@@ -358,13 +379,22 @@ size_t PathTracer<PathVisitor, Adjoint>::trace(
         ++vertex.m_path_length;
 
         // Construct the scattered ray.
-        const ShadingRay scattered_ray(
+        ShadingRay scattered_ray(
             vertex.m_shading_point->get_biased_point(incoming),
             incoming,
             ray.m_time,
             bsdf_mode_to_ray_type(bsdf_mode),
             ray.m_depth + 1);
 
+        // Propagate the ray differentials.
+        if (ray.m_has_differentials)
+        {
+            vertex.m_shading_point->compute_scattered_ray_differentials(
+                incoming,
+                bsdf_mode == BSDF::Specular ? 0.0 : compute_lobe_spread(sample_prob),
+                scattered_ray);
+        }
+
         // Trace the ray.
         shading_points[shading_point_index].clear();
         shading_context.get_intersector().trace(
@@ -380,6 +410,119 @@ size_t PathTracer<PathVisitor, Adjoint>::trace(
     return vertex.m_path_length;
 }
 
+template <typename PathVisitor, bool Adjoint>
+BSDF::Mode PathTracer<PathVisitor, Adjoint>::sample_bsdf(
+    SamplingContext&            sampling_context,
+    const PathVertex&           vertex,
+    foundation::Vector3d&       incoming,
+    Spectrum&                   value,
+    double&                     probability,
+    double&                     bsdf_probability) const
+{
+    // Purely specular BSDFs cannot be guided.
+    const DirectionalQuadtree* distribution =
+        m_path_guide && !vertex.m_bsdf->is_purely_specular()
+            ? m_path_guide->get_distribution(vertex.get_point())
+            : 0;
+
+    if (distribution == 0)
+    {
+        const BSDF::Mode mode =
+            vertex.m_bsdf->sample(
+                sampling_context,
+                vertex.m_bsdf_data,
+                Adjoint,
+                true,       // multiply by |cos(incoming, normal)|
+                vertex.get_geometric_normal(),
+                vertex.get_shading_basis(),
+                vertex.m_outgoing,
+                incoming,
+                value,
+                probability);
+
+        bsdf_probability = probability;
+
+        return mode;
+    }
+
+    const double bsdf_fraction = m_path_guide->get_bsdf_sampling_fraction();
+
+    // Choose between sampling the BSDF and sampling the guide.
+    sampling_context.split_in_place(1, 1);
+    const double s = sampling_context.next_double2();
+
+    if (s < bsdf_fraction)
+    {
+        const BSDF::Mode mode =
+            vertex.m_bsdf->sample(
+                sampling_context,
+                vertex.m_bsdf_data,
+                Adjoint,
+                true,       // multiply by |cos(incoming, normal)|
+                vertex.get_geometric_normal(),
+                vertex.get_shading_basis(),
+                vertex.m_outgoing,
+                incoming,
+                value,
+                bsdf_probability);
+
+        if (mode == BSDF::Absorption)
+            return mode;
+
+        if (mode == BSDF::Specular)
+        {
+            // Specular directions can only be chosen by the BSDF.
+            value /= static_cast<float>(bsdf_fraction);
+            probability = BSDF::DiracDelta;
+        }
+        else
+        {
+            probability =
+                bsdf_fraction * bsdf_probability +
+                (1.0 - bsdf_fraction) * distribution->evaluate_pdf(incoming);
+        }
+
+        return mode;
+    }
+    else
+    {
+        sampling_context.split_in_place(2, 1);
+
+        double guide_probability;
+        incoming = distribution->sample(sampling_context.next_vector2<2>(), guide_probability);
+
+        bsdf_probability =
+            vertex.m_bsdf->evaluate(
+                vertex.m_bsdf_data,
+                Adjoint,
+                true,       // multiply by |cos(incoming, normal)|
+                vertex.get_geometric_normal(),
+                vertex.get_shading_basis(),
+                vertex.m_outgoing,
+                incoming,
+                BSDF::AllScatteringModes,
+                value);
+
+        // The BSDF does not scatter any light in this direction.
+        if (bsdf_probability == 0.0)
+            return BSDF::Absorption;
+
+        probability =
+            bsdf_fraction * bsdf_probability +
+            (1.0 - bsdf_fraction) * guide_probability;
+
+        return vertex.m_bsdf->is_purely_diffuse() ? BSDF::Diffuse : BSDF::Glossy;
+    }
+}
+
+template <typename PathVisitor, bool Adjoint>
+inline double PathTracer<PathVisitor, Adjoint>::compute_lobe_spread(const double probability)
+{
+    assert(probability > 0.0);
+
+    return std::min(1.0 / std::sqrt(foundation::Pi * probability), 1.0);
+}
+
 template <typename PathVisitor, bool Adjoint>
 inline ShadingRay::Type PathTracer<PathVisitor, Adjoint>::bsdf_mode_to_ray_type(
     const BSDF::Mode            mode)
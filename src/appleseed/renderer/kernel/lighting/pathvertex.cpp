@@ -55,7 +55,7 @@ void PathVertex::compute_emitted_radiance(
     const void* edf_data =
         input_evaluator.evaluate(
             m_edf->get_inputs(),
-            m_shading_point->get_uv(0));
+            m_shading_point->get_source_inputs(0));
 
     // Compute the emitted radiance.
     m_edf->evaluate(
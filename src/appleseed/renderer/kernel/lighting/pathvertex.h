@@ -72,6 +72,8 @@ class PathVertex
     size_t                  m_path_length;
     BSDF::Mode              m_prev_bsdf_mode;
     double                  m_prev_bsdf_prob;
+    foundation::Vector3d    m_prev_point;   // world space position of the previous vertex
+    foundation::Vector3d    m_prev_normal;  // world space shading normal at the previous vertex, unit-length
     Spectrum                m_throughput;
 
     // Constructor.
@@ -159,7 +161,7 @@ inline double PathVertex::get_bsdf_point_prob() const
 
 inline double PathVertex::get_light_point_prob(const LightSampler& light_sampler) const
 {
-    return light_sampler.evaluate_pdf(*m_shading_point);
+    return light_sampler.evaluate_pdf(m_prev_point, m_prev_normal, *m_shading_point);
 }
 
 }       // namespace renderer
@@ -35,6 +35,7 @@
 #include "renderer/kernel/lighting/directlightingintegrator.h"
 #include "renderer/kernel/lighting/imagebasedlighting.h"
 #include "renderer/kernel/lighting/lightsampler.h"
+#include "renderer/kernel/lighting/pathguide.h"
 #include "renderer/kernel/lighting/pathtracer.h"
 #include "renderer/kernel/lighting/pathvertex.h"
 #include "renderer/kernel/shading/shadingcontext.h"
@@ -94,6 +95,7 @@ namespace
             const size_t    m_max_path_length;              // maximum path length, ~0 for unlimited
             const size_t    m_rr_min_path_length;           // minimum path length before Russian Roulette kicks in, ~0 for unlimited
             const bool      m_next_event_estimation;        // use next event estimation?
+            const bool      m_enable_path_guiding;          // learn the distribution of light to guide scattering directions?
 
             const double    m_dl_light_sample_count;        // number of light samples used to estimate direct illumination
             const double    m_ibl_env_sample_count;         // number of environment samples used to estimate IBL
@@ -111,6 +113,7 @@ namespace
               , m_max_path_length(nz(params.get_optional<size_t>("max_path_length", 0)))
               , m_rr_min_path_length(nz(params.get_optional<size_t>("rr_min_path_length", 3)))
               , m_next_event_estimation(params.get_optional<bool>("next_event_estimation", true))
+              , m_enable_path_guiding(params.get_optional<bool>("enable_path_guiding", false))
               , m_dl_light_sample_count(params.get_optional<double>("dl_light_samples", 1.0))
               , m_ibl_env_sample_count(params.get_optional<double>("ibl_env_samples", 1.0))
               , m_has_max_ray_intensity(params.strings().exist("max_ray_intensity"))
@@ -144,6 +147,7 @@ namespace
                     "  max path length  %s\n"
                     "  rr min path len. %s\n"
                     "  next event est.  %s\n"
+                    "  path guiding     %s\n"
                     "  dl light samples %s\n"
                     "  ibl env samples  %s\n"
                     "  max ray intens.  %s",
@@ -153,6 +157,7 @@ namespace
                     m_max_path_length == ~0 ? "infinite" : pretty_uint(m_max_path_length).c_str(),
                     m_rr_min_path_length == ~0 ? "infinite" : pretty_uint(m_rr_min_path_length).c_str(),
                     m_next_event_estimation ? "on" : "off",
+                    m_enable_path_guiding ? "on" : "off",
                     pretty_scalar(m_dl_light_sample_count).c_str(),
                     pretty_scalar(m_ibl_env_sample_count).c_str(),
                     m_has_max_ray_intensity ? pretty_scalar(m_max_ray_intensity).c_str() : "infinite");
@@ -161,9 +166,11 @@ namespace
 
         PTLightingEngine(
             const LightSampler&     light_sampler,
+            PathGuide*              path_guide,
             const ParamArray&       params)
           : m_params(params)
           , m_light_sampler(light_sampler)
+          , m_path_guide(path_guide)
           , m_path_count(0)
         {
         }
@@ -212,6 +219,7 @@ namespace
             PathVisitor path_visitor(
                 m_params,
                 m_light_sampler,
+                m_path_guide,
                 sampling_context,
                 shading_context,
                 shading_point.get_scene(),
@@ -222,7 +230,9 @@ namespace
                 path_visitor,
                 m_params.m_rr_min_path_length,
                 m_params.m_max_path_length,
-                shading_context.get_max_iterations());
+                shading_context.get_max_iterations(),
+                0.0,
+                m_path_guide);
 
             const size_t path_length =
                 path_tracer.trace(
@@ -230,6 +240,10 @@ namespace
                     shading_context,
                     shading_point);
 
+            // Teach the path guide the light found along this path.
+            if (m_path_guide)
+                path_visitor.record_guiding_vertices();
+
             // Update statistics.
             ++m_path_count;
             m_path_length.insert(path_length);
@@ -247,6 +261,7 @@ namespace
       private:
         const Parameters                m_params;
         const LightSampler&             m_light_sampler;
+        PathGuide*                      m_path_guide;
 
         uint64                          m_path_count;
         Population<uint64>              m_path_length;
@@ -257,8 +272,20 @@ namespace
 
         struct PathVisitorBase
         {
+            // A vertex whose scattering direction was chosen by sampling a non-specular BSDF.
+            struct GuidingVertex
+            {
+                Vector3d                m_point;
+                Vector3d                m_incoming;         // world space direction toward the next vertex, unit-length
+                float                   m_throughput;       // average path throughput up to the next vertex
+                float                   m_path_radiance;    // average path radiance before reaching the next vertex
+            };
+
+            enum { MaxGuidingVertexCount = 32 };
+
             const Parameters&           m_params;
             const LightSampler&         m_light_sampler;
+            PathGuide*                  m_path_guide;
             SamplingContext&            m_sampling_context;
             const ShadingContext&       m_shading_context;
             TextureCache&               m_texture_cache;
@@ -266,10 +293,13 @@ namespace
             Spectrum&                   m_path_radiance;
             SpectrumStack&              m_path_aovs;
             bool                        m_omit_emitted_light;
+            GuidingVertex               m_guiding_vertices[MaxGuidingVertexCount];
+            size_t                      m_guiding_vertex_count;
 
             PathVisitorBase(
                 const Parameters&       params,
                 const LightSampler&     light_sampler,
+                PathGuide*              path_guide,
                 SamplingContext&        sampling_context,
                 const ShadingContext&   shading_context,
                 const Scene&            scene,
@@ -277,6 +307,7 @@ namespace
                 SpectrumStack&          path_aovs)
               : m_params(params)
               , m_light_sampler(light_sampler)
+              , m_path_guide(path_guide)
               , m_sampling_context(sampling_context)
               , m_shading_context(shading_context)
               , m_texture_cache(shading_context.get_texture_cache())
@@ -284,6 +315,7 @@ namespace
               , m_path_radiance(path_radiance)
               , m_path_aovs(path_aovs)
               , m_omit_emitted_light(false)
+              , m_guiding_vertex_count(0)
             {
             }
 
@@ -306,6 +338,47 @@ namespace
 
                 return true;
             }
+
+            // Remember the previous vertex of the path, before the radiance arriving at it is accumulated.
+            void store_guiding_vertex(const PathVertex& vertex)
+            {
+                if (m_path_guide == 0 ||
+                    vertex.m_path_length < 2 ||
+                    vertex.m_prev_bsdf_mode == BSDF::Specular ||
+                    m_guiding_vertex_count == MaxGuidingVertexCount)
+                    return;
+
+                GuidingVertex& guiding_vertex = m_guiding_vertices[m_guiding_vertex_count++];
+                guiding_vertex.m_point = vertex.m_prev_point;
+                guiding_vertex.m_incoming = -vertex.m_outgoing;
+                guiding_vertex.m_throughput = average_value(vertex.m_throughput);
+                guiding_vertex.m_path_radiance = average_value(m_path_radiance);
+            }
+
+            // Record in the path guide the radiance that arrived at each stored vertex.
+            void record_guiding_vertices()
+            {
+                const float path_radiance = average_value(m_path_radiance);
+
+                for (size_t i = 0; i < m_guiding_vertex_count; ++i)
+                {
+                    const GuidingVertex& guiding_vertex = m_guiding_vertices[i];
+
+                    if (guiding_vertex.m_throughput <= 0.0f)
+                        continue;
+
+                    const float radiance =
+                        (path_radiance - guiding_vertex.m_path_radiance) / guiding_vertex.m_throughput;
+
+                    if (radiance > 0.0f)
+                    {
+                        m_path_guide->record(
+                            guiding_vertex.m_point,
+                            guiding_vertex.m_incoming,
+                            radiance);
+                    }
+                }
+            }
         };
 
         //
@@ -318,6 +391,7 @@ namespace
             PathVisitorSimple(
                 const Parameters&       params,
                 const LightSampler&     light_sampler,
+                PathGuide*              path_guide,
                 SamplingContext&        sampling_context,
                 const ShadingContext&   shading_context,
                 const Scene&            scene,
@@ -326,6 +400,7 @@ namespace
               : PathVisitorBase(
                     params,
                     light_sampler,
+                    path_guide,
                     sampling_context,
                     shading_context,
                     scene,
@@ -336,6 +411,8 @@ namespace
 
             void visit_vertex(const PathVertex& vertex)
             {
+                store_guiding_vertex(vertex);
+
                 if ((!m_omit_emitted_light || m_params.m_enable_caustics) &&
                     vertex.m_edf &&
                     vertex.m_cos_on > 0.0 &&
@@ -357,6 +434,8 @@ namespace
             {
                 assert(vertex.m_prev_bsdf_mode != BSDF::Absorption);
 
+                store_guiding_vertex(vertex);
+
                 // Can't look up the environment if there's no environment EDF.
                 if (m_env_edf == 0)
                     return;
@@ -394,6 +473,7 @@ namespace
             PathVisitorNextEventEstimation(
                 const Parameters&       params,
                 const LightSampler&     light_sampler,
+                PathGuide*              path_guide,
                 SamplingContext&        sampling_context,
                 const ShadingContext&   shading_context,
                 const Scene&            scene,
@@ -402,6 +482,7 @@ namespace
               : PathVisitorBase(
                     params,
                     light_sampler,
+                    path_guide,
                     sampling_context,
                     shading_context,
                     scene,
@@ -413,6 +494,8 @@ namespace
 
             void visit_vertex(const PathVertex& vertex)
             {
+                store_guiding_vertex(vertex);
+
                 // Any light contribution after a diffuse or glossy bounce is considered indirect.
                 if (BSDF::has_diffuse_or_glossy(vertex.m_prev_bsdf_mode))
                     m_is_indirect_lighting = true;
@@ -614,6 +697,8 @@ namespace
             {
                 assert(vertex.m_prev_bsdf_mode != BSDF::Absorption);
 
+                store_guiding_vertex(vertex);
+
                 // Can't look up the environment if there's no environment EDF.
                 if (m_env_edf == 0)
                     return;
@@ -680,8 +765,10 @@ namespace
 
 PTLightingEngineFactory::PTLightingEngineFactory(
     const LightSampler& light_sampler,
+    PathGuide*          path_guide,
     const ParamArray&   params)
   : m_light_sampler(light_sampler)
+  , m_path_guide(path_guide)
   , m_params(params)
 {
     PTLightingEngine::Parameters(params).print();
@@ -694,7 +781,7 @@ void PTLightingEngineFactory::release()
 
 ILightingEngine* PTLightingEngineFactory::create()
 {
-    return new PTLightingEngine(m_light_sampler, m_params);
+    return new PTLightingEngine(m_light_sampler, m_path_guide, m_params);
 }
 
 }   // namespace renderer
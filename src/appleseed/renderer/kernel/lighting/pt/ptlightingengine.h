@@ -36,6 +36,7 @@
 
 // Forward declarations.
 namespace renderer  { class LightSampler; }
+namespace renderer  { class PathGuide; }
 
 namespace renderer
 {
@@ -51,6 +52,7 @@ class PTLightingEngineFactory
     // Constructor.
     PTLightingEngineFactory(
         const LightSampler& light_sampler,
+        PathGuide*          path_guide,             // optional, may be 0
         const ParamArray&   params);
 
     // Delete this instance.
@@ -61,6 +63,7 @@ class PTLightingEngineFactory
 
   private:
     const LightSampler&     m_light_sampler;
+    PathGuide*              m_path_guide;
     ParamArray              m_params;
 };
 
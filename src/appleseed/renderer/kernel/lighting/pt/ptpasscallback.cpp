@@ -0,0 +1,116 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "ptpasscallback.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/modeling/scene/scene.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/scalar.h"
+#include "foundation/utility/string.h"
+
+using namespace foundation;
+
+namespace renderer
+{
+
+namespace
+{
+    double get_bsdf_fraction(const ParamArray& params)
+    {
+        // Never sampling the BSDF would miss its specular lobes entirely.
+        const double MinFraction = 0.01;
+
+        const double fraction = params.get_optional<double>("path_guiding_bsdf_fraction", 0.5);
+
+        if (fraction < MinFraction || fraction > 1.0)
+        {
+            const double clamped_fraction = clamp(fraction, MinFraction, 1.0);
+
+            RENDERER_LOG_ERROR(
+                "invalid value %s for parameter \"path_guiding_bsdf_fraction\", using value %s; "
+                "it must be greater than 0 and at most 1.",
+                pretty_scalar(fraction, 3).c_str(),
+                pretty_scalar(clamped_fraction, 3).c_str());
+
+            return clamped_fraction;
+        }
+
+        return fraction;
+    }
+}
+
+
+//
+// PTPassCallback class implementation.
+//
+
+PTPassCallback::PTPassCallback(
+    const Scene&            scene,
+    const ParamArray&       params)
+  : m_path_guide(
+        AABB3d(scene.compute_bbox()),
+        params.get_optional<size_t>("path_guiding_spatial_threshold", 4000),
+        params.get_optional<double>("path_guiding_directional_threshold", 0.01),
+        get_bsdf_fraction(params))
+{
+}
+
+void PTPassCallback::release()
+{
+    delete this;
+}
+
+void PTPassCallback::pre_render(
+    const Frame&            frame,
+    JobQueue&               job_queue,
+    AbortSwitch&            abort_switch)
+{
+}
+
+void PTPassCallback::post_render(
+    const Frame&            frame,
+    JobQueue&               job_queue,
+    AbortSwitch&            abort_switch)
+{
+    // Guide the next pass with the light found during this one.
+    m_path_guide.update();
+
+    RENDERER_LOG_INFO(
+        "path guide training iteration %s completed, %s spatial %s.",
+        pretty_uint(m_path_guide.get_iteration_count()).c_str(),
+        pretty_uint(m_path_guide.get_spatial_cell_count()).c_str(),
+        plural(m_path_guide.get_spatial_cell_count(), "cell").c_str());
+}
+
+}   // namespace renderer
@@ -349,8 +349,7 @@ namespace
                 const Vector3f normal(vertex.get_geometric_normal());
 
                 // Find the nearby photons around the path vertex.
-                const knn::Query3f query(photon_map, m_answer);
-                query.run(point, radius * radius);
+                photon_map.find_nearest_photons(point, radius, m_answer);
                 const size_t photon_count = m_answer.size();
 
                 // Compute the square radius of the lookup disk.
@@ -379,21 +378,24 @@ namespace
                     // Retrieve the i'th photon.
                     const knn::Answer<float>::Entry& photon = m_answer.get(i);
                     const SPPMPhotonData& data = m_pass_callback.get_photon_data(photon_map.remap(photon.m_index));
+                    const Vector3f photon_incoming = data.get_incoming();
 
                     // Reject photons from the opposite hemisphere as they won't contribute.
-                    if (dot(normal, data.m_incoming) <= 0.0f)
+                    if (dot(normal, photon_incoming) <= 0.0f)
                         continue;
 
+                    const Vector3f photon_geometric_normal = data.get_geometric_normal();
+
 #if 1
                     // Reject photons on a surface with too different an orientation.
                     const float NormalThreshold = 1.0e-3f;
-                    if (dot(normal, data.m_geometric_normal) < NormalThreshold)
+                    if (dot(normal, photon_geometric_normal) < NormalThreshold)
                         continue;
 #endif
 
 #if 0
                     // Reject photons on the wrong side of the surface.
-                    if (dot(vertex.m_outgoing, Vector3d(data.m_geometric_normal)) <= 0.0)
+                    if (dot(vertex.m_outgoing, Vector3d(photon_geometric_normal)) <= 0.0)
                         continue;
 #endif
 
@@ -416,7 +418,7 @@ namespace
                             vertex.get_geometric_normal(),
                             vertex.get_shading_basis(),
                             vertex.m_outgoing,                      // toward the camera
-                            normalize(Vector3d(data.m_incoming)),   // toward the light
+                            normalize(Vector3d(photon_incoming)),   // toward the light
                             BSDF::Diffuse,
                             bsdf_value);
                     if (bsdf_prob == 0.0)
@@ -425,8 +427,10 @@ namespace
                     // The photons store flux but we are computing reflected radiance.
                     // The first step of the flux -> radiance conversion is done here.
                     // The conversion will be completed when doing density estimation.
-                    bsdf_value /= abs(dot(data.m_incoming, data.m_geometric_normal));
-                    bsdf_value *= data.m_flux;
+                    Spectrum photon_flux;
+                    data.get_flux(photon_flux);
+                    bsdf_value /= abs(dot(photon_incoming, photon_geometric_normal));
+                    bsdf_value *= photon_flux;
 
                     // Apply kernel weight.
 #if 0
@@ -505,11 +509,11 @@ namespace
             Spectrum&               radiance)
         {
             const SPPMPhotonMap& photon_map = m_pass_callback.get_photon_map();
-            const knn::Query3f query(photon_map, m_answer);
 
-            query.run(
+            photon_map.find_nearest_photons(
                 Vector3f(shading_point.get_point()),
-                square(m_params.m_view_photons_radius));
+                m_params.m_view_photons_radius,
+                m_answer);
 
             radiance.set(0.0f);
 
@@ -517,7 +521,9 @@ namespace
             for (size_t i = 0; i < photon_count; ++i)
             {
                 const knn::Answer<float>::Entry& photon = m_answer.get(i);
-                radiance += m_pass_callback.get_photon_data(photon_map.remap(photon.m_index)).m_flux;
+                Spectrum photon_flux;
+                m_pass_callback.get_photon_data(photon_map.remap(photon.m_index)).get_flux(photon_flux);
+                radiance += photon_flux;
             }
 
             const float m = max_value(radiance);
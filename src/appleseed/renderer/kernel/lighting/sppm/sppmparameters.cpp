@@ -80,6 +80,31 @@ namespace
             return default_mode;
         }
     }
+
+    SPPMParameters::PhotonMapType get_photon_map_type(
+        const ParamArray&           params,
+        const char*                 name,
+        const SPPMParameters::PhotonMapType default_type)
+    {
+        const string default_type_str =
+            default_type == SPPMParameters::KdTree ? "kdtree" : "hashgrid";
+
+        const string value = params.get_optional<string>(name, default_type_str);
+
+        if (value == "kdtree")
+            return SPPMParameters::KdTree;
+        else if (value == "hashgrid")
+            return SPPMParameters::HashGrid;
+        else
+        {
+            RENDERER_LOG_ERROR(
+                "invalid value \"%s\" for parameter \"%s\", using default value \"%s\"",
+                value.c_str(),
+                name,
+                default_type_str.c_str());
+            return default_type;
+        }
+    }
 }
 
 SPPMParameters::SPPMParameters(const ParamArray& params)
@@ -97,6 +122,7 @@ SPPMParameters::SPPMParameters(const ParamArray& params)
   , m_max_iterations(params.get_optional<size_t>("max_iterations", 1000))
   , m_initial_radius_percents(params.get_required<float>("initial_radius", 0.1f))
   , m_alpha(params.get_optional<float>("alpha", 0.7f))
+  , m_photon_map_type(get_photon_map_type(params, "photon_map", KdTree))
   , m_max_photons_per_estimate(params.get_optional<size_t>("max_photons_per_estimate", 100))
   , m_dl_light_sample_count(params.get_optional<double>("dl_light_samples", 1.0))
   , m_view_photons(params.get_optional<bool>("view_photons", false))
@@ -135,12 +161,14 @@ void SPPMParameters::print() const
         "  rr min path len. %s\n"
         "  initial radius   %s%%\n"
         "  alpha            %s\n"
+        "  photon map       %s\n"
         "  max photons/est. %s\n"
         "  dl light samples %s",
         m_path_tracing_max_path_length == ~0 ? "infinite" : pretty_uint(m_path_tracing_max_path_length).c_str(),
         m_path_tracing_rr_min_path_length == ~0 ? "infinite" : pretty_uint(m_path_tracing_rr_min_path_length).c_str(),
         pretty_scalar(m_initial_radius_percents, 3).c_str(),
         pretty_scalar(m_alpha, 1).c_str(),
+        m_photon_map_type == KdTree ? "kd-tree" : "hash grid",
         pretty_uint(m_max_photons_per_estimate).c_str(),
         pretty_scalar(m_dl_light_sample_count).c_str());
 }
@@ -42,6 +42,7 @@ namespace renderer
 struct SPPMParameters
 {
     enum Mode { SPPM, RayTraced, Off };
+    enum PhotonMapType { KdTree, HashGrid };
 
     const Mode      m_dl_mode;                              // direct lighting mode
     const bool      m_enable_ibl;                           // is image-based lighting enabled?
@@ -62,6 +63,7 @@ struct SPPMParameters
 
     const float     m_initial_radius_percents;              // initial lookup radius as a percentage of the scene diameter
     const float     m_alpha;                                // radius shrinking control
+    const PhotonMapType m_photon_map_type;                  // data structure used to look up photons
     const size_t    m_max_photons_per_estimate;             // maximum number of photons per density estimation
     const double    m_dl_light_sample_count;                // number of light samples used to estimate direct illumination in ray traced mode
     float           m_rcp_dl_light_sample_count;
@@ -117,7 +117,12 @@ void SPPMPassCallback::pre_render(
         return;
 
     // Build a new photon map.
-    m_photon_map.reset(new SPPMPhotonMap(m_photons));
+    m_photon_map.reset(
+        new SPPMPhotonMap(
+            m_photons,
+            m_params,
+            m_lookup_radius,
+            job_queue));
 }
 
 void SPPMPassCallback::post_render(
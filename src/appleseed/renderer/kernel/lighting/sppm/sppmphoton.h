@@ -34,12 +34,16 @@
 #include "renderer/global/globaltypes.h"
 
 // appleseed.foundation headers.
+#include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
 
 // boost headers.
 #include "foundation/platform/thread.h"
 
 // Standard headers.
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <vector>
 
@@ -49,13 +53,40 @@ namespace renderer
 //
 // A photon in the SPPM photon map.
 //
+// Photon data is stored in compact form since there are usually millions of photons per pass:
+// directions are quantized to 2x16 bits using an octahedral mapping, and the flux is quantized
+// to 16 bits per wavelength, relatively to its largest component.
+//
+// Reference:
+//
+//   A Survey of Efficient Representations for Independent Unit Vectors
+//   Zina H. Cigolle, Sam Donow, Daniel Evangelakos, Michael Mara, Morgan McGuire, Quirin Meyer
+//   http://jcgt.org/published/0003/02/01/
+//
 
 class SPPMPhotonData
 {
   public:
-    foundation::Vector3f    m_incoming;             // incoming direction, world space, unit length
-    foundation::Vector3f    m_geometric_normal;     // geometric normal at the photon location, world space, unit length
-    Spectrum                m_flux;                 // flux carried by this photon (in W)
+    // Incoming direction, world space, unit length.
+    void set_incoming(const foundation::Vector3f& incoming);
+    foundation::Vector3f get_incoming() const;
+
+    // Geometric normal at the photon location, world space, unit length.
+    void set_geometric_normal(const foundation::Vector3f& geometric_normal);
+    foundation::Vector3f get_geometric_normal() const;
+
+    // Flux carried by this photon (in W).
+    void set_flux(const Spectrum& flux);
+    void get_flux(Spectrum& flux) const;
+
+  private:
+    foundation::uint32      m_incoming;
+    foundation::uint32      m_geometric_normal;
+    float                   m_flux_scale;
+    foundation::uint16      m_flux[Spectrum::Samples];
+
+    static foundation::uint32 encode_direction(const foundation::Vector3f& v);
+    static foundation::Vector3f decode_direction(const foundation::uint32 packed);
 };
 
 class SPPMPhoton
@@ -92,6 +123,96 @@ class SPPMPhotonVector
     void append(const SPPMPhotonVector& rhs);
 };
 
+
+//
+// SPPMPhotonData class implementation.
+//
+
+inline void SPPMPhotonData::set_incoming(const foundation::Vector3f& incoming)
+{
+    m_incoming = encode_direction(incoming);
+}
+
+inline foundation::Vector3f SPPMPhotonData::get_incoming() const
+{
+    return decode_direction(m_incoming);
+}
+
+inline void SPPMPhotonData::set_geometric_normal(const foundation::Vector3f& geometric_normal)
+{
+    m_geometric_normal = encode_direction(geometric_normal);
+}
+
+inline foundation::Vector3f SPPMPhotonData::get_geometric_normal() const
+{
+    return decode_direction(m_geometric_normal);
+}
+
+inline void SPPMPhotonData::set_flux(const Spectrum& flux)
+{
+    float max_flux = 0.0f;
+
+    for (size_t i = 0; i < Spectrum::Samples; ++i)
+        max_flux = std::max(max_flux, flux[i]);
+
+    m_flux_scale = max_flux * (1.0f / 65535.0f);
+
+    const float rcp_scale = max_flux > 0.0f ? 65535.0f / max_flux : 0.0f;
+
+    for (size_t i = 0; i < Spectrum::Samples; ++i)
+    {
+        m_flux[i] =
+            static_cast<foundation::uint16>(
+                foundation::clamp(flux[i] * rcp_scale + 0.5f, 0.0f, 65535.0f));
+    }
+}
+
+inline void SPPMPhotonData::get_flux(Spectrum& flux) const
+{
+    for (size_t i = 0; i < Spectrum::Samples; ++i)
+        flux[i] = m_flux[i] * m_flux_scale;
+}
+
+inline foundation::uint32 SPPMPhotonData::encode_direction(const foundation::Vector3f& v)
+{
+    // Project the direction onto the octahedron, then unfold the lower half over the upper half.
+    const float rcp_norm1 = 1.0f / (std::abs(v[0]) + std::abs(v[1]) + std::abs(v[2]));
+    float x = v[0] * rcp_norm1;
+    float y = v[1] * rcp_norm1;
+
+    if (v[2] < 0.0f)
+    {
+        const float folded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float folded_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+        y = folded_y;
+    }
+
+    const foundation::uint32 qx =
+        static_cast<foundation::uint32>(foundation::clamp(x * 32767.5f + 32768.0f, 0.0f, 65535.0f));
+    const foundation::uint32 qy =
+        static_cast<foundation::uint32>(foundation::clamp(y * 32767.5f + 32768.0f, 0.0f, 65535.0f));
+
+    return qx | (qy << 16);
+}
+
+inline foundation::Vector3f SPPMPhotonData::decode_direction(const foundation::uint32 packed)
+{
+    float x = (packed & 0xFFFF) * (2.0f / 65535.0f) - 1.0f;
+    float y = (packed >> 16) * (2.0f / 65535.0f) - 1.0f;
+    const float z = 1.0f - std::abs(x) - std::abs(y);
+
+    if (z < 0.0f)
+    {
+        const float unfolded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float unfolded_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = unfolded_x;
+        y = unfolded_y;
+    }
+
+    return foundation::normalize(foundation::Vector3f(x, y, z));
+}
+
 }       // namespace renderer
 
 #endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMPHOTON_H
@@ -37,6 +37,7 @@
 // appleseed.foundation headers.
 #include "foundation/platform/defaulttimers.h"
 #include "foundation/utility/statistics.h"
+#include "foundation/utility/stopwatch.h"
 #include "foundation/utility/string.h"
 
 // Standard headers.
@@ -48,7 +49,59 @@ using namespace foundation;
 namespace renderer
 {
 
-SPPMPhotonMap::SPPMPhotonMap(SPPMPhotonVector& photons)
+namespace
+{
+    // Collect the nearest points found in a hash grid into a k-nearest neighbor answer.
+    class AnswerBuilder
+    {
+      public:
+        AnswerBuilder(
+            knn::Answer<float>&     answer,
+            const size_t            max_answer_size,
+            const float             max_square_dist)
+          : m_answer(answer)
+          , m_max_answer_size(max_answer_size)
+          , m_max_square_dist(max_square_dist)
+        {
+            m_answer.clear();
+        }
+
+        void visit(const size_t index, const float square_dist)
+        {
+            if (square_dist >= m_max_square_dist)
+                return;
+
+            if (m_answer.size() == m_max_answer_size)
+            {
+                m_answer.heap_insert(index, square_dist);
+                m_max_square_dist = m_answer.top().m_square_dist;
+            }
+            else
+            {
+                m_answer.array_insert(index, square_dist);
+
+                if (m_answer.size() == m_max_answer_size)
+                {
+                    m_answer.make_heap();
+                    m_max_square_dist = m_answer.top().m_square_dist;
+                }
+            }
+        }
+
+      private:
+        knn::Answer<float>&         m_answer;
+        const size_t                m_max_answer_size;
+        float                       m_max_square_dist;
+    };
+}
+
+SPPMPhotonMap::SPPMPhotonMap(
+    SPPMPhotonVector&       photons,
+    const SPPMParameters&   params,
+    const float             lookup_radius,
+    JobQueue&               job_queue)
+  : m_type(params.m_photon_map_type)
+  , m_max_answer_size(params.m_max_photons_per_estimate)
 {
     const size_t photon_count = photons.size();
 
@@ -59,13 +112,28 @@ SPPMPhotonMap::SPPMPhotonMap(SPPMPhotonVector& photons)
             pretty_uint(photon_count).c_str(),
             photon_count > 1 ? "photons" : "photon");
 
-        knn::Builder3f builder(*this);
-        builder.build_move_points<DefaultWallclockTimer>(photons.m_positions);
-
         Statistics statistics;
-        statistics.insert_time("build time", builder.get_build_time());
-        statistics.insert_size("size", photons.get_memory_size());
-        statistics.merge(knn::TreeStatistics<knn::Tree3f>(*this));
+
+        if (m_type == SPPMParameters::KdTree)
+        {
+            knn::Builder3f builder(m_tree);
+            builder.build_move_points<DefaultWallclockTimer>(photons.m_positions, job_queue);
+
+            statistics.insert_time("build time", builder.get_build_time());
+            statistics.insert_size("size", photons.get_memory_size());
+            statistics.merge(knn::TreeStatistics<knn::Tree3f>(m_tree));
+        }
+        else
+        {
+            Stopwatch<DefaultWallclockTimer> stopwatch;
+            stopwatch.start();
+
+            // With cells twice as large as the lookup radius, lookups visit at most 2x2x2 cells.
+            m_grid.build_move_points(photons.m_positions, 2.0f * lookup_radius);
+
+            statistics.insert_time("build time", stopwatch.measure().get_seconds());
+            statistics.insert_size("size", photons.get_memory_size() + m_grid.get_memory_size());
+        }
 
         RENDERER_LOG_DEBUG("%s",
             StatisticsVector::make(
@@ -79,4 +147,21 @@ SPPMPhotonMap::SPPMPhotonMap(SPPMPhotonVector& photons)
     }
 }
 
+void SPPMPhotonMap::find_nearest_photons(
+    const Vector3f&         point,
+    const float             max_dist,
+    knn::Answer<float>&     answer) const
+{
+    if (m_type == SPPMParameters::KdTree)
+    {
+        const knn::Query3f query(m_tree, answer);
+        query.run(point, max_dist * max_dist);
+    }
+    else
+    {
+        AnswerBuilder answer_builder(answer, m_max_answer_size, max_dist * max_dist);
+        m_grid.find_points(point, max_dist, answer_builder);
+    }
+}
+
 }   // namespace renderer
@@ -30,23 +30,86 @@
 #ifndef APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMPHOTONMAP_H
 #define APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMPHOTONMAP_H
 
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/sppm/sppmparameters.h"
+
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/hashgrid.h"
 #include "foundation/math/knn.h"
+#include "foundation/math/vector.h"
+
+// Standard headers.
+#include <cstddef>
 
 // Forward declarations.
-namespace renderer  { class SPPMPhotonVector; }
+namespace foundation    { class JobQueue; }
+namespace renderer      { class SPPMPhotonVector; }
 
 namespace renderer
 {
 
+//
+// The photon map is either a kd-tree, or a hash grid whose cells are as large as
+// the lookup disk: the hash grid is faster to build and to query but only suits
+// lookups of a given radius.
+//
+
 class SPPMPhotonMap
-  : public foundation::knn::Tree3f
+  : public foundation::NonCopyable
 {
   public:
     // Constructor, *moves* the photon positions into the map.
-    explicit SPPMPhotonMap(SPPMPhotonVector& photons);
+    // The kd-tree is built in parallel by the worker threads of the job queue.
+    SPPMPhotonMap(
+        SPPMPhotonVector&       photons,
+        const SPPMParameters&   params,
+        const float             lookup_radius,
+        foundation::JobQueue&   job_queue);
+
+    // Return true if the map does not contain any photon.
+    bool empty() const;
+
+    // Transform an internal index to a photon index.
+    size_t remap(const size_t i) const;
+
+    // Return the position of the i'th photon, where i is an internal index.
+    const foundation::Vector3f& get_point(const size_t i) const;
+
+    // Find the photons nearest to a given point within a given distance.
+    // Entries of the answer are internal indices.
+    void find_nearest_photons(
+        const foundation::Vector3f& point,
+        const float                 max_dist,
+        foundation::knn::Answer<float>& answer) const;
+
+  private:
+    const SPPMParameters::PhotonMapType m_type;
+    const size_t                        m_max_answer_size;
+    foundation::knn::Tree3f             m_tree;
+    foundation::HashGrid3f              m_grid;
 };
 
+
+//
+// SPPMPhotonMap class implementation.
+//
+
+inline bool SPPMPhotonMap::empty() const
+{
+    return m_type == SPPMParameters::KdTree ? m_tree.empty() : m_grid.empty();
+}
+
+inline size_t SPPMPhotonMap::remap(const size_t i) const
+{
+    return m_type == SPPMParameters::KdTree ? m_tree.remap(i) : m_grid.remap(i);
+}
+
+inline const foundation::Vector3f& SPPMPhotonMap::get_point(const size_t i) const
+{
+    return m_type == SPPMParameters::KdTree ? m_tree.get_point(i) : m_grid.get_point(i);
+}
+
 }       // namespace renderer
 
 #endif  // !APPLESEED_RENDERER_KERNEL_LIGHTING_SPPM_SPPMPHOTONMAP_H
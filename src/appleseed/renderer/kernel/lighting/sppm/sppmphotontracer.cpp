@@ -143,10 +143,11 @@ namespace
                 // Create and store a new photon.
                 SPPMPhoton photon;
                 photon.m_position = vertex.get_point();
-                photon.m_data.m_incoming = Vector3f(vertex.m_outgoing);
-                photon.m_data.m_geometric_normal = Vector3f(vertex.get_geometric_normal());
-                photon.m_data.m_flux = m_initial_flux;
-                photon.m_data.m_flux *= vertex.m_throughput;
+                Spectrum flux = m_initial_flux;
+                flux *= vertex.m_throughput;
+                photon.m_data.set_incoming(Vector3f(vertex.m_outgoing));
+                photon.m_data.set_geometric_normal(Vector3f(vertex.get_geometric_normal()));
+                photon.m_data.set_flux(flux);
                 m_photons.push_back(photon);
             }
         }
@@ -231,7 +232,10 @@ namespace
                 instance);          // initial instance number
 
             for (size_t i = m_photon_begin; i < m_photon_end && !m_abort_switch.is_aborted(); ++i)
+            {
+                m_shading_context.get_arena().clear();
                 trace_light_photon(sampling_context);
+            }
 
             m_global_photons.append(m_local_photons);
         }
@@ -483,7 +487,10 @@ namespace
                 instance);          // initial instance number
 
             for (size_t i = m_photon_begin; i < m_photon_end && !m_abort_switch.is_aborted(); ++i)
+            {
+                m_shading_context.get_arena().clear();
                 trace_env_photon(sampling_context);
+            }
 
             m_global_photons.append(m_local_photons);
         }
@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
 #ifdef WITH_OSL
 #include "renderer/kernel/shading/oslshadergroupexec.h"
 #include "renderer/modeling/shadergroup/shadergroup.h"
@@ -43,7 +44,11 @@
 // appleseed.foundation headers.
 #include "foundation/utility/string.h"
 
+// Standard headers.
+#include <algorithm>
+
 using namespace foundation;
+using namespace std;
 
 namespace renderer
 {
@@ -75,6 +80,50 @@ Tracer::Tracer(
     }
 }
 
+void Tracer::trace_between(
+    const ShadingPoint&         origin,
+    const Vector3d              targets[],
+    const size_t                target_count,
+    const ShadingRay::Type      ray_type,
+    double                      transmissions[])
+{
+    if (m_assume_no_alpha_mapping)
+    {
+        for (size_t begin = 0; begin < target_count; begin += RayPacketSize)
+        {
+            const size_t packet_size = min(target_count - begin, RayPacketSize);
+
+            ShadingRay rays[RayPacketSize];
+
+            for (size_t i = 0; i < packet_size; ++i)
+            {
+                const Vector3d direction = targets[begin + i] - origin.get_point();
+
+                rays[i] =
+                    ShadingRay(
+                        origin.get_biased_point(direction),
+                        direction,
+                        0.0,                    // ray tmin
+                        1.0 - 1.0e-6,           // ray tmax
+                        origin.get_time(),
+                        ray_type,
+                        origin.get_ray().m_depth + 1);
+            }
+
+            bool hits[RayPacketSize];
+            m_intersector.trace_probe(rays, packet_size, hits, &origin);
+
+            for (size_t i = 0; i < packet_size; ++i)
+                transmissions[begin + i] = hits[i] ? 0.0 : 1.0;
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < target_count; ++i)
+            transmissions[i] = trace_between(origin, targets[i], ray_type);
+    }
+}
+
 const ShadingPoint& Tracer::do_trace(
     const Vector3d&             origin,
     const Vector3d&             direction,
@@ -243,7 +292,7 @@ void Tracer::evaluate_alpha(
     {
         alpha_map->evaluate(
             m_texture_cache,
-            shading_point.get_uv(0),
+            shading_point.get_source_inputs(0),
             alpha);
     }
 
@@ -140,6 +140,15 @@ class Tracer
         const foundation::Vector3d&     target,
         const ShadingRay::Type          ray_type);
 
+    // Compute the transmission between a point and several target points.
+    // Segments are traced together as packets of probe rays when possible.
+    void trace_between(
+        const ShadingPoint&             origin,
+        const foundation::Vector3d      targets[],
+        const size_t                    target_count,
+        const ShadingRay::Type          ray_type,
+        double                          transmissions[]);
+
   private:
     const Intersector&                  m_intersector;
     TextureCache&                       m_texture_cache;
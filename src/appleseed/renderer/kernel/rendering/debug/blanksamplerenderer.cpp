@@ -38,6 +38,9 @@
 #include "foundation/math/vector.h"
 #include "foundation/utility/statistics.h"
 
+// Standard headers.
+#include <cstddef>
+
 // Forward declarations.
 namespace renderer  { class PixelContext; }
 
@@ -71,6 +74,29 @@ namespace
             shading_result.set_aovs_to_transparent_black_linear_rgba();
         }
 
+        virtual void render_samples(
+            SamplingContext     sampling_contexts[],
+            const PixelContext& pixel_context,
+            const Vector2d      image_points[],
+            const size_t        sample_count,
+            ShadingResult*      shading_results[]) OVERRIDE
+        {
+            for (size_t i = 0; i < sample_count; ++i)
+            {
+                render_sample(
+                    sampling_contexts[i],
+                    pixel_context,
+                    image_points[i],
+                    *shading_results[i]);
+            }
+        }
+
+        virtual void prefetch_textures(
+            SamplingContext&    sampling_context,
+            const Vector2d&     image_point) OVERRIDE
+        {
+        }
+
         virtual StatisticsVector get_statistics() const OVERRIDE
         {
             return StatisticsVector();
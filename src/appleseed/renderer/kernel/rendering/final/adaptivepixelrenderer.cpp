@@ -65,6 +65,7 @@
 #include <cmath>
 #include <cstddef>
 #include <memory>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -116,6 +117,14 @@ namespace
             delete this;
         }
 
+        virtual void prefetch_textures(
+            const Frame&                frame,
+            const AABB2i&               bbox,
+            const size_t                spacing) OVERRIDE
+        {
+            prefetch_textures_on_grid(*m_sample_renderer, frame, bbox, spacing);
+        }
+
         virtual void on_tile_begin(
             const Frame&                frame,
             Tile&                       tile,
@@ -209,22 +218,34 @@ namespace
                 // Each batch contains 'min' samples.
                 const size_t batch_size = min(m_params.m_min_samples, remaining_samples);
 
+                m_sampling_contexts.clear();
+                m_sample_positions.clear();
+                m_sample_offsets.clear();
+
                 for (size_t i = 0; i < batch_size; ++i)
                 {
                     // Generate a uniform sample in [0,1)^2.
                     const Vector2d s = sampling_context.next_vector2<2>();
 
                     // Compute the sample position in NDC.
-                    const Vector2d sample_position = frame.get_sample_position(ix + s.x, iy + s.y);
-
-                    // Render the sample.
-                    SamplingContext child_sampling_context(sampling_context);
-                    ShadingResult shading_result(aov_count);
-                    m_sample_renderer->render_sample(
-                        child_sampling_context,
-                        pixel_context,
-                        sample_position,
-                        shading_result);
+                    m_sample_positions.push_back(frame.get_sample_position(ix + s.x, iy + s.y));
+                    m_sample_offsets.push_back(s);
+                    m_sampling_contexts.push_back(sampling_context);
+                }
+
+                // Render the samples of the batch all at once.
+                ShadingResult** shading_results = get_shading_results(batch_size, aov_count);
+                m_sample_renderer->render_samples(
+                    &m_sampling_contexts[0],
+                    pixel_context,
+                    &m_sample_positions[0],
+                    batch_size,
+                    shading_results);
+
+                for (size_t i = 0; i < batch_size; ++i)
+                {
+                    const ShadingResult& shading_result = *shading_results[i];
+                    const Vector2d& s = m_sample_offsets[i];
 
                     // Ignore invalid samples.
                     if (!shading_result.is_valid_linear_rgb())
@@ -331,6 +352,9 @@ namespace
         int                                 m_scratch_fb_half_height;
         auto_ptr<ShadingResultFrameBuffer>  m_scratch_fb;
         auto_ptr<Tile>                      m_diagnostics;
+        vector<SamplingContext>             m_sampling_contexts;
+        vector<Vector2d>                    m_sample_positions;
+        vector<Vector2d>                    m_sample_offsets;
 
         static Color4f scalar_to_color(const float value)
         {
@@ -58,6 +58,7 @@
 // Standard headers.
 #include <cmath>
 #include <cstddef>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class Tile; }
@@ -110,6 +111,14 @@ namespace
             delete this;
         }
 
+        virtual void prefetch_textures(
+            const Frame&                frame,
+            const AABB2i&               bbox,
+            const size_t                spacing) OVERRIDE
+        {
+            prefetch_textures_on_grid(*m_sample_renderer, frame, bbox, spacing);
+        }
+
         virtual void render_pixel(
             const Frame&                frame,
             Tile&                       tile,
@@ -126,6 +135,11 @@ namespace
             const int iy = pixel_context.m_iy;
             const size_t aov_count = frame.aov_images().size();
 
+            // The samples of the pixel are rendered all at once.
+            m_sampling_contexts.clear();
+            m_sample_positions.clear();
+            m_sample_offsets.clear();
+
             if (m_params.m_decorrelate)
             {
                 // Create a sampling context.
@@ -146,21 +160,9 @@ namespace
                             : Vector2d(0.5);
 
                     // Compute the sample position in NDC.
-                    const Vector2d sample_position = frame.get_sample_position(ix + s.x, iy + s.y);
-
-                    // Render the sample.
-                    SamplingContext child_sampling_context(sampling_context);
-                    ShadingResult shading_result(aov_count);
-                    m_sample_renderer->render_sample(
-                        child_sampling_context,
-                        pixel_context,
-                        sample_position,
-                        shading_result);
-
-                    // Merge the sample into the framebuffer.
-                    if (shading_result.is_valid_linear_rgb())
-                        framebuffer.add(tx + s.x, ty + s.y, shading_result);
-                    else signal_invalid_sample();
+                    m_sample_positions.push_back(frame.get_sample_position(ix + s.x, iy + s.y));
+                    m_sample_offsets.push_back(Vector2d(tx + s.x, ty + s.y));
+                    m_sampling_contexts.push_back(sampling_context);
                 }
             }
             else
@@ -178,32 +180,42 @@ namespace
                         m_pixel_sampler.sample(base_sx + sx, base_sy + sy, s, instance);
 
                         // Compute the sample position in NDC.
-                        const Vector2d sample_position = frame.get_sample_position(s.x, s.y);
+                        m_sample_positions.push_back(frame.get_sample_position(s.x, s.y));
+                        m_sample_offsets.push_back(Vector2d(s.x - ix + tx, s.y - iy + ty));
 
                         // Create a sampling context. We start with an initial dimension of 1,
                         // as this seems to give less correlation artifacts than when the
                         // initial dimension is set to 0 or 2.
-                        SamplingContext sampling_context(
-                            rng,
-                            1,              // number of dimensions
-                            instance,       // number of samples
-                            instance);      // initial instance number -- end of sequence
-
-                        // Render the sample.
-                        ShadingResult shading_result(aov_count);
-                        m_sample_renderer->render_sample(
-                            sampling_context,
-                            pixel_context,
-                            sample_position,
-                            shading_result);
-
-                        // Merge the sample into the framebuffer.
-                        if (shading_result.is_valid_linear_rgb())
-                            framebuffer.add(s.x - ix + tx, s.y - iy + ty, shading_result);
-                        else signal_invalid_sample();
+                        m_sampling_contexts.push_back(
+                            SamplingContext(
+                                rng,
+                                1,              // number of dimensions
+                                instance,       // number of samples
+                                instance));     // initial instance number -- end of sequence
                     }
                 }
             }
+
+            const size_t sample_count = m_sampling_contexts.size();
+            if (sample_count == 0)
+                return;
+
+            // Render the samples.
+            ShadingResult** shading_results = get_shading_results(sample_count, aov_count);
+            m_sample_renderer->render_samples(
+                &m_sampling_contexts[0],
+                pixel_context,
+                &m_sample_positions[0],
+                sample_count,
+                shading_results);
+
+            // Merge the samples into the framebuffer.
+            for (size_t i = 0; i < sample_count; ++i)
+            {
+                if (shading_results[i]->is_valid_linear_rgb())
+                    framebuffer.add(m_sample_offsets[i].x, m_sample_offsets[i].y, *shading_results[i]);
+                else signal_invalid_sample();
+            }
         }
 
         virtual StatisticsVector get_statistics() const OVERRIDE
@@ -231,6 +243,9 @@ namespace
         const size_t                        m_sample_count;
         const int                           m_sqrt_sample_count;
         PixelSampler                        m_pixel_sampler;
+        vector<SamplingContext>             m_sampling_contexts;
+        vector<Vector2d>                    m_sample_positions;
+        vector<Vector2d>                    m_sample_offsets;
     };
 }
 
@@ -36,6 +36,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/platform/system.h"
+#include "foundation/utility/job/jobmanager.h"
 #include "foundation/utility/string.h"
 
 // Standard headers.
@@ -91,6 +92,29 @@ size_t FrameRendererBase::get_rendering_thread_count(const ParamArray& params)
     return thread_count;
 }
 
+int FrameRendererBase::get_thread_affinity_flags(const ParamArray& params)
+{
+    static const char* ThreadAffinityParameterName = "thread_affinity";
+
+    const string thread_affinity =
+        params.get_optional<string>(ThreadAffinityParameterName, "none");
+
+    if (thread_affinity == "none")
+        return 0;
+    else if (thread_affinity == "cores")
+        return JobManager::PinThreadsToCpuCores;
+    else if (thread_affinity == "numa_nodes")
+        return JobManager::PinThreadsToNumaNodes;
+
+    RENDERER_LOG_ERROR(
+        "invalid value \"%s\" for parameter \"%s\", using default value \"%s\".",
+        thread_affinity.c_str(),
+        ThreadAffinityParameterName,
+        "none");
+
+    return 0;
+}
+
 void FrameRendererBase::print_rendering_thread_count(const size_t thread_count)
 {
     RENDERER_LOG_INFO(
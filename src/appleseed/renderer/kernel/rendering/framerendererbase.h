@@ -53,6 +53,10 @@ class FrameRendererBase
     // Extract the number of rendering threads from the "rendering_threads" parameter.
     static size_t get_rendering_thread_count(const ParamArray& params);
 
+    // Extract the foundation::JobManager flags that bind rendering threads to CPU cores
+    // or NUMA nodes from the "thread_affinity" parameter.
+    static int get_thread_affinity_flags(const ParamArray& params);
+
     // Output the number of rendering threads to the log.
     static void print_rendering_thread_count(const size_t thread_count);
 };
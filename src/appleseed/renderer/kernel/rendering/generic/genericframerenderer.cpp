@@ -92,7 +92,7 @@ namespace
                     global_logger(),
                     m_job_queue,
                     m_params.m_thread_count,
-                    JobManager::KeepRunningOnEmptyQueue));
+                    JobManager::KeepRunningOnEmptyQueue | m_params.m_thread_affinity));
 
             // Instantiate tile renderers, one per rendering thread.
             m_tile_renderers.reserve(m_params.m_thread_count);
@@ -197,11 +197,13 @@ namespace
         struct Parameters
         {
             const size_t                        m_thread_count;     // number of rendering threads
+            const int                           m_thread_affinity;  // foundation::JobManager flags binding threads to cores
             const TileJobFactory::TileOrdering  m_tile_ordering;    // tile rendering order
             const size_t                        m_pass_count;       // number of rendering passes
 
             explicit Parameters(const ParamArray& params)
               : m_thread_count(FrameRendererBase::get_rendering_thread_count(params))
+              , m_thread_affinity(FrameRendererBase::get_thread_affinity_flags(params))
               , m_tile_ordering(get_tile_ordering(params))
               , m_pass_count(params.get_optional<size_t>("passes", 1))
             {
@@ -34,6 +34,7 @@
 #include "renderer/global/globallogger.h"
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/aov/spectrumstack.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
 #include "renderer/kernel/intersection/intersector.h"
 #include "renderer/kernel/intersection/tracecontext.h"
 #include "renderer/kernel/lighting/ilightingengine.h"
@@ -48,8 +49,14 @@
 #include "renderer/kernel/shading/shadingray.h"
 #include "renderer/kernel/shading/shadingresult.h"
 #include "renderer/kernel/texturing/texturecache.h"
+#include "renderer/modeling/bsdf/bsdf.h"
 #include "renderer/modeling/camera/camera.h"
+#include "renderer/modeling/edf/edf.h"
 #include "renderer/modeling/frame/frame.h"
+#include "renderer/modeling/input/inputarray.h"
+#include "renderer/modeling/input/source.h"
+#include "renderer/modeling/input/sourceinputs.h"
+#include "renderer/modeling/material/material.h"
 #include "renderer/modeling/scene/scene.h"
 
 // appleseed.foundation headers.
@@ -62,6 +69,7 @@
 #include "foundation/utility/string.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cstddef>
 #include <limits>
 #include <string>
@@ -157,13 +165,6 @@ namespace
             const Vector2d&         image_point,
             ShadingResult&          shading_result) OVERRIDE
         {
-#ifdef DEBUG_DISPLAY_TEXTURE_CACHE_PERFORMANCES
-
-            const uint64 last_texture_cache_hit_count = m_texture_cache.get_hit_count();
-            const uint64 last_texture_cache_miss_count = m_texture_cache.get_miss_count();
-
-#endif
-
             // Construct a primary ray.
             ShadingRay primary_ray;
             m_scene.get_camera()->generate_ray(
@@ -171,33 +172,154 @@ namespace
                 image_point,
                 primary_ray);
 
-            ShadingPoint shading_points[2];
-            size_t shading_point_index = 0;
-            const ShadingPoint* shading_point_ptr = 0;
-            size_t iterations = 0;
+            // Trace the ray.
+            ShadingPoint shading_point;
+            m_intersector.trace(primary_ray, shading_point);
 
-            while (true)
+            shade_sample(
+                sampling_context,
+                pixel_context,
+                primary_ray,
+                shading_point,
+                shading_result);
+        }
+
+        virtual void render_samples(
+            SamplingContext         sampling_contexts[],
+            const PixelContext&     pixel_context,
+            const Vector2d          image_points[],
+            const size_t            sample_count,
+            ShadingResult*          shading_results[]) OVERRIDE
+        {
+            for (size_t begin = 0; begin < sample_count; begin += RayPacketSize)
             {
-                // Put a hard limit on the number of iterations.
-                if (++iterations >= m_params.m_max_iterations)
+                const size_t packet_size = min(sample_count - begin, RayPacketSize);
+
+                // Construct the primary rays.
+                ShadingRay primary_rays[RayPacketSize];
+                for (size_t i = 0; i < packet_size; ++i)
                 {
-                    RENDERER_LOG_WARNING(
-                        "reached hard iteration limit (%s), breaking primary ray trace loop.",
-                        pretty_int(m_params.m_max_iterations).c_str());
-                    break;
+                    m_scene.get_camera()->generate_ray(
+                        sampling_contexts[begin + i],
+                        image_points[begin + i],
+                        primary_rays[i]);
                 }
 
-                // Trace the ray.
-                shading_points[shading_point_index].clear();
-                m_intersector.trace(
-                    primary_ray,
-                    shading_points[shading_point_index],
-                    shading_point_ptr);
+                // Trace the rays as a packet.
+                ShadingPoint shading_points[RayPacketSize];
+                m_intersector.trace(primary_rays, packet_size, shading_points);
 
-                // Update the pointers to the shading points.
-                shading_point_ptr = &shading_points[shading_point_index];
-                shading_point_index = 1 - shading_point_index;
+                for (size_t i = 0; i < packet_size; ++i)
+                {
+                    shade_sample(
+                        sampling_contexts[begin + i],
+                        pixel_context,
+                        primary_rays[i],
+                        shading_points[i],
+                        *shading_results[begin + i]);
+                }
+            }
+        }
+
+        virtual void prefetch_textures(
+            SamplingContext&        sampling_context,
+            const Vector2d&         image_point) OVERRIDE
+        {
+            // Find the surface visible through this point.
+            ShadingRay primary_ray;
+            m_scene.get_camera()->generate_ray(
+                sampling_context,
+                image_point,
+                primary_ray);
+
+            ShadingPoint shading_point;
+            m_intersector.trace(primary_ray, shading_point);
+
+            if (!shading_point.hit())
+                return;
+
+            const Material* material = shading_point.get_material();
+            if (material == 0)
+                return;
+
+            // Prefetch the textures of the material, at the level of detail used for shading.
+            const SourceInputs source_inputs = shading_point.get_source_inputs(0);
+
+            if (const Source* alpha_map = material->get_alpha_map())
+                alpha_map->prefetch(m_texture_cache, source_inputs);
+
+            if (const BSDF* bsdf = material->get_bsdf())
+                bsdf->get_inputs().prefetch(m_texture_cache, source_inputs);
+
+            if (const EDF* edf = material->get_edf())
+                edf->get_inputs().prefetch(m_texture_cache, source_inputs);
+        }
+
+        virtual StatisticsVector get_statistics() const OVERRIDE
+        {
+            StatisticsVector stats;
+            stats.merge(m_texture_cache.get_statistics());
+            stats.merge(m_intersector.get_statistics());
+            stats.merge(m_lighting_engine->get_statistics());
+            return stats;
+        }
+
+      private:
+        struct Parameters
+        {
+            const float     m_transparency_threshold;
+            const size_t    m_max_iterations;
+            const bool      m_report_self_intersections;
+
+            explicit Parameters(const ParamArray& params)
+              : m_transparency_threshold(params.get_optional<float>("transparency_threshold", 0.001f))
+              , m_max_iterations(params.get_optional<size_t>("max_iterations", 1000))
+              , m_report_self_intersections(params.get_optional<bool>("report_self_intersections", false))
+            {
+            }
+        };
+
+        const Parameters            m_params;
+        const Scene&                m_scene;
+        const LightingConditions&   m_lighting_conditions;
+        const float                 m_opacity_threshold;
+
+        TextureCache                m_texture_cache;
+        Intersector                 m_intersector;
+#ifdef WITH_OSL
+        OSLShaderGroupExec          m_shadergroup_exec;
+#endif
+        Tracer                      m_tracer;
+        ILightingEngine*            m_lighting_engine;
+        const ShadingContext        m_shading_context;
+        ShadingEngine&              m_shading_engine;
+
+        // Shade the surface visible along a primary ray, then continue the ray through
+        // transparent surfaces until full opacity is reached.
+        void shade_sample(
+            SamplingContext&        sampling_context,
+            const PixelContext&     pixel_context,
+            ShadingRay&             primary_ray,
+            const ShadingPoint&     first_shading_point,
+            ShadingResult&          shading_result)
+        {
+#ifdef DEBUG_DISPLAY_TEXTURE_CACHE_PERFORMANCES
+
+            const uint64 last_texture_cache_hit_count = m_texture_cache.get_hit_count();
+            const uint64 last_texture_cache_miss_count = m_texture_cache.get_miss_count();
+
+#endif
+
+            // Discard scratch memory allocated while rendering the previous sample.
+            m_shading_context.get_arena().clear();
+
+            ShadingPoint shading_points[2];
+            size_t shading_point_index = 0;
+            const ShadingPoint* shading_point_ptr = &first_shading_point;
+            size_t iterations = 1;
 
+            while (true)
+            {
                 if (iterations == 1)
                 {
                     // Shade the intersection point.
@@ -245,9 +367,29 @@ namespace
                 if (max_value(shading_result.m_main.m_alpha) > m_opacity_threshold)
                     break;
 
+                // Put a hard limit on the number of iterations.
+                if (++iterations >= m_params.m_max_iterations)
+                {
+                    RENDERER_LOG_WARNING(
+                        "reached hard iteration limit (%s), breaking primary ray trace loop.",
+                        pretty_int(m_params.m_max_iterations).c_str());
+                    break;
+                }
+
                 // Move the ray origin to the intersection point.
                 primary_ray.m_org = shading_point_ptr->get_point();
                 primary_ray.m_tmax = numeric_limits<double>::max();
+
+                // Trace the ray.
+                shading_points[shading_point_index].clear();
+                m_intersector.trace(
+                    primary_ray,
+                    shading_points[shading_point_index],
+                    shading_point_ptr);
+
+                // Update the pointers to the shading points.
+                shading_point_ptr = &shading_points[shading_point_index];
+                shading_point_index = 1 - shading_point_index;
             }
 
 #ifdef DEBUG_DISPLAY_TEXTURE_CACHE_PERFORMANCES
@@ -273,45 +415,6 @@ namespace
 
 #endif
         }
-
-        virtual StatisticsVector get_statistics() const OVERRIDE
-        {
-            StatisticsVector stats;
-            stats.merge(m_texture_cache.get_statistics());
-            stats.merge(m_intersector.get_statistics());
-            stats.merge(m_lighting_engine->get_statistics());
-            return stats;
-        }
-
-      private:
-        struct Parameters
-        {
-            const float     m_transparency_threshold;
-            const size_t    m_max_iterations;
-            const bool      m_report_self_intersections;
-
-            explicit Parameters(const ParamArray& params)
-              : m_transparency_threshold(params.get_optional<float>("transparency_threshold", 0.001f))
-              , m_max_iterations(params.get_optional<size_t>("max_iterations", 1000))
-              , m_report_self_intersections(params.get_optional<bool>("report_self_intersections", false))
-            {
-            }
-        };
-
-        const Parameters            m_params;
-        const Scene&                m_scene;
-        const LightingConditions&   m_lighting_conditions;
-        const float                 m_opacity_threshold;
-
-        TextureCache                m_texture_cache;
-        Intersector                 m_intersector;
-#ifdef WITH_OSL
-        OSLShaderGroupExec          m_shadergroup_exec;
-#endif
-        Tracer                      m_tracer;
-        ILightingEngine*            m_lighting_engine;
-        const ShadingContext        m_shading_context;
-        ShadingEngine&              m_shading_engine;
     };
 }
 
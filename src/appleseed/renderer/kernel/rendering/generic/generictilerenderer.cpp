@@ -99,6 +99,7 @@ namespace
             const bool                          primary)
           : m_pixel_renderer(pixel_renderer_factory->create(primary))
           , m_framebuffer_factory(framebuffer_factory)
+          , m_texture_prefetch_spacing(params.get_optional<size_t>("texture_prefetch_spacing", 0))
         {
             compute_tile_margins(frame, primary);
             compute_pixel_ordering(frame);
@@ -137,6 +138,15 @@ namespace
             if (!tile_bbox.is_valid())
                 return;
 
+            // Give the texture store a head start on the tiles this tile will need.
+            if (m_texture_prefetch_spacing > 0)
+            {
+                m_pixel_renderer->prefetch_textures(
+                    frame,
+                    AABB2i(tile_bbox),
+                    m_texture_prefetch_spacing);
+            }
+
             // Transform the bounding box to local (tile) space.
             tile_bbox.min.x -= tile_origin_x;
             tile_bbox.min.y -= tile_origin_y;
@@ -225,6 +235,7 @@ namespace
       protected:
         auto_release_ptr<IPixelRenderer>    m_pixel_renderer;
         IShadingResultFrameBufferFactory*   m_framebuffer_factory;
+        const size_t                        m_texture_prefetch_spacing;
         int                                 m_margin_width;
         int                                 m_margin_height;
         vector<Vector<int16, 2> >           m_pixel_ordering;
@@ -40,7 +40,16 @@
 #include "foundation/image/image.h"
 #include "foundation/image/pixel.h"
 #include "foundation/image/tile.h"
+#include "foundation/math/scalar.h"
 #include "foundation/platform/thread.h"
+#include "foundation/utility/memory.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <new>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -48,13 +57,38 @@ using namespace std;
 namespace renderer
 {
 
+namespace
+{
+    // Minimum height of a band, in pixels.
+    const size_t MinBandHeight = 16;
+
+    size_t compute_band_height(const Filter2d& filter)
+    {
+        return max(MinBandHeight, static_cast<size_t>(ceil(filter.get_yradius())) + 1);
+    }
+}
+
 GlobalSampleAccumulationBuffer::GlobalSampleAccumulationBuffer(
     const size_t    width,
     const size_t    height,
     const Filter2d& filter)
   : m_fb(width, height, 3, filter)
   , m_filter_rcp_norm_factor(static_cast<float>(1.0 / compute_normalization_factor(filter)))
+  , m_band_height(compute_band_height(filter))
+  , m_band_count(max<size_t>((height + m_band_height - 1) / m_band_height, 1))
+  , m_bands(static_cast<Band*>(aligned_malloc(m_band_count * sizeof(Band), sizeof(Band))))
 {
+    // Bands start on a cache line boundary so that each lock has its own cache line.
+    for (size_t i = 0; i < m_band_count; ++i)
+        new (&m_bands[i]) Band();
+}
+
+GlobalSampleAccumulationBuffer::~GlobalSampleAccumulationBuffer()
+{
+    for (size_t i = 0; i < m_band_count; ++i)
+        m_bands[i].~Band();
+
+    aligned_free(m_bands);
 }
 
 void GlobalSampleAccumulationBuffer::clear()
@@ -63,28 +97,83 @@ void GlobalSampleAccumulationBuffer::clear()
 
     SampleAccumulationBuffer::clear_no_lock();
 
+    lock_bands(0, m_band_count - 1);
     m_fb.clear();
+    unlock_bands(0, m_band_count - 1);
 }
 
 void GlobalSampleAccumulationBuffer::store_samples(
     const size_t    sample_count,
     const Sample    samples[])
 {
-    boost::mutex::scoped_lock lock(m_mutex);
-
     const double fw = static_cast<double>(m_fb.get_width());
     const double fh = static_cast<double>(m_fb.get_height());
-    const Sample* sample_end = samples + sample_count;
 
-    for (const Sample* sample_ptr = samples; sample_ptr < sample_end; ++sample_ptr)
+    // Reuse the sorting memory of the calling thread.
+    SortScratch* scratch = m_sort_scratch.get();
+    if (scratch == 0)
     {
-        const double fx = sample_ptr->m_position.x * fw;
-        const double fy = sample_ptr->m_position.y * fh;
+        scratch = new SortScratch();
+        m_sort_scratch.reset(scratch);
+    }
 
-        Color3f value = sample_ptr->m_color.rgb();
-        value *= m_filter_rcp_norm_factor;
+    vector<size_t>& sample_bands = scratch->m_sample_bands;
+    vector<size_t>& band_offsets = scratch->m_band_offsets;
+    vector<size_t>& band_ends = scratch->m_band_ends;
+    vector<const Sample*>& sorted_samples = scratch->m_sorted_samples;
+
+    // Sort the samples by band (counting sort), so that each band is locked once.
+    sample_bands.resize(sample_count);
+    band_offsets.assign(m_band_count + 1, 0);
+
+    for (size_t i = 0; i < sample_count; ++i)
+    {
+        const double fy = samples[i].m_position.y * fh;
+        const size_t y = fy > 0.0 ? truncate<size_t>(fy) : 0;
+        const size_t band = min(y / m_band_height, m_band_count - 1);
 
-        m_fb.add(fx, fy, &value[0]);
+        sample_bands[i] = band;
+        ++band_offsets[band + 1];
+    }
+
+    for (size_t i = 0; i < m_band_count; ++i)
+        band_offsets[i + 1] += band_offsets[i];
+
+    sorted_samples.resize(sample_count);
+    band_ends.assign(band_offsets.begin(), band_offsets.end() - 1);
+
+    for (size_t i = 0; i < sample_count; ++i)
+        sorted_samples[band_ends[sample_bands[i]]++] = &samples[i];
+
+    // Accumulate the samples of each band.
+    for (size_t band = 0; band < m_band_count; ++band)
+    {
+        const size_t begin = band_offsets[band];
+        const size_t end = band_offsets[band + 1];
+
+        if (begin == end)
+            continue;
+
+        // The filter footprint of the samples may extend into the adjacent bands.
+        const size_t first_band = band > 0 ? band - 1 : 0;
+        const size_t last_band = min(band + 1, m_band_count - 1);
+
+        lock_bands(first_band, last_band);
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Sample* sample_ptr = sorted_samples[i];
+
+            const double fx = sample_ptr->m_position.x * fw;
+            const double fy = sample_ptr->m_position.y * fh;
+
+            Color3f value = sample_ptr->m_color.rgb();
+            value *= m_filter_rcp_norm_factor;
+
+            m_fb.add(fx, fy, &value[0]);
+        }
+
+        unlock_bands(first_band, last_band);
     }
 }
 
@@ -103,15 +192,24 @@ void GlobalSampleAccumulationBuffer::develop_to_frame(Frame& frame)
 
     for (size_t ty = 0; ty < frame_props.m_tile_count_y; ++ty)
     {
+        const size_t y = ty * frame_props.m_tile_height;
+
+        // Only lock the bands covered by this row of tiles.
+        const size_t first_band = min(y / m_band_height, m_band_count - 1);
+        const size_t last_band = min((y + frame_props.m_tile_height - 1) / m_band_height, m_band_count - 1);
+
+        lock_bands(first_band, last_band);
+
         for (size_t tx = 0; tx < frame_props.m_tile_count_x; ++tx)
         {
             Tile& tile = image.tile(tx, ty);
 
             const size_t x = tx * frame_props.m_tile_width;
-            const size_t y = ty * frame_props.m_tile_height;
 
             develop_to_tile(tile, x, y, tx, ty, scale);
         }
+
+        unlock_bands(first_band, last_band);
     }
 }
 
@@ -122,6 +220,22 @@ void GlobalSampleAccumulationBuffer::increment_sample_count(const uint64 delta_s
     m_sample_count += delta_sample_count;
 }
 
+void GlobalSampleAccumulationBuffer::lock_bands(
+    const size_t    first_band,
+    const size_t    last_band)
+{
+    for (size_t i = first_band; i <= last_band; ++i)
+        m_bands[i].m_lock.lock();
+}
+
+void GlobalSampleAccumulationBuffer::unlock_bands(
+    const size_t    first_band,
+    const size_t    last_band)
+{
+    for (size_t i = first_band; i <= last_band; ++i)
+        m_bands[i].m_lock.unlock();
+}
+
 void GlobalSampleAccumulationBuffer::develop_to_tile(
     Tile&           tile,
     const size_t    origin_x,
@@ -37,19 +37,35 @@
 #include "foundation/image/filteredtile.h"
 #include "foundation/math/filter.h"
 #include "foundation/platform/compiler.h"
+#include "foundation/platform/thread.h"
 #include "foundation/platform/types.h"
+#include "foundation/utility/test.h"
+
+// boost headers.
+#include "boost/thread/tss.hpp"
 
 // Standard headers.
 #include <cstddef>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class Tile; }
 namespace renderer      { class Frame; }
 namespace renderer      { class Sample; }
+DECLARE_TEST_CASE(Renderer_Kernel_Rendering_GlobalSampleAccumulationBuffer, StoreSamples_GivenSamplesFromMultipleThreads_AccumulatesSameValuesAsSingleThread);
 
 namespace renderer
 {
 
+//
+// An accumulation buffer where samples can land anywhere in the frame.
+//
+// The frame is divided into horizontal bands of pixel rows, each protected by its own
+// lock, so that threads storing samples into different parts of the frame don't wait
+// for each other. Bands are at least as high as the filter footprint, so a sample only
+// ever touches its own band and the two adjacent ones.
+//
+
 class GlobalSampleAccumulationBuffer
   : public SampleAccumulationBuffer
 {
@@ -60,6 +76,9 @@ class GlobalSampleAccumulationBuffer
         const size_t                height,
         const foundation::Filter2d& filter);
 
+    // Destructor.
+    ~GlobalSampleAccumulationBuffer();
+
     // Reset the buffer to its initial state. Thread-safe.
     virtual void clear() OVERRIDE;
 
@@ -75,8 +94,34 @@ class GlobalSampleAccumulationBuffer
     void increment_sample_count(const foundation::uint64 delta_sample_count);
 
   private:
+    GRANT_ACCESS_TO_TEST_CASE(Renderer_Kernel_Rendering_GlobalSampleAccumulationBuffer, StoreSamples_GivenSamplesFromMultipleThreads_AccumulatesSameValuesAsSingleThread);
+
+    // Padded to a cache line to prevent false sharing between adjacent locks.
+    struct Band
+    {
+        foundation::Spinlock        m_lock;
+        foundation::uint8           m_padding[64 - sizeof(foundation::Spinlock)];
+    };
+
+    // Memory used by store_samples() to sort samples by band, kept across calls.
+    struct SortScratch
+    {
+        std::vector<size_t>         m_sample_bands;
+        std::vector<size_t>         m_band_offsets;
+        std::vector<size_t>         m_band_ends;
+        std::vector<const Sample*>  m_sorted_samples;
+    };
+
     foundation::FilteredTile        m_fb;
     const float                     m_filter_rcp_norm_factor;
+    const size_t                    m_band_height;
+    const size_t                    m_band_count;
+    Band*                           m_bands;
+    boost::thread_specific_ptr<SortScratch> m_sort_scratch;
+
+    // Lock or unlock the bands first_band to last_band. Bands are always locked in increasing order.
+    void lock_bands(const size_t first_band, const size_t last_band);
+    void unlock_bands(const size_t first_band, const size_t last_band);
 
     void develop_to_tile(
         foundation::Tile&           tile,
@@ -71,6 +71,14 @@ class IPixelRenderer
         foundation::Tile&           tile,
         TileStack&                  aov_tiles) = 0;
 
+    // Hint that the pixels of an image space rectangle will soon be rendered, so that
+    // the texture tiles they need can be loaded in the background. Only the pixels of
+    // a sparse grid with a given spacing (in pixels) are considered.
+    virtual void prefetch_textures(
+        const Frame&                frame,
+        const foundation::AABB2i&   bbox,
+        const size_t                spacing) = 0;
+
     // Render a pixel.
     virtual void render_pixel(
         const Frame&                frame,
@@ -37,6 +37,9 @@
 #include "foundation/core/concepts/iunknown.h"
 #include "foundation/math/vector.h"
 
+// Standard headers.
+#include <cstddef>
+
 // Forward declarations.
 namespace foundation    { class StatisticsVector; }
 namespace renderer      { class PixelContext; }
@@ -61,6 +64,23 @@ class ISampleRenderer
         const foundation::Vector2d&     image_point,
         ShadingResult&                  shading_result) = 0;
 
+    // Render several samples at once. Each sample has its own sampling context and is
+    // rendered exactly as if render_sample() had been called. Samples should be close to
+    // each other on the image plane (e.g. samples of a same pixel) since their primary
+    // rays may be traced together.
+    virtual void render_samples(
+        SamplingContext                 sampling_contexts[],
+        const PixelContext&             pixel_context,
+        const foundation::Vector2d      image_points[],
+        const size_t                    sample_count,
+        ShadingResult*                  shading_results[]) = 0;
+
+    // Hint that samples will soon be rendered around a given point on the image plane,
+    // so that the texture tiles they need can be loaded in the background.
+    virtual void prefetch_textures(
+        SamplingContext&                sampling_context,
+        const foundation::Vector2d&     image_point) = 0;
+
     // Retrieve performance statistics.
     virtual foundation::StatisticsVector get_statistics() const = 0;
 };
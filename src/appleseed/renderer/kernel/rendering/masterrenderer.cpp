@@ -33,6 +33,7 @@
 #include "renderer/kernel/lighting/drt/drtlightingengine.h"
 #include "renderer/kernel/lighting/lighttracing/lighttracingsamplegenerator.h"
 #include "renderer/kernel/lighting/pt/ptlightingengine.h"
+#include "renderer/kernel/lighting/pt/ptpasscallback.h"
 #include "renderer/kernel/lighting/sppm/sppmlightingengine.h"
 #include "renderer/kernel/lighting/sppm/sppmparameters.h"
 #include "renderer/kernel/lighting/sppm/sppmpasscallback.h"
@@ -403,10 +404,38 @@ IRendererController::Status MasterRenderer::initialize_and_render_frame_sequence
         }
         else if (value == "pt")
         {
+            const ParamArray params = m_params.child("pt");    // todo: change to "pt_lighting_engine" -- or?
+
+            // The path guide is trained at the end of each pass: it is useless unless
+            // the generic frame renderer renders at least two passes.
+            bool enable_path_guiding = params.get_optional<bool>("enable_path_guiding", false);
+            if (enable_path_guiding)
+            {
+                if (m_params.get_optional<string>("frame_renderer", "generic") != "generic")
+                {
+                    RENDERER_LOG_WARNING("path guiding requires the generic frame renderer, disabling it.");
+                    enable_path_guiding = false;
+                }
+                else if (m_params.child("generic_frame_renderer").get_optional<size_t>("passes", 1) < 2)
+                {
+                    RENDERER_LOG_WARNING("path guiding requires multipass rendering, disabling it.");
+                    enable_path_guiding = false;
+                }
+            }
+
+            PathGuide* path_guide = 0;
+            if (enable_path_guiding)
+            {
+                PTPassCallback* pt_pass_callback = new PTPassCallback(scene, params);
+                pass_callback.reset(pt_pass_callback);
+                path_guide = &pt_pass_callback->get_path_guide();
+            }
+
             lighting_engine_factory.reset(
                 new PTLightingEngineFactory(
                     light_sampler,
-                    m_params.child("pt")));     // todo: change to "pt_lighting_engine" -- or?
+                    path_guide,
+                    params));
         }
         else if (value == "sppm")
         {
@@ -641,6 +670,7 @@ IRendererController::Status MasterRenderer::initialize_and_render_frame_sequence
         {
             ParamArray params = m_params.child("generic_frame_renderer");
             copy_param(params, m_params, "rendering_threads");
+            copy_param(params, m_params, "thread_affinity");
 
             frame_renderer.reset(
                 GenericFrameRendererFactory::create(
@@ -654,6 +684,7 @@ IRendererController::Status MasterRenderer::initialize_and_render_frame_sequence
         {
             ParamArray params = m_params.child("progressive_frame_renderer");
             copy_param(params, m_params, "rendering_threads");
+            copy_param(params, m_params, "thread_affinity");
 
             frame_renderer.reset(
                 ProgressiveFrameRendererFactory::create(
@@ -32,11 +32,18 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/rendering/isamplerenderer.h"
+#include "renderer/kernel/shading/shadingresult.h"
+#include "renderer/modeling/frame/frame.h"
 
 // appleseed.foundation headers.
+#include "foundation/math/vector.h"
 #include "foundation/utility/string.h"
 
 // Standard headers.
+#include <cassert>
+#include <cstddef>
 #include <string>
 
 using namespace foundation;
@@ -55,6 +62,8 @@ PixelRendererBase::PixelRendererBase()
 
 PixelRendererBase::~PixelRendererBase()
 {
+    clear_shading_results();
+
     if (m_invalid_sample_count > 0)
     {
         RENDERER_LOG_WARNING(
@@ -85,4 +94,54 @@ void PixelRendererBase::signal_invalid_sample()
         RENDERER_LOG_WARNING("found at least one pixel sample with NaN or negative values.");
 }
 
+void PixelRendererBase::prefetch_textures_on_grid(
+    ISampleRenderer&    sample_renderer,
+    const Frame&        frame,
+    const AABB2i&       bbox,
+    const size_t        spacing)
+{
+    assert(spacing > 0);
+
+    // Use a private RNG so that the sample sequences of the tile are left untouched.
+    SamplingContext::RNGType rng;
+    SamplingContext sampling_context(
+        rng,
+        2,                      // number of dimensions
+        0,                      // number of samples -- unknown
+        0);                     // initial instance number
+
+    const int step = static_cast<int>(spacing);
+
+    for (int y = bbox.min.y + step / 2; y <= bbox.max.y; y += step)
+    {
+        for (int x = bbox.min.x + step / 2; x <= bbox.max.x; x += step)
+        {
+            const Vector2d image_point = frame.get_sample_position(x + 0.5, y + 0.5);
+            SamplingContext child_sampling_context(sampling_context);
+            sample_renderer.prefetch_textures(child_sampling_context, image_point);
+        }
+    }
+}
+
+ShadingResult** PixelRendererBase::get_shading_results(
+    const size_t        sample_count,
+    const size_t        aov_count)
+{
+    if (!m_shading_results.empty() && m_shading_results.front()->m_aovs.size() != aov_count)
+        clear_shading_results();
+
+    while (m_shading_results.size() < sample_count)
+        m_shading_results.push_back(new ShadingResult(aov_count));
+
+    return m_shading_results.empty() ? 0 : &m_shading_results[0];
+}
+
+void PixelRendererBase::clear_shading_results()
+{
+    for (size_t i = 0; i < m_shading_results.size(); ++i)
+        delete m_shading_results[i];
+
+    m_shading_results.clear();
+}
+
 }   // namespace renderer
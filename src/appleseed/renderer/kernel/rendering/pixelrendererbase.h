@@ -34,12 +34,19 @@
 #include "renderer/kernel/rendering/ipixelrenderer.h"
 
 // appleseed.foundation headers.
+#include "foundation/math/aabb.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/platform/types.h"
 
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
 // Forward declarations.
 namespace foundation    { class Tile; }
 namespace renderer      { class Frame; }
+namespace renderer      { class ISampleRenderer; }
+namespace renderer      { class ShadingResult; }
 namespace renderer      { class TileStack; }
 
 namespace renderer
@@ -74,8 +81,25 @@ class PixelRendererBase
   protected:
     void signal_invalid_sample();
 
+    // Forward texture prefetching hints for the pixels of a sparse grid to a sample renderer.
+    static void prefetch_textures_on_grid(
+        ISampleRenderer&            sample_renderer,
+        const Frame&                frame,
+        const foundation::AABB2i&   bbox,
+        const size_t                spacing);
+
+    // Return an array of at least sample_count shading results with aov_count AOVs each,
+    // to render the samples of a pixel with ISampleRenderer::render_samples(). As with a
+    // newly constructed shading result, the contents of the shading results are undefined.
+    ShadingResult** get_shading_results(
+        const size_t                sample_count,
+        const size_t                aov_count);
+
   private:
-    foundation::uint64 m_invalid_sample_count;
+    foundation::uint64              m_invalid_sample_count;
+    std::vector<ShadingResult*>     m_shading_results;
+
+    void clear_shading_results();
 };
 
 }       // namespace renderer
@@ -101,7 +101,7 @@ namespace
                     global_logger(),
                     m_job_queue,
                     m_params.m_thread_count,
-                    JobManager::KeepRunningOnEmptyQueue));
+                    JobManager::KeepRunningOnEmptyQueue | m_params.m_thread_affinity));
 
             // Instantiate sample generators, one per rendering thread.
             for (size_t i = 0; i < m_params.m_thread_count; ++i)
@@ -263,12 +263,14 @@ namespace
         struct Parameters
         {
             const size_t    m_thread_count;             // number of rendering threads
+            const int       m_thread_affinity;          // foundation::JobManager flags binding threads to cores
             const uint64    m_max_sample_count;         // maximum total number of samples to compute
             const bool      m_print_luminance_stats;    // compute and print luminance statistics?
             const string    m_ref_image_path;           // path to the reference image
 
             explicit Parameters(const ParamArray& params)
               : m_thread_count(FrameRendererBase::get_rendering_thread_count(params))
+              , m_thread_affinity(FrameRendererBase::get_thread_affinity_flags(params))
               , m_max_sample_count(params.get_optional<uint64>("max_samples", numeric_limits<uint64>::max()))
               , m_print_luminance_stats(params.get_optional<bool>("print_luminance_statistics", false))
               , m_ref_image_path(params.get_optional<string>("reference_image", ""))
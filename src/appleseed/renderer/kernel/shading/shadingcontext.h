@@ -37,6 +37,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
+#include "foundation/utility/arena.h"
 
 // OpenImageIO headers.
 #ifdef WITH_OIIO
@@ -87,6 +88,11 @@ class ShadingContext
 
     ILightingEngine* get_lighting_engine() const;
 
+    // Return the arena from which per-sample scratch memory should be allocated.
+    // The arena is cleared by the owner of the shading context at the beginning
+    // of every sample (or path), so allocations must not outlive the sample.
+    foundation::Arena& get_arena() const;
+
     // Return the minimum transmission value that defines transparency.
     float get_transparency_threshold() const;
 
@@ -116,6 +122,7 @@ class ShadingContext
     ILightingEngine*            m_lighting_engine;
     const float                 m_transparency_threshold;
     const size_t                m_max_iterations;
+    mutable foundation::Arena   m_arena;
 #ifdef WITH_OIIO
     OIIO::TextureSystem&        m_oiio_texture_system;
 #endif    
@@ -144,6 +151,11 @@ inline ILightingEngine* ShadingContext::get_lighting_engine() const
     return m_lighting_engine;
 }
 
+inline foundation::Arena& ShadingContext::get_arena() const
+{
+    return m_arena;
+}
+
 inline float ShadingContext::get_transparency_threshold() const
 {
     return m_transparency_threshold;
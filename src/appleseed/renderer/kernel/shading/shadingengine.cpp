@@ -98,7 +98,7 @@ void ShadingEngine::shade_hit_point(
         // There is an alpha map: evaluate it.
         material->get_alpha_map()->evaluate(
             shading_context.get_texture_cache(),
-            shading_point.get_uv(0),
+            shading_point.get_source_inputs(0),
             shading_result.m_main.m_alpha);
     }
     else
@@ -276,6 +276,109 @@ Vector3d ShadingPoint::get_biased_point(const Vector3d& direction) const
     return m_biased_point;
 }
 
+void ShadingPoint::compute_screen_space_derivatives() const
+{
+    m_dpdx = Vector3d(0.0);
+    m_dpdy = Vector3d(0.0);
+    m_duvdx = Vector2d(0.0);
+    m_duvdy = Vector2d(0.0);
+
+    if (!m_ray.m_has_differentials)
+        return;
+
+    // Intersect the auxiliary rays with the tangent plane at the intersection point.
+    const Vector3d& p = get_point();
+    const Vector3d& n = get_geometric_normal();
+    const double dx_dot_n = dot(m_ray.m_rx.m_dir, n);
+    const double dy_dot_n = dot(m_ray.m_ry.m_dir, n);
+    if (dx_dot_n == 0.0 || dy_dot_n == 0.0)
+        return;
+    const double tx = dot(p - m_ray.m_rx.m_org, n) / dx_dot_n;
+    const double ty = dot(p - m_ray.m_ry.m_org, n) / dy_dot_n;
+    m_dpdx = m_ray.m_rx.point_at(tx) - p;
+    m_dpdy = m_ray.m_ry.point_at(ty) - p;
+
+    if (m_primitive_type != PrimitiveTriangle)
+        return;
+
+    cache_source_geometry();
+
+    // Express the position derivatives in terms of two edges of the triangle,
+    // working in the coordinate plane most parallel to the triangle.
+    const Vector3d e0 = get_vertex(0) - get_vertex(2);
+    const Vector3d e1 = get_vertex(1) - get_vertex(2);
+    const size_t axis = max_abs_index(n);
+    const size_t i0 = axis == 0 ? 1 : 0;
+    const size_t i1 = axis == 2 ? 1 : 2;
+    const double det = e0[i0] * e1[i1] - e1[i0] * e0[i1];
+    if (det == 0.0)
+        return;
+    const double rcp_det = 1.0 / det;
+
+    const Vector2d duv0 = Vector2d(m_v0_uv) - Vector2d(m_v2_uv);
+    const Vector2d duv1 = Vector2d(m_v1_uv) - Vector2d(m_v2_uv);
+
+    const double b0x = (m_dpdx[i0] * e1[i1] - e1[i0] * m_dpdx[i1]) * rcp_det;
+    const double b1x = (e0[i0] * m_dpdx[i1] - m_dpdx[i0] * e0[i1]) * rcp_det;
+    const double b0y = (m_dpdy[i0] * e1[i1] - e1[i0] * m_dpdy[i1]) * rcp_det;
+    const double b1y = (e0[i0] * m_dpdy[i1] - m_dpdy[i0] * e0[i1]) * rcp_det;
+
+    m_duvdx = b0x * duv0 + b1x * duv1;
+    m_duvdy = b0y * duv0 + b1y * duv1;
+}
+
+namespace
+{
+    void widen_differential(
+        Vector3d&           dw,
+        const Vector3d&     fallback_axis,
+        const double        spread)
+    {
+        const double n = norm(dw);
+
+        if (n > 0.0)
+            dw *= (n + spread) / n;
+        else dw = spread * fallback_axis;
+    }
+}
+
+void ShadingPoint::compute_scattered_ray_differentials(
+    const Vector3d&         direction,
+    const double            spread,
+    ShadingRay&             scattered_ray) const
+{
+    scattered_ray.m_has_differentials = m_ray.m_has_differentials;
+
+    if (!m_ray.m_has_differentials)
+        return;
+
+    // Differentials of the direction of the incident ray.
+    const Vector3d d = normalize(m_ray.m_dir);
+    Vector3d dwdx = normalize(m_ray.m_rx.m_dir) - d;
+    Vector3d dwdy = normalize(m_ray.m_ry.m_dir) - d;
+
+    // Mirror the direction differentials for reflection, assuming a locally flat surface.
+    const Vector3d& n = get_shading_normal();
+    if (dot(direction, n) * dot(d, n) < 0.0)
+    {
+        dwdx -= (2.0 * dot(dwdx, n)) * n;
+        dwdy -= (2.0 * dot(dwdy, n)) * n;
+    }
+
+    // Account for the blur introduced by non-specular scattering.
+    if (spread > 0.0)
+    {
+        const Basis3d basis(direction);
+        widen_differential(dwdx, basis.get_tangent_u(), spread);
+        widen_differential(dwdy, basis.get_tangent_v(), spread);
+    }
+
+    scattered_ray.m_rx.m_org = scattered_ray.m_org + get_dpdx();
+    scattered_ray.m_ry.m_org = scattered_ray.m_org + get_dpdy();
+    scattered_ray.m_rx.m_dir = direction + dwdx;
+    scattered_ray.m_ry.m_dir = direction + dwdy;
+}
+
 #ifdef WITH_OSL
 
 bool ShadingPoint::OSLObjectTransformInfo::is_animated() const
@@ -332,8 +435,8 @@ OSL::ShaderGlobals& ShadingPoint::get_osl_shader_globals() const
         const ShadingRay& ray(get_ray());
 
         m_shader_globals.P = Vector3f(get_point());
-        m_shader_globals.dPdx = OSL::Vec3(0, 0, 0);
-        m_shader_globals.dPdy = OSL::Vec3(0, 0, 0);
+        m_shader_globals.dPdx = Vector3f(get_dpdx());
+        m_shader_globals.dPdy = Vector3f(get_dpdy());
         m_shader_globals.dPdz = OSL::Vec3(0, 0, 0);
 
         m_shader_globals.I = Vector3f(normalize(ray.m_dir));
@@ -344,13 +447,15 @@ OSL::ShaderGlobals& ShadingPoint::get_osl_shader_globals() const
         m_shader_globals.Ng = Vector3f(get_geometric_normal());
 
         Vector2d uv = get_uv(0);
+        const Vector2d& duvdx = get_duvdx(0);
+        const Vector2d& duvdy = get_duvdy(0);
         m_shader_globals.u = uv.x;
-        m_shader_globals.dudx = 0;
-        m_shader_globals.dudy = 0;
+        m_shader_globals.dudx = duvdx.x;
+        m_shader_globals.dudy = duvdy.x;
 
         m_shader_globals.v = uv.y;
-        m_shader_globals.dvdx = 0;
-        m_shader_globals.dvdy = 0;
+        m_shader_globals.dvdx = duvdx.y;
+        m_shader_globals.dvdy = duvdy.y;
 
         m_shader_globals.dPdu = Vector3f(get_dpdu(0));
         m_shader_globals.dPdv = Vector3f(get_dpdv(0));
@@ -35,6 +35,7 @@
 #include "renderer/kernel/intersection/intersectionsettings.h"
 #include "renderer/kernel/shading/shadingray.h"
 #include "renderer/kernel/tessellation/statictessellation.h"
+#include "renderer/modeling/input/sourceinputs.h"
 #include "renderer/modeling/material/inormalmodifier.h"
 #include "renderer/modeling/material/material.h"
 #include "renderer/modeling/object/curveobject.h"
@@ -137,6 +138,28 @@ class ShadingPoint
     const foundation::Vector3d& get_dpdu(const size_t uvset) const;
     const foundation::Vector3d& get_dpdv(const size_t uvset) const;
 
+    // Return the world space screen-space derivatives of the intersection point, i.e. the
+    // change of the intersection point when moving by one pixel along the x or y axis of the
+    // film plane. They are zero if the ray that was cast carries no differentials.
+    const foundation::Vector3d& get_dpdx() const;
+    const foundation::Vector3d& get_dpdy() const;
+
+    // Return the screen-space derivatives of the texture coordinates from a given UV set.
+    const foundation::Vector2d& get_duvdx(const size_t uvset) const;
+    const foundation::Vector2d& get_duvdy(const size_t uvset) const;
+
+    // Return the texture coordinates from a given UV set and their screen-space derivatives.
+    SourceInputs get_source_inputs(const size_t uvset) const;
+
+    // Set the differentials of a ray leaving the intersection point in a given direction.
+    // Direction differentials are mirrored about the shading normal for reflection and kept
+    // as is for transmission, then widened by 'spread' (in radians) to account for the blur
+    // introduced by non-specular scattering. Does nothing if the incoming ray carries no differentials.
+    void compute_scattered_ray_differentials(
+        const foundation::Vector3d& direction,                  // world space scattered direction, unit-length
+        const double                spread,
+        ShadingRay&                 scattered_ray) const;
+
     // Return the world space geometric normal at the intersection point. The geometric normal
     // always faces the incoming ray, i.e. dot(ray_dir, geometric_normal) is always positive or null.
     const foundation::Vector3d& get_geometric_normal() const;
@@ -219,6 +242,7 @@ class ShadingPoint
 #endif
 
   private:
+    friend class AssemblyLeafPacketVisitor;
     friend class AssemblyLeafProbeVisitor;
     friend class AssemblyLeafVisitor;
     friend class CurveLeafVisitor;
@@ -262,10 +286,11 @@ class ShadingPoint
         HasShadingBasis                 = 1 << 9,
         HasWorldSpaceVertices           = 1 << 10,
         HasWorldSpaceVertexNormals      = 1 << 11,
-        HasMaterial                     = 1 << 12
+        HasMaterial                     = 1 << 12,
+        HasScreenSpaceDerivatives       = 1 << 13
 
 #ifdef WITH_OSL
-        , HasOSLShaderGlobals           = 1 << 13
+        , HasOSLShaderGlobals           = 1 << 14
 #endif
     };
     mutable foundation::uint32          m_members;                      // which members have already been computed
@@ -281,6 +306,10 @@ class ShadingPoint
     mutable foundation::Vector3d        m_biased_point;                 // world space intersection point with per-object-instance bias applied
     mutable foundation::Vector3d        m_dpdu;                         // world space partial derivative of the intersection point wrt. U
     mutable foundation::Vector3d        m_dpdv;                         // world space partial derivative of the intersection point wrt. V
+    mutable foundation::Vector3d        m_dpdx;                         // world space screen-space derivative of the intersection point along x
+    mutable foundation::Vector3d        m_dpdy;                         // world space screen-space derivative of the intersection point along y
+    mutable foundation::Vector2d        m_duvdx;                        // screen-space derivative of the texture coordinates along x
+    mutable foundation::Vector2d        m_duvdy;                        // screen-space derivative of the texture coordinates along y
     mutable foundation::Vector3d        m_geometric_normal;             // world space geometric normal, unit-length
     mutable foundation::Vector3d        m_shading_normal;               // world space (possibly modified) shading normal, unit-length
     mutable foundation::Vector3d        m_original_shading_normal;      // original world space shading normal, unit-length
@@ -317,6 +346,9 @@ class ShadingPoint
 
     // Compute the partial derivatives dp/du and dp/dv.
     void compute_partial_derivatives() const;
+
+    // Compute the screen-space derivatives dp/dx, dp/dy, duv/dx and duv/dy.
+    void compute_screen_space_derivatives() const;
 };
 
 
@@ -483,6 +515,69 @@ inline const foundation::Vector3d& ShadingPoint::get_dpdv(const size_t uvset) co
     return m_dpdv;
 }
 
+inline const foundation::Vector3d& ShadingPoint::get_dpdx() const
+{
+    assert(hit());
+
+    if (!(m_members & HasScreenSpaceDerivatives))
+    {
+        compute_screen_space_derivatives();
+        m_members |= HasScreenSpaceDerivatives;
+    }
+
+    return m_dpdx;
+}
+
+inline const foundation::Vector3d& ShadingPoint::get_dpdy() const
+{
+    assert(hit());
+
+    if (!(m_members & HasScreenSpaceDerivatives))
+    {
+        compute_screen_space_derivatives();
+        m_members |= HasScreenSpaceDerivatives;
+    }
+
+    return m_dpdy;
+}
+
+inline const foundation::Vector2d& ShadingPoint::get_duvdx(const size_t uvset) const
+{
+    assert(hit());
+    assert(uvset == 0);     // todo: support multiple UV sets
+
+    if (!(m_members & HasScreenSpaceDerivatives))
+    {
+        compute_screen_space_derivatives();
+        m_members |= HasScreenSpaceDerivatives;
+    }
+
+    return m_duvdx;
+}
+
+inline const foundation::Vector2d& ShadingPoint::get_duvdy(const size_t uvset) const
+{
+    assert(hit());
+    assert(uvset == 0);     // todo: support multiple UV sets
+
+    if (!(m_members & HasScreenSpaceDerivatives))
+    {
+        compute_screen_space_derivatives();
+        m_members |= HasScreenSpaceDerivatives;
+    }
+
+    return m_duvdy;
+}
+
+inline SourceInputs ShadingPoint::get_source_inputs(const size_t uvset) const
+{
+    return
+        SourceInputs(
+            get_uv(uvset),
+            get_duvdx(uvset),
+            get_duvdy(uvset));
+}
+
 inline const foundation::Vector3d& ShadingPoint::get_geometric_normal() const
 {
     assert(hit());
@@ -42,8 +42,12 @@ namespace renderer
 //
 // A ray as it is used throughout the renderer.
 //
+// The ray optionally carries differentials in the form of two auxiliary rays
+// offset by one pixel along the x and y axes of the film plane (Igehy, Tracing
+// Ray Differentials, SIGGRAPH 1999). They are used to estimate the footprint
+// of the ray on the surfaces it hits.
+//
 // todo: add importance/contribution?
-// todo: replace ray by ray differential.
 //
 
 class ShadingRay
@@ -74,9 +78,12 @@ class ShadingRay
     double                          m_time;
     TypeType                        m_type;
     DepthType                       m_depth;
+    bool                            m_has_differentials;
+    RayType                         m_rx;           // auxiliary ray offset by one pixel along x
+    RayType                         m_ry;           // auxiliary ray offset by one pixel along y
 
     // Constructors.
-    ShadingRay();                               // leave all fields uninitialized
+    ShadingRay();                               // leave all fields uninitialized except m_has_differentials
     ShadingRay(
         const RayType&              ray,
         const double                time,
@@ -96,9 +103,12 @@ class ShadingRay
         const double                time,
         const TypeType              type,
         const DepthType             depth = 0);
+
+    // Copy the differentials of another ray.
+    void copy_differentials(const ShadingRay& rhs);
 };
 
-// Transform a ShadingRay.
+// Transform a ShadingRay. Differentials are only needed in world space and are dropped.
 template <typename U>
 ShadingRay transform_to_local(
     const foundation::Transform<U>& transform,
@@ -114,6 +124,7 @@ ShadingRay transform_to_parent(
 //
 
 inline ShadingRay::ShadingRay()
+  : m_has_differentials(false)
 {
 }
 
@@ -126,6 +137,7 @@ inline ShadingRay::ShadingRay(
   , m_time(time)
   , m_type(type)
   , m_depth(depth)
+  , m_has_differentials(false)
 {
 }
 
@@ -139,6 +151,7 @@ inline ShadingRay::ShadingRay(
   , m_time(time)
   , m_type(type)
   , m_depth(depth)
+  , m_has_differentials(false)
 {
 }
 
@@ -154,9 +167,21 @@ inline ShadingRay::ShadingRay(
   , m_time(time)
   , m_type(type)
   , m_depth(depth)
+  , m_has_differentials(false)
 {
 }
 
+inline void ShadingRay::copy_differentials(const ShadingRay& rhs)
+{
+    m_has_differentials = rhs.m_has_differentials;
+
+    if (m_has_differentials)
+    {
+        m_rx = rhs.m_rx;
+        m_ry = rhs.m_ry;
+    }
+}
+
 template <typename U>
 inline ShadingRay transform_to_local(
     const foundation::Transform<U>& transform,
@@ -53,6 +53,9 @@ namespace renderer
 //
 // A thread-local cache of texture tiles.
 //
+// When a miss is adjacent to the previous miss in the same texture and level,
+// the next tile in the same direction is prefetched.
+//
 
 class TextureCache
   : public foundation::NonCopyable
@@ -61,12 +64,22 @@ class TextureCache
     // Constructor.
     explicit TextureCache(TextureStore& store);
 
-    // Get a tile from the cache.
+    // Get a tile of a given level of the MIP pyramid of a texture from the cache.
     foundation::Tile& get(
         const foundation::UniqueID  assembly_uid,
         const foundation::UniqueID  texture_uid,
         const size_t                tile_x,
-        const size_t                tile_y);
+        const size_t                tile_y,
+        const size_t                level = 0);
+
+    // Hint that a tile will likely be needed soon. If it isn't already in this cache,
+    // the texture store is asked to load it in the background.
+    void prefetch(
+        const foundation::UniqueID  assembly_uid,
+        const foundation::UniqueID  texture_uid,
+        const size_t                tile_x,
+        const size_t                tile_y,
+        const size_t                level = 0);
 
     // Retrieve performance statistics.
     foundation::StatisticsVector get_statistics() const;
@@ -111,9 +124,14 @@ class TextureCache
         4                   // number of ways
     > TileCache;
 
+    TextureStore&           m_store;
     TileKeyHasher           m_tile_key_hasher;
     TileRecordSwapper       m_tile_record_swapper;
     TileCache               m_tile_cache;
+    TileKey                 m_last_miss;
+
+    // Prefetch the next tile if a miss continues a sequential access pattern.
+    void prefetch_next_tile(const TileKey& key);
 };
 
 
@@ -122,8 +140,10 @@ class TextureCache
 //
 
 inline TextureCache::TextureCache(TextureStore& store)
-  : m_tile_record_swapper(store)
+  : m_store(store)
+  , m_tile_record_swapper(store)
   , m_tile_cache(m_tile_key_hasher, m_tile_record_swapper, TileKey::invalid())
+  , m_last_miss(TileKey::invalid())
 {
 }
 
@@ -131,10 +151,59 @@ inline foundation::Tile& TextureCache::get(
     const foundation::UniqueID      assembly_uid,
     const foundation::UniqueID      texture_uid,
     const size_t                    tile_x,
-    const size_t                    tile_y)
+    const size_t                    tile_y,
+    const size_t                    level)
 {
-    const TileKey key(assembly_uid, texture_uid, tile_x, tile_y);
-    return *m_tile_cache.get(key)->m_tile;
+    const TileKey key(assembly_uid, texture_uid, tile_x, tile_y, level);
+
+    const foundation::uint64 miss_count = m_tile_cache.get_miss_count();
+    foundation::Tile& tile = *m_tile_cache.get(key)->m_tile;
+
+    if (m_tile_cache.get_miss_count() != miss_count)
+        prefetch_next_tile(key);
+
+    return tile;
+}
+
+inline void TextureCache::prefetch(
+    const foundation::UniqueID      assembly_uid,
+    const foundation::UniqueID      texture_uid,
+    const size_t                    tile_x,
+    const size_t                    tile_y,
+    const size_t                    level)
+{
+    const TileKey key(assembly_uid, texture_uid, tile_x, tile_y, level);
+
+    if (!m_tile_cache.contains(key))
+        m_store.prefetch(key);
+}
+
+inline void TextureCache::prefetch_next_tile(const TileKey& key)
+{
+    if (key.m_assembly_uid == m_last_miss.m_assembly_uid &&
+        key.m_texture_uid == m_last_miss.m_texture_uid &&
+        key.m_level == m_last_miss.m_level)
+    {
+        const int x = static_cast<int>(key.get_tile_x());
+        const int y = static_cast<int>(key.get_tile_y());
+        const int dx = x - static_cast<int>(m_last_miss.get_tile_x());
+        const int dy = y - static_cast<int>(m_last_miss.get_tile_y());
+
+        // Tiles past the edges of the texture are discarded by the texture store.
+        if ((dx != 0 || dy != 0) &&
+            dx >= -1 && dx <= 1 && dy >= -1 && dy <= 1 &&
+            x + dx >= 0 && y + dy >= 0)
+        {
+            prefetch(
+                key.m_assembly_uid,
+                key.m_texture_uid,
+                static_cast<size_t>(x + dx),
+                static_cast<size_t>(y + dy),
+                key.m_level);
+        }
+    }
+
+    m_last_miss = key;
 }
 
 inline foundation::StatisticsVector TextureCache::get_statistics() const
@@ -166,7 +235,8 @@ inline size_t TextureCache::TileKeyHasher::operator()(const TileKey& key) const
         foundation::mix_uint32(
             static_cast<foundation::uint32>(key.m_assembly_uid),
             static_cast<foundation::uint32>(key.m_texture_uid),
-            static_cast<foundation::uint32>(key.m_tile_xy));
+            static_cast<foundation::uint32>(key.m_tile_xy),
+            key.m_level);
 }
 
 
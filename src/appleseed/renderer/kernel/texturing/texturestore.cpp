@@ -39,10 +39,15 @@
 
 // appleseed.foundation headers.
 #include "foundation/image/color.h"
+#include "foundation/image/canvasproperties.h"
 #include "foundation/image/colorspace.h"
+#include "foundation/image/pixel.h"
 #include "foundation/image/tile.h"
+#include "foundation/math/hash.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/foreach.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobmanager.h"
 #include "foundation/utility/memory.h"
 #include "foundation/utility/statistics.h"
 #include "foundation/utility/string.h"
@@ -61,22 +66,419 @@ namespace renderer
 // TextureStore class implementation.
 //
 
+namespace
+{
+    // Sum of the performance counters of all shards, in a form suitable for make_single_stage_cache_stats().
+    struct CacheCounters
+    {
+        uint64  m_hit_count;
+        uint64  m_miss_count;
+
+        uint64 get_hit_count() const    { return m_hit_count; }
+        uint64 get_miss_count() const   { return m_miss_count; }
+    };
+}
+
+class TextureStore::PrefetchJob
+  : public IJob
+{
+  public:
+    PrefetchJob(
+        TextureStore&       store,
+        const TileKey&      key)
+      : m_store(store)
+      , m_key(key)
+    {
+    }
+
+    virtual void execute(const size_t thread_index) OVERRIDE
+    {
+        m_store.load_prefetched_tile(m_key);
+    }
+
+  private:
+    TextureStore&   m_store;
+    const TileKey   m_key;
+};
+
 TextureStore::TextureStore(
     const Scene&        scene,
     const ParamArray&   params)
   : m_tile_swapper(scene, params)
-  , m_tile_cache(m_tile_swapper)
+  , m_max_pending_prefetches(params.get_optional<size_t>("max_pending_prefetches", 256))
+  , m_prefetch_count(0)
+  , m_dropped_prefetch_count(0)
 {
+    for (size_t i = 0; i < ShardCount; ++i)
+        m_shards[i] = new Shard(m_tile_swapper);
+
+    const size_t prefetch_thread_count = params.get_optional<size_t>("prefetch_thread_count", 0);
+
+    if (prefetch_thread_count > 0)
+    {
+        m_prefetch_manager.reset(
+            new JobManager(
+                global_logger(),
+                m_prefetch_queue,
+                prefetch_thread_count,
+                JobManager::KeepRunningOnEmptyQueue | JobManager::KeepRunningOnJobFailure));
+        m_prefetch_manager->start();
+    }
+}
+
+TextureStore::~TextureStore()
+{
+    // Stop the background I/O threads before destroying the shards they load tiles into.
+    if (m_prefetch_manager.get())
+    {
+        m_prefetch_queue.clear_scheduled_jobs();
+        m_prefetch_manager.reset();
+    }
+
+    for (size_t i = 0; i < ShardCount; ++i)
+        delete m_shards[i];
+}
+
+TextureStore::TileRecord& TextureStore::acquire(const TileKey& key)
+{
+    Shard& shard = get_shard(key);
+
+    boost::mutex::scoped_lock lock(shard.m_mutex);
+
+    TileRecord& record = shard.m_tile_cache.get(key);
+
+    // Owning the record prevents it from being evicted while we wait for it or load it.
+    boost_atomic::atomic_inc32(&record.m_owners);
+
+    if (record.m_state == TileRecord::Loading)
+    {
+        // Another thread is loading this tile: wait until it's done.
+        ++shard.m_wait_count;
+
+        do
+        {
+            shard.m_tile_loaded.wait(lock);
+        } while (record.m_state == TileRecord::Loading);
+    }
+
+    if (record.m_state == TileRecord::Unloaded)
+    {
+        // Load the tile without holding the lock, so that other tiles can be
+        // acquired (and loaded) while this one is being read from disk.
+        record.m_state = TileRecord::Loading;
+        lock.unlock();
+
+        Tile* tile;
+
+        try
+        {
+            tile = load_tile(key);
+        }
+        catch (...)
+        {
+            // Let a waiting thread (if any) retry loading the tile.
+            lock.lock();
+            record.m_state = TileRecord::Unloaded;
+            boost_atomic::atomic_dec32(&record.m_owners);
+            shard.m_tile_loaded.notify_all();
+            throw;
+        }
+
+        lock.lock();
+        record.m_tile = tile;
+        record.m_state = TileRecord::Loaded;
+        shard.m_tile_loaded.notify_all();
+    }
+
+    return record;
+}
+
+void TextureStore::prefetch(const TileKey& key)
+{
+    if (m_prefetch_manager.get() == 0)
+        return;
+
+    {
+        boost::mutex::scoped_lock lock(m_prefetch_mutex);
+
+        if (m_pending_prefetches.size() >= m_max_pending_prefetches)
+        {
+            // The background I/O threads are falling behind: drop the request.
+            ++m_dropped_prefetch_count;
+            return;
+        }
+
+        // Ignore requests for tiles that are already scheduled for loading.
+        if (!m_pending_prefetches.insert(key).second)
+            return;
+
+        ++m_prefetch_count;
+    }
+
+    m_prefetch_queue.schedule(new PrefetchJob(*this, key));
 }
 
 StatisticsVector TextureStore::get_statistics() const
 {
-    Statistics stats = make_single_stage_cache_stats(m_tile_cache);
+    CacheCounters counters;
+    counters.m_hit_count = 0;
+    counters.m_miss_count = 0;
+
+    uint64 wait_count = 0;
+
+    for (size_t i = 0; i < ShardCount; ++i)
+    {
+        Shard& shard = *m_shards[i];
+        boost::mutex::scoped_lock lock(shard.m_mutex);
+
+        counters.m_hit_count += shard.m_tile_cache.get_hit_count();
+        counters.m_miss_count += shard.m_tile_cache.get_miss_count();
+        wait_count += shard.m_wait_count;
+    }
+
+    Statistics stats = make_single_stage_cache_stats(counters);
     stats.insert_size("peak size", m_tile_swapper.get_peak_memory_size());
+    stats.insert("shared loads", wait_count);
+
+    if (m_prefetch_manager.get())
+    {
+        boost::mutex::scoped_lock lock(m_prefetch_mutex);
+        stats.insert("prefetches", m_prefetch_count);
+        stats.insert("dropped prefetches", m_dropped_prefetch_count);
+    }
 
     return StatisticsVector::make("texture store statistics", stats);
 }
 
+TextureStore::Shard& TextureStore::get_shard(const TileKey& key)
+{
+    const uint32 h =
+        mix_uint32(
+            static_cast<uint32>(key.m_assembly_uid),
+            static_cast<uint32>(key.m_texture_uid),
+            static_cast<uint32>(key.m_tile_xy),
+            key.m_level);
+
+    return *m_shards[h % ShardCount];
+}
+
+bool TextureStore::is_valid_tile(const TileKey& key) const
+{
+    Texture* texture = m_tile_swapper.get_texture(key);
+    if (texture == 0)
+        return false;
+
+    const CanvasProperties& props = texture->properties();
+    if (key.m_level >= get_level_count(props))
+        return false;
+
+    const size_t level_width = get_level_size(props.m_canvas_width, key.m_level);
+    const size_t level_height = get_level_size(props.m_canvas_height, key.m_level);
+
+    return
+        key.get_tile_x() * props.m_tile_width < level_width &&
+        key.get_tile_y() * props.m_tile_height < level_height;
+}
+
+void TextureStore::load_prefetched_tile(const TileKey& key)
+{
+    // Hints may point outside of the texture: validate them before loading anything.
+    if (is_valid_tile(key))
+    {
+        try
+        {
+            release(acquire(key));
+        }
+        catch (...)
+        {
+            // Errors are reported when the tile is actually needed.
+        }
+    }
+
+    boost::mutex::scoped_lock lock(m_prefetch_mutex);
+    m_pending_prefetches.erase(key);
+}
+
+size_t TextureStore::get_level_count(const CanvasProperties& props)
+{
+    size_t size = max(props.m_canvas_width, props.m_canvas_height);
+    size_t level_count = 1;
+
+    while (size > 1)
+    {
+        size >>= 1;
+        ++level_count;
+    }
+
+    return level_count;
+}
+
+Tile* TextureStore::load_tile(const TileKey& key)
+{
+    Tile* tile =
+        key.m_level == 0
+            ? m_tile_swapper.load_tile(key)
+            : build_mip_tile(key);
+
+    m_tile_swapper.track_loaded_tile(*tile);
+
+    return tile;
+}
+
+namespace
+{
+    // Keeps tiles acquired from a texture store until it goes out of scope.
+    class ParentTiles
+      : public NonCopyable
+    {
+      public:
+        explicit ParentTiles(TextureStore& store)
+          : m_store(store)
+        {
+            for (size_t i = 0; i < 4; ++i)
+                m_records[i] = 0;
+        }
+
+        ~ParentTiles()
+        {
+            for (size_t i = 0; i < 4; ++i)
+            {
+                if (m_records[i])
+                    m_store.release(*m_records[i]);
+            }
+        }
+
+        void acquire(const size_t i, const TextureStore::TileKey& key)
+        {
+            m_records[i] = &m_store.acquire(key);
+        }
+
+        const Tile& get(const size_t i) const
+        {
+            assert(m_records[i]);
+            return *m_records[i]->m_tile;
+        }
+
+      private:
+        TextureStore&               m_store;
+        TextureStore::TileRecord*   m_records[4];
+    };
+}
+
+Tile* TextureStore::build_mip_tile(const TileKey& key)
+{
+    assert(key.m_level > 0);
+
+    const CanvasProperties& props = m_tile_swapper.get_texture(key)->properties();
+
+    const size_t tile_x = key.get_tile_x();
+    const size_t tile_y = key.get_tile_y();
+    const size_t tile_width = props.m_tile_width;
+    const size_t tile_height = props.m_tile_height;
+
+    // Dimensions of the source (finer) level.
+    const size_t src_width = get_level_size(props.m_canvas_width, key.m_level - 1);
+    const size_t src_height = get_level_size(props.m_canvas_height, key.m_level - 1);
+
+    // Dimensions of this level and of this tile.
+    const size_t dst_width = get_level_size(props.m_canvas_width, key.m_level);
+    const size_t dst_height = get_level_size(props.m_canvas_height, key.m_level);
+    assert(tile_x * tile_width < dst_width);
+    assert(tile_y * tile_height < dst_height);
+    const size_t width = min(tile_width, dst_width - tile_x * tile_width);
+    const size_t height = min(tile_height, dst_height - tile_y * tile_height);
+
+    // Acquire the (up to) four tiles of the source level covered by this tile.
+    ParentTiles parents(*this);
+    for (size_t j = 0; j < 2; ++j)
+    {
+        for (size_t i = 0; i < 2; ++i)
+        {
+            const size_t src_tile_x = 2 * tile_x + i;
+            const size_t src_tile_y = 2 * tile_y + j;
+
+            if (src_tile_x * tile_width < src_width && src_tile_y * tile_height < src_height)
+            {
+                parents.acquire(
+                    j * 2 + i,
+                    TileKey(
+                        key.m_assembly_uid,
+                        key.m_texture_uid,
+                        src_tile_x,
+                        src_tile_y,
+                        key.m_level - 1));
+            }
+        }
+    }
+
+    const Tile& first_parent = parents.get(0);
+    const size_t channel_count = first_parent.get_channel_count();
+
+    Tile* tile =
+        new Tile(
+            width,
+            height,
+            channel_count,
+            first_parent.get_pixel_format());
+
+    // Coordinates of the first texel of the source tiles, in source level space.
+    const size_t src_org_x = 2 * tile_x * tile_width;
+    const size_t src_org_y = 2 * tile_y * tile_height;
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            // Average the 2x2 block of source texels, clamping at the edges of the source level.
+            Color4f sum(0.0f);
+
+            for (size_t j = 0; j < 2; ++j)
+            {
+                const size_t sy = min(src_org_y + 2 * y + j, src_height - 1) - src_org_y;
+                const size_t py = sy >= tile_height ? 1 : 0;
+
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    const size_t sx = min(src_org_x + 2 * x + i, src_width - 1) - src_org_x;
+                    const size_t px = sx >= tile_width ? 1 : 0;
+
+                    const Tile& parent = parents.get(py * 2 + px);
+
+                    Color4f texel;
+                    if (channel_count == 3)
+                    {
+                        Color3f rgb;
+                        parent.get_pixel(sx - px * tile_width, sy - py * tile_height, rgb);
+                        texel = Color4f(rgb[0], rgb[1], rgb[2], 1.0f);
+                    }
+                    else parent.get_pixel(sx - px * tile_width, sy - py * tile_height, texel);
+
+                    sum += texel;
+                }
+            }
+
+            sum *= 0.25f;
+
+            if (channel_count == 3)
+                tile->set_pixel(x, y, sum.rgb());
+            else tile->set_pixel(x, y, sum);
+        }
+    }
+
+    return tile;
+}
+
+
+//
+// TextureStore::Shard class implementation.
+//
+
+TextureStore::Shard::Shard(TileSwapper& tile_swapper)
+  : m_tile_cache(tile_swapper)
+  , m_wait_count(0)
+{
+}
+
 
 //
 // TextureStore::TileSwapper class implementation.
@@ -156,14 +558,18 @@ TextureStore::TileSwapper::TileSwapper(
 
 void TextureStore::TileSwapper::load(const TileKey& key, TileRecord& record)
 {
-    // Fetch the texture container.
-    const TextureContainer& textures =
-        key.m_assembly_uid == ~0
-            ? m_scene.textures()
-            : m_assemblies[key.m_assembly_uid]->textures();
+    // The tile is loaded by the thread that acquires the record, outside of the shard's lock.
+    record.m_tile = 0;
+    record.m_owners = 0;
+    record.m_state = TileRecord::Unloaded;
+}
+
+Tile* TextureStore::TileSwapper::load_tile(const TileKey& key)
+{
+    assert(key.m_level == 0);
 
     // Fetch the texture.
-    Texture* texture = textures.get_by_uid(key.m_texture_uid);
+    Texture* texture = get_texture(key);
 
     if (m_params.m_track_tile_loading)
     {
@@ -176,8 +582,7 @@ void TextureStore::TileSwapper::load(const TileKey& key, TileRecord& record)
     }
 
     // Load the tile.
-    record.m_tile = texture->load_tile(key.get_tile_x(), key.get_tile_y());
-    record.m_owners = 0;
+    Tile* tile = texture->load_tile(key.get_tile_x(), key.get_tile_y());
 
     // Convert the tile to the linear RGB color space.
     switch (texture->get_color_space())
@@ -186,60 +591,71 @@ void TextureStore::TileSwapper::load(const TileKey& key, TileRecord& record)
         break;
 
       case ColorSpaceSRGB:
-        convert_tile_srgb_to_linear_rgb(*record.m_tile);
+        convert_tile_srgb_to_linear_rgb(*tile);
         break;
 
       case ColorSpaceCIEXYZ:
-        convert_tile_ciexyz_to_linear_rgb(*record.m_tile);
+        convert_tile_ciexyz_to_linear_rgb(*tile);
         break;
 
       assert_otherwise;
     }
 
+    return tile;
+}
+
+void TextureStore::TileSwapper::track_loaded_tile(const Tile& tile)
+{
     // Track the amount of memory used by the tile cache.
-    m_memory_size += record.m_tile->get_memory_size();
-    m_peak_memory_size = max(m_peak_memory_size, m_memory_size);
+    size_t memory_size;
+    {
+        Spinlock::ScopedLock lock(m_memory_size_lock);
+        m_memory_size += tile.get_memory_size();
+        m_peak_memory_size = max(m_peak_memory_size, m_memory_size);
+        memory_size = m_memory_size;
+    }
 
     if (m_params.m_track_store_size)
     {
-        if (m_memory_size > m_params.m_memory_limit)
+        if (memory_size > m_params.m_memory_limit)
         {
             RENDERER_LOG_DEBUG(
                 "texture store size is %s, exceeding capacity %s by %s",
-                pretty_size(m_memory_size).c_str(),
+                pretty_size(memory_size).c_str(),
                 pretty_size(m_params.m_memory_limit).c_str(),
-                pretty_size(m_memory_size - m_params.m_memory_limit).c_str());
+                pretty_size(memory_size - m_params.m_memory_limit).c_str());
         }
         else
         {
             RENDERER_LOG_DEBUG(
                 "texture store size is %s, below capacity %s by %s",
-                pretty_size(m_memory_size).c_str(),
+                pretty_size(memory_size).c_str(),
                 pretty_size(m_params.m_memory_limit).c_str(),
-                pretty_size(m_params.m_memory_limit - m_memory_size).c_str());
+                pretty_size(m_params.m_memory_limit - memory_size).c_str());
         }
     }
 }
 
 bool TextureStore::TileSwapper::unload(const TileKey& key, TileRecord& record)
 {
-    // Cannot unload tiles that are still in use.
+    // Cannot unload tiles that are still in use (this includes tiles being loaded).
     if (boost_atomic::atomic_read32(&record.m_owners) > 0)
         return false;
 
+    // Nothing to do if the tile failed to load.
+    if (record.m_state != TileRecord::Loaded)
+        return true;
+
     // Track the amount of memory used by the tile cache.
     const size_t tile_memory_size = record.m_tile->get_memory_size();
-    assert(m_memory_size >= tile_memory_size);
-    m_memory_size -= tile_memory_size;
-
-    // Fetch the texture container.
-    const TextureContainer& textures =
-        key.m_assembly_uid == ~0
-            ? m_scene.textures()
-            : m_assemblies[key.m_assembly_uid]->textures();
+    {
+        Spinlock::ScopedLock lock(m_memory_size_lock);
+        assert(m_memory_size >= tile_memory_size);
+        m_memory_size -= tile_memory_size;
+    }
 
     // Fetch the texture.
-    Texture* texture = textures.get_by_uid(key.m_texture_uid);
+    Texture* texture = get_texture(key);
 
     if (m_params.m_track_tile_unloading)
     {
@@ -251,8 +667,10 @@ bool TextureStore::TileSwapper::unload(const TileKey& key, TileRecord& record)
             texture->get_name());
     }
 
-    // Unload the tile.
-    texture->unload_tile(key.get_tile_x(), key.get_tile_y(), record.m_tile);
+    // Unload the tile. Tiles of higher levels are owned by the store.
+    if (key.m_level == 0)
+        texture->unload_tile(key.get_tile_x(), key.get_tile_y(), record.m_tile);
+    else delete record.m_tile;
 
     // Successfully unloaded the tile.
     return true;
@@ -267,6 +685,19 @@ void TextureStore::TileSwapper::gather_assemblies(const AssemblyContainer& assem
     }
 }
 
+Texture* TextureStore::TileSwapper::get_texture(const TileKey& key) const
+{
+    // Fetch the texture container. The assembly map is never modified after
+    // construction, so it can be read concurrently from multiple threads.
+    if (key.m_assembly_uid == ~0)
+        return m_scene.textures().get_by_uid(key.m_texture_uid);
+
+    const AssemblyMap::const_iterator i = m_assemblies.find(key.m_assembly_uid);
+    assert(i != m_assemblies.end());
+
+    return i->second->textures().get_by_uid(key.m_texture_uid);
+}
+
 
 //
 // TextureStore::TileSwapper::Parameters class implementation.
@@ -38,22 +38,30 @@
 #include "foundation/platform/thread.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/cache.h"
+#include "foundation/utility/job/jobqueue.h"
 #include "foundation/utility/uid.h"
 
 // boost headers.
 #include "boost/cstdint.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
 
 // Standard headers.
 #include <cassert>
 #include <cstddef>
 #include <map>
+#include <memory>
+#include <set>
 
 // Forward declarations.
+namespace foundation    { class CanvasProperties; }
+namespace foundation    { class JobManager; }
 namespace foundation    { class Statistics; }
 namespace foundation    { class Tile; }
 namespace renderer      { class Assemblies; }
 namespace renderer      { class ParamArray; }
 namespace renderer      { class Scene; }
+namespace renderer      { class Texture; }
 
 namespace renderer
 {
@@ -61,6 +69,21 @@ namespace renderer
 //
 // A shared store for texture tiles (the backend of the thread-local texture cache).
 //
+// Tiles are distributed over a number of independently locked shards. Tiles are
+// loaded outside of any lock: the first thread requesting a missing tile loads it
+// while other threads requesting the same tile wait for it to become available.
+// Threads requesting other tiles are not blocked.
+//
+// Tiles of level 0 are the tiles of the textures themselves. Tiles of higher levels
+// form a MIP pyramid: each level is half the size of the previous one (rounded down,
+// but never smaller than one texel) and is built on demand by box-filtering tiles of
+// the previous level. All levels use the tile size of the texture.
+//
+// Tiles can also be prefetched: prefetch() returns immediately and the tile is
+// loaded by a pool of background I/O threads, so that render threads find it in
+// the store by the time they need it. Prefetching is disabled unless the
+// prefetch_thread_count parameter is greater than zero.
+//
 
 class TextureStore
   : public foundation::NonCopyable
@@ -72,6 +95,7 @@ class TextureStore
         foundation::UniqueID    m_assembly_uid;
         foundation::UniqueID    m_texture_uid;
         foundation::uint32      m_tile_xy;
+        foundation::uint32      m_level;
 
         TileKey();
 
@@ -79,7 +103,8 @@ class TextureStore
             const foundation::UniqueID  assembly_uid,
             const foundation::UniqueID  texture_uid,
             const size_t                tile_x,
-            const size_t                tile_y);
+            const size_t                tile_y,
+            const size_t                level = 0);
 
         TileKey(
             const foundation::UniqueID  assembly_uid,
@@ -102,8 +127,16 @@ class TextureStore
 
     struct TileRecord
     {
+        enum State
+        {
+            Unloaded,
+            Loading,
+            Loaded
+        };
+
         foundation::Tile*           m_tile;
         volatile boost::uint32_t    m_owners;
+        State                       m_state;        // protected by the mutex of the owning shard
     };
 
     // Constructor.
@@ -111,15 +144,32 @@ class TextureStore
         const Scene&        scene,
         const ParamArray&   params = ParamArray());
 
+    // Destructor.
+    ~TextureStore();
+
     // Acquire an element from the cache. Thread-safe.
+    // Blocks until the tile is loaded.
     TileRecord& acquire(const TileKey& key);
 
     // Release a previously-acquired element. Thread-safe.
     void release(TileRecord& record) const;
 
+    // Schedule the loading of a tile by the background I/O threads. Returns immediately.
+    // The request is ignored if prefetching is disabled or too many requests are pending.
+    // Thread-safe.
+    void prefetch(const TileKey& key);
+
     // Retrieve performance statistics.
     foundation::StatisticsVector get_statistics() const;
 
+    // Return the number of levels of the MIP pyramid of a texture.
+    static size_t get_level_count(const foundation::CanvasProperties& props);
+
+    // Return the width or height of a given level of the MIP pyramid.
+    static size_t get_level_size(
+        const size_t                    base_size,
+        const size_t                    level);
+
   private:
     class TileSwapper
       : public foundation::NonCopyable
@@ -130,7 +180,7 @@ class TextureStore
             const Scene&        scene,
             const ParamArray&   params);
 
-        // Load a cache line.
+        // Load a cache line. Only initializes the record; the tile itself is loaded by load_tile().
         void load(const TileKey& key, TileRecord& record);
 
         // Unload a cache line.
@@ -139,6 +189,15 @@ class TextureStore
         // Return true if the cache is full, false otherwise.
         bool is_full(const size_t element_count) const;
 
+        // Load a tile of level 0 and convert it to the linear RGB color space. Thread-safe.
+        foundation::Tile* load_tile(const TileKey& key);
+
+        // Account for a tile that was just loaded or built. Thread-safe.
+        void track_loaded_tile(const foundation::Tile& tile);
+
+        // Retrieve the texture a tile belongs to. Thread-safe.
+        Texture* get_texture(const TileKey& key) const;
+
         // Return the peak memory size in bytes of the tile cache.
         size_t get_peak_memory_size() const;
 
@@ -155,11 +214,12 @@ class TextureStore
 
         typedef std::map<foundation::UniqueID, const Assembly*> AssemblyMap;
 
-        const Scene&        m_scene;
-        const Parameters    m_params;
-        size_t              m_memory_size;
-        size_t              m_peak_memory_size;
-        AssemblyMap         m_assemblies;
+        const Scene&                    m_scene;
+        const Parameters                m_params;
+        mutable foundation::Spinlock    m_memory_size_lock;
+        size_t                          m_memory_size;
+        size_t                          m_peak_memory_size;
+        AssemblyMap                     m_assemblies;
 
         void gather_assemblies(const AssemblyContainer& assemblies);
     };
@@ -170,26 +230,51 @@ class TextureStore
         TileSwapper
     > TileCache;
 
-    boost::mutex    m_mutex;
-    TileSwapper     m_tile_swapper;
-    TileCache       m_tile_cache;
-};
+    struct Shard
+      : public foundation::NonCopyable
+    {
+        boost::mutex                m_mutex;
+        boost::condition_variable   m_tile_loaded;
+        TileCache                   m_tile_cache;
+        foundation::uint64          m_wait_count;   // number of times a thread waited for a tile loaded by another thread
 
+        explicit Shard(TileSwapper& tile_swapper);
+    };
 
-//
-// TextureStore class implementation.
-//
+    enum { ShardCount = 16 };
 
-inline TextureStore::TileRecord& TextureStore::acquire(const TileKey& key)
-{
-    boost::mutex::scoped_lock lock(m_mutex);
+    class PrefetchJob;
 
-    TileRecord& record = m_tile_cache.get(key);
+    TileSwapper                             m_tile_swapper;
+    Shard*                                  m_shards[ShardCount];
 
-    boost_atomic::atomic_inc32(&record.m_owners);
+    mutable boost::mutex                    m_prefetch_mutex;
+    std::set<TileKey>                       m_pending_prefetches;       // protected by m_prefetch_mutex
+    const size_t                            m_max_pending_prefetches;
+    foundation::uint64                      m_prefetch_count;           // protected by m_prefetch_mutex
+    foundation::uint64                      m_dropped_prefetch_count;   // protected by m_prefetch_mutex
+    foundation::JobQueue                    m_prefetch_queue;
+    std::auto_ptr<foundation::JobManager>   m_prefetch_manager;         // null if prefetching is disabled
 
-    return record;
-}
+    Shard& get_shard(const TileKey& key);
+
+    // Return true if a tile exists in its texture.
+    bool is_valid_tile(const TileKey& key) const;
+
+    // Load a prefetched tile. Called by the background I/O threads.
+    void load_prefetched_tile(const TileKey& key);
+
+    // Load a tile of level 0, or build a tile of a higher level. Thread-safe.
+    foundation::Tile* load_tile(const TileKey& key);
+
+    // Build a tile of a given level (> 0) by downsampling tiles of the previous level.
+    foundation::Tile* build_mip_tile(const TileKey& key);
+};
+
+
+//
+// TextureStore class implementation.
+//
 
 inline void TextureStore::release(TileRecord& record) const
 {
@@ -199,6 +284,15 @@ inline void TextureStore::release(TileRecord& record) const
 }
 
 
+inline size_t TextureStore::get_level_size(
+    const size_t                base_size,
+    const size_t                level)
+{
+    const size_t size = base_size >> level;
+    return size > 0 ? size : 1;
+}
+
+
 //
 // TextureStore::TileKey class implementation.
 //
@@ -211,10 +305,12 @@ inline TextureStore::TileKey::TileKey(
     const foundation::UniqueID  assembly_uid,
     const foundation::UniqueID  texture_uid,
     const size_t                tile_x,
-    const size_t                tile_y)
+    const size_t                tile_y,
+    const size_t                level)
   : m_assembly_uid(assembly_uid)
   , m_texture_uid(texture_uid)
   , m_tile_xy(static_cast<foundation::uint32>((tile_y << 16) | tile_x))
+  , m_level(static_cast<foundation::uint32>(level))
 {
     assert(tile_x < (1UL << 16));
     assert(tile_y < (1UL << 16));
@@ -227,6 +323,7 @@ inline TextureStore::TileKey::TileKey(
   : m_assembly_uid(assembly_uid)
   , m_texture_uid(texture_uid)
   , m_tile_xy(tile_xy)
+  , m_level(0)
 {
 }
 
@@ -234,6 +331,7 @@ inline TextureStore::TileKey::TileKey(const TileKey& rhs)
   : m_assembly_uid(rhs.m_assembly_uid)
   , m_texture_uid(rhs.m_texture_uid)
   , m_tile_xy(rhs.m_tile_xy)
+  , m_level(rhs.m_level)
 {
 }
 
@@ -249,13 +347,16 @@ inline size_t TextureStore::TileKey::get_tile_y() const
 
 inline TextureStore::TileKey TextureStore::TileKey::invalid()
 {
-    return TileKey(~0, ~0, ~0);
+    TileKey key(~0, ~0, ~0);
+    key.m_level = ~0;
+    return key;
 }
 
 inline bool TextureStore::TileKey::operator==(const TileKey& rhs) const
 {
     return
         m_tile_xy == rhs.m_tile_xy &&
+        m_level == rhs.m_level &&
         m_texture_uid == rhs.m_texture_uid &&
         m_assembly_uid == rhs.m_assembly_uid;
 }
@@ -270,7 +371,9 @@ inline bool TextureStore::TileKey::operator<(const TileKey& rhs) const
     return
         m_assembly_uid == rhs.m_assembly_uid ?
             m_texture_uid == rhs.m_texture_uid ?
-                m_tile_xy < rhs.m_tile_xy :
+                m_level == rhs.m_level ?
+                    m_tile_xy < rhs.m_tile_xy :
+                m_level < rhs.m_level :
             m_texture_uid < rhs.m_texture_uid :
         m_assembly_uid < rhs.m_assembly_uid;
 }
@@ -282,11 +385,13 @@ inline bool TextureStore::TileKey::operator<(const TileKey& rhs) const
 
 inline bool TextureStore::TileSwapper::is_full(const size_t element_count) const
 {
+    foundation::Spinlock::ScopedLock lock(m_memory_size_lock);
     return m_memory_size >= m_params.m_memory_limit;
 }
 
 inline size_t TextureStore::TileSwapper::get_peak_memory_size() const
 {
+    foundation::Spinlock::ScopedLock lock(m_memory_size_lock);
     return m_peak_memory_size;
 }
 
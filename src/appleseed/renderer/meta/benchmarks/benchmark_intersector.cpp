@@ -0,0 +1,394 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/intersector.h"
+#include "renderer/kernel/intersection/tracecontext.h"
+#include "renderer/kernel/shading/shadingpoint.h"
+#include "renderer/kernel/shading/shadingray.h"
+#include "renderer/kernel/texturing/texturecache.h"
+#include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/object/meshobject.h"
+#include "renderer/modeling/object/object.h"
+#include "renderer/modeling/object/triangle.h"
+#include "renderer/modeling/project/project.h"
+#include "renderer/modeling/project-builtin/cornellboxproject.h"
+#include "renderer/modeling/scene/assembly.h"
+#include "renderer/modeling/scene/assemblyinstance.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/objectinstance.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/utility/paramarray.h"
+#include "renderer/utility/testutils.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/basis.h"
+#include "foundation/math/rng.h"
+#include "foundation/math/sampling.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/transform.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/benchmark.h"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+BENCHMARK_SUITE(Renderer_Kernel_Intersection_Intersector)
+{
+    //
+    // Scenes.
+    //
+    // Each scene provides a viewpoint from which most camera rays hit geometry,
+    // and a point light position for shadow rays.
+    //
+
+    struct CornellBoxScene
+    {
+        auto_release_ptr<Project>   m_project;
+        Scene*                      m_scene;
+        Vector3d                    m_eye;
+        Vector3d                    m_target;
+        Vector3d                    m_light;
+
+        CornellBoxScene()
+          : m_project(CornellBoxProjectFactory::create())
+          , m_scene(m_project->get_scene())
+          , m_eye(0.278, 0.273, -0.800)
+          , m_target(0.278, 0.273, 0.280)
+          , m_light(0.278, 0.500, 0.280)
+        {
+        }
+    };
+
+    // A UV sphere of unit radius with 2 * Segments^2 triangles.
+    template <size_t Segments>
+    struct TessellatedSphereScene
+    {
+        auto_release_ptr<Scene>     m_scene;
+        Vector3d                    m_eye;
+        Vector3d                    m_target;
+        Vector3d                    m_light;
+
+        TessellatedSphereScene()
+          : m_scene(SceneFactory::create())
+          , m_eye(0.0, 0.0, 3.0)
+          , m_target(0.0, 0.0, 0.0)
+          , m_light(2.0, 3.0, 4.0)
+        {
+            auto_release_ptr<MeshObject> mesh(MeshObjectFactory::create("sphere", ParamArray()));
+
+            const size_t Rings = Segments / 2;
+
+            for (size_t j = 0; j <= Rings; ++j)
+            {
+                const double theta = Pi * j / Rings;
+
+                for (size_t i = 0; i < Segments; ++i)
+                {
+                    const double phi = TwoPi * i / Segments;
+
+                    mesh->push_vertex(
+                        GVector3(
+                            static_cast<GScalar>(sin(theta) * cos(phi)),
+                            static_cast<GScalar>(cos(theta)),
+                            static_cast<GScalar>(sin(theta) * sin(phi))));
+                }
+            }
+
+            for (size_t j = 0; j < Rings; ++j)
+            {
+                for (size_t i = 0; i < Segments; ++i)
+                {
+                    const size_t v00 = j * Segments + i;
+                    const size_t v01 = j * Segments + (i + 1) % Segments;
+                    const size_t v10 = v00 + Segments;
+                    const size_t v11 = v01 + Segments;
+
+                    mesh->push_triangle(Triangle(v00, v10, v11, 0));
+                    mesh->push_triangle(Triangle(v00, v11, v01, 0));
+                }
+            }
+
+            auto_release_ptr<Assembly> assembly(
+                AssemblyFactory::create("assembly", ParamArray()));
+
+            assembly->objects().insert(auto_release_ptr<Object>(mesh));
+
+            assembly->object_instances().insert(
+                ObjectInstanceFactory::create(
+                    "sphere_inst",
+                    ParamArray(),
+                    "sphere",
+                    Transformd::identity(),
+                    StringDictionary()));
+
+            m_scene->assembly_instances().insert(
+                auto_release_ptr<AssemblyInstance>(
+                    AssemblyInstanceFactory::create(
+                        "assembly_inst",
+                        ParamArray(),
+                        "assembly")));
+
+            m_scene->assemblies().insert(assembly);
+        }
+    };
+
+    typedef TessellatedSphereScene<64> LowDensitySphereScene;      // 8,192 triangles
+    typedef TessellatedSphereScene<512> HighDensitySphereScene;    // 524,288 triangles
+
+
+    //
+    // Fixture.
+    //
+    // Rays are generated once: a grid of camera rays, shadow rays from the camera
+    // ray hits toward the light, and cosine-distributed diffuse rays from the same hits.
+    //
+
+    const size_t ImageSize = 32;
+    const size_t RayCount = ImageSize * ImageSize;
+
+    template <typename SceneType>
+    struct Fixture
+      : public BindInputs<SceneType>
+    {
+        TraceContext                m_trace_context;
+        TextureStore                m_texture_store;
+        TextureCache                m_texture_cache;
+        Intersector                 m_intersector;
+        vector<ShadingRay>          m_camera_rays;
+        vector<ShadingRay>          m_shadow_rays;
+        vector<ShadingRay>          m_diffuse_rays;
+        ShadingPoint                m_shading_points[RayCount];
+        size_t                      m_hit_count;
+
+        Fixture()
+          : m_trace_context(*SceneType::m_scene)
+          , m_texture_store(*SceneType::m_scene)
+          , m_texture_cache(m_texture_store)
+          , m_intersector(m_trace_context, m_texture_cache)
+          , m_hit_count(0)
+        {
+            // Camera rays. Tracing them also builds the child trees.
+            const Vector3d forward = normalize(SceneType::m_target - SceneType::m_eye);
+            const Basis3d basis(forward);
+            const double TanHalfFov = 0.4;
+
+            for (size_t y = 0; y < ImageSize; ++y)
+            {
+                for (size_t x = 0; x < ImageSize; ++x)
+                {
+                    const double u = TanHalfFov * (2.0 * (x + 0.5) / ImageSize - 1.0);
+                    const double v = TanHalfFov * (2.0 * (y + 0.5) / ImageSize - 1.0);
+
+                    m_camera_rays.push_back(
+                        ShadingRay(
+                            SceneType::m_eye,
+                            normalize(forward + u * basis.get_tangent_u() + v * basis.get_tangent_v()),
+                            0.0,
+                            ShadingRay::CameraRay));
+                }
+            }
+
+            // Shadow and diffuse rays leave the camera ray hits.
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < RayCount; ++i)
+            {
+                ShadingPoint shading_point;
+                if (!m_intersector.trace(m_camera_rays[i], shading_point))
+                    continue;
+
+                Vector3d n = shading_point.get_geometric_normal();
+                if (dot(n, m_camera_rays[i].m_dir) > 0.0)
+                    n = -n;
+
+                const Vector3d to_light = SceneType::m_light - shading_point.get_point();
+                const double light_distance = norm(to_light);
+                const Vector3d shadow_dir = to_light / light_distance;
+                m_shadow_rays.push_back(
+                    ShadingRay(
+                        shading_point.get_offset_point(shadow_dir),
+                        shadow_dir,
+                        0.0,
+                        light_distance,
+                        0.0,
+                        ShadingRay::ShadowRay));
+
+                Vector2d s;
+                s[0] = rand_double2(rng);
+                s[1] = rand_double2(rng);
+                const Vector3d diffuse_dir =
+                    Basis3d(n).transform_to_parent(sample_hemisphere_cosine(s));
+                m_diffuse_rays.push_back(
+                    ShadingRay(
+                        shading_point.get_offset_point(diffuse_dir),
+                        diffuse_dir,
+                        0.0,
+                        ShadingRay::DiffuseRay));
+            }
+        }
+
+        void build()
+        {
+            TraceContext trace_context(*SceneType::m_scene);
+            Intersector intersector(trace_context, m_texture_cache);
+
+            // Child trees are built when they are first accessed.
+            ShadingPoint shading_point;
+            m_hit_count += intersector.trace(m_camera_rays[RayCount / 2], shading_point) ? 1 : 0;
+        }
+
+        void trace(const vector<ShadingRay>& rays)
+        {
+            for (size_t i = 0; i < rays.size(); ++i)
+            {
+                ShadingPoint shading_point;
+                m_hit_count += m_intersector.trace(rays[i], shading_point) ? 1 : 0;
+            }
+        }
+
+        void trace_packets(const vector<ShadingRay>& rays)
+        {
+            for (size_t i = 0; i < rays.size(); ++i)
+                m_shading_points[i].clear();
+
+            m_intersector.trace(&rays[0], rays.size(), m_shading_points);
+            m_hit_count += m_shading_points[0].hit() ? 1 : 0;
+        }
+
+        void trace_probe(const vector<ShadingRay>& rays)
+        {
+            for (size_t i = 0; i < rays.size(); ++i)
+                m_hit_count += m_intersector.trace_probe(rays[i]) ? 1 : 0;
+        }
+    };
+
+    typedef Fixture<CornellBoxScene> CornellBoxFixture;
+    typedef Fixture<LowDensitySphereScene> LowDensitySphereFixture;
+    typedef Fixture<HighDensitySphereScene> HighDensitySphereFixture;
+
+
+    //
+    // Cornell Box.
+    //
+
+    BENCHMARK_CASE_F(CornellBox_Build, CornellBoxFixture)
+    {
+        build();
+    }
+
+    BENCHMARK_CASE_F(CornellBox_Trace1024CameraRays, CornellBoxFixture)
+    {
+        trace(m_camera_rays);
+    }
+
+    BENCHMARK_CASE_F(CornellBox_Trace1024CameraRaysInPackets, CornellBoxFixture)
+    {
+        trace_packets(m_camera_rays);
+    }
+
+    BENCHMARK_CASE_F(CornellBox_TraceShadowRays, CornellBoxFixture)
+    {
+        trace_probe(m_shadow_rays);
+    }
+
+    BENCHMARK_CASE_F(CornellBox_TraceDiffuseRays, CornellBoxFixture)
+    {
+        trace(m_diffuse_rays);
+    }
+
+
+    //
+    // Low density sphere.
+    //
+
+    BENCHMARK_CASE_F(LowDensitySphere_Build, LowDensitySphereFixture)
+    {
+        build();
+    }
+
+    BENCHMARK_CASE_F(LowDensitySphere_Trace1024CameraRays, LowDensitySphereFixture)
+    {
+        trace(m_camera_rays);
+    }
+
+    BENCHMARK_CASE_F(LowDensitySphere_Trace1024CameraRaysInPackets, LowDensitySphereFixture)
+    {
+        trace_packets(m_camera_rays);
+    }
+
+    BENCHMARK_CASE_F(LowDensitySphere_TraceShadowRays, LowDensitySphereFixture)
+    {
+        trace_probe(m_shadow_rays);
+    }
+
+    BENCHMARK_CASE_F(LowDensitySphere_TraceDiffuseRays, LowDensitySphereFixture)
+    {
+        trace(m_diffuse_rays);
+    }
+
+
+    //
+    // High density sphere.
+    //
+
+    BENCHMARK_CASE_F(HighDensitySphere_Build, HighDensitySphereFixture)
+    {
+        build();
+    }
+
+    BENCHMARK_CASE_F(HighDensitySphere_Trace1024CameraRays, HighDensitySphereFixture)
+    {
+        trace(m_camera_rays);
+    }
+
+    BENCHMARK_CASE_F(HighDensitySphere_Trace1024CameraRaysInPackets, HighDensitySphereFixture)
+    {
+        trace_packets(m_camera_rays);
+    }
+
+    BENCHMARK_CASE_F(HighDensitySphere_TraceShadowRays, HighDensitySphereFixture)
+    {
+        trace_probe(m_shadow_rays);
+    }
+
+    BENCHMARK_CASE_F(HighDensitySphere_TraceDiffuseRays, HighDensitySphereFixture)
+    {
+        trace(m_diffuse_rays);
+    }
+}
@@ -0,0 +1,220 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/sppm/sppmparameters.h"
+#include "renderer/kernel/lighting/sppm/sppmphoton.h"
+#include "renderer/kernel/lighting/sppm/sppmphotonmap.h"
+#include "renderer/utility/paramarray.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/basis.h"
+#include "foundation/math/knn.h"
+#include "foundation/math/rng.h"
+#include "foundation/math/sampling.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/benchmark.h"
+#include "foundation/utility/job.h"
+#include "foundation/utility/log.h"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+BENCHMARK_SUITE(Renderer_Kernel_Lighting_SPPM_SPPMPhotonMap)
+{
+    //
+    // Photons are traced from the ceiling light of an empty Cornell box and bounce
+    // diffusely off its walls, which gives the uneven photon density of a real scene:
+    // photons are concentrated on the floor below the light. Lookup points are the
+    // hits of rays cast from the camera through the open side of the box.
+    //
+
+    const Vector3f RoomSize(0.556f, 0.548f, 0.559f);
+    const size_t PhotonCount = 200000;
+    const size_t MaxBounces = 4;
+    const size_t QueryCount = 10000;
+    const float LookupRadius = 0.005f;
+
+    // Find where a ray leaving a point inside the room hits its walls.
+    // Return false if the ray leaves through the open side (z = 0).
+    bool hit_room(
+        const Vector3f&     org,
+        const Vector3f&     dir,
+        Vector3f&           hit,
+        Vector3f&           normal)
+    {
+        float tmin = 1.0e30f;
+        size_t axis = 0;
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            if (dir[i] == 0.0f)
+                continue;
+
+            const float t = ((dir[i] > 0.0f ? RoomSize[i] : 0.0f) - org[i]) / dir[i];
+
+            if (t < tmin)
+            {
+                tmin = t;
+                axis = i;
+            }
+        }
+
+        if (axis == 2 && dir[2] < 0.0f)
+            return false;
+
+        hit = org + tmin * dir;
+        hit[axis] = dir[axis] > 0.0f ? RoomSize[axis] : 0.0f;
+
+        normal = Vector3f(0.0f);
+        normal[axis] = dir[axis] > 0.0f ? -1.0f : 1.0f;
+
+        return true;
+    }
+
+    Vector3f sample_cosine_direction(Xorshift& rng, const Vector3f& normal)
+    {
+        Vector2f s;
+        s[0] = rand_float2(rng);
+        s[1] = rand_float2(rng);
+
+        return Basis3f(normal).transform_to_parent(sample_hemisphere_cosine(s));
+    }
+
+    template <SPPMParameters::PhotonMapType Type>
+    struct Fixture
+    {
+        Logger                      m_logger;
+        JobQueue                    m_job_queue;
+        JobManager                  m_job_manager;
+        SPPMParameters              m_params;
+        vector<Vector3f>            m_photon_positions;
+        vector<Vector3f>            m_query_points;
+        auto_ptr<SPPMPhotonMap>     m_photon_map;
+        knn::Answer<float>          m_answer;
+        size_t                      m_accumulator;
+
+        Fixture()
+          : m_job_manager(m_logger, m_job_queue, 1, JobManager::KeepRunningOnEmptyQueue)
+          , m_params(
+                ParamArray()
+                    .insert("initial_radius", 0.5f)
+                    .insert("photon_map", Type == SPPMParameters::KdTree ? "kdtree" : "hashgrid"))
+          , m_answer(m_params.m_max_photons_per_estimate)
+          , m_accumulator(0)
+        {
+            m_job_manager.start();
+
+            Xorshift rng;
+
+            while (m_photon_positions.size() < PhotonCount)
+            {
+                Vector3f org(
+                    rand_float2(rng, 0.213f, 0.343f),
+                    RoomSize[1],
+                    rand_float2(rng, 0.227f, 0.332f));
+                Vector3f dir = sample_cosine_direction(rng, Vector3f(0.0f, -1.0f, 0.0f));
+
+                for (size_t i = 0; i < MaxBounces && m_photon_positions.size() < PhotonCount; ++i)
+                {
+                    Vector3f hit, normal;
+                    if (!hit_room(org, dir, hit, normal))
+                        break;
+
+                    m_photon_positions.push_back(hit);
+                    org = hit;
+                    dir = sample_cosine_direction(rng, normal);
+                }
+            }
+
+            const Vector3f eye(0.278f, 0.273f, -0.800f);
+
+            while (m_query_points.size() < QueryCount)
+            {
+                const Vector3f target(
+                    rand_float2(rng, 0.0f, RoomSize[0]),
+                    rand_float2(rng, 0.0f, RoomSize[1]),
+                    0.0f);
+
+                Vector3f hit, normal;
+                if (hit_room(target, normalize(target - eye), hit, normal))
+                    m_query_points.push_back(hit);
+            }
+
+            m_photon_map.reset(build());
+        }
+
+        SPPMPhotonMap* build()
+        {
+            SPPMPhotonVector photons;
+            photons.m_positions = m_photon_positions;
+            photons.m_data.resize(m_photon_positions.size());
+
+            return new SPPMPhotonMap(photons, m_params, LookupRadius, m_job_queue);
+        }
+
+        void run_queries()
+        {
+            for (size_t i = 0; i < QueryCount; ++i)
+            {
+                m_photon_map->find_nearest_photons(m_query_points[i], LookupRadius, m_answer);
+                m_accumulator += m_answer.size();
+            }
+        }
+    };
+
+    typedef Fixture<SPPMParameters::KdTree> KdTreeFixture;
+    typedef Fixture<SPPMParameters::HashGrid> HashGridFixture;
+
+    BENCHMARK_CASE_F(Build_KdTree, KdTreeFixture)
+    {
+        delete build();
+    }
+
+    BENCHMARK_CASE_F(Build_HashGrid, HashGridFixture)
+    {
+        delete build();
+    }
+
+    BENCHMARK_CASE_F(FindNearestPhotons_KdTree, KdTreeFixture)
+    {
+        run_queries();
+    }
+
+    BENCHMARK_CASE_F(FindNearestPhotons_HashGrid, HashGridFixture)
+    {
+        run_queries();
+    }
+}
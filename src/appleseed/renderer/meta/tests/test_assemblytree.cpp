@@ -0,0 +1,142 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/assemblytree.h"
+#include "renderer/kernel/intersection/triangletree.h"
+#include "renderer/kernel/tessellation/statictessellation.h"
+#include "renderer/modeling/object/iregion.h"
+#include "renderer/modeling/object/meshobject.h"
+#include "renderer/modeling/object/object.h"
+#include "renderer/modeling/object/regionkit.h"
+#include "renderer/modeling/object/triangle.h"
+#include "renderer/modeling/scene/assembly.h"
+#include "renderer/modeling/scene/assemblyinstance.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/objectinstance.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/utility/paramarray.h"
+#include "renderer/utility/testutils.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/transform.h"
+#include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/lazy.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Intersection_AssemblyTree)
+{
+    struct TestScene
+    {
+        auto_release_ptr<Scene>         m_scene;
+        Assembly*                       m_assembly;
+        MeshObject*                     m_mesh;
+
+        TestScene()
+          : m_scene(SceneFactory::create())
+        {
+            m_scene->assemblies().insert(AssemblyFactory::create("assembly", ParamArray()));
+            m_assembly = m_scene->assemblies().get_by_name("assembly");
+
+            // A unit square made of two triangles.
+            auto_release_ptr<MeshObject> mesh_object =
+                MeshObjectFactory::create("object", ParamArray());
+            mesh_object->push_vertex(GVector3(0.0f, 0.0f, 0.0f));
+            mesh_object->push_vertex(GVector3(1.0f, 0.0f, 0.0f));
+            mesh_object->push_vertex(GVector3(1.0f, 1.0f, 0.0f));
+            mesh_object->push_vertex(GVector3(0.0f, 1.0f, 0.0f));
+            mesh_object->push_triangle(Triangle(0, 1, 2, 0));
+            mesh_object->push_triangle(Triangle(2, 3, 0, 0));
+            mesh_object->push_material_slot("material");
+            m_mesh = mesh_object.get();
+            m_assembly->objects().insert(auto_release_ptr<Object>(mesh_object.release()));
+
+            m_assembly->object_instances().insert(
+                ObjectInstanceFactory::create(
+                    "object_instance",
+                    ParamArray(),
+                    "object",
+                    Transformd::identity(),
+                    StringDictionary()));
+
+            m_scene->assembly_instances().insert(
+                AssemblyInstanceFactory::create(
+                    "assembly_instance",
+                    ParamArray(),
+                    "assembly"));
+        }
+
+        // Move all the vertices of the mesh by a given offset.
+        void translate_mesh(const GVector3& offset)
+        {
+            Access<RegionKit> region_kit(&m_mesh->get_region_kit());
+            Update<StaticTriangleTess> tess(&(*region_kit)[0]->get_static_triangle_tess());
+
+            for (size_t i = 0; i < tess->m_vertices.size(); ++i)
+                tess->m_vertices[i] += offset;
+
+            m_assembly->bump_version_id();
+        }
+    };
+
+    TEST_CASE_F(Update_GivenRefittedTriangleTreeCollectedByBudget_RebuildsTreeWithAllTriangles, BindInputs<TestScene>)
+    {
+        AssemblyTree assembly_tree(m_scene.ref());
+        Lazy<TriangleTree>* triangle_tree = assembly_tree.m_triangle_trees[m_assembly->get_uid()];
+
+        {
+            Access<TriangleTree> access(triangle_tree);
+            ASSERT_EQ(2, access->get_static_triangle_count());
+        }
+
+        // Move the triangles outside the bounding box the tree was built with, and refit the tree.
+        translate_mesh(GVector3(10.0f, 0.0f, 0.0f));
+        assembly_tree.update();
+        ASSERT_EQ(triangle_tree, assembly_tree.m_triangle_trees[m_assembly->get_uid()]);
+
+        // Force the refitted tree out of memory.
+        m_scene->get_parameters().insert_path("acceleration_structure.child_trees_memory_budget", 1);
+        assembly_tree.update();
+        ASSERT_EQ(1, assembly_tree.m_child_tree_budget.get_collected_count());
+
+        // The tree is rebuilt on next access.
+        Access<TriangleTree> access(triangle_tree);
+        EXPECT_EQ(2, access->get_static_triangle_count());
+    }
+}
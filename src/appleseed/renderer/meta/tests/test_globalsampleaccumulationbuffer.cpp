@@ -0,0 +1,172 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/rendering/globalsampleaccumulationbuffer.h"
+#include "renderer/kernel/rendering/sample.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/color.h"
+#include "foundation/math/filter.h"
+#include "foundation/math/rng.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/thread.h"
+#include "foundation/utility/test.h"
+
+// boost headers.
+#include "boost/thread/thread.hpp"
+
+// Standard headers.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Rendering_GlobalSampleAccumulationBuffer)
+{
+    const size_t FrameWidth = 64;
+    const size_t FrameHeight = 64;
+
+    struct SampleStorer
+    {
+        GlobalSampleAccumulationBuffer& m_buffer;
+        const vector<Sample>&           m_samples;
+        const size_t                    m_begin;
+        const size_t                    m_end;
+
+        SampleStorer(
+            GlobalSampleAccumulationBuffer& buffer,
+            const vector<Sample>&           samples,
+            const size_t                    begin,
+            const size_t                    end)
+          : m_buffer(buffer)
+          , m_samples(samples)
+          , m_begin(begin)
+          , m_end(end)
+        {
+        }
+
+        void operator()()
+        {
+            // Store the samples in small batches, as sample generators do.
+            const size_t BatchSize = 97;
+
+            for (size_t i = m_begin; i < m_end; i += BatchSize)
+                m_buffer.store_samples(min(BatchSize, m_end - i), &m_samples[i]);
+        }
+    };
+
+    vector<Sample> make_samples(const size_t band_height)
+    {
+        MersenneTwister rng;
+        vector<Sample> samples;
+
+        for (size_t i = 0; i < 20000; ++i)
+        {
+            const double x = rand_double2(rng) * FrameWidth;
+            double y = rand_double2(rng) * FrameHeight;
+
+            // Put every other sample within the filter footprint of a band edge.
+            if (i % 2 == 0)
+            {
+                const size_t edge = band_height * (1 + i / 2 % (FrameHeight / band_height - 1));
+                y = edge + 5.0 * (rand_double2(rng) - 0.5);
+            }
+
+            Sample sample;
+            sample.m_position = Vector2d(x / FrameWidth, y / FrameHeight);
+            sample.m_color = Color4f(
+                static_cast<float>(rand_double1(rng)),
+                static_cast<float>(rand_double1(rng)),
+                static_cast<float>(rand_double1(rng)),
+                1.0f);
+            samples.push_back(sample);
+        }
+
+        return samples;
+    }
+
+    TEST_CASE(StoreSamples_GivenSamplesFromMultipleThreads_AccumulatesSameValuesAsSingleThread)
+    {
+        const GaussianFilter2<double> filter(2.0, 2.0, 8.0);
+
+        GlobalSampleAccumulationBuffer reference_buffer(FrameWidth, FrameHeight, filter);
+        GlobalSampleAccumulationBuffer buffer(FrameWidth, FrameHeight, filter);
+        reference_buffer.clear();
+        buffer.clear();
+
+        const vector<Sample> samples = make_samples(buffer.m_band_height);
+
+        // Accumulate all samples from this thread.
+        SampleStorer reference_storer(reference_buffer, samples, 0, samples.size());
+        reference_storer();
+
+        // Accumulate the same samples from several threads.
+        const size_t ThreadCount = 4;
+        vector<SampleStorer*> storers;
+        boost::thread_group threads;
+
+        for (size_t i = 0; i < ThreadCount; ++i)
+        {
+            storers.push_back(
+                new SampleStorer(
+                    buffer,
+                    samples,
+                    i * samples.size() / ThreadCount,
+                    (i + 1) * samples.size() / ThreadCount));
+            threads.create_thread(ThreadFunctionWrapper<SampleStorer>(storers.back()));
+        }
+
+        threads.join_all();
+
+        for (size_t i = 0; i < ThreadCount; ++i)
+            delete storers[i];
+
+        // Samples are accumulated in a different order, allow for rounding errors.
+        size_t mismatch_count = 0;
+
+        for (size_t i = 0; i < FrameWidth * FrameHeight; ++i)
+        {
+            const float* expected = reference_buffer.m_fb.pixel(i);
+            const float* actual = buffer.m_fb.pixel(i);
+
+            for (size_t c = 0; c < 4; ++c)
+            {
+                if (abs(actual[c] - expected[c]) > 1.0e-4f * max(1.0f, abs(expected[c])))
+                    ++mismatch_count;
+            }
+        }
+
+        EXPECT_EQ(0, mismatch_count);
+    }
+}
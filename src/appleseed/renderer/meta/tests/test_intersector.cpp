@@ -29,6 +29,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
 #include "renderer/kernel/intersection/intersector.h"
 #include "renderer/kernel/intersection/tracecontext.h"
 #include "renderer/kernel/shading/shadingpoint.h"
@@ -36,6 +37,8 @@
 #include "renderer/kernel/texturing/texturecache.h"
 #include "renderer/kernel/texturing/texturestore.h"
 #include "renderer/modeling/object/object.h"
+#include "renderer/modeling/project/project.h"
+#include "renderer/modeling/project-builtin/cornellboxproject.h"
 #include "renderer/modeling/scene/assembly.h"
 #include "renderer/modeling/scene/assemblyinstance.h"
 #include "renderer/modeling/scene/containers.h"
@@ -46,14 +49,20 @@
 
 // appleseed.foundation headers.
 #include "foundation/math/matrix.h"
+#include "foundation/math/rng.h"
 #include "foundation/math/transform.h"
 #include "foundation/math/vector.h"
 #include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/test.h"
 
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
 using namespace foundation;
 using namespace renderer;
+using namespace std;
 
 TEST_SUITE(Renderer_Kernel_Intersection_Intersector)
 {
@@ -139,4 +148,150 @@ TEST_SUITE(Renderer_Kernel_Intersection_Intersector)
 
         EXPECT_FALSE(hit);
     }
+
+    TEST_CASE_F(TracePacket_GivenAssemblyContainingEmptyBoundingBoxAndRaysWithTMaxInsideAssembly_ReturnsFalse, Fixture)
+    {
+        const ShadingRay ray(
+            Vector3d(0.0, 0.0, 2.0),
+            Vector3d(0.0, 0.0, -1.0),
+            0.0,
+            2.0,
+            0.0,
+            ShadingRay::CameraRay);
+        const ShadingRay rays[3] = { ray, ray, ray };
+
+        ShadingPoint shading_points[3];
+        m_intersector.trace(rays, 3, shading_points);
+
+        EXPECT_FALSE(shading_points[0].hit());
+        EXPECT_FALSE(shading_points[1].hit());
+        EXPECT_FALSE(shading_points[2].hit());
+    }
+
+    TEST_CASE_F(TraceProbePacket_GivenAssemblyContainingEmptyBoundingBoxAndRaysWithTMaxInsideAssembly_ReturnsFalse, Fixture)
+    {
+        const ShadingRay ray(
+            Vector3d(0.0, 0.0, 2.0),
+            Vector3d(0.0, 0.0, -1.0),
+            0.0,
+            2.0,
+            0.0,
+            ShadingRay::CameraRay);
+        const ShadingRay rays[3] = { ray, ray, ray };
+
+        bool hits[3] = { true, true, true };
+        m_intersector.trace_probe(rays, 3, hits);
+
+        EXPECT_FALSE(hits[0]);
+        EXPECT_FALSE(hits[1]);
+        EXPECT_FALSE(hits[2]);
+    }
+
+    // Enough rays to fill several packets, the last one partially.
+    const size_t RayCount = 2 * RayPacketSize + 5;
+
+    struct CornellBoxScene
+    {
+        auto_release_ptr<Project>   m_project;
+        Scene*                      m_scene;
+
+        CornellBoxScene()
+          : m_project(CornellBoxProjectFactory::create())
+          , m_scene(m_project->get_scene())
+        {
+        }
+    };
+
+    struct CornellBoxFixture
+      : public BindInputs<CornellBoxScene>
+    {
+        TraceContext        m_trace_context;
+        TextureStore        m_texture_store;
+        TextureCache        m_texture_cache;
+        Intersector         m_intersector;
+        vector<ShadingRay>  m_rays;
+
+        CornellBoxFixture()
+          : m_trace_context(*m_scene)
+          , m_texture_store(*m_scene)
+          , m_texture_cache(m_texture_store)
+          , m_intersector(m_trace_context, m_texture_cache)
+        {
+            // Rays leave a point in front of the open side of the box. Some of them
+            // point outside the box, and some of them stop before reaching a wall.
+            const Vector3d origin(0.278, 0.273, -0.800);
+            MersenneTwister rng;
+
+            for (size_t i = 0; i < RayCount; ++i)
+            {
+                const Vector3d target(
+                    -0.5 + 1.6 * rand_double1(rng),
+                    -0.5 + 1.6 * rand_double1(rng),
+                    0.280);
+
+                const double tmax =
+                    i % 3 == 0
+                        ? 1.0e6
+                        : 0.5 + 2.0 * rand_double1(rng);
+
+                m_rays.push_back(
+                    ShadingRay(
+                        origin,
+                        normalize(target - origin),
+                        0.0,
+                        tmax,
+                        0.0,
+                        ShadingRay::CameraRay));
+            }
+        }
+    };
+
+    TEST_CASE_F(TracePacket_GivenRaysHittingAndMissingGeometry_ReturnsSameIntersectionsAsTrace, CornellBoxFixture)
+    {
+        ShadingPoint packet_shading_points[RayCount];
+        m_intersector.trace(&m_rays[0], RayCount, packet_shading_points);
+
+        size_t hit_count = 0;
+
+        for (size_t i = 0; i < RayCount; ++i)
+        {
+            ShadingPoint shading_point;
+            const bool hit = m_intersector.trace(m_rays[i], shading_point);
+
+            EXPECT_EQ(hit, packet_shading_points[i].hit());
+
+            if (hit && packet_shading_points[i].hit())
+            {
+                EXPECT_EQ(shading_point.get_distance(), packet_shading_points[i].get_distance());
+                EXPECT_EQ(shading_point.get_object_instance_index(), packet_shading_points[i].get_object_instance_index());
+                EXPECT_EQ(shading_point.get_primitive_index(), packet_shading_points[i].get_primitive_index());
+                ++hit_count;
+            }
+        }
+
+        // Make sure the rays exercise both hits and misses.
+        EXPECT_LT(RayCount, hit_count);
+        EXPECT_GT(0, hit_count);
+    }
+
+    TEST_CASE_F(TraceProbePacket_GivenRaysHittingAndMissingGeometry_ReturnsSameHitsAsTraceProbe, CornellBoxFixture)
+    {
+        bool hits[RayCount];
+        m_intersector.trace_probe(&m_rays[0], RayCount, hits);
+
+        size_t hit_count = 0;
+
+        for (size_t i = 0; i < RayCount; ++i)
+        {
+            const bool hit = m_intersector.trace_probe(m_rays[i]);
+
+            EXPECT_EQ(hit, hits[i]);
+
+            if (hit)
+                ++hit_count;
+        }
+
+        EXPECT_LT(RayCount, hit_count);
+        EXPECT_GT(0, hit_count);
+    }
 }
@@ -0,0 +1,169 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/lighttree.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Lighting_DirectionCone)
+{
+    TEST_CASE(Merge_GivenTwoCones_ReturnsConeContainingBoth)
+    {
+        const DirectionCone a(Vector3d(1.0, 0.0, 0.0));
+        const DirectionCone b(Vector3d(0.0, 1.0, 0.0));
+
+        const DirectionCone result = DirectionCone::merge(a, b);
+
+        EXPECT_TRUE(dot(result.m_axis, a.m_axis) >= result.m_cos_theta - 1.0e-9);
+        EXPECT_TRUE(dot(result.m_axis, b.m_axis) >= result.m_cos_theta - 1.0e-9);
+        EXPECT_FEQ(cos(HalfPi / 2.0), result.m_cos_theta);
+    }
+
+    TEST_CASE(Merge_GivenOppositeDirections_ReturnsWholeSphere)
+    {
+        const DirectionCone a(Vector3d(0.0, 0.0, 1.0));
+        const DirectionCone b(Vector3d(0.0, 0.0, -1.0));
+
+        const DirectionCone result = DirectionCone::merge(a, b);
+
+        EXPECT_EQ(-1.0, result.m_cos_theta);
+    }
+}
+
+TEST_SUITE(Renderer_Kernel_Lighting_LightTree)
+{
+    LightTree::Item make_item(const Vector3d& position, const Vector3d& normal, const double power)
+    {
+        LightTree::Item item;
+        item.m_bbox = AABB3d(position - Vector3d(0.1), position + Vector3d(0.1));
+        item.m_normals = DirectionCone(normal);
+        item.m_power = power;
+        return item;
+    }
+
+    struct Fixture
+    {
+        vector<LightTree::Item> m_items;
+        LightTree               m_tree;
+
+        Fixture()
+        {
+            // Four lights on the ceiling facing down, one on the floor facing down.
+            m_items.push_back(make_item(Vector3d(-2.0, 2.0, 0.0), Vector3d(0.0, -1.0, 0.0), 1.0));
+            m_items.push_back(make_item(Vector3d(-1.0, 2.0, 0.0), Vector3d(0.0, -1.0, 0.0), 1.0));
+            m_items.push_back(make_item(Vector3d( 1.0, 2.0, 0.0), Vector3d(0.0, -1.0, 0.0), 1.0));
+            m_items.push_back(make_item(Vector3d( 2.0, 2.0, 0.0), Vector3d(0.0, -1.0, 0.0), 4.0));
+            m_items.push_back(make_item(Vector3d( 0.0, -2.0, 0.0), Vector3d(0.0, -1.0, 0.0), 1.0));
+            m_tree.build(m_items);
+        }
+    };
+
+    TEST_CASE(Build_GivenNoItems_ProducesEmptyTree)
+    {
+        LightTree tree;
+        tree.build(vector<LightTree::Item>());
+
+        EXPECT_TRUE(tree.empty());
+        EXPECT_FALSE(tree.contributes(Vector3d(0.0), Vector3d(0.0)));
+    }
+
+    TEST_CASE_F(Build_GivenFiveItems_ProducesNineNodes, Fixture)
+    {
+        EXPECT_EQ(9, m_tree.get_node_count());
+    }
+
+    TEST_CASE_F(EvaluatePDF_SumsToOneOverAllItems, Fixture)
+    {
+        const Vector3d point(0.0, 0.0, 0.0);
+        const Vector3d normal(0.0, 1.0, 0.0);
+
+        double sum = 0.0;
+        for (size_t i = 0; i < m_items.size(); ++i)
+            sum += m_tree.evaluate_pdf(point, normal, i);
+
+        EXPECT_FEQ(1.0, sum);
+    }
+
+    TEST_CASE_F(EvaluatePDF_GivenItemFacingAway_ReturnsZero, Fixture)
+    {
+        // The light on the floor faces away from the point.
+        EXPECT_EQ(0.0, m_tree.evaluate_pdf(Vector3d(0.0), Vector3d(0.0, 1.0, 0.0), 4));
+    }
+
+    TEST_CASE_F(EvaluatePDF_GivenBrighterItem_ReturnsHigherProbability, Fixture)
+    {
+        const Vector3d point(0.0, 0.0, 0.0);
+        const Vector3d normal(0.0, 1.0, 0.0);
+
+        EXPECT_TRUE(m_tree.evaluate_pdf(point, normal, 3) > m_tree.evaluate_pdf(point, normal, 0));
+    }
+
+    TEST_CASE_F(Sample_ReturnsProbabilityMatchingEvaluatePDF, Fixture)
+    {
+        const Vector3d point(0.5, 0.0, 0.3);
+        const Vector3d normal(0.0, 1.0, 0.0);
+
+        const size_t SampleCount = 64;
+
+        for (size_t i = 0; i < SampleCount; ++i)
+        {
+            const double s = (i + 0.5) / SampleCount;
+
+            size_t item_index;
+            double probability;
+            const bool found = m_tree.sample(point, normal, s, item_index, probability);
+
+            ASSERT_TRUE(found);
+            EXPECT_NEQ(4, item_index);
+            EXPECT_FEQ(m_tree.evaluate_pdf(point, normal, item_index), probability);
+        }
+    }
+
+    TEST_CASE_F(Sample_GivenPointBehindAllLights_ReturnsFalse, Fixture)
+    {
+        size_t item_index;
+        double probability;
+        const bool found = m_tree.sample(Vector3d(0.0, 10.0, 0.0), Vector3d(0.0), 0.5, item_index, probability);
+
+        EXPECT_FALSE(found);
+    }
+}
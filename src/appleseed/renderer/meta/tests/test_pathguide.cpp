@@ -0,0 +1,213 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/pathguide.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/qmc.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/sampling/mappings.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/iostreamop.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+
+using namespace foundation;
+using namespace renderer;
+
+TEST_SUITE(Renderer_Kernel_Lighting_DirectionalQuadtree)
+{
+    TEST_CASE(SquareToDirection_GivenResultOfDirectionToSquare_ReturnsOriginalDirection)
+    {
+        const Vector3d direction = normalize(Vector3d(0.3, -0.5, 0.8));
+
+        const Vector2d point = DirectionalQuadtree::direction_to_square(direction);
+        const Vector3d result = DirectionalQuadtree::square_to_direction(point);
+
+        EXPECT_FEQ(direction, result);
+    }
+
+    TEST_CASE(GetEnergy_GivenRecordedEnergy_ReturnsTotalEnergyAfterBuild)
+    {
+        DirectionalQuadtree tree;
+        tree.record(Vector3d(0.0, 0.0, 1.0), 1.0f);
+        tree.record(Vector3d(0.0, 0.0, -1.0), 2.0f);
+        tree.build();
+
+        EXPECT_FEQ(3.0, tree.get_energy());
+    }
+
+    TEST_CASE(Refine_GivenConcentratedEnergy_SubdividesTreeAndResetsEnergy)
+    {
+        DirectionalQuadtree source;
+        source.record(Vector3d(0.0, 0.0, 1.0), 1.0f);
+        source.build();
+
+        DirectionalQuadtree tree;
+        tree.refine(source, 0.01, 20);
+        tree.build();
+
+        EXPECT_TRUE(tree.get_node_count() > 1);
+        EXPECT_EQ(0.0, tree.get_energy());
+    }
+
+    TEST_CASE(Refine_GivenMaxDepthOfOne_DoesNotSubdivideTree)
+    {
+        DirectionalQuadtree source;
+        source.record(Vector3d(0.0, 0.0, 1.0), 1.0f);
+        source.build();
+
+        DirectionalQuadtree tree;
+        tree.refine(source, 0.01, 1);
+
+        EXPECT_EQ(1, tree.get_node_count());
+    }
+
+    struct Fixture
+    {
+        DirectionalQuadtree m_tree;
+
+        Fixture()
+        {
+            // Record energy from a single direction, then train a second tree
+            // whose structure follows this distribution.
+            const Vector3d light_direction = normalize(Vector3d(1.0, 1.0, 1.0));
+
+            DirectionalQuadtree source;
+            source.record(light_direction, 1.0f);
+            source.build();
+
+            m_tree.refine(source, 0.01, 20);
+
+            MersenneTwister rng;
+            for (size_t i = 0; i < 1000; ++i)
+            {
+                const Vector2d s = rand_vector2<Vector2d>(rng);
+                const Vector3d d = sample_sphere_uniform(s);
+                m_tree.record(d, dot(d, light_direction) > 0.9 ? 10.0f : 0.1f);
+            }
+
+            m_tree.build();
+        }
+    };
+
+    TEST_CASE_F(Sample_ReturnsProbabilityDensityEqualToEvaluatePDF, Fixture)
+    {
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const Vector2d s = rand_vector2<Vector2d>(rng);
+
+            double probability;
+            const Vector3d direction = m_tree.sample(s, probability);
+
+            EXPECT_FEQ(1.0, norm(direction));
+            EXPECT_FEQ_EPS(probability, m_tree.evaluate_pdf(direction), 1.0e-6);
+        }
+    }
+
+    TEST_CASE_F(EvaluatePDF_IntegratesToOneOverSphere, Fixture)
+    {
+        const size_t SampleCount = 10000;
+        double integral = 0.0;
+
+        for (size_t i = 0; i < SampleCount; ++i)
+        {
+            const size_t Bases[] = { 2 };
+            const Vector2d s = hammersley_sequence<double, 2>(Bases, i, SampleCount);
+            const Vector3d direction = sample_sphere_uniform(s);
+            integral += m_tree.evaluate_pdf(direction) * 4.0 * Pi;
+        }
+
+        integral /= SampleCount;
+
+        EXPECT_FEQ_EPS(1.0, integral, 0.05);
+    }
+}
+
+TEST_SUITE(Renderer_Kernel_Lighting_PathGuide)
+{
+    const AABB3d SceneBBox(Vector3d(-1.0), Vector3d(1.0));
+
+    TEST_CASE(GetDistribution_BeforeFirstUpdate_ReturnsNull)
+    {
+        PathGuide guide(SceneBBox, 10, 0.01, 0.5);
+        guide.record(Vector3d(0.0), Vector3d(0.0, 0.0, 1.0), 1.0f);
+
+        EXPECT_EQ(0, guide.get_distribution(Vector3d(0.0)));
+    }
+
+    TEST_CASE(GetDistribution_AfterUpdate_ReturnsDistributionFavoringRecordedDirection)
+    {
+        const Vector3d light_direction(0.0, 0.0, 1.0);
+
+        PathGuide guide(SceneBBox, 10, 0.01, 0.5);
+        guide.record(Vector3d(0.0), light_direction, 1.0f);
+        guide.update();
+
+        const DirectionalQuadtree* distribution = guide.get_distribution(Vector3d(0.0));
+        ASSERT_NEQ(0, distribution);
+
+        EXPECT_TRUE(distribution->evaluate_pdf(light_direction) > 1.0 / (4.0 * Pi));
+        EXPECT_EQ(0.0, distribution->evaluate_pdf(-light_direction));
+    }
+
+    TEST_CASE(Update_GivenManyRecordsInCell_SplitsCell)
+    {
+        PathGuide guide(SceneBBox, 10, 0.01, 0.5);
+
+        MersenneTwister rng;
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const Vector3d point = 2.0 * rand_vector1<Vector3d>(rng) - Vector3d(1.0);
+            guide.record(point, Vector3d(0.0, 0.0, 1.0), 1.0f);
+        }
+
+        guide.update();
+
+        EXPECT_TRUE(guide.get_spatial_cell_count() > 1);
+        EXPECT_EQ(1, guide.get_iteration_count());
+    }
+
+    TEST_CASE(Update_GivenFewRecordsInCell_DoesNotSplitCell)
+    {
+        PathGuide guide(SceneBBox, 10, 0.01, 0.5);
+        guide.record(Vector3d(0.0), Vector3d(0.0, 0.0, 1.0), 1.0f);
+        guide.update();
+
+        EXPECT_EQ(1, guide.get_spatial_cell_count());
+    }
+}
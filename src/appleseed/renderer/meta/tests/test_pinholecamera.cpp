@@ -28,12 +28,16 @@
 //
 
 // appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/shading/shadingray.h"
 #include "renderer/modeling/camera/camera.h"
 #include "renderer/modeling/camera/pinholecamera.h"
+#include "renderer/modeling/frame/frame.h"
 #include "renderer/modeling/project/project.h"
 #include "renderer/utility/paramarray.h"
 
 // appleseed.foundation headers.
+#include "foundation/math/rng.h"
 #include "foundation/math/vector.h"
 #include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/iostreamop.h"
@@ -66,4 +70,59 @@ TEST_SUITE(Renderer_Modeling_Camera_PinholeCamera)
 
         camera->on_frame_end(project.ref());
     }
+
+    auto_release_ptr<Camera> create_camera()
+    {
+        PinholeCameraFactory factory;
+        return
+            factory.create(
+                "camera",
+                ParamArray().insert("film_width", "0.025")
+                            .insert("film_height", "0.025")
+                            .insert("focal_length", "0.035"));
+    }
+
+    TEST_CASE(GenerateRay_GivenProjectWithoutFrame_GeneratesRayWithoutDifferentials)
+    {
+        auto_release_ptr<Project> project(ProjectFactory::create("test"));
+        auto_release_ptr<Camera> camera(create_camera());
+
+        camera->on_frame_begin(project.ref());
+
+        MersenneTwister rng;
+        SamplingContext sampling_context(rng);
+
+        ShadingRay ray;
+        camera->generate_ray(sampling_context, Vector2d(0.5, 0.5), ray);
+
+        EXPECT_FALSE(ray.m_has_differentials);
+
+        camera->on_frame_end(project.ref());
+    }
+
+    TEST_CASE(GenerateRay_GivenProjectWithFrame_GeneratesRayDifferentialsOffsetByOnePixel)
+    {
+        auto_release_ptr<Project> project(ProjectFactory::create("test"));
+        project->set_frame(
+            FrameFactory::create(
+                "frame",
+                ParamArray().insert("resolution", "500 250")));
+        auto_release_ptr<Camera> camera(create_camera());
+
+        camera->on_frame_begin(project.ref());
+
+        MersenneTwister rng;
+        SamplingContext sampling_context(rng);
+
+        ShadingRay ray;
+        camera->generate_ray(sampling_context, Vector2d(0.5, 0.5), ray);
+
+        ASSERT_TRUE(ray.m_has_differentials);
+        EXPECT_FEQ(ray.m_org, ray.m_rx.m_org);
+        EXPECT_FEQ(ray.m_org, ray.m_ry.m_org);
+        EXPECT_FEQ(Vector3d(0.025 / 500, 0.0, 0.0), ray.m_rx.m_dir - ray.m_dir);
+        EXPECT_FEQ(Vector3d(0.0, -0.025 / 250, 0.0), ray.m_ry.m_dir - ray.m_dir);
+
+        camera->on_frame_end(project.ref());
+    }
 }
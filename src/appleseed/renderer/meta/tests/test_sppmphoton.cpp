@@ -0,0 +1,130 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/lighting/sppm/sppmphoton.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/sampling/mappings.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/iostreamop.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Lighting_SPPM_SPPMPhotonData)
+{
+    TEST_CASE(GetIncoming_ReturnsDirectionCloseToOriginalDirection)
+    {
+        MersenneTwister rng;
+        float max_error = 0.0f;
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            Vector2f s;
+            s[0] = rand_float2(rng);
+            s[1] = rand_float2(rng);
+            const Vector3f incoming = sample_sphere_uniform(s);
+
+            SPPMPhotonData data;
+            data.set_incoming(incoming);
+
+            const float error = norm(data.get_incoming() - incoming);
+            if (max_error < error)
+                max_error = error;
+        }
+
+        EXPECT_LT(1.0e-4f, max_error);
+    }
+
+    TEST_CASE(GetGeometricNormal_GivenAxisAlignedNormal_ReturnsOriginalNormal)
+    {
+        const Vector3f normals[] =
+        {
+            Vector3f( 1.0f,  0.0f,  0.0f),
+            Vector3f(-1.0f,  0.0f,  0.0f),
+            Vector3f( 0.0f,  1.0f,  0.0f),
+            Vector3f( 0.0f, -1.0f,  0.0f),
+            Vector3f( 0.0f,  0.0f,  1.0f),
+            Vector3f( 0.0f,  0.0f, -1.0f)
+        };
+
+        for (size_t i = 0; i < 6; ++i)
+        {
+            SPPMPhotonData data;
+            data.set_geometric_normal(normals[i]);
+
+            EXPECT_FEQ_EPS(normals[i], data.get_geometric_normal(), 1.0e-4f);
+        }
+    }
+
+    TEST_CASE(GetFlux_ReturnsFluxCloseToOriginalFlux)
+    {
+        Spectrum flux;
+        for (size_t i = 0; i < Spectrum::Samples; ++i)
+            flux[i] = 0.002f * (i + 1);
+
+        SPPMPhotonData data;
+        data.set_flux(flux);
+
+        Spectrum result;
+        data.get_flux(result);
+
+        float max_error = 0.0f;
+        for (size_t i = 0; i < Spectrum::Samples; ++i)
+        {
+            const float error = abs(result[i] - flux[i]);
+            if (max_error < error)
+                max_error = error;
+        }
+
+        // The quantization step is relative to the largest component.
+        EXPECT_LT(0.002f * Spectrum::Samples / 65535.0f, max_error);
+    }
+
+    TEST_CASE(GetFlux_GivenZeroFlux_ReturnsZeroFlux)
+    {
+        SPPMPhotonData data;
+        data.set_flux(Spectrum(0.0f));
+
+        Spectrum result;
+        data.get_flux(result);
+
+        EXPECT_EQ(Spectrum(0.0f), result);
+    }
+}
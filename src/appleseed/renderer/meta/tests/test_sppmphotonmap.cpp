@@ -0,0 +1,169 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/sppm/sppmparameters.h"
+#include "renderer/kernel/lighting/sppm/sppmphoton.h"
+#include "renderer/kernel/lighting/sppm/sppmphotonmap.h"
+#include "renderer/utility/paramarray.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/knn.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/job.h"
+#include "foundation/utility/log.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Lighting_SPPM_SPPMPhotonMap)
+{
+    void build_photons(
+        const vector<Vector3f>& points,
+        SPPMPhotonVector&       photons)
+    {
+        photons.m_positions = points;
+        photons.m_data.resize(points.size());
+    }
+
+    // Return the number of lookups where the two photon maps disagree.
+    size_t compare_lookups(
+        const SPPMPhotonMap&    lhs,
+        const SPPMPhotonMap&    rhs,
+        const vector<Vector3f>& query_points,
+        const float             lookup_radius,
+        const size_t            max_answer_size)
+    {
+        knn::Answer<float> lhs_answer(max_answer_size);
+        knn::Answer<float> rhs_answer(max_answer_size);
+        size_t mismatch_count = 0;
+
+        for (size_t i = 0; i < query_points.size(); ++i)
+        {
+            lhs.find_nearest_photons(query_points[i], lookup_radius, lhs_answer);
+            rhs.find_nearest_photons(query_points[i], lookup_radius, rhs_answer);
+
+            if (lhs_answer.size() != rhs_answer.size())
+            {
+                ++mismatch_count;
+                continue;
+            }
+
+            lhs_answer.sort();
+            rhs_answer.sort();
+
+            for (size_t j = 0; j < lhs_answer.size(); ++j)
+            {
+                if (lhs.remap(lhs_answer.get(j).m_index) != rhs.remap(rhs_answer.get(j).m_index) ||
+                    lhs_answer.get(j).m_square_dist != rhs_answer.get(j).m_square_dist)
+                {
+                    ++mismatch_count;
+                    break;
+                }
+            }
+        }
+
+        return mismatch_count;
+    }
+
+    TEST_CASE(FindNearestPhotons_GivenDensePhotons_HashGridAndKdTreeReturnSamePhotons)
+    {
+        const size_t MaxAnswerSize = 8;
+        const float LookupRadius = 0.025f;
+
+        // Lookup disks hold a few more photons than the answer, and grid cells many more.
+        MersenneTwister rng;
+        vector<Vector3f> points;
+        for (size_t i = 0; i < 20000; ++i)
+        {
+            points.push_back(
+                Vector3f(
+                    rand_float2(rng),
+                    rand_float2(rng) * 0.1f,
+                    rand_float2(rng)));
+        }
+
+        vector<Vector3f> query_points;
+        for (size_t i = 0; i < 2000; ++i)
+        {
+            query_points.push_back(
+                Vector3f(
+                    rand_float2(rng),
+                    rand_float2(rng) * 0.1f,
+                    rand_float2(rng)));
+        }
+
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, 2, JobManager::KeepRunningOnEmptyQueue);
+        job_manager.start();
+
+        SPPMPhotonVector kdtree_photons;
+        build_photons(points, kdtree_photons);
+        const SPPMPhotonMap kdtree_photon_map(
+            kdtree_photons,
+            SPPMParameters(
+                ParamArray()
+                    .insert("initial_radius", 0.5f)
+                    .insert("max_photons_per_estimate", MaxAnswerSize)
+                    .insert("photon_map", "kdtree")),
+            LookupRadius,
+            job_queue);
+
+        SPPMPhotonVector hashgrid_photons;
+        build_photons(points, hashgrid_photons);
+        const SPPMPhotonMap hashgrid_photon_map(
+            hashgrid_photons,
+            SPPMParameters(
+                ParamArray()
+                    .insert("initial_radius", 0.5f)
+                    .insert("max_photons_per_estimate", MaxAnswerSize)
+                    .insert("photon_map", "hashgrid")),
+            LookupRadius,
+            job_queue);
+
+        const size_t mismatch_count =
+            compare_lookups(
+                kdtree_photon_map,
+                hashgrid_photon_map,
+                query_points,
+                LookupRadius,
+                MaxAnswerSize);
+
+        EXPECT_EQ(0, mismatch_count);
+    }
+}
@@ -29,10 +29,28 @@
 
 // appleseed.renderer headers.
 #include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/modeling/texture/texture.h"
+#include "renderer/utility/paramarray.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
+#include "foundation/image/colorspace.h"
+#include "foundation/image/pixel.h"
+#include "foundation/image/tile.h"
+#include "foundation/platform/thread.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/test.h"
 
+// boost headers.
+#include "boost/thread/thread.hpp"
+
+// Standard headers.
+#include <cstddef>
+
+using namespace foundation;
 using namespace renderer;
 
 TEST_SUITE(Renderer_Kernel_Texturing_TextureStore_TileKey)
@@ -45,5 +63,250 @@ TEST_SUITE(Renderer_Kernel_Texturing_TextureStore_TileKey)
         EXPECT_EQ(12345, key.m_texture_uid);
         EXPECT_EQ(32323, key.get_tile_x());
         EXPECT_EQ(56565, key.get_tile_y());
+        EXPECT_EQ(0, key.m_level);
+    }
+
+    TEST_CASE(OperatorEqual_GivenKeysDifferingOnlyByLevel_ReturnsFalse)
+    {
+        const TextureStore::TileKey key1(123, 12345, 1, 2, 0);
+        const TextureStore::TileKey key2(123, 12345, 1, 2, 1);
+
+        EXPECT_FALSE(key1 == key2);
+    }
+}
+
+TEST_SUITE(Renderer_Kernel_Texturing_TextureStore_MipLevels)
+{
+    TEST_CASE(GetLevelCount_GivenSquareCanvas)
+    {
+        const CanvasProperties props(64, 64, 8, 8, 4, PixelFormatFloat);
+
+        EXPECT_EQ(7, TextureStore::get_level_count(props));
+    }
+
+    TEST_CASE(GetLevelCount_GivenNonSquareCanvas_UsesLargestDimension)
+    {
+        const CanvasProperties props(100, 3, 32, 32, 4, PixelFormatFloat);
+
+        EXPECT_EQ(7, TextureStore::get_level_count(props));
+    }
+
+    TEST_CASE(GetLevelSize_NeverReturnsZero)
+    {
+        EXPECT_EQ(100, TextureStore::get_level_size(100, 0));
+        EXPECT_EQ(50, TextureStore::get_level_size(100, 1));
+        EXPECT_EQ(1, TextureStore::get_level_size(100, 10));
+    }
+}
+
+TEST_SUITE(Renderer_Kernel_Texturing_TextureStore)
+{
+    class CountingTexture
+      : public Texture
+    {
+      public:
+        volatile boost::uint32_t m_load_count;
+        volatile boost::uint32_t m_unload_count;
+
+        CountingTexture()
+          : Texture("texture", ParamArray())
+          , m_load_count(0)
+          , m_unload_count(0)
+          , m_props(
+                64, 64,
+                8, 8,
+                4,
+                PixelFormatFloat)
+        {
+        }
+
+        virtual void release() OVERRIDE
+        {
+            delete this;
+        }
+
+        virtual const char* get_model() const OVERRIDE
+        {
+            return "counting_texture";
+        }
+
+        virtual ColorSpace get_color_space() const OVERRIDE
+        {
+            return ColorSpaceLinearRGB;
+        }
+
+        virtual const CanvasProperties& properties() OVERRIDE
+        {
+            return m_props;
+        }
+
+        virtual Tile* load_tile(
+            const size_t    tile_x,
+            const size_t    tile_y) OVERRIDE
+        {
+            boost_atomic::atomic_inc32(&m_load_count);
+
+            // Give other threads a chance to request the tile while it's being loaded.
+            yield();
+
+            return
+                new Tile(
+                    m_props.m_tile_width,
+                    m_props.m_tile_height,
+                    m_props.m_channel_count,
+                    m_props.m_pixel_format);
+        }
+
+        virtual void unload_tile(
+            const size_t    tile_x,
+            const size_t    tile_y,
+            const Tile*     tile) OVERRIDE
+        {
+            boost_atomic::atomic_inc32(&m_unload_count);
+            delete tile;
+        }
+
+      private:
+        const CanvasProperties  m_props;
+    };
+
+    struct Fixture
+    {
+        auto_release_ptr<Scene> m_scene;
+        CountingTexture*        m_texture;
+
+        Fixture()
+          : m_scene(SceneFactory::create())
+          , m_texture(new CountingTexture())
+        {
+            m_scene->textures().insert(auto_release_ptr<Texture>(m_texture));
+        }
+
+        TextureStore::TileKey make_key(const size_t tile_x, const size_t tile_y) const
+        {
+            return TextureStore::TileKey(~0, m_texture->get_uid(), tile_x, tile_y);
+        }
+    };
+
+    struct TileAcquirer
+    {
+        TextureStore&               m_store;
+        const TextureStore::TileKey m_key;
+        const Tile*                 m_tile;
+
+        TileAcquirer(TextureStore& store, const TextureStore::TileKey& key)
+          : m_store(store)
+          , m_key(key)
+          , m_tile(0)
+        {
+        }
+
+        void operator()()
+        {
+            TextureStore::TileRecord& record = m_store.acquire(m_key);
+            m_tile = record.m_tile;
+            m_store.release(record);
+        }
+    };
+
+    TEST_CASE_F(Acquire_ReturnsLoadedTile, Fixture)
+    {
+        TextureStore store(m_scene.ref());
+
+        TextureStore::TileRecord& record = store.acquire(make_key(1, 2));
+
+        ASSERT_NEQ(0, record.m_tile);
+        EXPECT_EQ(8, record.m_tile->get_width());
+        EXPECT_EQ(1, m_texture->m_load_count);
+
+        store.release(record);
+    }
+
+    TEST_CASE_F(Acquire_GivenSameKeyTwice_LoadsTileOnce, Fixture)
+    {
+        TextureStore store(m_scene.ref());
+
+        TextureStore::TileRecord& record1 = store.acquire(make_key(3, 4));
+        store.release(record1);
+
+        TextureStore::TileRecord& record2 = store.acquire(make_key(3, 4));
+        store.release(record2);
+
+        EXPECT_EQ(&record1, &record2);
+        EXPECT_EQ(1, m_texture->m_load_count);
+    }
+
+    TEST_CASE_F(Acquire_GivenSameKeyFromMultipleThreads_LoadsTileOnce, Fixture)
+    {
+        TextureStore store(m_scene.ref());
+
+        const size_t ThreadCount = 8;
+
+        TileAcquirer* acquirers[ThreadCount];
+        boost::thread_group threads;
+
+        for (size_t i = 0; i < ThreadCount; ++i)
+        {
+            acquirers[i] = new TileAcquirer(store, make_key(5, 6));
+            threads.create_thread(ThreadFunctionWrapper<TileAcquirer>(acquirers[i]));
+        }
+
+        threads.join_all();
+
+        EXPECT_EQ(1, m_texture->m_load_count);
+
+        for (size_t i = 0; i < ThreadCount; ++i)
+        {
+            EXPECT_EQ(acquirers[0]->m_tile, acquirers[i]->m_tile);
+            delete acquirers[i];
+        }
+    }
+
+    TEST_CASE_F(Acquire_GivenMemoryLimitIsReached_UnloadsUnusedTiles, Fixture)
+    {
+        // Room for about two 8x8 RGBA float tiles.
+        TextureStore store(m_scene.ref(), ParamArray().insert("max_size", 2 * 8 * 8 * 4 * 4));
+
+        for (size_t y = 0; y < 8; ++y)
+        {
+            for (size_t x = 0; x < 8; ++x)
+                store.release(store.acquire(make_key(x, y)));
+        }
+
+        EXPECT_EQ(64, m_texture->m_load_count);
+        EXPECT_TRUE(m_texture->m_unload_count > 0);
+    }
+
+    TEST_CASE_F(Acquire_GivenTileOfLevelOne_BuildsItFromFourTilesOfLevelZero, Fixture)
+    {
+        TextureStore store(m_scene.ref());
+
+        TextureStore::TileRecord& record =
+            store.acquire(TextureStore::TileKey(~0, m_texture->get_uid(), 1, 1, 1));
+
+        ASSERT_NEQ(0, record.m_tile);
+        EXPECT_EQ(8, record.m_tile->get_width());
+        EXPECT_EQ(4, m_texture->m_load_count);
+
+        store.release(record);
+    }
+
+    TEST_CASE_F(Prefetch_GivenPrefetchingIsDisabled_DoesNotLoadTile, Fixture)
+    {
+        TextureStore store(m_scene.ref());
+
+        store.prefetch(make_key(1, 2));
+
+        EXPECT_EQ(0, m_texture->m_load_count);
+    }
+
+    TEST_CASE_F(Prefetch_ThenAcquire_LoadsTileOnce, Fixture)
+    {
+        TextureStore store(m_scene.ref(), ParamArray().insert("prefetch_thread_count", 1));
+
+        store.prefetch(make_key(1, 2));
+        store.release(store.acquire(make_key(1, 2)));
+
+        EXPECT_EQ(1, m_texture->m_load_count);
     }
 }
@@ -753,6 +753,75 @@ TEST_SUITE(Renderer_Kernel_Lighting_Tracer)
         EXPECT_EQ(1.0, transmission);
     }
 
+    TEST_CASE_F(TraceBetween_PacketVariant_GivenTwoOpaqueOccluders_ReturnsSameTransmissionsAsSingleVariant, Fixture<SceneWithTwoOpaqueOccluders>)
+    {
+        Tracer parent_tracer(
+            *m_scene,
+            m_intersector,
+            m_texture_cache
+#ifdef WITH_OSL
+            , *m_shading_group_exec
+#endif
+            );
+
+        double parent_transmission;
+        const ShadingPoint& parent_shading_point =
+            parent_tracer.trace(
+                Vector3d(0.0, 0.0, 0.0),
+                Vector3d(1.0, 0.0, 0.0),
+                0.0,
+                ShadingRay::ShadowRay,
+                0,
+                parent_transmission);
+
+        ASSERT_TRUE(parent_shading_point.hit());
+
+        // Targets before, on and past the second occluder, some of them beside it.
+        // There are more targets than rays in a packet.
+        const size_t TargetCount = 20;
+        Vector3d targets[TargetCount];
+        for (size_t i = 0; i < TargetCount; ++i)
+        {
+            targets[i] =
+                Vector3d(
+                    3.0 + 0.25 * (i % 10),
+                    i < 10 ? 0.1 : 1.0,
+                    0.0);
+        }
+
+        Tracer tracer(
+            *m_scene,
+            m_intersector,
+            m_texture_cache
+#ifdef WITH_OSL
+            , *m_shading_group_exec
+#endif
+            );
+
+        double transmissions[TargetCount];
+        tracer.trace_between(
+            parent_shading_point,
+            targets,
+            TargetCount,
+            ShadingRay::ShadowRay,
+            transmissions);
+
+        for (size_t i = 0; i < TargetCount; ++i)
+        {
+            const double expected_transmission =
+                tracer.trace_between(
+                    parent_shading_point,
+                    targets[i],
+                    ShadingRay::ShadowRay);
+
+            EXPECT_EQ(expected_transmission, transmissions[i]);
+        }
+
+        EXPECT_EQ(1.0, transmissions[0]);           // before the second occluder
+        EXPECT_EQ(0.0, transmissions[9]);           // past the second occluder
+        EXPECT_EQ(1.0, transmissions[19]);          // beside the second occluder
+    }
+
     struct SceneWithTwoOpaqueOccludersAndScaledAssemblyInstance
       : public SceneWithTwoOpaqueOccluders
     {
@@ -580,6 +580,87 @@ TEST_SUITE(Renderer_Utility_TransformSequence)
         EXPECT_FEQ_EPS(AABB3d(Vector3d(-0.54119610014619690, -1.4142135623730951, 0.0), Vector3d(1.4142135623730949, 1.0, 0.0)), motion_bbox, 1.0e-3);
     }
 
+    TEST_CASE(ToParent_GivenWholeTimeInterval_ReturnsMotionBoundingBox)
+    {
+        TransformSequence sequence;
+        sequence.set_transform(
+            0.0,
+            Transformd::from_local_to_parent(
+                Matrix4d::rotation(Vector3d(0.0, 0.0, 1.0), 0.0)));
+        sequence.set_transform(
+            1.0,
+            Transformd::from_local_to_parent(
+                Matrix4d::rotation(Vector3d(0.0, 0.0, 1.0), Pi - Pi / 8)));
+        sequence.prepare();
+
+        const AABB3d bbox(Vector3d(1.0, 1.0, 0.0), Vector3d(1.0, 1.0, 0.0));
+        const AABB3d motion_bbox = sequence.to_parent(bbox, 0.0, 1.0);
+
+        EXPECT_FEQ_EPS(sequence.to_parent(bbox), motion_bbox, 1.0e-9);
+    }
+
+    TEST_CASE(ToParent_GivenTranslationAndFirstHalfOfTimeInterval_ReturnsBoundingBoxOfFirstHalfOfPath)
+    {
+        TransformSequence sequence;
+        sequence.set_transform(
+            0.0,
+            Transformd::from_local_to_parent(
+                Matrix4d::translation(Vector3d(0.0, 0.0, 0.0))));
+        sequence.set_transform(
+            1.0,
+            Transformd::from_local_to_parent(
+                Matrix4d::translation(Vector3d(10.0, 0.0, 0.0))));
+        sequence.prepare();
+
+        const AABB3d bbox(Vector3d(0.0, 0.0, 0.0), Vector3d(1.0, 1.0, 1.0));
+        const AABB3d motion_bbox = sequence.to_parent(bbox, 0.0, 0.5);
+
+        EXPECT_FEQ_EPS(AABB3d(Vector3d(0.0, 0.0, 0.0), Vector3d(6.0, 1.0, 1.0)), motion_bbox, 1.0e-9);
+    }
+
+    TEST_CASE(ToParent_GivenTimeIntervalSpanningKeyFrame_ReturnsBoundingBoxOfPathThroughKeyFrame)
+    {
+        TransformSequence sequence;
+        sequence.set_transform(
+            0.0,
+            Transformd::from_local_to_parent(
+                Matrix4d::translation(Vector3d(0.0, 0.0, 0.0))));
+        sequence.set_transform(
+            0.5,
+            Transformd::from_local_to_parent(
+                Matrix4d::translation(Vector3d(10.0, 0.0, 0.0))));
+        sequence.set_transform(
+            1.0,
+            Transformd::from_local_to_parent(
+                Matrix4d::translation(Vector3d(10.0, 10.0, 0.0))));
+        sequence.prepare();
+
+        const AABB3d bbox(Vector3d(0.0, 0.0, 0.0), Vector3d(0.0, 0.0, 0.0));
+        const AABB3d motion_bbox = sequence.to_parent(bbox, 0.25, 0.75);
+
+        EXPECT_FEQ_EPS(AABB3d(Vector3d(5.0, 0.0, 0.0), Vector3d(10.0, 5.0, 0.0)), motion_bbox, 1.0e-9);
+    }
+
+    TEST_CASE(ToParent_GivenRotationAndSecondHalfOfTimeInterval_ReturnsBoundingBoxOfSecondHalfOfPath)
+    {
+        TransformSequence sequence;
+        sequence.set_transform(
+            0.0,
+            Transformd::from_local_to_parent(
+                Matrix4d::rotation(Vector3d(0.0, 0.0, 1.0), 0.0)));
+        sequence.set_transform(
+            1.0,
+            Transformd::from_local_to_parent(
+                Matrix4d::rotation(Vector3d(0.0, 0.0, 1.0), HalfPi)));
+        sequence.prepare();
+
+        // The point (1, 0, 0) rotates from angle Pi/4 to angle Pi/2.
+        const AABB3d bbox(Vector3d(1.0, 0.0, 0.0), Vector3d(1.0, 0.0, 0.0));
+        const AABB3d motion_bbox = sequence.to_parent(bbox, 0.5, 1.0);
+
+        EXPECT_FEQ_EPS(AABB3d(Vector3d(0.0, 0.70710678118654757, 0.0), Vector3d(0.70710678118654757, 1.0, 0.0)), motion_bbox, 1.0e-3);
+    }
+
     void visualize(
         const char*                 filename,
         const TransformSequence&    sequence,
@@ -0,0 +1,144 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/triangleencoder.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/iostreamop.h"
+#include "foundation/utility/memory.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Intersection_TriangleEncoder)
+{
+    // Two triangles sharing an edge.
+    vector<GVector3> make_quad()
+    {
+        vector<GVector3> vertices;
+        vertices.push_back(GVector3(0.0f, 0.0f, 0.0f));
+        vertices.push_back(GVector3(1.0f, 0.0f, 0.0f));
+        vertices.push_back(GVector3(1.0f, 1.0f, 0.0f));
+        vertices.push_back(GVector3(0.0f, 0.0f, 0.0f));
+        vertices.push_back(GVector3(1.0f, 1.0f, 0.0f));
+        vertices.push_back(GVector3(0.0f, 1.0f, 0.5f));
+        return vertices;
+    }
+
+    vector<uint8> encode_indexed(const vector<GVector3>& leaf_vertices, const bool quantized)
+    {
+        vector<uint8> leaf_data(TriangleEncoder::compute_indexed_size(leaf_vertices, quantized));
+        MemoryWriter writer(&leaf_data[0]);
+        TriangleEncoder::encode_indexed(leaf_vertices, quantized, writer);
+        return leaf_data;
+    }
+
+    TEST_CASE(ComputeIndexedSize_SharesVerticesBetweenTriangles)
+    {
+        const vector<GVector3> leaf_vertices = make_quad();
+
+        const size_t size = TriangleEncoder::compute_indexed_size(leaf_vertices, false);
+
+        EXPECT_EQ(sizeof(uint32) + 4 * sizeof(GVector3) + 6 * sizeof(uint16), size);
+    }
+
+    TEST_CASE(EncodeIndexed_WritesAsManyBytesAsComputed)
+    {
+        const vector<GVector3> leaf_vertices = make_quad();
+        const size_t size = TriangleEncoder::compute_indexed_size(leaf_vertices, true);
+
+        vector<uint8> leaf_data(size);
+        MemoryWriter writer(&leaf_data[0]);
+        TriangleEncoder::encode_indexed(leaf_vertices, true, writer);
+
+        EXPECT_EQ(size, writer.offset());
+        EXPECT_EQ(size, TriangleEncoder::compute_indexed_size(&leaf_data[0], 2, true));
+    }
+
+    TEST_CASE(IndexedTriangleLeafDecoder_GivenIndexedLeaf_ReturnsOriginalVertices)
+    {
+        const vector<GVector3> leaf_vertices = make_quad();
+        const vector<uint8> leaf_data = encode_indexed(leaf_vertices, false);
+
+        const IndexedTriangleLeafDecoder decoder(&leaf_data[0], false);
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            GVector3 v0, v1, v2;
+            decoder.get_triangle(i, v0, v1, v2);
+
+            EXPECT_EQ(leaf_vertices[i * 3 + 0], v0);
+            EXPECT_EQ(leaf_vertices[i * 3 + 1], v1);
+            EXPECT_EQ(leaf_vertices[i * 3 + 2], v2);
+        }
+    }
+
+    TEST_CASE(IndexedTriangleLeafDecoder_GivenQuantizedLeaf_ReturnsVerticesCloseToOriginalOnes)
+    {
+        const vector<GVector3> leaf_vertices = make_quad();
+        const vector<uint8> leaf_data = encode_indexed(leaf_vertices, true);
+
+        const IndexedTriangleLeafDecoder decoder(&leaf_data[0], true);
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            GVector3 v0, v1, v2;
+            decoder.get_triangle(i, v0, v1, v2);
+
+            EXPECT_FEQ_EPS(leaf_vertices[i * 3 + 0], v0, 1.0e-4f);
+            EXPECT_FEQ_EPS(leaf_vertices[i * 3 + 1], v1, 1.0e-4f);
+            EXPECT_FEQ_EPS(leaf_vertices[i * 3 + 2], v2, 1.0e-4f);
+        }
+    }
+
+    TEST_CASE(IndexedTriangleLeafDecoder_GivenQuantizedLeaf_DecodesSharedVerticesIdentically)
+    {
+        const vector<GVector3> leaf_vertices = make_quad();
+        const vector<uint8> leaf_data = encode_indexed(leaf_vertices, true);
+
+        const IndexedTriangleLeafDecoder decoder(&leaf_data[0], true);
+
+        GVector3 a0, a1, a2, b0, b1, b2;
+        decoder.get_triangle(0, a0, a1, a2);
+        decoder.get_triangle(1, b0, b1, b2);
+
+        EXPECT_EQ(a0, b0);
+        EXPECT_EQ(a2, b1);
+    }
+}
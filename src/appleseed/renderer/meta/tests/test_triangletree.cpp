@@ -0,0 +1,334 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/regioninfo.h"
+#include "renderer/kernel/intersection/triangleencoder.h"
+#include "renderer/kernel/intersection/triangletree.h"
+#include "renderer/modeling/object/meshobject.h"
+#include "renderer/modeling/object/object.h"
+#include "renderer/modeling/object/triangle.h"
+#include "renderer/modeling/scene/assembly.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/objectinstance.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/utility/bbox.h"
+#include "renderer/utility/paramarray.h"
+#include "renderer/utility/testutils.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/transform.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/test.h"
+
+// boost headers.
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Intersection_TriangleTree)
+{
+    struct TestScene
+    {
+        const filesystem::path          m_cache_directory;
+        auto_release_ptr<Scene>         m_scene;
+        Assembly*                       m_assembly;
+        MeshObject*                     m_mesh;
+
+        TestScene()
+          : m_cache_directory(filesystem::absolute("unit tests/outputs/test_triangletree/"))
+          , m_scene(SceneFactory::create())
+        {
+            filesystem::remove_all(m_cache_directory);
+            filesystem::create_directories(m_cache_directory);
+
+            m_scene->get_parameters().insert_path(
+                "acceleration_structure.cache_directory",
+                m_cache_directory.string());
+
+            ParamArray assembly_params;
+            assembly_params.insert_path("acceleration_structure.algorithm", "bvh");
+            assembly_params.insert_path("acceleration_structure.time", 0.5);
+
+            m_scene->assemblies().insert(AssemblyFactory::create("assembly", assembly_params));
+            m_assembly = m_scene->assemblies().get_by_name("assembly");
+
+            create_mesh_object();
+
+            m_assembly->object_instances().insert(
+                ObjectInstanceFactory::create(
+                    "object_instance",
+                    ParamArray(),
+                    "object",
+                    Transformd::identity(),
+                    StringDictionary()));
+        }
+
+        // Create a bumpy grid, large enough to get a tree with many nodes.
+        void create_mesh_object()
+        {
+            auto_release_ptr<MeshObject> mesh_object =
+                MeshObjectFactory::create("object", ParamArray());
+
+            const size_t GridSize = 16;
+
+            for (size_t y = 0; y <= GridSize; ++y)
+            {
+                for (size_t x = 0; x <= GridSize; ++x)
+                {
+                    mesh_object->push_vertex(
+                        GVector3(
+                            static_cast<GScalar>(x),
+                            static_cast<GScalar>(0.5 * sin(0.7 * x) * cos(1.3 * y)),
+                            static_cast<GScalar>(y)));
+                }
+            }
+
+            for (size_t y = 0; y < GridSize; ++y)
+            {
+                for (size_t x = 0; x < GridSize; ++x)
+                {
+                    const size_t v00 = y * (GridSize + 1) + x;
+                    const size_t v01 = v00 + 1;
+                    const size_t v10 = v00 + GridSize + 1;
+                    const size_t v11 = v10 + 1;
+
+                    mesh_object->push_triangle(Triangle(v00, v01, v11, 0));
+                    mesh_object->push_triangle(Triangle(v11, v10, v00, 0));
+                }
+            }
+
+            mesh_object->push_material_slot("material");
+
+            m_mesh = mesh_object.get();
+
+            m_assembly->objects().insert(auto_release_ptr<Object>(mesh_object.release()));
+        }
+    };
+
+    struct Fixture
+      : public BindInputs<TestScene>
+    {
+        const ParamArray& get_tree_params() const
+        {
+            return m_assembly->get_parameters().child("acceleration_structure");
+        }
+
+        auto_ptr<TriangleTree> create_tree() const
+        {
+            const ObjectInstance* object_instance =
+                m_assembly->object_instances().get_by_name("object_instance");
+
+            RegionInfoVector regions;
+            regions.push_back(RegionInfo(0, 0, object_instance->compute_parent_bbox()));
+
+            return
+                auto_ptr<TriangleTree>(
+                    new TriangleTree(
+                        TriangleTree::Arguments(
+                            m_scene.ref(),
+                            m_assembly->get_uid(),
+                            compute_parent_bbox<GAABB3>(
+                                m_assembly->object_instances().begin(),
+                                m_assembly->object_instances().end()),
+                            *m_assembly,
+                            regions)));
+        }
+
+        static vector<char> read_file(const string& filepath)
+        {
+            ifstream file(filepath.c_str(), ios_base::in | ios_base::binary);
+            return vector<char>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        }
+
+        static void write_file(const string& filepath, const vector<char>& contents)
+        {
+            ofstream file(filepath.c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+            file.write(&contents[0], contents.size());
+        }
+    };
+
+    template <typename Vector>
+    bool have_same_contents(const Vector& lhs, const Vector& rhs)
+    {
+        return
+            lhs.size() == rhs.size() &&
+            (lhs.empty() ||
+             memcmp(&lhs[0], &rhs[0], lhs.size() * sizeof(typename Vector::value_type)) == 0);
+    }
+
+    TEST_CASE_F(SaveToCache_ThenLoadFromCache_RestoresIdenticalTree, Fixture)
+    {
+        auto_ptr<TriangleTree> tree(create_tree());
+        const uint64 cache_key = tree->compute_cache_key(get_tree_params(), "bvh", 0.5, false);
+        const string filepath = TriangleTree::make_cache_filepath(m_cache_directory.string(), cache_key);
+
+        // The constructor already saved the tree, save it again explicitly.
+        filesystem::remove(filepath);
+        tree->save_to_cache(filepath, cache_key);
+        ASSERT_TRUE(filesystem::exists(filepath));
+
+        auto_ptr<TriangleTree> loaded_tree(create_tree());
+        loaded_tree->m_nodes.clear();
+        loaded_tree->m_node_bboxes.clear();
+        loaded_tree->m_triangle_keys.clear();
+        loaded_tree->m_leaf_data.clear();
+        loaded_tree->m_static_triangle_count = 0;
+        loaded_tree->m_moving_triangle_count = 0;
+        const bool loaded = loaded_tree->load_from_cache(filepath, cache_key);
+
+        ASSERT_TRUE(loaded);
+        EXPECT_TRUE(have_same_contents(tree->m_nodes, loaded_tree->m_nodes));
+        EXPECT_TRUE(have_same_contents(tree->m_node_bboxes, loaded_tree->m_node_bboxes));
+        EXPECT_TRUE(have_same_contents(tree->m_triangle_keys, loaded_tree->m_triangle_keys));
+        EXPECT_TRUE(have_same_contents(tree->m_leaf_data, loaded_tree->m_leaf_data));
+        EXPECT_EQ(tree->m_static_triangle_count, loaded_tree->m_static_triangle_count);
+        EXPECT_EQ(tree->m_moving_triangle_count, loaded_tree->m_moving_triangle_count);
+        EXPECT_EQ(tree->m_leaf_encoding, loaded_tree->m_leaf_encoding);
+    }
+
+    TEST_CASE_F(LoadFromCache_GivenTruncatedFile_ReturnsFalseAndTreeIsRebuilt, Fixture)
+    {
+        auto_ptr<TriangleTree> tree(create_tree());
+        const uint64 cache_key = tree->compute_cache_key(get_tree_params(), "bvh", 0.5, false);
+        const string filepath = TriangleTree::make_cache_filepath(m_cache_directory.string(), cache_key);
+        const vector<char> contents = read_file(filepath);
+        ASSERT_FALSE(contents.empty());
+
+        write_file(filepath, vector<char>(contents.begin(), contents.begin() + contents.size() / 2));
+
+        auto_ptr<TriangleTree> probe_tree(create_tree());
+        EXPECT_TRUE(have_same_contents(tree->m_nodes, probe_tree->m_nodes));
+        EXPECT_TRUE(have_same_contents(tree->m_triangle_keys, probe_tree->m_triangle_keys));
+        EXPECT_TRUE(have_same_contents(tree->m_leaf_data, probe_tree->m_leaf_data));
+        EXPECT_TRUE(have_same_contents(contents, read_file(filepath)));
+
+        write_file(filepath, vector<char>(contents.begin(), contents.begin() + contents.size() / 2));
+
+        EXPECT_FALSE(probe_tree->load_from_cache(filepath, cache_key));
+        EXPECT_TRUE(probe_tree->m_nodes.empty());
+    }
+
+    TEST_CASE_F(LoadFromCache_GivenCorruptedHeader_ReturnsFalseAndTreeIsRebuilt, Fixture)
+    {
+        auto_ptr<TriangleTree> tree(create_tree());
+        const uint64 cache_key = tree->compute_cache_key(get_tree_params(), "bvh", 0.5, false);
+        const string filepath = TriangleTree::make_cache_filepath(m_cache_directory.string(), cache_key);
+        const vector<char> contents = read_file(filepath);
+        ASSERT_FALSE(contents.empty());
+
+        // Corrupt the magic number.
+        vector<char> corrupted_contents = contents;
+        corrupted_contents[0] ^= 0xFF;
+        write_file(filepath, corrupted_contents);
+
+        auto_ptr<TriangleTree> probe_tree(create_tree());
+        EXPECT_TRUE(have_same_contents(tree->m_nodes, probe_tree->m_nodes));
+        EXPECT_TRUE(have_same_contents(tree->m_triangle_keys, probe_tree->m_triangle_keys));
+        EXPECT_TRUE(have_same_contents(tree->m_leaf_data, probe_tree->m_leaf_data));
+        EXPECT_TRUE(have_same_contents(contents, read_file(filepath)));
+
+        write_file(filepath, corrupted_contents);
+
+        EXPECT_FALSE(probe_tree->load_from_cache(filepath, cache_key));
+        EXPECT_TRUE(probe_tree->m_nodes.empty());
+    }
+
+    TEST_CASE_F(LoadFromCache_GivenCorruptedCacheKey_ReturnsFalseAndTreeIsRebuilt, Fixture)
+    {
+        auto_ptr<TriangleTree> tree(create_tree());
+        const uint64 cache_key = tree->compute_cache_key(get_tree_params(), "bvh", 0.5, false);
+        const string filepath = TriangleTree::make_cache_filepath(m_cache_directory.string(), cache_key);
+        const vector<char> contents = read_file(filepath);
+        ASSERT_FALSE(contents.empty());
+
+        // Corrupt the cache key, stored after the magic number and the format version.
+        vector<char> corrupted_contents = contents;
+        corrupted_contents[8] ^= 0xFF;
+        write_file(filepath, corrupted_contents);
+
+        auto_ptr<TriangleTree> probe_tree(create_tree());
+        EXPECT_TRUE(have_same_contents(tree->m_nodes, probe_tree->m_nodes));
+        EXPECT_TRUE(have_same_contents(tree->m_triangle_keys, probe_tree->m_triangle_keys));
+        EXPECT_TRUE(have_same_contents(tree->m_leaf_data, probe_tree->m_leaf_data));
+        EXPECT_TRUE(have_same_contents(contents, read_file(filepath)));
+
+        write_file(filepath, corrupted_contents);
+
+        EXPECT_FALSE(probe_tree->load_from_cache(filepath, cache_key));
+        EXPECT_TRUE(probe_tree->m_nodes.empty());
+    }
+
+    TEST_CASE_F(ComputeCacheKey_GivenDifferentBuildInputs_ReturnsDifferentKeys, Fixture)
+    {
+        auto_ptr<TriangleTree> tree(create_tree());
+        const ParamArray& params = get_tree_params();
+
+        const uint64 key = tree->compute_cache_key(params, "bvh", 0.5, false);
+        EXPECT_EQ(key, tree->compute_cache_key(params, "bvh", 0.5, false));
+
+        // Algorithm.
+        EXPECT_NEQ(key, tree->compute_cache_key(params, "sbvh", 0.5, false));
+        EXPECT_NEQ(key, tree->compute_cache_key(params, "binned_bvh", 0.5, false));
+
+        // Time.
+        EXPECT_NEQ(key, tree->compute_cache_key(params, "bvh", 0.25, false));
+
+        // Leaf encoding.
+        const TriangleEncoder::Encoding leaf_encoding = tree->m_leaf_encoding;
+        tree->m_leaf_encoding =
+            leaf_encoding == TriangleEncoder::Indexed
+                ? TriangleEncoder::Triangles
+                : TriangleEncoder::Indexed;
+        EXPECT_NEQ(key, tree->compute_cache_key(params, "bvh", 0.5, false));
+        tree->m_leaf_encoding = leaf_encoding;
+        EXPECT_EQ(key, tree->compute_cache_key(params, "bvh", 0.5, false));
+
+        // Geometry.
+        m_mesh->push_triangle(Triangle(0, 1, 2, 0));
+        EXPECT_NEQ(key, tree->compute_cache_key(params, "bvh", 0.5, false));
+    }
+}
@@ -93,7 +93,7 @@ void BSDF::evaluate_inputs(
     const ShadingPoint&     shading_point,
     const size_t            offset) const
 {
-    input_evaluator.evaluate(get_inputs(), shading_point.get_uv(0), offset);
+    input_evaluator.evaluate(get_inputs(), shading_point.get_source_inputs(0), offset);
 }
 
 }   // namespace renderer
@@ -97,7 +97,8 @@ class DLLSYMBOL Camera
 
     // Generate a ray directed toward a given point on the film plane, expressed
     // in normalized device coordinates (https://github.com/appleseedhq/appleseed/wiki/Terminology).
-    // The generated ray is expressed in world space.
+    // The generated ray is expressed in world space. If the camera is rendering a frame,
+    // the ray carries differentials corresponding to a one-pixel offset on the film plane.
     virtual void generate_ray(
         SamplingContext&                sampling_context,
         const foundation::Vector2d&     point,
@@ -125,9 +126,10 @@ class DLLSYMBOL Camera
         const foundation::Vector2d&     point) const = 0;
 
   protected:
-    TransformSequence   m_transform_sequence;
-    double              m_shutter_open_time;
-    double              m_shutter_close_time;
+    TransformSequence       m_transform_sequence;
+    double                  m_shutter_open_time;
+    double                  m_shutter_close_time;
+    foundation::Vector2d    m_pixel_ndc_size;           // size of a pixel in NDC, or zero if there is no frame
 
     // Utility function to retrieve the film dimensions (in meters) from the camera parameters.
     foundation::Vector2d extract_film_dimensions() const;
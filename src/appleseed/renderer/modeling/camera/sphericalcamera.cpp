@@ -124,6 +124,16 @@ namespace
 
             // Compute the direction of the ray.
             ray.m_dir = transform.vector_to_parent(ndc_to_camera(point));
+
+            // Compute the ray differentials.
+            if (m_pixel_ndc_size[0] > 0.0)
+            {
+                ray.m_has_differentials = true;
+                ray.m_rx.m_org = ray.m_org;
+                ray.m_ry.m_org = ray.m_org;
+                ray.m_rx.m_dir = transform.vector_to_parent(ndc_to_camera(Vector2d(point.x + m_pixel_ndc_size[0], point.y)));
+                ray.m_ry.m_dir = transform.vector_to_parent(ndc_to_camera(Vector2d(point.x, point.y + m_pixel_ndc_size[1])));
+            }
         }
 
         virtual bool project_point(
@@ -296,6 +296,16 @@ namespace
             ray.m_dir.y = (0.5 - point.y) * m_ky - lens_point.y;
             ray.m_dir.z = -m_focal_distance;
             ray.m_dir = transform.vector_to_parent(ray.m_dir);
+
+            // Compute the ray differentials. The auxiliary rays go through the same lens point.
+            if (m_pixel_ndc_size[0] > 0.0)
+            {
+                ray.m_has_differentials = true;
+                ray.m_rx.m_org = ray.m_org;
+                ray.m_ry.m_org = ray.m_org;
+                ray.m_rx.m_dir = ray.m_dir + transform.vector_to_parent(Vector3d(m_pixel_ndc_size[0] * m_kx, 0.0, 0.0));
+                ray.m_ry.m_dir = ray.m_dir + transform.vector_to_parent(Vector3d(0.0, -m_pixel_ndc_size[1] * m_ky, 0.0));
+            }
         }
 
         virtual bool project_point(
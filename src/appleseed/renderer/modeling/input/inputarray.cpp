@@ -115,7 +115,7 @@ namespace
 
         uint8* evaluate(
             TextureCache&       texture_cache,
-            const Vector2d&     uv,
+            const SourceInputs& source_inputs,
             uint8*              ptr) const
         {
             switch (m_format)
@@ -126,7 +126,7 @@ namespace
                     double* out_scalar = reinterpret_cast<double*>(ptr);
 
                     if (m_source)
-                        m_source->evaluate(texture_cache, uv, *out_scalar);
+                        m_source->evaluate(texture_cache, source_inputs, *out_scalar);
                     else *out_scalar = 0.0;
 
                     ptr += sizeof(double);
@@ -140,7 +140,7 @@ namespace
                     Spectrum* out_spectrum = reinterpret_cast<Spectrum*>(ptr);
 
                     if (m_source)
-                        m_source->evaluate(texture_cache, uv, *out_spectrum);
+                        m_source->evaluate(texture_cache, source_inputs, *out_spectrum);
                     else
                         out_spectrum->set(0.0f);
 
@@ -156,7 +156,7 @@ namespace
                     Alpha* out_alpha = reinterpret_cast<Alpha*>(ptr + sizeof(Spectrum));
 
                     if (m_source)
-                        m_source->evaluate(texture_cache, uv, *out_spectrum, *out_alpha);
+                        m_source->evaluate(texture_cache, source_inputs, *out_spectrum, *out_alpha);
                     else
                     {
                         out_spectrum->set(0.0f);
@@ -361,7 +361,7 @@ size_t InputArray::compute_data_size() const
 
 void InputArray::evaluate(
     TextureCache&       texture_cache,
-    const Vector2d&     uv,
+    const SourceInputs& source_inputs,
     void*               values,
     const size_t        offset) const
 {
@@ -374,7 +374,18 @@ void InputArray::evaluate(
 #endif
 
     for (const_each<InputVector> i = impl->m_inputs; i; ++i)
-        ptr = i->evaluate(texture_cache, uv, ptr);
+        ptr = i->evaluate(texture_cache, source_inputs, ptr);
+}
+
+void InputArray::prefetch(
+    TextureCache&       texture_cache,
+    const SourceInputs& source_inputs) const
+{
+    for (const_each<InputVector> i = impl->m_inputs; i; ++i)
+    {
+        if (i->m_source)
+            i->m_source->prefetch(texture_cache, source_inputs);
+    }
 }
 
 void InputArray::evaluate_uniforms(
@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/modeling/input/inputformat.h"
+#include "renderer/modeling/input/sourceinputs.h"
 
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
@@ -188,10 +189,16 @@ class DLLSYMBOL InputArray
     // The address 'values + offset' must be 16-byte aligned.
     void evaluate(
         TextureCache&               texture_cache,
-        const foundation::Vector2d& uv,
+        const SourceInputs&         source_inputs,
         void*                       values,
         const size_t                offset = 0) const;
 
+    // Hint that the inputs will soon be evaluated at a given shading point,
+    // so that the texture tiles they need can be loaded in the background.
+    void prefetch(
+        TextureCache&               texture_cache,
+        const SourceInputs&         source_inputs) const;
+
     // Evaluate all uniform inputs into a preallocated block of memory.
     // The address 'values + offset' must be 16-byte aligned.
     void evaluate_uniforms(
@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/modeling/input/inputarray.h"
+#include "renderer/modeling/input/sourceinputs.h"
 
 // appleseed.foundation headers.
 #include "foundation/math/vector.h"
@@ -59,12 +60,12 @@ class InputEvaluator
     // Evaluate a set of inputs, and return the values as an opaque block of memory.
     const void* evaluate(
         const InputArray&           inputs,
-        const foundation::Vector2d& uv,
+        const SourceInputs&         source_inputs,
         const size_t                offset = 0);
     template <typename T>
     const T* evaluate(
         const InputArray&           inputs,
-        const foundation::Vector2d& uv,
+        const SourceInputs&         source_inputs,
         const size_t                offset = 0);
 
     // Access the values stored by the evaluate() methods.
@@ -90,20 +91,20 @@ inline InputEvaluator::InputEvaluator(TextureCache& texture_cache)
 
 inline const void* InputEvaluator::evaluate(
     const InputArray&               inputs,
-    const foundation::Vector2d&     uv,
+    const SourceInputs&             source_inputs,
     const size_t                    offset)
 {
-    inputs.evaluate(m_texture_cache, uv, m_data, offset);
+    inputs.evaluate(m_texture_cache, source_inputs, m_data, offset);
     return m_data + offset;
 }
 
 template <typename T>
 inline const T* InputEvaluator::evaluate(
     const InputArray&               inputs,
-    const foundation::Vector2d&     uv,
+    const SourceInputs&             source_inputs,
     const size_t                    offset)
 {
-    inputs.evaluate(m_texture_cache, uv, m_data, offset);
+    inputs.evaluate(m_texture_cache, source_inputs, m_data, offset);
     return reinterpret_cast<const T*>(m_data + offset);
 }
 
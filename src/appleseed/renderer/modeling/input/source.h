@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globaltypes.h"
+#include "renderer/modeling/input/sourceinputs.h"
 
 // appleseed.foundation headers.
 #include "foundation/image/color.h"
@@ -66,28 +67,28 @@ class Source
     // Evaluate the source at a given shading point.
     virtual void evaluate(
         TextureCache&               texture_cache,
-        const foundation::Vector2d& uv,
+        const SourceInputs&         source_inputs,
         double&                     scalar) const;
     virtual void evaluate(
         TextureCache&               texture_cache,
-        const foundation::Vector2d& uv,
+        const SourceInputs&         source_inputs,
         foundation::Color3f&        linear_rgb) const;
     virtual void evaluate(
         TextureCache&               texture_cache,
-        const foundation::Vector2d& uv,
+        const SourceInputs&         source_inputs,
         Spectrum&                   spectrum) const;
     virtual void evaluate(
         TextureCache&               texture_cache,
-        const foundation::Vector2d& uv,
+        const SourceInputs&         source_inputs,
         Alpha&                      alpha) const;
     virtual void evaluate(
         TextureCache&               texture_cache,
-        const foundation::Vector2d& uv,
+        const SourceInputs&         source_inputs,
         foundation::Color3f&        linear_rgb,
         Alpha&                      alpha) const;
     virtual void evaluate(
         TextureCache&               texture_cache,
-        const foundation::Vector2d& uv,
+        const SourceInputs&         source_inputs,
         Spectrum&                   spectrum,
         Alpha&                      alpha) const;
 
@@ -107,6 +108,13 @@ class Source
         Spectrum&                   spectrum,
         Alpha&                      alpha) const;
 
+    // Hint that the source will soon be evaluated at a given shading point.
+    // Sources backed by textures ask the texture cache to prefetch the tiles
+    // involved. The default implementation does nothing.
+    virtual void prefetch(
+        TextureCache&               texture_cache,
+        const SourceInputs&         source_inputs) const;
+
   private:
     const bool  m_uniform;
 };
@@ -132,7 +140,7 @@ inline bool Source::is_uniform() const
 
 inline void Source::evaluate(
     TextureCache&                   texture_cache,
-    const foundation::Vector2d&     uv,
+    const SourceInputs&             source_inputs,
     double&                         scalar) const
 {
     evaluate_uniform(scalar);
@@ -140,7 +148,7 @@ inline void Source::evaluate(
 
 inline void Source::evaluate(
     TextureCache&                   texture_cache,
-    const foundation::Vector2d&     uv,
+    const SourceInputs&             source_inputs,
     foundation::Color3f&            linear_rgb) const
 {
     evaluate_uniform(linear_rgb);
@@ -148,7 +156,7 @@ inline void Source::evaluate(
 
 inline void Source::evaluate(
     TextureCache&                   texture_cache,
-    const foundation::Vector2d&     uv,
+    const SourceInputs&             source_inputs,
     Spectrum&                       spectrum) const
 {
     evaluate_uniform(spectrum);
@@ -156,7 +164,7 @@ inline void Source::evaluate(
 
 inline void Source::evaluate(
     TextureCache&                   texture_cache,
-    const foundation::Vector2d&     uv,
+    const SourceInputs&             source_inputs,
     Alpha&                          alpha) const
 {
     evaluate_uniform(alpha);
@@ -164,22 +172,22 @@ inline void Source::evaluate(
 
 inline void Source::evaluate(
     TextureCache&                   texture_cache,
-    const foundation::Vector2d&     uv,
+    const SourceInputs&             source_inputs,
     foundation::Color3f&            linear_rgb,
     Alpha&                          alpha) const
 {
-    evaluate(texture_cache, uv, linear_rgb);
-    evaluate(texture_cache, uv, alpha);
+    evaluate(texture_cache, source_inputs, linear_rgb);
+    evaluate(texture_cache, source_inputs, alpha);
 }
 
 inline void Source::evaluate(
     TextureCache&                   texture_cache,
-    const foundation::Vector2d&     uv,
+    const SourceInputs&             source_inputs,
     Spectrum&                       spectrum,
     Alpha&                          alpha) const
 {
-    evaluate(texture_cache, uv, spectrum);
-    evaluate(texture_cache, uv, alpha);
+    evaluate(texture_cache, source_inputs, spectrum);
+    evaluate(texture_cache, source_inputs, alpha);
 }
 
 inline void Source::evaluate_uniform(
@@ -222,6 +230,12 @@ inline void Source::evaluate_uniform(
     evaluate_uniform(alpha);
 }
 
+inline void Source::prefetch(
+    TextureCache&                   texture_cache,
+    const SourceInputs&             source_inputs) const
+{
+}
+
 }       // namespace renderer
 
 #endif  // !APPLESEED_RENDERER_MODELING_INPUT_SOURCE_H
@@ -0,0 +1,87 @@
+
+//
+// This source file is part of appleseed.
+// Visit http://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2010-2013 Francois Beaune, Jupiter Jazz Limited
+// Copyright (c) 2014 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef APPLESEED_RENDERER_MODELING_INPUT_SOURCEINPUTS_H
+#define APPLESEED_RENDERER_MODELING_INPUT_SOURCEINPUTS_H
+
+// appleseed.foundation headers.
+#include "foundation/math/vector.h"
+
+namespace renderer
+{
+
+//
+// The values a source is evaluated at: UV coordinates and, when known,
+// the screen-space derivatives of the UV coordinates. The derivatives
+// define the footprint of the lookup and are used to select MIP levels.
+//
+
+class SourceInputs
+{
+  public:
+    foundation::Vector2d    m_uv;       // UV coordinates
+    foundation::Vector2d    m_duvdx;    // derivative of the UV coordinates along screen-space X
+    foundation::Vector2d    m_duvdy;    // derivative of the UV coordinates along screen-space Y
+
+    // Constructor for point lookups (no footprint).
+    // Intentionally not explicit so that UV coordinates can be passed wherever source inputs are expected.
+    SourceInputs(const foundation::Vector2d& uv);
+
+    // Constructor for lookups with a footprint.
+    SourceInputs(
+        const foundation::Vector2d&     uv,
+        const foundation::Vector2d&     duvdx,
+        const foundation::Vector2d&     duvdy);
+};
+
+
+//
+// SourceInputs class implementation.
+//
+
+inline SourceInputs::SourceInputs(const foundation::Vector2d& uv)
+  : m_uv(uv)
+  , m_duvdx(0.0)
+  , m_duvdy(0.0)
+{
+}
+
+inline SourceInputs::SourceInputs(
+    const foundation::Vector2d&         uv,
+    const foundation::Vector2d&         duvdx,
+    const foundation::Vector2d&         duvdy)
+  : m_uv(uv)
+  , m_duvdx(duvdx)
+  , m_duvdy(duvdy)
+{
+}
+
+}       // namespace renderer
+
+#endif  // !APPLESEED_RENDERER_MODELING_INPUT_SOURCEINPUTS_H
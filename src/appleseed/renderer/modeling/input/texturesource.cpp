@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/kernel/texturing/texturecache.h"
+#include "renderer/kernel/texturing/texturestore.h"
 #include "renderer/modeling/entity/entity.h"
 #include "renderer/modeling/texture/texture.h"
 
@@ -42,7 +43,9 @@
 #include "foundation/platform/types.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 
 using namespace foundation;
 using namespace std;
@@ -143,6 +146,7 @@ namespace
         const UniqueID              texture_uid,
         const size_t                tile_x,
         const size_t                tile_y,
+        const size_t                level,
         const size_t                pixel_x,
         const size_t                pixel_y,
         Color4f&                    sample)
@@ -153,7 +157,8 @@ namespace
                 assembly_uid,
                 texture_uid,
                 tile_x,
-                tile_y);
+                tile_y,
+                level);
 
         // Sample the tile.
         if (tile.get_channel_count() == 3)
@@ -184,6 +189,7 @@ TextureSource::TextureSource(
   , m_scalar_canvas_height(static_cast<double>(m_texture_props.m_canvas_height))
   , m_max_x(static_cast<double>(m_texture_props.m_canvas_width - 1))
   , m_max_y(static_cast<double>(m_texture_props.m_canvas_height - 1))
+  , m_level_count(TextureStore::get_level_count(m_texture_props))
 {
 }
 
@@ -204,6 +210,15 @@ Vector2d TextureSource::apply_transform(const Vector2d& uv) const
     return Vector2d(p.x, p.y);
 }
 
+Vector2d TextureSource::transform_derivative(const Vector2d& duv) const
+{
+    // Derivatives transform like vectors.
+    const Vector3d d = m_texture_transform.vector_to_local(Vector3d(duv.x, duv.y, 0.0));
+
+    // The V axis is flipped in texture space.
+    return Vector2d(d.x * m_scalar_canvas_width, -d.y * m_scalar_canvas_height);
+}
+
 Color4f TextureSource::get_texel(
     TextureCache&               texture_cache,
     const size_t                ix,
@@ -244,6 +259,7 @@ Color4f TextureSource::get_texel(
         m_texture_uid,
         tile_x,
         tile_y,
+        0,
         pixel_x,
         pixel_y,
         sample);
@@ -253,6 +269,7 @@ Color4f TextureSource::get_texel(
 
 void TextureSource::get_texels_2x2(
     TextureCache&               texture_cache,
+    const size_t                level,
     const int                   ix,
     const int                   iy,
     Color4f&                    t00,
@@ -260,19 +277,22 @@ void TextureSource::get_texels_2x2(
     Color4f&                    t01,
     Color4f&                    t11) const
 {
+    const size_t level_width = TextureStore::get_level_size(m_texture_props.m_canvas_width, level);
+    const size_t level_height = TextureStore::get_level_size(m_texture_props.m_canvas_height, level);
+
     const Vector<size_t, 2> p00 =
         constrain_to_canvas(
             m_texture_instance.get_addressing_mode(),
-            m_texture_props.m_canvas_width,
-            m_texture_props.m_canvas_height,
+            level_width,
+            level_height,
             ix + 0,
             iy + 0);
 
     const Vector<size_t, 2> p11 =
         constrain_to_canvas(
             m_texture_instance.get_addressing_mode(),
-            m_texture_props.m_canvas_width,
-            m_texture_props.m_canvas_height,
+            level_width,
+            level_height,
             ix + 1,
             iy + 1);
 
@@ -298,10 +318,10 @@ void TextureSource::get_texels_2x2(
         const size_t pixel_y_11 = p11.y - tile_y_11 * m_texture_props.m_tile_height;
 
         // Sample the tile.
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_00, tile_y_00, pixel_x_00, pixel_y_00, t00);
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_11, tile_y_00, pixel_x_11, pixel_y_00, t10);
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_00, tile_y_11, pixel_x_00, pixel_y_11, t01);
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_11, tile_y_11, pixel_x_11, pixel_y_11, t11);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_00, tile_y_00, level, pixel_x_00, pixel_y_00, t00);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_11, tile_y_00, level, pixel_x_11, pixel_y_00, t10);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_00, tile_y_11, level, pixel_x_00, pixel_y_11, t01);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_11, tile_y_11, level, pixel_x_11, pixel_y_11, t11);
     }
     else
     {
@@ -319,7 +339,8 @@ void TextureSource::get_texels_2x2(
                 m_assembly_uid,
                 m_texture_uid,
                 tile_x_00,
-                tile_y_00);
+                tile_y_00,
+                level);
 
         // Sample the tile.
         if (tile.get_channel_count() == 3)
@@ -360,12 +381,133 @@ void TextureSource::get_texels_2x2(
     }
 }
 
+Color4f TextureSource::sample_bilinear(
+    TextureCache&               texture_cache,
+    const size_t                level,
+    const Vector2d&             p) const
+{
+    const double max_x = static_cast<double>(TextureStore::get_level_size(m_texture_props.m_canvas_width, level) - 1);
+    const double max_y = static_cast<double>(TextureStore::get_level_size(m_texture_props.m_canvas_height, level) - 1);
+
+    const double x = p.x * max_x;
+    const double y = p.y * max_y;
+
+    const int ix = truncate<int>(x);
+    const int iy = truncate<int>(y);
+
+    // Retrieve the four surrounding texels.
+    Color4f t00, t10, t01, t11;
+    get_texels_2x2(
+        texture_cache,
+        level,
+        ix, iy,
+        t00, t10, t01, t11);
+
+    // Compute weights.
+    const float wx1 = static_cast<float>(x - ix);
+    const float wy1 = static_cast<float>(y - iy);
+    const float wx0 = 1.0f - wx1;
+    const float wy0 = 1.0f - wy1;
+
+    // Apply weights.
+    t00 *= wx0 * wy0;
+    t10 *= wx1 * wy0;
+    t01 *= wx0 * wy1;
+    t11 *= wx1 * wy1;
+
+    // Accumulate.
+    t00 += t10;
+    t00 += t01;
+    t00 += t11;
+
+    return t00;
+}
+
+Color4f TextureSource::sample_trilinear(
+    TextureCache&               texture_cache,
+    const Vector2d&             p,
+    const double                lod) const
+{
+    assert(lod >= 0.0);
+
+    const size_t level = truncate<size_t>(lod);
+    const float w1 = static_cast<float>(lod - level);
+
+    Color4f c0 = sample_bilinear(texture_cache, level, p);
+
+    if (w1 == 0.0f || level + 1 >= m_level_count)
+        return c0;
+
+    Color4f c1 = sample_bilinear(texture_cache, level + 1, p);
+
+    c0 *= 1.0f - w1;
+    c1 *= w1;
+    c0 += c1;
+
+    return c0;
+}
+
+double TextureSource::compute_lod(const double footprint_width) const
+{
+    if (footprint_width <= 1.0)
+        return 0.0;
+
+    const double lod = log(footprint_width) * (1.0 / log(2.0));
+
+    return min(lod, static_cast<double>(m_level_count - 1));
+}
+
+void TextureSource::prefetch(
+    TextureCache&               texture_cache,
+    const SourceInputs&         source_inputs) const
+{
+    // Compute the transformed input texture coordinates.
+    Vector2d p = apply_transform(source_inputs.m_uv);
+    p.y = 1.0 - p.y;
+
+    // Apply the texture addressing mode.
+    apply_addressing_mode(m_texture_instance.get_addressing_mode(), p);
+
+    // Find the texel at this location in the sampled level.
+    const size_t level = select_level(source_inputs);
+    const size_t level_width = TextureStore::get_level_size(m_texture_props.m_canvas_width, level);
+    const size_t level_height = TextureStore::get_level_size(m_texture_props.m_canvas_height, level);
+    const size_t ix = min(truncate<size_t>(max(p.x, 0.0) * level_width), level_width - 1);
+    const size_t iy = min(truncate<size_t>(max(p.y, 0.0) * level_height), level_height - 1);
+
+    texture_cache.prefetch(
+        m_assembly_uid,
+        m_texture_uid,
+        ix / m_texture_props.m_tile_width,
+        iy / m_texture_props.m_tile_height,
+        level);
+}
+
+size_t TextureSource::select_level(const SourceInputs& source_inputs) const
+{
+    const double dpdx_norm = norm(transform_derivative(source_inputs.m_duvdx));
+    const double dpdy_norm = norm(transform_derivative(source_inputs.m_duvdy));
+
+    switch (m_texture_instance.get_filtering_mode())
+    {
+      case TextureFilteringTrilinear:
+        return truncate<size_t>(compute_lod(max(dpdx_norm, dpdy_norm)));
+
+      case TextureFilteringFeline:
+        // The probes are never narrower than the minor axis of the footprint.
+        return truncate<size_t>(compute_lod(min(dpdx_norm, dpdy_norm)));
+
+      default:
+        return 0;
+    }
+}
+
 Color4f TextureSource::sample_texture(
     TextureCache&               texture_cache,
-    const Vector2d&             uv) const
+    const SourceInputs&         source_inputs) const
 {
     // Start with the transformed input texture coordinates.
-    Vector2d p = apply_transform(uv);
+    Vector2d p = apply_transform(source_inputs.m_uv);
     p.y = 1.0 - p.y;
 
     // Apply the texture addressing mode.
@@ -385,38 +527,70 @@ Color4f TextureSource::sample_texture(
         }
 
       case TextureFilteringBilinear:
+        return sample_bilinear(texture_cache, 0, p);
+
+      case TextureFilteringTrilinear:
+        {
+            // Use the longest axis of the footprint, trading sharpness for the absence of aliasing.
+            const double width =
+                max(
+                    norm(transform_derivative(source_inputs.m_duvdx)),
+                    norm(transform_derivative(source_inputs.m_duvdy)));
+
+            return sample_trilinear(texture_cache, p, compute_lod(width));
+        }
+
+      case TextureFilteringFeline:
         {
-            p.x *= m_max_x;
-            p.y *= m_max_y;
-
-            const int ix = truncate<int>(p.x);
-            const int iy = truncate<int>(p.y);
-
-            // Retrieve the four surrounding texels.
-            Color4f t00, t10, t01, t11;
-            get_texels_2x2(
-                texture_cache,
-                ix, iy,
-                t00, t10, t01, t11);
-
-            // Compute weights.
-            const float wx1 = static_cast<float>(p.x - ix);
-            const float wy1 = static_cast<float>(p.y - iy);
-            const float wx0 = 1.0f - wx1;
-            const float wy0 = 1.0f - wy1;
-
-            // Apply weights.
-            t00 *= wx0 * wy0;
-            t10 *= wx1 * wy0;
-            t01 *= wx0 * wy1;
-            t11 *= wx1 * wy1;
-
-            // Accumulate.
-            t00 += t10;
-            t00 += t01;
-            t00 += t11;
-
-            return t00;
+            // Approximate the anisotropic footprint by a line of trilinear probes along
+            // its major axis, each probe filtering across the minor axis. Reference:
+            // http://www.hpl.hp.com/techreports/Compaq-DEC/WRL-99-1.pdf
+            const Vector2d dpdx = transform_derivative(source_inputs.m_duvdx);
+            const Vector2d dpdy = transform_derivative(source_inputs.m_duvdy);
+            const double dpdx_norm = norm(dpdx);
+            const double dpdy_norm = norm(dpdy);
+            const Vector2d& major_axis = dpdx_norm > dpdy_norm ? dpdx : dpdy;
+            const double major_norm = max(dpdx_norm, dpdy_norm);
+            const double minor_norm = min(dpdx_norm, dpdy_norm);
+
+            const size_t MaxProbeCount = 8;
+            const size_t probe_count =
+                major_norm <= 1.0 ? 1 :
+                minor_norm * MaxProbeCount <= major_norm ? MaxProbeCount :
+                static_cast<size_t>(ceil(major_norm / minor_norm));
+
+            const double lod = compute_lod(major_norm / probe_count);
+
+            if (probe_count == 1)
+                return sample_trilinear(texture_cache, p, lod);
+
+            // Major axis of the footprint in [0,1]^2 space.
+            const Vector2d axis(
+                major_axis.x / m_scalar_canvas_width,
+                major_axis.y / m_scalar_canvas_height);
+
+            Color4f result(0.0f);
+            float weight_sum = 0.0f;
+
+            for (size_t i = 0; i < probe_count; ++i)
+            {
+                // Evenly space the probes along the major axis and weight them with a Gaussian.
+                const double t = (i + 0.5) / probe_count - 0.5;
+                const float weight = static_cast<float>(exp(-8.0 * t * t));
+
+                Vector2d q = p + t * axis;
+                apply_addressing_mode(m_texture_instance.get_addressing_mode(), q);
+
+                Color4f probe = sample_trilinear(texture_cache, q, lod);
+                probe *= weight;
+
+                result += probe;
+                weight_sum += weight;
+            }
+
+            result *= 1.0f / weight_sum;
+
+            return result;
         }
 
       default:
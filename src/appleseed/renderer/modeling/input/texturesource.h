@@ -34,6 +34,7 @@
 #include "renderer/global/globaltypes.h"
 #include "renderer/modeling/input/inputformat.h"
 #include "renderer/modeling/input/source.h"
+#include "renderer/modeling/input/sourceinputs.h"
 #include "renderer/modeling/scene/textureinstance.h"
 
 // appleseed.foundation headers.
@@ -78,31 +79,36 @@ class TextureSource
     // Evaluate the source at a given shading point.
     virtual void evaluate(
         TextureCache&                       texture_cache,
-        const foundation::Vector2d&         uv,
+        const SourceInputs&                 source_inputs,
         double&                             scalar) const OVERRIDE;
     virtual void evaluate(
         TextureCache&                       texture_cache,
-        const foundation::Vector2d&         uv,
+        const SourceInputs&                 source_inputs,
         foundation::Color3f&                linear_rgb) const OVERRIDE;
     virtual void evaluate(
         TextureCache&                       texture_cache,
-        const foundation::Vector2d&         uv,
+        const SourceInputs&                 source_inputs,
         Spectrum&                           spectrum) const OVERRIDE;
     virtual void evaluate(
         TextureCache&                       texture_cache,
-        const foundation::Vector2d&         uv,
+        const SourceInputs&                 source_inputs,
         Alpha&                              alpha) const OVERRIDE;
     virtual void evaluate(
         TextureCache&                       texture_cache,
-        const foundation::Vector2d&         uv,
+        const SourceInputs&                 source_inputs,
         foundation::Color3f&                linear_rgb,
         Alpha&                              alpha) const OVERRIDE;
     virtual void evaluate(
         TextureCache&                       texture_cache,
-        const foundation::Vector2d&         uv,
+        const SourceInputs&                 source_inputs,
         Spectrum&                           spectrum,
         Alpha&                              alpha) const OVERRIDE;
 
+    // Prefetch the tile containing the texel that would be sampled at a given shading point.
+    virtual void prefetch(
+        TextureCache&                       texture_cache,
+        const SourceInputs&                 source_inputs) const OVERRIDE;
+
   private:
     const foundation::UniqueID              m_assembly_uid;
     const TextureInstance&                  m_texture_instance;
@@ -114,20 +120,26 @@ class TextureSource
     const double                            m_scalar_canvas_height;
     const double                            m_max_x;
     const double                            m_max_y;
+    const size_t                            m_level_count;
 
     // Apply the texture instance transform to UV coordinates.
     foundation::Vector2d apply_transform(
         const foundation::Vector2d&         uv) const;
 
-    // Retrieve a given texel. Return a color in the linear RGB color space.
+    // Apply the texture instance transform to a UV derivative and express it in texels of level 0.
+    foundation::Vector2d transform_derivative(
+        const foundation::Vector2d&         duv) const;
+
+    // Retrieve a given texel of level 0. Return a color in the linear RGB color space.
     foundation::Color4f get_texel(
         TextureCache&                       texture_cache,
         const size_t                        ix,
         const size_t                        iy) const;
 
-    // Retrieve a 2x2 block of texels. Texels are expressed in the linear RGB color space.
+    // Retrieve a 2x2 block of texels of a given level. Texels are expressed in the linear RGB color space.
     void get_texels_2x2(
         TextureCache&                       texture_cache,
+        const size_t                        level,
         const int                           ix,
         const int                           iy,
         foundation::Color4f&                t00,
@@ -135,10 +147,28 @@ class TextureSource
         foundation::Color4f&                t01,
         foundation::Color4f&                t11) const;
 
+    // Bilinearly sample a given level at a point in [0,1]^2. Return a color in the linear RGB color space.
+    foundation::Color4f sample_bilinear(
+        TextureCache&                       texture_cache,
+        const size_t                        level,
+        const foundation::Vector2d&         p) const;
+
+    // Sample the MIP pyramid at a fractional level of detail, blending the two nearest levels.
+    foundation::Color4f sample_trilinear(
+        TextureCache&                       texture_cache,
+        const foundation::Vector2d&         p,
+        const double                        lod) const;
+
+    // Return the level of detail matching a footprint of a given width, in texels of level 0.
+    double compute_lod(const double footprint_width) const;
+
+    // Return the (finest) MIP level sampled at a given shading point.
+    size_t select_level(const SourceInputs& source_inputs) const;
+
     // Sample the texture. Return a color in the linear RGB color space.
     foundation::Color4f sample_texture(
         TextureCache&                       texture_cache,
-        const foundation::Vector2d&         uv) const;
+        const SourceInputs&                 source_inputs) const;
 
     // Compute an alpha value given a linear RGBA color and the alpha mode of the texture instance.
     void evaluate_alpha(
@@ -158,30 +188,30 @@ inline const TextureInstance& TextureSource::get_texture_instance() const
 
 inline void TextureSource::evaluate(
     TextureCache&                           texture_cache,
-    const foundation::Vector2d&             uv,
+    const SourceInputs&                     source_inputs,
     double&                                 scalar) const
 {
-    const foundation::Color4f color = sample_texture(texture_cache, uv);
+    const foundation::Color4f color = sample_texture(texture_cache, source_inputs);
 
     scalar = static_cast<double>(color[0]);
 }
 
 inline void TextureSource::evaluate(
     TextureCache&                           texture_cache,
-    const foundation::Vector2d&             uv,
+    const SourceInputs&                     source_inputs,
     foundation::Color3f&                    linear_rgb) const
 {
-    const foundation::Color4f color = sample_texture(texture_cache, uv);
+    const foundation::Color4f color = sample_texture(texture_cache, source_inputs);
 
     linear_rgb = color.rgb();
 }
 
 inline void TextureSource::evaluate(
     TextureCache&                           texture_cache,
-    const foundation::Vector2d&             uv,
+    const SourceInputs&                     source_inputs,
     Spectrum&                               spectrum) const
 {
-    const foundation::Color4f color = sample_texture(texture_cache, uv);
+    const foundation::Color4f color = sample_texture(texture_cache, source_inputs);
 
     if (m_input_format == InputFormatSpectralReflectance ||
         m_input_format == InputFormatSpectralReflectanceWithAlpha)
@@ -191,21 +221,21 @@ inline void TextureSource::evaluate(
 
 inline void TextureSource::evaluate(
     TextureCache&                           texture_cache,
-    const foundation::Vector2d&             uv,
+    const SourceInputs&                     source_inputs,
     Alpha&                                  alpha) const
 {
-    const foundation::Color4f color = sample_texture(texture_cache, uv);
+    const foundation::Color4f color = sample_texture(texture_cache, source_inputs);
 
     evaluate_alpha(color, alpha);
 }
 
 inline void TextureSource::evaluate(
     TextureCache&                           texture_cache,
-    const foundation::Vector2d&             uv,
+    const SourceInputs&                     source_inputs,
     foundation::Color3f&                    linear_rgb,
     Alpha&                                  alpha) const
 {
-    const foundation::Color4f color = sample_texture(texture_cache, uv);
+    const foundation::Color4f color = sample_texture(texture_cache, source_inputs);
 
     linear_rgb = color.rgb();
 
@@ -214,11 +244,11 @@ inline void TextureSource::evaluate(
 
 inline void TextureSource::evaluate(
     TextureCache&                           texture_cache,
-    const foundation::Vector2d&             uv,
+    const SourceInputs&                     source_inputs,
     Spectrum&                               spectrum,
     Alpha&                                  alpha) const
 {
-    const foundation::Color4f color = sample_texture(texture_cache, uv);
+    const foundation::Color4f color = sample_texture(texture_cache, source_inputs);
 
     if (m_input_format == InputFormatSpectralReflectance ||
         m_input_format == InputFormatSpectralReflectanceWithAlpha)
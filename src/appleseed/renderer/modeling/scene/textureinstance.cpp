@@ -114,6 +114,10 @@ TextureInstance::TextureInstance(
         m_filtering_mode = TextureFilteringNearest;
     else if (filtering_mode == "bilinear")
         m_filtering_mode = TextureFilteringBilinear;
+    else if (filtering_mode == "trilinear")
+        m_filtering_mode = TextureFilteringTrilinear;
+    else if (filtering_mode == "anisotropic")
+        m_filtering_mode = TextureFilteringFeline;
     else
     {
         RENDERER_LOG_ERROR(
@@ -310,7 +314,9 @@ DictionaryArray TextureInstanceFactory::get_input_metadata()
             .insert("items",
                 Dictionary()
                     .insert("Nearest", "nearest")
-                    .insert("Bilinear", "bilinear"))
+                    .insert("Bilinear", "bilinear")
+                    .insert("Trilinear", "trilinear")
+                    .insert("Anisotropic", "anisotropic"))
             .insert("use", "required")
             .insert("default", "bilinear"));
 
@@ -72,6 +72,7 @@ enum TextureFilteringMode
 {
     TextureFilteringNearest,
     TextureFilteringBilinear,
+    TextureFilteringTrilinear,          // bilinear lookups in the two nearest MIP levels
     TextureFilteringBicubic,
     TextureFilteringFeline,             // Reference: http://www.hpl.hp.com/techreports/Compaq-DEC/WRL-99-1.pdf
     TextureFilteringEWA
@@ -157,7 +157,7 @@ namespace
             InputValues values;
             m_inputs.evaluate(
                 shading_context.get_texture_cache(),
-                shading_point.get_uv(0),
+                shading_point.get_source_inputs(0),
                 &values);
 
             Spectrum radiance;
@@ -41,15 +41,25 @@
 #include "foundation/image/colorspace.h"
 #include "foundation/image/genericprogressiveimagefilereader.h"
 #include "foundation/image/tile.h"
+#include "foundation/platform/system.h"
 #include "foundation/platform/thread.h"
 #include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/containers/specializedarrays.h"
 #include "foundation/utility/makevector.h"
 #include "foundation/utility/searchpaths.h"
+#include "foundation/utility/string.h"
+
+// boost headers.
+#include "boost/filesystem/path.hpp"
+#include "boost/thread/condition_variable.hpp"
 
 // Standard headers.
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -75,10 +85,18 @@ namespace
             const SearchPaths&  search_paths)
           : Texture(name, params)
           , m_reader(&global_logger())
+          , m_extra_reader_count(0)
+          , m_loaded_tile_count(0)
         {
             extract_parameters(search_paths);
         }
 
+        ~DiskTexture2d()
+        {
+            for (size_t i = 0; i < m_extra_readers.size(); ++i)
+                delete m_extra_readers[i];
+        }
+
         virtual void release() OVERRIDE
         {
             delete this;
@@ -105,9 +123,28 @@ namespace
             const size_t        tile_x,
             const size_t        tile_y) OVERRIDE
         {
-            boost::mutex::scoped_lock lock(m_mutex);
-            open_image_file();
-            return m_reader.read_tile(tile_x, tile_y);
+            if (!m_concurrent_reads)
+            {
+                boost::mutex::scoped_lock lock(m_mutex);
+                open_image_file();
+                return m_reader.read_tile(tile_x, tile_y);
+            }
+
+            // Use a reader of our own so that other tiles of this texture
+            // can be read and decoded by other threads at the same time.
+            GenericProgressiveImageFileReader* reader = acquire_reader();
+
+            try
+            {
+                Tile* tile = reader->read_tile(tile_x, tile_y);
+                release_reader(reader, true);
+                return tile;
+            }
+            catch (...)
+            {
+                release_reader(reader, false);
+                throw;
+            }
         }
 
         virtual void unload_tile(
@@ -116,16 +153,39 @@ namespace
             const Tile*         tile) OVERRIDE
         {
             delete tile;
+
+            if (m_concurrent_reads)
+            {
+                boost::mutex::scoped_lock lock(m_mutex);
+
+                // Once no tile of this texture is loaded anymore (the texture was entirely
+                // evicted, or the texture store is being destroyed at the end of a render),
+                // close the additional files since they may not be needed again.
+                assert(m_loaded_tile_count > 0);
+                if (--m_loaded_tile_count == 0)
+                    close_idle_extra_readers();
+            }
         }
 
       private:
         string                              m_filepath;
         ColorSpace                          m_color_space;
 
+        bool                                m_concurrent_reads;
+        size_t                              m_max_reader_count;
+
         mutable boost::mutex                m_mutex;
+        boost::condition_variable           m_reader_released;
         GenericProgressiveImageFileReader   m_reader;
         CanvasProperties                    m_props;
 
+        typedef vector<GenericProgressiveImageFileReader*> ReaderVector;
+
+        ReaderVector                        m_extra_readers;        // additional readers, owned by the texture
+        ReaderVector                        m_idle_readers;         // readers not currently reading a tile
+        size_t                              m_extra_reader_count;   // additional readers, including those being opened
+        size_t                              m_loaded_tile_count;    // tiles read by concurrent readers and not yet unloaded
+
         void extract_parameters(const SearchPaths& search_paths)
         {
             const EntityDefMessageContext message_context("texture", this);
@@ -145,6 +205,20 @@ namespace
             else if (color_space == "srgb")
                 m_color_space = ColorSpaceSRGB;
             else m_color_space = ColorSpaceCIEXYZ;
+
+            // OpenEXR files are read and decoded one tile at a time, so multiple readers
+            // can decode different tiles concurrently. Other formats are entirely decoded
+            // when the file is opened: additional readers would only duplicate the image.
+            const string extension = lower_case(boost::filesystem::path(m_filepath).extension().string());
+            m_concurrent_reads = extension == ".exr";
+
+            // Retrieve the maximum number of files open at the same time for concurrent reads.
+            m_max_reader_count =
+                max<size_t>(
+                    m_params.get_optional<size_t>(
+                        "max_concurrent_reads",
+                        System::get_logical_cpu_core_count()),
+                    1);
         }
 
         void open_image_file()
@@ -157,7 +231,88 @@ namespace
 
                 m_reader.open(m_filepath.c_str());
                 m_reader.read_canvas_properties(m_props);
+
+                if (m_concurrent_reads)
+                    m_idle_readers.push_back(&m_reader);
+            }
+        }
+
+        GenericProgressiveImageFileReader* acquire_reader()
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+
+            open_image_file();
+
+            // Wait for an idle reader if the maximum number of readers is reached.
+            while (m_idle_readers.empty() && 1 + m_extra_reader_count >= m_max_reader_count)
+                m_reader_released.wait(lock);
+
+            if (!m_idle_readers.empty())
+            {
+                GenericProgressiveImageFileReader* reader = m_idle_readers.back();
+                m_idle_readers.pop_back();
+                return reader;
+            }
+
+            // All readers are busy: open the file once more, without holding the lock.
+            ++m_extra_reader_count;
+            lock.unlock();
+
+            auto_ptr<GenericProgressiveImageFileReader> reader;
+
+            try
+            {
+                reader.reset(new GenericProgressiveImageFileReader(&global_logger()));
+                reader->open(m_filepath.c_str());
+            }
+            catch (...)
+            {
+                lock.lock();
+                --m_extra_reader_count;
+                m_reader_released.notify_one();
+                throw;
+            }
+
+            lock.lock();
+            m_extra_readers.push_back(reader.get());
+
+            return reader.release();
+        }
+
+        void release_reader(
+            GenericProgressiveImageFileReader*  reader,
+            const bool                          loaded_tile)
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+
+            if (loaded_tile)
+                ++m_loaded_tile_count;
+
+            m_idle_readers.push_back(reader);
+            m_reader_released.notify_one();
+        }
+
+        // Close the additional readers that are not reading a tile. Must be called with m_mutex locked.
+        void close_idle_extra_readers()
+        {
+            ReaderVector idle_readers;
+
+            for (size_t i = 0; i < m_idle_readers.size(); ++i)
+            {
+                GenericProgressiveImageFileReader* reader = m_idle_readers[i];
+
+                if (reader == &m_reader)
+                {
+                    idle_readers.push_back(reader);
+                    continue;
+                }
+
+                m_extra_readers.erase(find(m_extra_readers.begin(), m_extra_readers.end(), reader));
+                --m_extra_reader_count;
+                delete reader;
             }
+
+            m_idle_readers.swap(idle_readers);
         }
     };
 }
@@ -113,6 +113,14 @@ class DLLSYMBOL TransformSequence
     template <typename T>
     foundation::AABB<T, 3> to_parent(const foundation::AABB<T, 3>& bbox) const;
 
+    // Transform a 3D axis-aligned bounding box over the time interval [time_begin, time_end].
+    // If the bounding box is invalid, it is returned unmodified.
+    template <typename T>
+    foundation::AABB<T, 3> to_parent(
+        const foundation::AABB<T, 3>&   bbox,
+        const double                    time_begin,
+        const double                    time_end) const;
+
   private:
     struct TransformKey
     {
@@ -216,6 +224,47 @@ foundation::AABB<T, 3> TransformSequence::to_parent(const foundation::AABB<T, 3>
     return result;
 }
 
+template <typename T>
+foundation::AABB<T, 3> TransformSequence::to_parent(
+    const foundation::AABB<T, 3>&   bbox,
+    const double                    time_begin,
+    const double                    time_end) const
+{
+    assert(time_begin <= time_end);
+
+    if (m_size == 0 || !bbox.is_valid())
+        return bbox;
+
+    const foundation::AABB3d bbox_d(bbox);
+
+    foundation::AABB3d result;
+    result.invalidate();
+
+    // Between two key frames, the path over a subinterval is the interpolation
+    // between the transforms at the ends of the subinterval.
+    foundation::Transformd from = evaluate(time_begin);
+
+    for (size_t i = 0; i < m_size; ++i)
+    {
+        if (m_keys[i].m_time <= time_begin)
+            continue;
+
+        if (m_keys[i].m_time >= time_end)
+            break;
+
+        // Insert the bounding box of the path up to this key frame.
+        result.insert(compute_motion_segment_bbox(bbox_d, from, m_keys[i].m_transform));
+        from = m_keys[i].m_transform;
+    }
+
+    // Insert the bounding box of the path up to the end of the interval.
+    const foundation::Transformd to = evaluate(time_end);
+    result.insert(compute_motion_segment_bbox(bbox_d, from, to));
+    result.insert(to.to_parent(bbox_d));
+
+    return foundation::AABB<T, 3>(result);
+}
+
 }       // namespace renderer
 
 #endif  // !APPLESEED_RENDERER_UTILITY_TRANSFORMSEQUENCE_H